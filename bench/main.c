@@ -0,0 +1,698 @@
+/*
+ * polybuild_bench - synthetic workloads over the trie, DAG and
+ * integration hot paths, reported as one JSON document on stdout
+ *
+ * Every result carries ns/op, throughput, the allocations the library
+ * made while it ran and the process's peak RSS so far, so two runs can
+ * be diffed mechanically.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "polybuild/dag.h"
+#include "polybuild/dag_vote.h"
+#include "polybuild/trie.h"
+#include "polybuild/trie_dag.h"
+#include "polybuild/intent_dag_integration.h"
+#include "polybuild/trace.h"
+
+/*
+ * With POLYBUILD_BENCH_COUNT_ALLOCS the benchmark is linked against the
+ * static library with --wrap=malloc/calloc/realloc, so every allocation
+ * the library makes passes through these counters. Allocations made
+ * inside libc itself (strdup, regcomp) are not seen.
+ */
+static atomic_size_t bench_allocs;
+static atomic_size_t bench_alloc_bytes;
+
+#ifdef POLYBUILD_BENCH_COUNT_ALLOCS
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    atomic_fetch_add_explicit(&bench_allocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bench_alloc_bytes, size, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    atomic_fetch_add_explicit(&bench_allocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bench_alloc_bytes, count * size, memory_order_relaxed);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    atomic_fetch_add_explicit(&bench_allocs, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&bench_alloc_bytes, size, memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+#define BENCH_COUNTS_ALLOCS "true"
+#else
+#define BENCH_COUNTS_ALLOCS "false"
+#endif
+
+// Edges added per node of the synthetic graphs
+#define BENCH_EDGES_PER_NODE 3
+
+// In-edges per node of the dense graphs the vote kernels are timed on
+#define BENCH_DENSE_EDGES 256
+
+// Category and state queries timed per graph
+#define BENCH_QUERIES 1000
+
+// Threads appending to the concurrent builder
+#define BENCH_PRODUCERS 4
+
+/**
+ * Run-wide settings from the command line
+ */
+typedef struct BenchOptions {
+    size_t max_nodes;
+    size_t max_patterns;
+    size_t max_text;
+    size_t max_intents;
+    const char* filter;
+    const char* trace_path;
+    bool first_result;
+} BenchOptions;
+
+/**
+ * Clock and allocation counters at the start of a measurement
+ */
+typedef struct BenchTimer {
+    struct timespec start;
+    size_t allocs;
+    size_t alloc_bytes;
+} BenchTimer;
+
+/**
+ * Deterministic xorshift64 stream, wide enough for million-node graphs
+ */
+static uint64_t bench_random(uint64_t* state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static bool bench_selected(const BenchOptions* options, const char* name) {
+    return !options->filter || strstr(name, options->filter) != NULL;
+}
+
+static void bench_start(BenchTimer* timer) {
+    timer->allocs = atomic_load_explicit(&bench_allocs, memory_order_relaxed);
+    timer->alloc_bytes = atomic_load_explicit(&bench_alloc_bytes, memory_order_relaxed);
+    clock_gettime(CLOCK_MONOTONIC, &timer->start);
+}
+
+/**
+ * Emit one result; bytes is 0 for workloads not measured in bytes
+ */
+static void bench_stop(BenchOptions* options, const BenchTimer* timer, const char* name,
+                       size_t ops, size_t bytes) {
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ns = (double)(end.tv_sec - timer->start.tv_sec) * 1e9 +
+                (double)(end.tv_nsec - timer->start.tv_nsec);
+    double seconds = ns > 0 ? ns / 1e9 : 1e-9;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("%s\n    {\"name\": \"%s\", \"ops\": %zu, \"ns_per_op\": %.2f, \"ops_per_sec\": %.0f",
+           options->first_result ? "" : ",", name, ops, ops ? ns / (double)ops : 0.0,
+           (double)ops / seconds);
+    if (bytes > 0) {
+        printf(", \"mb_per_sec\": %.2f", (double)bytes / (1024.0 * 1024.0) / seconds);
+    }
+    printf(", \"allocs\": %zu, \"alloc_bytes\": %zu, \"peak_rss_kb\": %ld}",
+           atomic_load_explicit(&bench_allocs, memory_order_relaxed) - timer->allocs,
+           atomic_load_explicit(&bench_alloc_bytes, memory_order_relaxed) - timer->alloc_bytes,
+           usage.ru_maxrss);
+    fflush(stdout);
+    options->first_result = false;
+}
+
+// =============================================================================
+// DAG WORKLOADS
+// =============================================================================
+
+/**
+ * Add the edges of a random or layered DAG to nodes already in a graph
+ *
+ * Random graphs draw each source from all earlier nodes; layered graphs
+ * split the nodes into sqrt(n) layers and draw sources from the layer
+ * above, which gives deep, narrow levels for the resolvers.
+ */
+static size_t bench_add_edges(DAGGraph* graph, bool layered, uint64_t seed) {
+    size_t count = graph->node_count;
+    size_t width = layered ? (size_t)sqrt((double)count) : 0;
+    if (width == 0) {
+        width = 1;
+    }
+    size_t edges = 0;
+    for (size_t i = 1; i < count; i++) {
+        size_t begin = 0;
+        size_t span = i;
+        if (layered) {
+            if (i < width) {
+                continue;
+            }
+            begin = (i / width - 1) * width;
+            span = width;
+        }
+        for (size_t j = 0; j < BENCH_EDGES_PER_NODE; j++) {
+            size_t from = begin + bench_random(&seed) % span;
+            float weight = (float)((int)(bench_random(&seed) % 7) - 2);
+            dag_add_edge(graph->nodes[from], graph->nodes[i], weight);
+            edges++;
+        }
+    }
+    return edges;
+}
+
+static int bench_graph(BenchOptions* options, size_t count, bool layered) {
+    const char* shape = layered ? "layered" : "random";
+    char name[128];
+    BenchTimer timer;
+
+    DAGGraph* graph = dag_graph_create(count);
+    if (!graph) {
+        return -1;
+    }
+
+    bench_start(&timer);
+    for (size_t i = 0; i < count; i++) {
+        DAGNode* node = dag_node_create(TOKEN_IDENTIFIER, (TaxonomyCategory)(i % 5));
+        if (!node || dag_graph_add_node(graph, node) != 0) {
+            dag_node_free(node);
+            dag_graph_free_all(graph);
+            return -1;
+        }
+    }
+    snprintf(name, sizeof(name), "dag_node_create/%s/%zu", shape, count);
+    if (bench_selected(options, name)) {
+        bench_stop(options, &timer, name, count, 0);
+    }
+
+    bench_start(&timer);
+    size_t edges = bench_add_edges(graph, layered, 0x9e3779b97f4a7c15ull ^ count);
+    snprintf(name, sizeof(name), "dag_add_edge/%s/%zu", shape, count);
+    if (bench_selected(options, name)) {
+        bench_stop(options, &timer, name, edges, 0);
+    }
+
+    int result = 0;
+    snprintf(name, sizeof(name), "dag_resolve/%s/%zu", shape, count);
+    if (bench_selected(options, name)) {
+        bench_start(&timer);
+        result |= dag_resolve(graph->nodes, count);
+        bench_stop(options, &timer, name, count, 0);
+    }
+
+    // The first graph resolve also freezes the edges into CSR form
+    snprintf(name, sizeof(name), "dag_graph_resolve/%s/%zu", shape, count);
+    bench_start(&timer);
+    result |= dag_graph_resolve(graph);
+    if (bench_selected(options, name)) {
+        bench_stop(options, &timer, name, count, 0);
+    }
+
+    snprintf(name, sizeof(name), "dag_graph_resolve_parallel/%s/%zu", shape, count);
+    if (bench_selected(options, name)) {
+        bench_start(&timer);
+        result |= dag_graph_resolve_parallel(graph, 0);
+        bench_stop(options, &timer, name, count, 0);
+    }
+
+    // Index queries: live action nodes, as a dashboard would filter them
+    snprintf(name, sizeof(name), "dag_graph_select/%s/%zu", shape, count);
+    if (bench_selected(options, name)) {
+        DAGNodeSet* actions = dag_node_set_create(count);
+        DAGNodeSet* live = dag_node_set_create(count);
+        size_t found = 0;
+        result |= actions && live ? 0 : -1;
+        bench_start(&timer);
+        for (size_t q = 0; q < BENCH_QUERIES && result == 0; q++) {
+            result |= dag_graph_select_category(graph, TAX_ACTION, actions);
+            result |= dag_graph_select_state(graph, STATE_TRUE, live);
+            result |= dag_node_set_and(actions, live);
+            found += dag_node_set_count(actions);
+        }
+        if (result == 0) {
+            bench_stop(options, &timer, name, BENCH_QUERIES, 0);
+        }
+        result |= found > 0 ? 0 : -1;
+        dag_node_set_free(actions);
+        dag_node_set_free(live);
+    }
+
+    dag_graph_free_all(graph);
+    return result;
+}
+
+/**
+ * Resolve a graph whose nodes have hundreds of in-edges with each kernel
+ */
+static int bench_votes(BenchOptions* options, size_t count) {
+    char name[128];
+    BenchTimer timer;
+    uint64_t seed = 0x2545f4914f6cdd1dull ^ count;
+
+    DAGGraph* graph = dag_graph_create(count);
+    if (!graph) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        DAGNode* node = dag_node_create(TOKEN_IDENTIFIER, (TaxonomyCategory)(i % 5));
+        if (!node || dag_graph_add_node(graph, node) != 0) {
+            dag_node_free(node);
+            dag_graph_free_all(graph);
+            return -1;
+        }
+    }
+    for (size_t i = 1; i < count; i++) {
+        size_t edges = i < BENCH_DENSE_EDGES ? i : BENCH_DENSE_EDGES;
+        for (size_t j = 0; j < edges; j++) {
+            size_t from = bench_random(&seed) % i;
+            float weight = (float)((int)(bench_random(&seed) % 7) - 2);
+            dag_add_edge(graph->nodes[from], graph->nodes[i], weight);
+        }
+    }
+
+    DAGVoteKernel active = dag_vote_kernel();
+    int result = dag_graph_freeze(graph);
+    for (int k = 0; k < DAG_VOTE_KERNEL_COUNT && result == 0; k++) {
+        snprintf(name, sizeof(name), "dag_graph_resolve/dense/%zu/%s", count,
+                 dag_vote_kernel_name((DAGVoteKernel)k));
+        if (!bench_selected(options, name) || dag_vote_set_kernel((DAGVoteKernel)k) != 0) {
+            continue;
+        }
+        bench_start(&timer);
+        result |= dag_graph_resolve(graph);
+        bench_stop(options, &timer, name, count, 0);
+    }
+    dag_vote_set_kernel(active);
+
+    dag_graph_free_all(graph);
+    return result;
+}
+
+/**
+ * One producer's share of a random graph: the in-edges of a node slice
+ */
+typedef struct BenchProducer {
+    DAGBuilder* builder;
+    size_t count;
+    size_t begin;
+    size_t end;
+    int result;
+} BenchProducer;
+
+static void* bench_produce(void* arg) {
+    BenchProducer* task = (BenchProducer*)arg;
+    DAGProducer* producer = dag_builder_producer(task->builder);
+    uint64_t seed = 0x9e3779b97f4a7c15ull ^ task->count ^ task->begin;
+    task->result = producer ? 0 : -1;
+    for (size_t i = task->begin ? task->begin : 1; i < task->end && task->result == 0; i++) {
+        for (size_t j = 0; j < BENCH_EDGES_PER_NODE; j++) {
+            uint32_t from = (uint32_t)(bench_random(&seed) % i);
+            float weight = (float)((int)(bench_random(&seed) % 7) - 2);
+            task->result |= dag_producer_add_edge(producer, from, (uint32_t)i, weight);
+        }
+    }
+    return NULL;
+}
+
+static int bench_builder(BenchOptions* options, size_t count) {
+    char name[128];
+    BenchTimer timer;
+
+    DAGBuilder* builder = dag_builder_create();
+    DAGProducer* nodes = dag_builder_producer(builder);
+    if (!nodes) {
+        dag_builder_free(builder);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        dag_producer_add_node(nodes, TOKEN_IDENTIFIER, (TaxonomyCategory)(i % 5));
+    }
+
+    BenchProducer tasks[BENCH_PRODUCERS];
+    pthread_t threads[BENCH_PRODUCERS];
+    size_t started = 0;
+    int result = 0;
+    bench_start(&timer);
+    for (size_t t = 0; t < BENCH_PRODUCERS; t++) {
+        tasks[t] = (BenchProducer){ builder, count, count * t / BENCH_PRODUCERS,
+                                    count * (t + 1) / BENCH_PRODUCERS, 0 };
+        if (pthread_create(&threads[t], NULL, bench_produce, &tasks[t]) != 0) {
+            result = -1;
+            break;
+        }
+        started++;
+    }
+    for (size_t t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+        result |= tasks[t].result;
+    }
+    snprintf(name, sizeof(name), "dag_producer_add_edge/random/%zu", count);
+    if (result == 0 && bench_selected(options, name)) {
+        bench_stop(options, &timer, name, (count - 1) * BENCH_EDGES_PER_NODE, 0);
+    }
+
+    DAGGraph* graph = NULL;
+    if (result == 0) {
+        bench_start(&timer);
+        graph = dag_builder_finish(builder, 0);
+        snprintf(name, sizeof(name), "dag_builder_finish/random/%zu", count);
+        if (graph && bench_selected(options, name)) {
+            bench_stop(options, &timer, name, count, 0);
+        }
+        result = graph ? 0 : -1;
+    }
+
+    dag_graph_free_all(graph);
+    dag_builder_free(builder);
+    return result;
+}
+
+// =============================================================================
+// TRIE WORKLOADS
+// =============================================================================
+
+/**
+ * Fill a buffer with a random lowercase word of 6 to 12 letters
+ */
+static void bench_word(uint64_t* seed, char* word) {
+    size_t len = 6 + bench_random(seed) % 7;
+    for (size_t i = 0; i < len; i++) {
+        word[i] = (char)('a' + bench_random(seed) % 26);
+    }
+    word[len] = '\0';
+}
+
+static int bench_trie(BenchOptions* options, size_t count) {
+    char name[128];
+    BenchTimer timer;
+    uint64_t seed = 0x2545f4914f6cdd1dull ^ count;
+
+    char (*words)[16] = (char (*)[16])malloc(count * sizeof(*words));
+    TrieNode** nodes = (TrieNode**)malloc(count * sizeof(TrieNode*));
+    TrieNode* root = trie_node_create("root", TAX_UNKNOWN, 1.0f);
+    if (!words || !nodes || !root) {
+        free(words);
+        free(nodes);
+        trie_free(root);
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        bench_word(&seed, words[i]);
+    }
+
+    bench_start(&timer);
+    for (size_t i = 0; i < count; i++) {
+        trie_insert(root, words[i], (TaxonomyCategory)(1 + i % 4), 1.0f);
+    }
+    snprintf(name, sizeof(name), "trie_insert/%zu", count);
+    if (bench_selected(options, name)) {
+        bench_stop(options, &timer, name, count, 0);
+    }
+
+    int result = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!(nodes[i] = trie_lookup(root, words[i]))) {
+            result = -1;
+        }
+    }
+
+    // Alternate hits on the node's own pattern with misses on a neighbour's
+    snprintf(name, sizeof(name), "trie_match_node/%zu", count);
+    if (result == 0 && bench_selected(options, name)) {
+        size_t matched = 0;
+        bench_start(&timer);
+        for (size_t i = 0; i < count; i++) {
+            const char* text = words[i & 1 ? (i + 1) % count : i];
+            matched += trie_match_node(nodes[i], text, strlen(text));
+        }
+        bench_stop(options, &timer, name, count, 0);
+        result = matched >= count / 2 ? 0 : -1;
+    }
+
+    trie_free(root);
+    free(nodes);
+    free(words);
+    return result;
+}
+
+// =============================================================================
+// SCAN WORKLOADS
+// =============================================================================
+
+static const char* const bench_vocabulary[] = {
+    "build", "compile", "link", "test", "deploy", "lib", "src", "obj", "main", "target",
+    "Makefile", "Config", "x86", "arm64", "-O2", "4096", "config.h", "the", "and", "of"
+};
+
+#define BENCH_VOCABULARY_COUNT (sizeof(bench_vocabulary) / sizeof(bench_vocabulary[0]))
+
+/**
+ * Synthesize build-log-like text of exactly len bytes
+ */
+static char* bench_text(size_t len) {
+    char* text = (char*)malloc(len + 1);
+    if (!text) {
+        return NULL;
+    }
+    uint64_t seed = 0xd1b54a32d192ed03ull;
+    size_t used = 0;
+    while (used < len) {
+        const char* word = bench_vocabulary[bench_random(&seed) % BENCH_VOCABULARY_COUNT];
+        size_t word_len = strlen(word);
+        if (word_len > len - used) {
+            word_len = len - used;
+        }
+        memcpy(text + used, word, word_len);
+        used += word_len;
+        if (used < len) {
+            text[used++] = bench_random(&seed) % 8 == 0 ? '\n' : ' ';
+        }
+    }
+    text[len] = '\0';
+    return text;
+}
+
+static bool bench_count_match(const TrieDagMatch* match, void* ctx) {
+    (void)match;
+    (*(size_t*)ctx)++;
+    return true;
+}
+
+static int bench_scan(BenchOptions* options, TrieNode* root, size_t len) {
+    char name[128];
+    BenchTimer timer;
+    char* text = bench_text(len);
+    if (!text) {
+        return -1;
+    }
+
+    int result = 0;
+    snprintf(name, sizeof(name), "trie_dag_scan/%zuKB", len / 1024);
+    if (bench_selected(options, name)) {
+        size_t matches = 0;
+        bench_start(&timer);
+        result |= trie_dag_scan(root, text, len, bench_count_match, &matches) < 0 ? -1 : 0;
+        bench_stop(options, &timer, name, matches, len);
+    }
+
+    // One node per match, so the largest texts are left to the scan alone
+    snprintf(name, sizeof(name), "create_dag_from_trie_matches/%zuKB", len / 1024);
+    if (len <= 4u << 20 && bench_selected(options, name)) {
+        bench_start(&timer);
+        DAGNode** nodes = create_dag_from_trie_matches(root, text, len);
+        size_t count = 0;
+        while (nodes && nodes[count]) {
+            count++;
+        }
+        bench_stop(options, &timer, name, count, len);
+        result |= nodes ? 0 : -1;
+        trie_dag_free_matches(nodes);
+    }
+
+    free(text);
+    return result;
+}
+
+static TrieNode* bench_scan_rules(void) {
+    TrieNode* root = trie_node_create("root", TAX_UNKNOWN, 1.0f);
+    if (!root) {
+        return NULL;
+    }
+    trie_insert(root, "build", TAX_ACTION, 2.0f);
+    trie_insert(root, "compile", TAX_ACTION, 2.0f);
+    trie_insert(root, "link", TAX_ACTION, 2.0f);
+    trie_insert(root, "test", TAX_ACTION, 1.0f);
+    trie_insert(root, "lib", TAX_RESOURCE, 1.0f);
+    trie_insert(root, "src", TAX_RESOURCE, 1.0f);
+    trie_insert(root, "obj", TAX_RESOURCE, 1.0f);
+    trie_insert(root, "[0-9]+", TAX_PROPERTY, 1.0f);
+    trie_insert(root, "-O[0-3s]", TAX_PROPERTY, 1.0f);
+    trie_insert(root, "[A-Z][a-z]+", TAX_CONTROLLER, 1.0f);
+    return root;
+}
+
+// =============================================================================
+// INTENT WORKLOADS
+// =============================================================================
+
+static void bench_free_intents(IntentResolution** intents, size_t count) {
+    for (size_t i = 0; intents && i < count && intents[i]; i++) {
+        dag_node_free(intents[i]->dag_representation);
+        free_intent_resolution(intents[i]);
+    }
+    free(intents);
+}
+
+static int bench_intents(BenchOptions* options, size_t count, const char* model,
+                         const char* encoding) {
+    char name[128];
+    snprintf(name, sizeof(name), "apply_parallel_intent_processing/%s/%zu", model, count);
+    if (!bench_selected(options, name)) {
+        return 0;
+    }
+
+    IntentResolution** intents = (IntentResolution**)calloc(count, sizeof(IntentResolution*));
+    TopologyDecoding* topology = decode_topology_binary(encoding);
+    int result = intents && topology ? 0 : -1;
+    for (size_t i = 0; i < count && result == 0; i++) {
+        char expression[64];
+        snprintf(expression, sizeof(expression), "%s %s b%zu",
+                 intent_verb_to_string((IntentVerb)(i % 9)),
+                 intent_noun_to_string((IntentNoun)(i % 8)), i);
+        intents[i] = (IntentResolution*)calloc(1, sizeof(IntentResolution));
+        if (!intents[i] || !(intents[i]->semantic_context = strdup(expression))) {
+            result = -1;
+        }
+    }
+
+    if (result == 0) {
+        BenchTimer timer;
+        bench_start(&timer);
+        result = apply_parallel_intent_processing(intents, count, topology);
+        bench_stop(options, &timer, name, count, 0);
+    }
+
+    free_topology_decoding(topology);
+    bench_free_intents(intents, count);
+    return result;
+}
+
+// =============================================================================
+// DRIVER
+// =============================================================================
+
+static void bench_usage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--quick] [--max-nodes N] [--max-patterns N] [--max-text BYTES]\n"
+            "          [--max-intents N] [--filter SUBSTRING] [--trace FILE]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = { 1000000, 100000, 16u << 20, 100000, NULL, NULL, true };
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--quick") == 0) {
+            options.max_nodes = 10000;
+            options.max_patterns = 10000;
+            options.max_text = 1u << 20;
+            options.max_intents = 10000;
+        } else if (strcmp(arg, "--max-nodes") == 0 && value) {
+            options.max_nodes = strtoull(value, NULL, 10);
+            i++;
+        } else if (strcmp(arg, "--max-patterns") == 0 && value) {
+            options.max_patterns = strtoull(value, NULL, 10);
+            i++;
+        } else if (strcmp(arg, "--max-text") == 0 && value) {
+            options.max_text = strtoull(value, NULL, 10);
+            i++;
+        } else if (strcmp(arg, "--max-intents") == 0 && value) {
+            options.max_intents = strtoull(value, NULL, 10);
+            i++;
+        } else if (strcmp(arg, "--filter") == 0 && value) {
+            options.filter = value;
+            i++;
+        } else if (strcmp(arg, "--trace") == 0 && value) {
+            options.trace_path = value;
+            i++;
+        } else {
+            bench_usage(argv[0]);
+            return 2;
+        }
+    }
+
+    printf("{\n  \"suite\": \"polybuild_bench\",\n  \"allocations_counted\": %s,\n"
+           "  \"tracing\": %s,\n  \"results\": [",
+           BENCH_COUNTS_ALLOCS, options.trace_path ? "true" : "false");
+
+    // Record the whole run; spans only exist in POLYBUILD_TRACE builds
+    if (options.trace_path) {
+        trace_start();
+    }
+
+    int result = 0;
+    for (size_t count = 1000; count <= options.max_nodes && result == 0; count *= 10) {
+        result = bench_graph(&options, count, false);
+        if (result == 0) {
+            result = bench_graph(&options, count, true);
+        }
+        if (result == 0) {
+            result = bench_builder(&options, count);
+        }
+        if (result == 0 && count * 100 <= options.max_nodes) {
+            result = bench_votes(&options, count);
+        }
+    }
+
+    for (size_t count = 10000; count <= options.max_patterns && result == 0; count *= 10) {
+        result = bench_trie(&options, count);
+    }
+
+    TrieNode* rules = bench_scan_rules();
+    result |= rules ? 0 : -1;
+    for (size_t len = 1u << 20; len <= options.max_text && result == 0; len *= 4) {
+        result = bench_scan(&options, rules, len);
+    }
+    trie_free(rules);
+
+    // Concurrency model is bits 5-6 of the encoding
+    const char* models[][2] = {
+        { "sequential", "0000000" }, { "parallel", "0000001" }, { "pipeline", "0000010" }
+    };
+    for (size_t m = 0; m < 3 && result == 0; m++) {
+        result = bench_intents(&options, options.max_intents, models[m][0], models[m][1]);
+    }
+
+    printf("\n  ]\n}\n");
+    if (options.trace_path) {
+        trace_stop();
+        if (trace_export_chrome(options.trace_path) != 0) {
+            fprintf(stderr, "polybuild_bench: cannot write %s\n", options.trace_path);
+            result = -1;
+        }
+    }
+    if (result != 0) {
+        fprintf(stderr, "polybuild_bench: a workload failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -10,6 +10,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include "taxonomy.h"
+#include "arena.h"
+#include "thread_pool.h"
 
 /**
  * @brief Token type enumeration for DAG nodes
@@ -22,17 +25,6 @@ typedef enum {
     TOKEN_OPERATOR
 } TokenType;
 
-/**
- * @brief Taxonomy category for DAG node classification
- */
-typedef enum {
-    TAX_UNKNOWN,
-    TAX_ACTION,
-    TAX_RESOURCE,
-    TAX_PROPERTY,
-    TAX_CONTROLLER
-} TaxonomyCategory;
-
 /**
  * @brief Node state enumeration
  */
@@ -44,6 +36,9 @@ typedef enum {
 
 /**
  * @brief Edge representation for DAG connections
+ *
+ * For outgoing edges @c target is the destination node; for incoming
+ * edges it is the source node.
  */
 typedef struct DAGEdge {
     struct DAGNode* target;
@@ -52,6 +47,9 @@ typedef struct DAGEdge {
 
 /**
  * @brief Node representation for DAG structure
+ *
+ * Edge lists are contiguous, geometrically grown arrays; they are the
+ * building front end and get frozen into CSR form by a DAGGraph.
  */
 typedef struct DAGNode {
     TokenType type;
@@ -61,8 +59,54 @@ typedef struct DAGNode {
     DAGEdge* out_edges;
     size_t in_count;
     size_t out_count;
+    size_t in_capacity;
+    size_t out_capacity;
+    size_t index;               // Dense position in the owning graph
+    struct DAGGraph* graph;     // Owning graph, NULL if not added to one
+    const PolyAllocator* allocator;
 } DAGNode;
 
+/**
+ * @brief Graph container with compressed-sparse-row edge storage
+ *
+ * Nodes are held in one dense array where nodes[i]->index == i. Freezing
+ * copies the per-node edge lists into structure-of-arrays CSR form so
+ * resolution walks sequential memory. Edges to nodes outside the graph
+ * are not part of the frozen form. All CSR arrays share one allocation.
+ */
+typedef struct DAGGraph {
+    const PolyAllocator* allocator;
+    DAGNode** nodes;
+    size_t node_count;
+    size_t node_capacity;
+    size_t edge_count;
+    bool frozen;                // CSR arrays match the node edge lists
+    uint32_t* out_offsets;      // node_count + 1 entries
+    uint32_t* out_targets;      // edge_count entries
+    float* out_weights;
+    uint32_t* in_offsets;       // node_count + 1 entries
+    uint32_t* in_sources;       // edge_count entries
+    float* in_weights;
+    uint8_t* states;            // Resolved NodeState per node
+    uint32_t* topo_rank;        // Topological rank from the last resolve
+    void* csr_block;            // Backing storage of the arrays above
+    size_t csr_size;
+    bool resolved;              // States and ranks match the frozen edges
+    struct DAGDirtySet* dirty;  // Pending incremental work, if any
+    struct DAGNodeIndex* index; // Category, type and state bitsets, once queried
+} DAGGraph;
+
+/**
+ * @brief Set of node indices of one graph, one bit per node
+ *
+ * Sets filled by the dag_graph_select_*() queries must be sized for the
+ * graph's node count; sets of the same size combine word by word.
+ */
+typedef struct DAGNodeSet {
+    uint64_t* words;
+    size_t node_count;          // Indices the set can hold
+} DAGNodeSet;
+
 /**
  * @brief Initialize the DAG subsystem
  * @return 0 on success, non-zero on failure
@@ -77,6 +121,29 @@ int dag_init(void);
  */
 DAGNode* dag_node_create(TokenType t, TaxonomyCategory cat);
 
+/**
+ * @brief Create a new DAG node drawing from an allocator
+ *
+ * The node's edge lists are grown through the same allocator.
+ *
+ * @param allocator Allocator to draw from (NULL for the default)
+ * @param t Token type for the node
+ * @param cat Taxonomy category for the node
+ * @return Pointer to the newly created node or NULL on failure
+ */
+DAGNode* dag_node_create_in(const PolyAllocator* allocator,
+                            TokenType t, TaxonomyCategory cat);
+
+/**
+ * @brief Free a node and its edge lists
+ *
+ * Edges of other nodes pointing at it are left dangling, so free whole
+ * graphs at once. A no-op for arena memory beyond detaching the lists.
+ *
+ * @param node Node to free
+ */
+void dag_node_free(DAGNode* node);
+
 /**
  * @brief Add an edge between two nodes
  * @param from Source node
@@ -87,9 +154,383 @@ void dag_add_edge(DAGNode *from, DAGNode *to, float weight);
 
 /**
  * @brief Resolve node states through the graph
- * @param nodes Array of nodes to resolve
+ *
+ * Runs a single Kahn-style topological pass in O(V+E). Each node is given
+ * its dense index in @p nodes, so only edges between nodes of the array
+ * take part in resolution. Nodes without incoming edges resolve to
+ * STATE_TRUE; every other node takes the weighted vote of its sources.
+ *
+ * @param nodes Array of distinct nodes to resolve
  * @param node_count Number of nodes in the array
+ * @return 0 on success, -1 if a cycle (or allocation failure) prevented
+ *         full resolution; nodes on a cycle are left STATE_UNKNOWN
+ */
+int dag_resolve(DAGNode *nodes[], size_t node_count);
+
+/**
+ * @brief Create an empty graph container
+ * @param node_hint Expected number of nodes (0 if unknown)
+ * @return Pointer to the new graph or NULL on failure
+ */
+DAGGraph* dag_graph_create(size_t node_hint);
+
+/**
+ * @brief Create an empty graph container drawing from an allocator
+ * @param allocator Allocator for the node array and CSR storage
+ *        (NULL for the default)
+ * @param node_hint Expected number of nodes (0 if unknown)
+ * @return Pointer to the new graph or NULL on failure
+ */
+DAGGraph* dag_graph_create_in(const PolyAllocator* allocator, size_t node_hint);
+
+/**
+ * @brief Make room for a number of nodes in total
+ *
+ * After a successful call, dag_graph_add_node() cannot fail for lack of
+ * memory until the graph holds @p node_count nodes.
+ *
+ * @param graph Graph to grow
+ * @param node_count Total number of nodes to make room for
+ * @return 0 on success, -1 on failure (the graph is unchanged)
+ */
+int dag_graph_reserve(DAGGraph* graph, size_t node_count);
+
+/**
+ * @brief Add a node to the graph and assign its dense index
+ * @param graph Graph to extend
+ * @param node Node not yet owned by any graph
+ * @return 0 on success, -1 on failure
+ */
+int dag_graph_add_node(DAGGraph* graph, DAGNode* node);
+
+/**
+ * @brief Freeze node edge lists into the CSR arrays
+ * @param graph Graph to freeze
+ * @return 0 on success, -1 on failure
+ */
+int dag_graph_freeze(DAGGraph* graph);
+
+/**
+ * @brief Resolve node states over the frozen CSR edges
+ *
+ * Freezes the graph first if edges were added since the last freeze.
+ * Uses the same rules as dag_resolve().
+ *
+ * @param graph Graph to resolve
+ * @return 0 on success, -1 on cycle or allocation failure
+ */
+int dag_graph_resolve(DAGGraph* graph);
+
+/**
+ * @brief Resolve node states level by level on a pool of threads
+ *
+ * Nodes are released into the next topological level through atomic
+ * in-degree counters, and every level is resolved concurrently. Each
+ * node sums its incoming edges in the same order as dag_graph_resolve(),
+ * so the results are identical to the sequential resolver.
+ *
+ * @param graph Graph to resolve
+ * @param thread_count Worker threads (0 for one per CPU, 1 for sequential)
+ * @return 0 on success, -1 on cycle or allocation failure
+ */
+int dag_graph_resolve_parallel(DAGGraph* graph, size_t thread_count);
+
+/**
+ * @brief Resolve node states level by level on a caller-owned pool
+ *
+ * Same as dag_graph_resolve_parallel(), without creating and joining
+ * threads on every call; repeated resolves can share one pool. Resolves
+ * on several threads sharing a pool take turns on it, see
+ * thread_pool_parallel_for().
+ *
+ * @param graph Graph to resolve
+ * @param pool Pool to run on (NULL or a one-worker pool resolves sequentially)
+ * @return 0 on success, -1 on cycle or allocation failure
+ */
+int dag_graph_resolve_parallel_on(DAGGraph* graph, ThreadPool* pool);
+
+/**
+ * @brief Record that a node's state was changed by the caller
+ *
+ * Copies @c node->state into the graph and queues the node's successors
+ * for the next dag_graph_resolve_dirty() call. The node itself keeps the
+ * state it was given, also when that call falls back to a full resolve
+ * after a structural change; an explicit full resolve in between
+ * recomputes it.
+ *
+ * @param graph Graph owning the node
+ * @param node Node whose state changed
+ * @return 0 on success, -1 on failure
+ */
+int dag_graph_mark_dirty(DAGGraph* graph, DAGNode* node);
+
+/**
+ * @brief Change the weight of an existing edge without re-freezing
+ *
+ * Updates the node edge lists and the CSR arrays in place and queues
+ * @p to for the next dag_graph_resolve_dirty() call.
+ *
+ * @param graph Graph owning both nodes
+ * @param from Source node
+ * @param to Target node
+ * @param weight New edge weight
+ * @return 0 on success, -1 if no such edge exists
+ */
+int dag_graph_set_edge_weight(DAGGraph* graph, DAGNode* from, DAGNode* to,
+                              float weight);
+
+/**
+ * @brief Re-propagate states through the downstream cone of dirty nodes
+ *
+ * Queued nodes are recomputed in topological order, and propagation
+ * stops at nodes whose resolved state does not change, so the cost is
+ * proportional to the affected subgraph. Falls back to a full resolve
+ * when the graph was never resolved or edges were added since.
+ *
+ * @param graph Graph to update
+ * @return Number of nodes whose state changed, or -1 on failure
+ */
+long dag_graph_resolve_dirty(DAGGraph* graph);
+
+/**
+ * @brief Free the graph container
+ *
+ * The nodes themselves are not freed; they are detached from the graph.
+ *
+ * @param graph Graph to free
+ */
+void dag_graph_free(DAGGraph* graph);
+
+/**
+ * @brief Free the graph container together with all of its nodes
+ *
+ * Graphs built entirely in a PolyArena can instead be released in O(1)
+ * by resetting or destroying the arena.
+ *
+ * @param graph Graph to free
+ */
+void dag_graph_free_all(DAGGraph* graph);
+
+/**
+ * @brief Create an empty node set
+ * @param node_count Number of node indices the set can hold
+ * @return Pointer to the new set or NULL on failure
+ */
+DAGNodeSet* dag_node_set_create(size_t node_count);
+
+/**
+ * @brief Free a node set
+ * @param set Set to free
+ */
+void dag_node_set_free(DAGNodeSet* set);
+
+/**
+ * @brief Add a node index to a set
+ * @param set Set to add to
+ * @param node Node index
+ * @return 0 on success, -1 if the index is out of range
+ */
+int dag_node_set_add(DAGNodeSet* set, size_t node);
+
+/**
+ * @brief Check whether a set holds a node index
+ * @param set Set to check
+ * @param node Node index
+ * @return true if the index is in the set
+ */
+bool dag_node_set_contains(const DAGNodeSet* set, size_t node);
+
+/**
+ * @brief Count the indices in a set
+ * @param set Set to count
+ * @return Number of indices
+ */
+size_t dag_node_set_count(const DAGNodeSet* set);
+
+/**
+ * @brief Find the first index in a set at or after a position
+ *
+ * Iterate with: for (i = dag_node_set_next(s, 0); i < s->node_count;
+ * i = dag_node_set_next(s, i + 1)).
+ *
+ * @param set Set to search
+ * @param from First index to consider
+ * @return Next index in the set, or set->node_count if there is none
+ */
+size_t dag_node_set_next(const DAGNodeSet* set, size_t from);
+
+/**
+ * @brief Keep only the indices also in another set
+ * @param set Set to update
+ * @param other Set of the same size
+ * @return 0 on success, -1 if the sizes differ
+ */
+int dag_node_set_and(DAGNodeSet* set, const DAGNodeSet* other);
+
+/**
+ * @brief Add every index of another set
+ * @param set Set to update
+ * @param other Set of the same size
+ * @return 0 on success, -1 if the sizes differ
+ */
+int dag_node_set_or(DAGNodeSet* set, const DAGNodeSet* other);
+
+/**
+ * @brief Remove every index of another set
+ * @param set Set to update
+ * @param other Set of the same size
+ * @return 0 on success, -1 if the sizes differ
+ */
+int dag_node_set_and_not(DAGNodeSet* set, const DAGNodeSet* other);
+
+/**
+ * @brief Select the nodes of a taxonomy category
+ *
+ * The first query builds per-category, per-type and per-state bitsets
+ * in O(V); dag_graph_add_node() keeps them current, so later queries
+ * cost one copy of V/64 words.
+ *
+ * @param graph Graph to query
+ * @param category Category to select
+ * @param out Set sized for the graph's node count, overwritten
+ * @return 0 on success, -1 on failure or an unknown category
+ */
+int dag_graph_select_category(DAGGraph* graph, TaxonomyCategory category, DAGNodeSet* out);
+
+/**
+ * @brief Select the nodes of a token type
+ * @param graph Graph to query
+ * @param type Token type to select
+ * @param out Set sized for the graph's node count, overwritten
+ * @return 0 on success, -1 on failure or an unknown type
+ */
+int dag_graph_select_type(DAGGraph* graph, TokenType type, DAGNodeSet* out);
+
+/**
+ * @brief Select the nodes in a state
+ *
+ * State bitsets are rebuilt on the first query after each resolve or
+ * execution of the graph; states written to nodes directly are seen
+ * after dag_graph_mark_dirty(), dag_graph_states_changed() or the next
+ * resolve.
+ *
+ * @param graph Graph to query
+ * @param state State to select
+ * @param out Set sized for the graph's node count, overwritten
+ * @return 0 on success, -1 on failure
+ */
+int dag_graph_select_state(DAGGraph* graph, NodeState state, DAGNodeSet* out);
+
+/**
+ * @brief Note that node states were written outside the resolvers
+ *
+ * Copies every node's state into the graph's dense state array, so the
+ * next dag_graph_resolve_dirty() votes from them, and marks the index's
+ * state bitsets stale so the next state query rebuilds them.
+ *
+ * @param graph Graph whose states changed
+ */
+void dag_graph_states_changed(DAGGraph* graph);
+
+/**
+ * @brief Select every node reachable from a set of nodes
+ *
+ * Freezes the graph if needed and walks the CSR out-edges. The seeds
+ * themselves are part of the result; @p out may be @p from.
+ *
+ * @param graph Graph to query
+ * @param from Seed nodes
+ * @param out Set sized for the graph's node count, overwritten
+ * @return 0 on success, -1 on failure
+ */
+int dag_graph_select_reachable(DAGGraph* graph, const DAGNodeSet* from, DAGNodeSet* out);
+
+/**
+ * @brief Concurrent graph builder
+ *
+ * Producer threads append nodes and edges to their own chunked logs
+ * without locks; dag_builder_finish() compacts every log into a frozen
+ * graph in one pass.
+ */
+typedef struct DAGBuilder DAGBuilder;
+
+/**
+ * @brief Append handle of one producer thread
+ */
+typedef struct DAGProducer DAGProducer;
+
+// Node index returned when a producer could not record a node
+#define DAG_BUILDER_NONE UINT32_MAX
+
+/**
+ * @brief Create an empty concurrent builder
+ * @return Pointer to the new builder or NULL on failure
+ */
+DAGBuilder* dag_builder_create(void);
+
+/**
+ * @brief Register a producer with a builder
+ *
+ * Safe to call from any thread. Each producer must be used by one
+ * thread at a time; it stays owned by the builder.
+ *
+ * @param builder Builder to produce into
+ * @return Producer handle or NULL on failure
+ */
+DAGProducer* dag_builder_producer(DAGBuilder* builder);
+
+/**
+ * @brief Append a node
+ * @param producer Calling thread's producer
+ * @param type Token type for the node
+ * @param category Taxonomy category for the node
+ * @return Index of the node in the finished graph, DAG_BUILDER_NONE on failure
+ */
+uint32_t dag_producer_add_node(DAGProducer* producer, TokenType type,
+                               TaxonomyCategory category);
+
+/**
+ * @brief Append an edge between two node indices
+ *
+ * The endpoints may come from any producer and need not exist yet;
+ * they are checked when the builder is finished.
+ *
+ * @param producer Calling thread's producer
+ * @param from Index of the source node
+ * @param to Index of the target node
+ * @param weight Edge weight
+ * @return 0 on success, -1 on failure
+ */
+int dag_producer_add_edge(DAGProducer* producer, uint32_t from, uint32_t to, float weight);
+
+/**
+ * @brief Compact all producer logs into a frozen graph
+ *
+ * Call once every producer has stopped appending. Each node's edges are
+ * ordered by neighbour index and weight, so the result does not depend
+ * on how appends interleaved. The builder can be freed afterwards.
+ *
+ * @param builder Builder to finish
+ * @param thread_count Workers to compact with (0 for one per CPU)
+ * @return Frozen graph owning its nodes, NULL on failure or an edge to an unknown node
+ */
+DAGGraph* dag_builder_finish(DAGBuilder* builder, size_t thread_count);
+
+/**
+ * @brief Compact all producer logs into a frozen graph on a caller-owned pool
+ *
+ * Callers sharing the pool take turns on it, see thread_pool_parallel_for().
+ *
+ * @param builder Builder to finish
+ * @param pool Pool to compact on (NULL compacts on the caller)
+ * @return Frozen graph owning its nodes, NULL on failure or an edge to an unknown node
+ */
+DAGGraph* dag_builder_finish_on(DAGBuilder* builder, ThreadPool* pool);
+
+/**
+ * @brief Free a builder and all of its producers
+ * @param builder Builder to free
  */
-void dag_resolve(DAGNode *nodes[], size_t node_count);
+void dag_builder_free(DAGBuilder* builder);
 
 #endif /* POLYBUILD_DAG_H */
@@ -0,0 +1,88 @@
+/**
+ * @file dag_vote.h
+ * @brief Vectorized weighted-vote kernels for node state resolution
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_DAG_VOTE_H
+#define POLYBUILD_DAG_VOTE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "dag.h"
+
+/**
+ * @brief Implementations of the vote over a node's incoming edges
+ *
+ * The vector kernels gather the source states of several in-edges at a
+ * time from the frozen CSR rows and keep per-lane true and false sums.
+ * All kernels, the scalar one included, add the weights in the same
+ * eight-lane order, so a graph resolves to the same states whichever
+ * kernel the host picks, near ties included.
+ */
+typedef enum {
+    DAG_VOTE_SCALAR,
+    DAG_VOTE_SSE2,
+    DAG_VOTE_AVX2,
+    DAG_VOTE_KERNEL_COUNT
+} DAGVoteKernel;
+
+/**
+ * @brief Get the kernel the resolvers use
+ *
+ * The first call picks the widest kernel the CPU supports.
+ *
+ * @return Active kernel
+ */
+DAGVoteKernel dag_vote_kernel(void);
+
+/**
+ * @brief Check whether a kernel can run on this CPU
+ * @param kernel Kernel to check
+ * @return true if it is compiled in and the CPU supports it
+ */
+bool dag_vote_kernel_supported(DAGVoteKernel kernel);
+
+/**
+ * @brief Make the resolvers use a given kernel
+ *
+ * Meant for tests and benchmarks; do not switch while a resolve runs.
+ *
+ * @param kernel Kernel to use
+ * @return 0 on success, -1 if the kernel is not supported
+ */
+int dag_vote_set_kernel(DAGVoteKernel kernel);
+
+/**
+ * @brief Get the name of a kernel
+ * @param kernel Kernel to name
+ * @return Static name, "unknown" if out of range
+ */
+const char *dag_vote_kernel_name(DAGVoteKernel kernel);
+
+/**
+ * @brief Resolve one node of a frozen graph from its sources' states
+ *
+ * Nodes without incoming edges resolve to STATE_TRUE; others to the
+ * side with the greater weight, or STATE_UNKNOWN on a tie.
+ *
+ * @param graph Frozen graph
+ * @param node Index of the node
+ * @return Resolved state
+ */
+NodeState dag_vote_node(const DAGGraph *graph, uint32_t node);
+
+/**
+ * @brief Resolve a batch of nodes, writing their states
+ *
+ * Every source of a node in the batch must already be resolved and
+ * must not itself be in the batch, as holds for a topological level.
+ *
+ * @param graph Frozen graph
+ * @param nodes Indices of the nodes to resolve
+ * @param count Number of nodes
+ */
+void dag_vote_resolve(DAGGraph *graph, const uint32_t *nodes, size_t count);
+
+#endif /* POLYBUILD_DAG_VOTE_H */
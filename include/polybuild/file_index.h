@@ -0,0 +1,82 @@
+/**
+ * @file file_index.h
+ * @brief Persistent file stat and content hash index for up-to-date checks
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_FILE_INDEX_H
+#define POLYBUILD_FILE_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "sha256.h"
+
+/**
+ * @brief Index of (mtime, size, inode, content digest) per path
+ *
+ * The index file is a path-sorted record table plus a string pool. It is
+ * memory-mapped on open and searched in place, so loading it costs one
+ * mmap whatever its size. Files whose stat tuple still matches their
+ * record are not read again; only changed files are rehashed. Records
+ * written while a file could still change within the same timestamp
+ * tick are rehashed on the next run to stay safe.
+ *
+ * The file is written in host byte order and is not shared between
+ * machines of different endianness.
+ */
+typedef struct FileIndex FileIndex;
+
+/**
+ * @brief Open an index file
+ * @param path Index file (an empty index if it does not exist or is
+ *        not a valid index)
+ * @return Pointer to the index or NULL on failure
+ */
+FileIndex* file_index_open(const char* path);
+
+/**
+ * @brief Get the content digest of a file, rehashing only if needed
+ * @param index Index to consult and update
+ * @param path File to check
+ * @param digest Receives the content digest
+ * @param changed Receives whether the contents differ from the recorded
+ *        ones (true for files not yet indexed); may be NULL
+ * @return 0 on success, -1 if the file cannot be read (its record is
+ *         dropped on the next save)
+ */
+int file_index_check(FileIndex* index, const char* path,
+                     uint8_t digest[SHA256_DIGEST_SIZE], bool* changed);
+
+/**
+ * @brief Get the number of files hashed since the index was opened
+ * @param index Index to inspect
+ * @return Number of files whose contents were read
+ */
+size_t file_index_rehash_count(const FileIndex* index);
+
+/**
+ * @brief Get the number of files recorded in the index
+ * @param index Index to inspect
+ * @return Number of live records, including unsaved ones
+ */
+size_t file_index_count(const FileIndex* index);
+
+/**
+ * @brief Write the index back to the file it was opened from
+ *
+ * The new file replaces the old one atomically and is mapped in its
+ * place.
+ *
+ * @param index Index to save
+ * @return 0 on success, -1 on failure
+ */
+int file_index_save(FileIndex* index);
+
+/**
+ * @brief Unmap and free an index without saving
+ * @param index Index to close
+ */
+void file_index_close(FileIndex* index);
+
+#endif /* POLYBUILD_FILE_INDEX_H */
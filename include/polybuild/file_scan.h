@@ -0,0 +1,121 @@
+/**
+ * @file file_scan.h
+ * @brief Memory-mapped file and directory scanning front end
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_FILE_SCAN_H
+#define POLYBUILD_FILE_SCAN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "trie_dag.h"
+#include "thread_pool.h"
+
+/**
+ * @brief Read-only view of a whole file
+ */
+typedef struct FileScanMapping {
+    const char* data;           // Mapped bytes, NULL for an empty file
+    size_t size;                // File size in bytes
+} FileScanMapping;
+
+/**
+ * @brief Decide whether a path of a tree walk is scanned or descended
+ * @param path Path of the entry, starting with the walk root
+ * @param is_dir True for directories
+ * @param ctx Caller context
+ * @return true to scan the file or enter the directory, false to skip it
+ */
+typedef bool (*FileScanFilterFn)(const char* path, bool is_dir, void* ctx);
+
+/**
+ * @brief Options of a tree walk
+ */
+typedef struct FileScanOptions {
+    FileScanFilterFn filter;    // NULL scans every regular file
+    void* filter_ctx;           // Context passed to the filter
+} FileScanOptions;
+
+/**
+ * @brief One input of a batch scan: an in-memory buffer or a file
+ */
+typedef struct FileScanInput {
+    const char* path;           // File to map when text is NULL
+    const char* text;           // Buffer to scan, or NULL
+    size_t len;                 // Buffer length
+} FileScanInput;
+
+/**
+ * @brief Map a file read-only with a sequential access hint
+ *
+ * The pages are file-backed and clean, so the kernel can drop them under
+ * memory pressure; nothing is copied onto the heap.
+ *
+ * @param path File to map
+ * @param mapping Receives the view
+ * @return 0 on success, -1 on failure
+ */
+int file_scan_map(const char* path, FileScanMapping* mapping);
+
+/**
+ * @brief Unmap a view returned by file_scan_map()
+ * @param mapping View to release
+ */
+void file_scan_unmap(FileScanMapping* mapping);
+
+/**
+ * @brief Stream the matches of one file to a sink
+ *
+ * Each match carries @p path as its source.
+ *
+ * @param scanner Compiled scanner
+ * @param path File to scan
+ * @param fn Sink receiving each match
+ * @param ctx Context passed to the sink
+ * @return Number of matches delivered, or -1 if the file could not be read
+ */
+long file_scan_path(const TrieScanner* scanner, const char* path,
+                    TrieDagMatchFn fn, void* ctx);
+
+/**
+ * @brief Stream the matches of every regular file under a directory
+ *
+ * Entries are visited in sorted order so results are reproducible.
+ * Symbolic links are not followed and unreadable entries are skipped.
+ * Each file is unmapped as soon as it has been scanned, which keeps the
+ * resident set bounded by the largest single file.
+ *
+ * @param scanner Compiled scanner
+ * @param root Directory (or single file) to scan
+ * @param options Walk options (NULL for defaults)
+ * @param fn Sink receiving each match
+ * @param ctx Context passed to the sink
+ * @return Number of matches delivered, or -1 if @p root could not be read
+ */
+long file_scan_tree(const TrieScanner* scanner, const char* root,
+                    const FileScanOptions* options, TrieDagMatchFn fn, void* ctx);
+
+/**
+ * @brief Scan many inputs on a pool and add one node per match to a graph
+ *
+ * Workers share the read-only scanner and claim chunks of inputs. Each
+ * worker records its matches in a shard of its own, so scanning takes
+ * no lock. The shards are turned into nodes in input order once every
+ * input is done, which keeps the result independent of scheduling.
+ * That merge runs on the caller, so nodes are drawn from the graph's
+ * allocator even if it is not thread-safe. Unreadable files are skipped.
+ * Other callers of the same pool wait for the scan to finish.
+ *
+ * @param scanner Compiled scanner
+ * @param inputs Inputs to scan
+ * @param count Number of inputs
+ * @param pool Pool to run on (NULL runs inline on the caller)
+ * @param graph Graph receiving the nodes
+ * @return Number of nodes added, or -1 on allocation failure (no node
+ *         is added then)
+ */
+long file_scan_batch(const TrieScanner* scanner, const FileScanInput* inputs, size_t count,
+                     ThreadPool* pool, DAGGraph* graph);
+
+#endif /* POLYBUILD_FILE_SCAN_H */
@@ -0,0 +1,84 @@
+/**
+ * @file history.h
+ * @brief Persistent per-action duration history for build scheduling
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_HISTORY_H
+#define POLYBUILD_HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/**
+ * @brief Duration estimates keyed by action name
+ *
+ * Each recorded run moves the estimate towards the new sample, so
+ * estimates follow actions that get slower or faster over time.
+ */
+typedef struct DAGExecHistory DAGExecHistory;
+
+/**
+ * @brief Create an empty history
+ * @return Pointer to the new history or NULL on failure
+ */
+DAGExecHistory* dag_exec_history_create(void);
+
+/**
+ * @brief Load a history file
+ * @param path File written by dag_exec_history_save()
+ * @return History holding the file's entries (empty if the file does not
+ *         exist) or NULL on failure
+ */
+DAGExecHistory* dag_exec_history_load(const char* path);
+
+/**
+ * @brief Write a history file, replacing the old one atomically
+ * @param history History to save
+ * @param path Destination file
+ * @return 0 on success, -1 on failure
+ */
+int dag_exec_history_save(const DAGExecHistory* history, const char* path);
+
+/**
+ * @brief Get the duration estimate of an action
+ * @param history History to query
+ * @param name Action name
+ * @param seconds Receives the estimate
+ * @return true if the action has been recorded
+ */
+bool dag_exec_history_lookup(const DAGExecHistory* history, const char* name,
+                             double* seconds);
+
+/**
+ * @brief Get the mean estimate over all recorded actions
+ * @param history History to query
+ * @param seconds Receives the mean
+ * @return true if the history holds any entry
+ */
+bool dag_exec_history_mean(const DAGExecHistory* history, double* seconds);
+
+/**
+ * @brief Record one run of an action
+ * @param history History to update
+ * @param name Action name
+ * @param seconds Measured duration
+ * @return 0 on success, -1 on failure
+ */
+int dag_exec_history_record(DAGExecHistory* history, const char* name, double seconds);
+
+/**
+ * @brief Get the number of recorded actions
+ * @param history History to inspect
+ * @return Number of entries
+ */
+size_t dag_exec_history_count(const DAGExecHistory* history);
+
+/**
+ * @brief Free a history
+ * @param history History to free
+ */
+void dag_exec_history_free(DAGExecHistory* history);
+
+#endif /* POLYBUILD_HISTORY_H */
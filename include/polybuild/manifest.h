@@ -0,0 +1,191 @@
+/**
+ * @file manifest.h
+ * @brief Streaming, schema-checked reader for PolyBuild XML manifests
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_MANIFEST_H
+#define POLYBUILD_MANIFEST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "xml_reader.h"
+#include "executor.h"
+#include "intent_dag_integration.h"
+
+// Namespace of config/polybuild-defintion-schema.xsd
+#define MANIFEST_NAMESPACE "http://schema.obinexus.org/polybuild/definition/1.0"
+
+/**
+ * @brief StabilityType values
+ */
+typedef enum {
+    MANIFEST_STABILITY_EXPERIMENTAL,
+    MANIFEST_STABILITY_BETA,
+    MANIFEST_STABILITY_STABLE,
+    MANIFEST_STABILITY_LEGACY
+} ManifestStability;
+
+/**
+ * @brief TopologyTypeEnum values
+ */
+typedef enum {
+    MANIFEST_TOPOLOGY_P2P,
+    MANIFEST_TOPOLOGY_BUS,
+    MANIFEST_TOPOLOGY_STAR,
+    MANIFEST_TOPOLOGY_RING,
+    MANIFEST_TOPOLOGY_MESH
+} ManifestTopologyType;
+
+/**
+ * @brief ConcurrencyModel values
+ */
+typedef enum {
+    MANIFEST_CONCURRENCY_SEQUENTIAL,
+    MANIFEST_CONCURRENCY_PARALLEL,
+    MANIFEST_CONCURRENCY_PIPELINE
+} ManifestConcurrency;
+
+/**
+ * @brief Definition attributes and identity block
+ */
+typedef struct ManifestIdentity {
+    const char* definition_name;
+    const char* definition_version;
+    const char* name;
+    const char* version;
+    ManifestStability stability;
+    const char* guid;
+} ManifestIdentity;
+
+/**
+ * @brief Topology block
+ */
+typedef struct ManifestTopology {
+    ManifestTopologyType type;
+    unsigned fault_tolerance;   // 0 to 12
+    ManifestConcurrency concurrency;
+    TopologyDecoding decoding;  // Decoded binary-encoding
+} ManifestTopology;
+
+/**
+ * @brief One dependency element
+ */
+typedef struct ManifestDependency {
+    const char* name;
+    const char* version;
+} ManifestDependency;
+
+/**
+ * @brief One include or exclude pattern of the source block
+ */
+typedef struct ManifestSourceRule {
+    const char* root;
+    const char* pattern;
+    bool exclude;
+} ManifestSourceRule;
+
+/**
+ * @brief Record callbacks; each returns false to stop reading
+ *
+ * Records and their strings are only valid during the callback. NULL
+ * callbacks skip their records.
+ */
+typedef struct ManifestSink {
+    bool (*identity)(const ManifestIdentity* identity, void* ctx);
+    bool (*topology)(const ManifestTopology* topology, void* ctx);
+    bool (*intent)(const IntentResolution* intent, void* ctx);
+    bool (*action)(const BuildAction* action, void* ctx);
+    bool (*dependency)(const ManifestDependency* dependency, void* ctx);
+    bool (*source)(const ManifestSourceRule* rule, void* ctx);
+    void* ctx;
+} ManifestSink;
+
+/**
+ * @brief Where and why reading stopped
+ */
+typedef struct ManifestError {
+    size_t line;
+    char message[128];
+} ManifestError;
+
+/**
+ * @brief Read a manifest, emitting records as their elements close
+ *
+ * Checks element order and occurrence, required attributes, and the
+ * schema's enumerations, ranges and patterns as the document streams
+ * by. No document tree is built: besides the reader's window, memory
+ * is held only for the record being assembled.
+ *
+ * @param reader Reader positioned at the start of the document
+ * @param sink Record callbacks
+ * @param error Receives the failure, may be NULL
+ * @return 0 on success, -1 on a malformed or invalid manifest or when
+ *         a callback stopped reading
+ */
+int manifest_read(XmlReader* reader, const ManifestSink* sink, ManifestError* error);
+
+/**
+ * @brief Read a manifest file
+ * @param path Manifest file
+ * @param sink Record callbacks
+ * @param error Receives the failure, may be NULL
+ * @return 0 on success, -1 on failure
+ */
+int manifest_read_file(const char* path, const ManifestSink* sink, ManifestError* error);
+
+/**
+ * @brief Graph built from manifest records
+ *
+ * Every intent, action and dependency becomes a node of @c graph, and
+ * @c actions holds one BuildAction per node index (commands only for
+ * manifest actions), ready for dag_graph_execute(). The node names are
+ * the action names, the intent expressions and the dependency names;
+ * manifest_graph_finish() may append hub nodes named after a verb.
+ */
+typedef struct ManifestGraph {
+    DAGGraph* graph;
+    BuildAction* actions;       // One per node, owned
+    size_t action_capacity;
+    IntentResolution** intents; // Owned, linked to their nodes
+    size_t intent_count;
+    size_t intent_capacity;
+    ManifestTopology topology;
+    bool has_topology;
+} ManifestGraph;
+
+/**
+ * @brief Start building into a graph
+ * @param builder Builder to initialize
+ * @param graph Empty graph receiving the nodes
+ * @param sink Receives callbacks that append to the graph
+ * @return 0 on success, -1 on failure
+ */
+int manifest_graph_init(ManifestGraph* builder, DAGGraph* graph, ManifestSink* sink);
+
+/**
+ * @brief Add the edges implied by the records read
+ *
+ * An action producing a path another action consumes precedes it. An
+ * intent whose binding names an action "<verb>-<binding>" precedes that
+ * action alone; any other intent precedes a hub node for its verb,
+ * added once, which precedes every action whose name starts with the
+ * verb. The edge count stays linear in the number of records, and a
+ * repeated pair is linked once.
+ *
+ * @param builder Builder to finish
+ * @return 0 on success, -1 on failure
+ */
+int manifest_graph_finish(ManifestGraph* builder);
+
+/**
+ * @brief Free the actions and intents of a builder
+ *
+ * The graph and its nodes are left to the caller.
+ *
+ * @param builder Builder to release
+ */
+void manifest_graph_free(ManifestGraph* builder);
+
+#endif /* POLYBUILD_MANIFEST_H */
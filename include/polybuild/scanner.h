@@ -0,0 +1,82 @@
+/**
+ * @file scanner.h
+ * @brief Single-pass multi-pattern scanner over the patterns of a trie
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_SCANNER_H
+#define POLYBUILD_SCANNER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "trie.h"
+
+/**
+ * @brief One pattern occurrence reported by a scan
+ */
+typedef struct TrieScanMatch {
+    size_t offset;              // Start of the match in the scanned text
+    size_t length;              // Length of the match in bytes
+    const TrieNode* rule;       // Terminal trie node that matched
+} TrieScanMatch;
+
+/**
+ * @brief Callback receiving each match of a scan
+ * @param match Match found
+ * @param ctx Caller context
+ * @return true to continue scanning, false to stop
+ */
+typedef bool (*TrieScanFn)(const TrieScanMatch* match, void* ctx);
+
+/**
+ * @brief Automaton compiled from every pattern of a trie
+ *
+ * Literal patterns form one Aho-Corasick automaton that reports every
+ * occurrence, overlapping ones included, in a single pass. Each regex
+ * pattern adds one linear left-to-right pass that reports its
+ * non-overlapping leftmost-longest matches. A scanner is read-only once
+ * built and may be shared between threads.
+ */
+typedef struct TrieScanner TrieScanner;
+
+/**
+ * @brief Compile the patterns of a trie into a scanner
+ *
+ * The trie must outlive the scanner and must not change while in use.
+ *
+ * @param root Root node of the trie (its own pattern is not included)
+ * @return Pointer to the new scanner or NULL on failure
+ */
+TrieScanner* trie_scanner_create(TrieNode* root);
+
+/**
+ * @brief Get the number of patterns compiled into a scanner
+ * @param scanner Scanner to inspect
+ * @return Number of literal and regex patterns
+ */
+size_t trie_scanner_rule_count(const TrieScanner* scanner);
+
+/**
+ * @brief Report every pattern match in a text
+ *
+ * Literal matches arrive in order of their end offset, followed by the
+ * matches of each regex pattern in turn.
+ *
+ * @param scanner Compiled scanner
+ * @param text Text to scan
+ * @param len Text length
+ * @param fn Callback receiving each match
+ * @param ctx Context passed to the callback
+ * @return Number of matches reported, or -1 on failure
+ */
+long trie_scanner_scan(const TrieScanner* scanner, const char* text, size_t len,
+                       TrieScanFn fn, void* ctx);
+
+/**
+ * @brief Free a scanner
+ * @param scanner Scanner to free
+ */
+void trie_scanner_free(TrieScanner* scanner);
+
+#endif /* POLYBUILD_SCANNER_H */
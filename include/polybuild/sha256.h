@@ -0,0 +1,70 @@
+/**
+ * @file sha256.h
+ * @brief SHA-256 digests for content addressing
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_SHA256_H
+#define POLYBUILD_SHA256_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Digest size in bytes
+#define SHA256_DIGEST_SIZE 32
+
+/**
+ * @brief Incremental SHA-256 state
+ */
+typedef struct Sha256 {
+    uint32_t state[8];
+    uint64_t length;            // Bytes hashed so far
+    uint8_t block[64];
+    size_t block_used;
+} Sha256;
+
+/**
+ * @brief Start a new digest
+ * @param sha Context to initialize
+ */
+void sha256_init(Sha256* sha);
+
+/**
+ * @brief Hash more bytes
+ * @param sha Context to update
+ * @param data Bytes to hash
+ * @param len Number of bytes
+ */
+void sha256_update(Sha256* sha, const void* data, size_t len);
+
+/**
+ * @brief Finish a digest
+ * @param sha Context to finish (must be initialized again for reuse)
+ * @param digest Receives the digest
+ */
+void sha256_final(Sha256* sha, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+/**
+ * @brief Hash a buffer in one call
+ * @param data Bytes to hash
+ * @param len Number of bytes
+ * @param digest Receives the digest
+ */
+void sha256_digest(const void* data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+/**
+ * @brief Hash the contents of a file
+ * @param path File to hash
+ * @param digest Receives the digest
+ * @return 0 on success, -1 if the file could not be read completely
+ */
+int sha256_file(const char* path, uint8_t digest[SHA256_DIGEST_SIZE]);
+
+/**
+ * @brief Format a digest as lowercase hex
+ * @param digest Digest to format
+ * @param hex Receives 64 hex digits and a terminator
+ */
+void sha256_to_hex(const uint8_t digest[SHA256_DIGEST_SIZE], char hex[2 * SHA256_DIGEST_SIZE + 1]);
+
+#endif /* POLYBUILD_SHA256_H */
@@ -0,0 +1,74 @@
+/**
+ * @file thread_pool.h
+ * @brief Fixed-size worker pool for data-parallel loops in PolyBuild
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_THREAD_POOL_H
+#define POLYBUILD_THREAD_POOL_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Loop body run over the half-open index range [begin, end)
+ * @param ctx Caller context
+ * @param begin First index of the chunk
+ * @param end One past the last index of the chunk
+ * @param worker Worker slot in [0, thread_pool_size())
+ */
+typedef void (*ThreadPoolRangeFn)(void* ctx, size_t begin, size_t end, size_t worker);
+
+/**
+ * @brief Worker pool; the calling thread takes part as worker 0
+ */
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * @brief Get the number of online processors
+ * @return Processor count, at least 1
+ */
+size_t thread_pool_cpu_count(void);
+
+/**
+ * @brief Create a worker pool
+ * @param thread_count Total workers including the caller (0 for one per CPU)
+ * @return Pointer to the new pool or NULL on failure
+ */
+ThreadPool* thread_pool_create(size_t thread_count);
+
+/**
+ * @brief Get the number of workers of a pool
+ * @param pool Pool to inspect
+ * @return Worker count including the calling thread
+ */
+size_t thread_pool_size(const ThreadPool* pool);
+
+/**
+ * @brief Run a loop body over [0, count) on all workers and wait for it
+ *
+ * Chunks of @p grain indices are claimed dynamically, so uneven work
+ * balances itself. Everything written by the body is visible to the
+ * caller on return.
+ *
+ * A pool runs one job at a time: callers on different threads take
+ * turns, each holding the pool until its loop is done. A loop body that
+ * calls back into the pool running it gets its loop run inline, on its
+ * own thread and worker slot.
+ *
+ * @param pool Pool to run on (NULL runs inline on the caller)
+ * @param count Number of indices
+ * @param grain Indices per chunk (0 picks one from count and pool size)
+ * @param fn Loop body
+ * @param ctx Context passed to the body
+ */
+void thread_pool_parallel_for(ThreadPool* pool, size_t count, size_t grain,
+                              ThreadPoolRangeFn fn, void* ctx);
+
+/**
+ * @brief Stop the workers and free the pool
+ * @param pool Pool to destroy
+ */
+void thread_pool_destroy(ThreadPool* pool);
+
+#endif /* POLYBUILD_THREAD_POOL_H */
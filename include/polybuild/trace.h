@@ -0,0 +1,137 @@
+/**
+ * @file trace.h
+ * @brief Low-overhead span and counter tracing with Chrome trace export
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_TRACE_H
+#define POLYBUILD_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Events each thread's ring keeps before overwriting the oldest
+#define TRACE_RING_CAPACITY 16384
+
+/**
+ * @brief Counters accumulated per thread while tracing
+ */
+typedef enum {
+    TRACE_COUNTER_REGEX_EXECS,      // regexec() calls made by the trie
+    TRACE_COUNTER_PATTERNS_INSERTED,// Patterns added by trie_insert()
+    TRACE_COUNTER_MATCHES,          // Matches delivered by scans
+    TRACE_COUNTER_NODES_VISITED,    // Nodes resolved by the DAG resolvers
+    TRACE_COUNTER_EDGES_RELAXED,    // Edges walked by the DAG resolvers
+    TRACE_COUNTER_INTENTS,          // Intents taken through processing
+    TRACE_COUNTER_ACTIONS_RUN,      // Build actions started by the executor
+    TRACE_COUNTER_COUNT
+} TraceCounter;
+
+/**
+ * @brief Open span; closed by trace_span_end()
+ */
+typedef struct TraceSpan {
+    const char* name;               // Static string, NULL if not recording
+    uint64_t start;                 // Nanoseconds on the trace clock
+} TraceSpan;
+
+/**
+ * @brief Start recording spans and counters
+ *
+ * Clears everything recorded before. Safe while other threads are
+ * traced: each thread clears its own spans and counters on its next
+ * record, and readers ignore what a thread recorded before the call.
+ * Recording is off until the first call, so a library built with
+ * tracing costs one relaxed load per span when nobody is tracing.
+ */
+void trace_start(void);
+
+/**
+ * @brief Stop recording; what was recorded stays available for export
+ */
+void trace_stop(void);
+
+/**
+ * @brief Check whether spans and counters are being recorded
+ * @return true between trace_start() and trace_stop()
+ */
+bool trace_active(void);
+
+/**
+ * @brief Open a span on the calling thread
+ * @param name Static name of the span
+ * @return Span to pass to trace_span_end()
+ */
+TraceSpan trace_span_begin(const char* name);
+
+/**
+ * @brief Close a span, appending it to the calling thread's ring
+ *
+ * Each thread writes only its own ring, without locks; when a ring is
+ * full the oldest spans are overwritten.
+ *
+ * @param span Span returned by trace_span_begin()
+ */
+void trace_span_end(TraceSpan* span);
+
+/**
+ * @brief Add to one of the calling thread's counters
+ * @param counter Counter to add to
+ * @param amount Amount to add
+ */
+void trace_count(TraceCounter counter, uint64_t amount);
+
+/**
+ * @brief Sum a counter over every thread
+ * @param counter Counter to read
+ * @return Total recorded since trace_start()
+ */
+uint64_t trace_counter_total(TraceCounter counter);
+
+/**
+ * @brief Get the name a counter is exported under
+ * @param counter Counter to name
+ * @return Static name, "unknown" if out of range
+ */
+const char* trace_counter_name(TraceCounter counter);
+
+/**
+ * @brief Count the spans held in all rings
+ * @return Number of spans an export would write
+ */
+size_t trace_span_count(void);
+
+/**
+ * @brief Write the recorded spans and counters as Chrome trace-event JSON
+ *
+ * Spans become complete ("X") events and each thread's counters one
+ * counter ("C") event, loadable in chrome://tracing or Perfetto. Call it
+ * once traced work has finished: rings still being written may lose
+ * their newest spans. The file is replaced atomically.
+ *
+ * @param path Output file
+ * @return 0 on success, -1 on failure
+ */
+int trace_export_chrome(const char* path);
+
+/*
+ * Instrumentation points. They compile to nothing unless the library is
+ * built with POLYBUILD_TRACE, so shipping builds carry no trace code.
+ */
+#ifdef POLYBUILD_TRACE
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Span covering the rest of the enclosing block
+#define TRACE_SPAN(name)                                                   \
+    TraceSpan TRACE_CONCAT(trace_span_, __LINE__)                          \
+        __attribute__((cleanup(trace_span_end))) = trace_span_begin(name)
+
+#define TRACE_COUNT(counter, amount) trace_count((counter), (uint64_t)(amount))
+#else
+#define TRACE_SPAN(name) ((void)sizeof(name))
+#define TRACE_COUNT(counter, amount) ((void)sizeof(amount))
+#endif
+
+#endif /* POLYBUILD_TRACE_H */
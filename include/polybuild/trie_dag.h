@@ -1,5 +1,5 @@
 /**
- * @file trie_dag.h
+ * @file trie_dag.h 
  * @brief Integration between Trie and DAG components
  * @author OBINexus Computing
  */
@@ -7,22 +7,145 @@
 #ifndef POLYBUILD_TRIE_DAG_H
 #define POLYBUILD_TRIE_DAG_H
 
-#include "../dag/dag.h"
-#include "../trie/trie.h"
+#include "dag.h"
+#include "trie.h"
+#include "scanner.h"
 
 /**
- * @brief Create DAG nodes from trie matches
+ * @brief One classified match streamed to a sink
+ */
+typedef struct TrieDagMatch {
+    size_t offset;              // Start of the match in the scanned text
+    size_t length;              // Length of the match in bytes
+    TaxonomyCategory category;  // Category of the matching pattern
+    float weight;               // Weight of the matching pattern
+    const TrieNode* rule;       // Terminal trie node that matched
+    const char* source;         // Input the match came from, NULL for plain text
+} TrieDagMatch;
+
+/**
+ * @brief Sink receiving each match as it is found
+ * @param match Match found (only valid during the call)
+ * @param ctx Caller context
+ * @return true to continue scanning, false to stop
+ */
+typedef bool (*TrieDagMatchFn)(const TrieDagMatch* match, void* ctx);
+
+/**
+ * @brief Growable match buffer, usable directly as a sink
+ *
+ * Pass trie_dag_match_buffer_append() as the sink and the buffer as its
+ * context to collect matches in batches; clear it between batches to
+ * reuse its storage.
+ */
+typedef struct TrieDagMatchBuffer {
+    TrieDagMatch* matches;
+    size_t count;
+    size_t capacity;
+    const PolyAllocator* allocator;
+} TrieDagMatchBuffer;
+
+/**
+ * @brief Stream every match of the trie's patterns in a text to a sink
+ *
+ * Nothing is capped or retained; memory use is independent of the
+ * number of matches.
+ *
  * @param root Trie root node
  * @param text Text to process
  * @param len Text length
- * @return Array of created DAG nodes (must be freed by caller)
+ * @param fn Sink receiving each match
+ * @param ctx Context passed to the sink
+ * @return Number of matches delivered, or -1 on failure
+ */
+long trie_dag_scan(TrieNode* root, const char* text, size_t len,
+                   TrieDagMatchFn fn, void* ctx);
+
+/**
+ * @brief Stream matches using a scanner compiled once for many texts
+ * @param scanner Scanner built by trie_scanner_create()
+ * @param text Text to process
+ * @param len Text length
+ * @param fn Sink receiving each match
+ * @param ctx Context passed to the sink
+ * @return Number of matches delivered, or -1 on failure
+ */
+long trie_dag_scan_with(const TrieScanner* scanner, const char* text, size_t len,
+                        TrieDagMatchFn fn, void* ctx);
+
+/**
+ * @brief Sink adding one STATE_UNKNOWN node per match to a graph
+ *
+ * Nodes are drawn from the graph's allocator and take the category of
+ * the matching pattern. Pass the DAGGraph as the sink context.
+ *
+ * @param match Match to add
+ * @param ctx DAGGraph receiving the node
+ * @return true on success, false when the node could not be added
+ */
+bool trie_dag_graph_append(const TrieDagMatch* match, void* ctx);
+
+/**
+ * @brief Initialize an empty match buffer
+ * @param buffer Buffer to initialize
+ * @param allocator Allocator for the buffer storage (NULL for the default)
+ */
+void trie_dag_match_buffer_init(TrieDagMatchBuffer* buffer,
+                                const PolyAllocator* allocator);
+
+/**
+ * @brief Append a match to a buffer, growing it as needed
+ * @param match Match to copy into the buffer
+ * @param ctx TrieDagMatchBuffer receiving the match
+ * @return true on success, false when the buffer could not grow
+ */
+bool trie_dag_match_buffer_append(const TrieDagMatch* match, void* ctx);
+
+/**
+ * @brief Drop the buffered matches but keep the storage
+ * @param buffer Buffer to clear
+ */
+void trie_dag_match_buffer_clear(TrieDagMatchBuffer* buffer);
+
+/**
+ * @brief Release the storage of a match buffer
+ * @param buffer Buffer to release
+ */
+void trie_dag_match_buffer_free(TrieDagMatchBuffer* buffer);
+
+/**
+ * @brief Create DAG nodes from trie matches
+ * @param root Trie root node
+ * @param text Text to process  
+ * @param len Text length
+ * @return NULL-terminated array with one node per match, however many
+ *         there are (free with trie_dag_free_matches()), or NULL on
+ *         failure; a partial array is never returned
  */
 DAGNode** create_dag_from_trie_matches(TrieNode* root, const char* text, size_t len);
 
 /**
- * @brief Initialize the trie-dag integration
+ * @brief Create DAG nodes from trie matches, drawing from an allocator
+ * @param allocator Allocator for the result array and nodes
+ *        (NULL for the default)
+ * @param root Trie root node
+ * @param text Text to process
+ * @param len Text length
+ * @return NULL-terminated array of created DAG nodes, or NULL on failure
+ */
+DAGNode** create_dag_from_trie_matches_in(const PolyAllocator* allocator,
+                                          TrieNode* root, const char* text, size_t len);
+
+/**
+ * @brief Free a heap-allocated match array and its nodes
+ * @param matches Array returned by create_dag_from_trie_matches()
+ */
+void trie_dag_free_matches(DAGNode** matches);
+
+/**
+ * @brief Initialize the trie-dag integration 
  * @return 0 on success, non-zero on failure
  */
 int trie_dag_init(void);
 
-#endif /* POLYBUILD_TRIE_DAG_H */
+#endif /* POLYBUILD_TRIE_DAG_H */
\ No newline at end of file
@@ -0,0 +1,138 @@
+/**
+ * @file xml_reader.h
+ * @brief Streaming pull reader for XML documents
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_XML_READER_H
+#define POLYBUILD_XML_READER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Default size of the read window
+#define XML_READER_BUFFER_SIZE 65536
+
+// Attributes per start tag and element nesting depth
+#define XML_READER_MAX_ATTRIBUTES 32
+#define XML_READER_MAX_DEPTH 64
+
+/**
+ * @brief Kind of event returned by xml_reader_next()
+ */
+typedef enum {
+    XML_EVENT_START,            // Start tag (also for empty-element tags)
+    XML_EVENT_END,              // End tag (synthesized for empty-element tags)
+    XML_EVENT_TEXT,             // Character data or a CDATA section
+    XML_EVENT_EOF,              // End of a well-formed document
+    XML_EVENT_ERROR             // Malformed input or a read failure
+} XmlEventType;
+
+/**
+ * @brief Byte range inside the reader's window
+ */
+typedef struct XmlSpan {
+    const char* data;
+    size_t len;
+} XmlSpan;
+
+/**
+ * @brief Attribute of a start tag, with entities already decoded
+ */
+typedef struct XmlAttribute {
+    XmlSpan prefix;             // Namespace prefix, empty if none
+    XmlSpan name;               // Local name
+    XmlSpan value;
+} XmlAttribute;
+
+/**
+ * @brief One reader event
+ *
+ * All spans point into the reader's window and stay valid only until
+ * the next call to xml_reader_next().
+ */
+typedef struct XmlEvent {
+    XmlEventType type;
+    XmlSpan prefix;             // Element namespace prefix (START and END)
+    XmlSpan name;               // Element local name (START and END)
+    const XmlAttribute* attributes;
+    size_t attribute_count;
+    XmlSpan text;               // Decoded character data (TEXT)
+    size_t depth;               // Depth of the element (1 for the root)
+} XmlEvent;
+
+/**
+ * @brief Pull reader over a file or a buffer
+ *
+ * The reader keeps one fixed-size window of the input and decodes each
+ * token in place, so memory use does not grow with the document. Any
+ * single token (a tag, or a run of text) must fit in the window.
+ * Comments, processing instructions and document type declarations
+ * without an internal subset are skipped. Start and end tags are
+ * checked to nest properly.
+ */
+typedef struct XmlReader XmlReader;
+
+/**
+ * @brief Open a reader over a file
+ * @param path File to read
+ * @param buffer_size Window size in bytes (0 for XML_READER_BUFFER_SIZE)
+ * @return Pointer to the reader or NULL on failure
+ */
+XmlReader* xml_reader_open(const char* path, size_t buffer_size);
+
+/**
+ * @brief Create a reader over a buffer
+ *
+ * The text is copied through the window as it is read, so it is not
+ * modified and must outlive the reader.
+ *
+ * @param text Document text
+ * @param len Length of the text
+ * @param buffer_size Window size in bytes (0 for XML_READER_BUFFER_SIZE)
+ * @return Pointer to the reader or NULL on failure
+ */
+XmlReader* xml_reader_create(const char* text, size_t len, size_t buffer_size);
+
+/**
+ * @brief Read the next event
+ *
+ * After XML_EVENT_EOF or XML_EVENT_ERROR every further call returns the
+ * same event type.
+ *
+ * @param reader Reader to advance
+ * @param event Receives the event
+ * @return Type of the event
+ */
+XmlEventType xml_reader_next(XmlReader* reader, XmlEvent* event);
+
+/**
+ * @brief Get the line of the last event
+ * @param reader Reader to inspect
+ * @return One-based line number where the last event started
+ */
+size_t xml_reader_line(const XmlReader* reader);
+
+/**
+ * @brief Describe the error that stopped the reader
+ * @param reader Reader to inspect
+ * @return Static message, NULL if no error occurred
+ */
+const char* xml_reader_error(const XmlReader* reader);
+
+/**
+ * @brief Compare a span with a NUL-terminated string
+ * @param span Span to compare
+ * @param text String to compare against
+ * @return true if both hold the same bytes
+ */
+bool xml_span_equals(XmlSpan span, const char* text);
+
+/**
+ * @brief Close the reader and its file
+ * @param reader Reader to close
+ */
+void xml_reader_close(XmlReader* reader);
+
+#endif /* POLYBUILD_XML_READER_H */
@@ -2,11 +2,34 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "dag.h"
+#include "dag_vote.h"
+#include "../parallel/thread_pool.h"
+#include "../trace/trace.h"
+
+// Initial per-node edge list capacity, doubled on demand
+#define DAG_EDGE_INITIAL_CAPACITY 4
+
+// Frontier nodes per parallel chunk and local ready-list buffer size
+#define DAG_PARALLEL_GRAIN 256
+#define DAG_PARALLEL_BATCH 128
+
+// Bytes after the states so vote kernels can load a 32-bit word at any state
+#define DAG_STATE_SLACK 4
+
+// Node index, defined with its helpers below
+typedef struct DAGNodeIndex DAGNodeIndex;
+
+// Forward declarations of helper functions
+static bool dag_edges_reserve(const PolyAllocator *allocator, DAGEdge **edges,
+                              size_t *capacity, size_t count);
+static void dag_graph_release_csr(DAGGraph *graph);
+static void dag_index_append(DAGGraph *graph, const DAGNode *node);
+static void dag_index_states_stale(DAGGraph *graph);
+static void dag_index_free(const PolyAllocator *allocator, DAGNodeIndex *index);
+static void dag_dirty_unpin(DAGGraph *graph);
 
-// Forward declaration of helper function
-static void resolve_node_recursive(DAGNode *nodes[], size_t node_count, 
-                                  size_t current, bool *visited, bool *resolved);
 /**
  * Initialize the DAG subsystem
  * Returns 0 on success, non-zero on failure
@@ -15,9 +38,16 @@ int dag_init(void) {
     // Placeholder implementation
     return 0;
 }
-                                
+
 DAGNode* dag_node_create(TokenType type, TaxonomyCategory category) {
-    DAGNode* node = (DAGNode*)malloc(sizeof(DAGNode));
+    return dag_node_create_in(NULL, type, category);
+}
+
+DAGNode* dag_node_create_in(const PolyAllocator *allocator,
+                            TokenType type, TaxonomyCategory category) {
+    if (!allocator) allocator = poly_allocator_default();
+
+    DAGNode* node = (DAGNode*)poly_alloc(allocator, sizeof(DAGNode));
     if (node) {
         node->type = type;
         node->category = category;
@@ -26,158 +56,1731 @@ DAGNode* dag_node_create(TokenType type, TaxonomyCategory category) {
         node->out_edges = NULL;
         node->in_count = 0;
         node->out_count = 0;
+        node->in_capacity = 0;
+        node->out_capacity = 0;
+        node->index = 0;
+        node->graph = NULL;
+        node->allocator = allocator;
     }
     return node;
 }
 
+void dag_node_free(DAGNode *node) {
+    if (!node) return;
+
+    poly_release(node->allocator, node->in_edges, node->in_capacity * sizeof(DAGEdge));
+    poly_release(node->allocator, node->out_edges, node->out_capacity * sizeof(DAGEdge));
+    poly_release(node->allocator, node, sizeof(DAGNode));
+}
+
+/**
+ * Make room for one more edge in a contiguous edge list
+ */
+static bool dag_edges_reserve(const PolyAllocator *allocator, DAGEdge **edges,
+                              size_t *capacity, size_t count) {
+    if (count < *capacity) {
+        return true;
+    }
+
+    size_t new_capacity = *capacity ? *capacity * 2 : DAG_EDGE_INITIAL_CAPACITY;
+    DAGEdge *grown = (DAGEdge *)poly_resize(allocator, *edges,
+                                            *capacity * sizeof(DAGEdge),
+                                            new_capacity * sizeof(DAGEdge));
+    if (!grown) {
+        return false;
+    }
+
+    *edges = grown;
+    *capacity = new_capacity;
+    return true;
+}
+
+/**
+ * Note a structural change: neither the CSR arrays nor the states and
+ * ranks computed from them describe the graph any more
+ */
+static inline void dag_graph_mark_changed(DAGGraph *graph) {
+    graph->frozen = false;
+    graph->resolved = false;
+}
+
 void dag_add_edge(DAGNode *from, DAGNode *to, float weight) {
     if (!from || !to) return;
-    
-    // Allocate/reallocate outgoing edge array
-    from->out_edges = (DAGEdge**)realloc(from->out_edges, 
-                                       (from->out_count + 1) * sizeof(DAGEdge*));
-    if (!from->out_edges) return;
-
-    // Allocate memory for the new edge
-    from->out_edges[from->out_count] = (DAGEdge*)malloc(sizeof(DAGEdge));
-    if (!from->out_edges[from->out_count]) return;
-    
-    // Allocate/reallocate incoming edge array
-    to->in_edges = (DAGEdge**)realloc(to->in_edges, 
-                                    (to->in_count + 1) * sizeof(DAGEdge*));
-    if (!to->in_edges) return;
-
-    // Allocate memory for the new edge  
-    to->in_edges[to->in_count] = (DAGEdge*)malloc(sizeof(DAGEdge));
-    if (!to->in_edges[to->in_count]) return;
-    
-    
-      // Set up the new outgoing edge
-    from->out_edges[from->out_count]->target = to;
-    from->out_edges[from->out_count]->weight = weight;
+
+    // Grow both edge lists up front so a failure leaves neither half-linked
+    if (!dag_edges_reserve(from->allocator, &from->out_edges,
+                           &from->out_capacity, from->out_count) ||
+        !dag_edges_reserve(to->allocator, &to->in_edges,
+                           &to->in_capacity, to->in_count)) {
+        return;
+    }
+
+    // Set up the new outgoing edge
+    from->out_edges[from->out_count].target = to;
+    from->out_edges[from->out_count].weight = weight;
     from->out_count++;
-    
-    // Set up the new incoming edge  
-    to->in_edges[to->in_count]->target = from;
-    to->in_edges[to->in_count]->weight = weight; 
+
+    // Set up the new incoming edge
+    to->in_edges[to->in_count].target = from;
+    to->in_edges[to->in_count].weight = weight;
     to->in_count++;
+
+    // Owning graphs have to re-freeze their CSR arrays
+    if (from->graph) dag_graph_mark_changed(from->graph);
+    if (to->graph) dag_graph_mark_changed(to->graph);
 }
 
-void dag_resolve(DAGNode *nodes[], size_t node_count) {
+int dag_resolve(DAGNode *nodes[], size_t node_count) {
     if (!nodes || node_count == 0) {
-        return;
+        return 0;
     }
-    
-    // Track visited and resolved states for topological sort
-    bool *visited = (bool *)calloc(node_count, sizeof(bool));
-    bool *resolved = (bool *)calloc(node_count, sizeof(bool));
-    
-    if (!visited || !resolved) {
-        free(visited);
-        free(resolved);
-        return;
+
+    // Borrow the caller's array as a transient graph; nodes keep their owner
+    DAGGraph view;
+    memset(&view, 0, sizeof(view));
+    view.nodes = nodes;
+    view.node_count = node_count;
+
+    // Nodes owned by a graph get their dense index back afterwards
+    size_t *saved_index = (size_t *)malloc(node_count * sizeof(size_t));
+    if (!saved_index) {
+        return -1;
     }
-    
-    // Perform depth-first topological resolution
+
+    // Give every node its dense index so edge endpoints resolve in O(1)
     for (size_t i = 0; i < node_count; i++) {
-        if (!visited[i]) {
-            resolve_node_recursive(nodes, node_count, i, visited, resolved);
-        }
-    }
-    
-    free(visited);
-    free(resolved);
-}
-
-static void resolve_node_recursive(DAGNode *nodes[], size_t node_count, 
-                                  size_t current, bool *visited, bool *resolved) {
-    visited[current] = true;
-    
-    // Process all outgoing edges
-    DAGNode *node = nodes[current];
-
-     for (size_t i = 0; i < node->in_count; i++) {
-        DAGEdge* edge = node->in_edges[i];
-        if (edge) {
-            DAGNode* source = edge->target;
-            if (source) {
-                if (source->state == (NodeState)STATE_TRUE) {
-                    node->state = (NodeState)STATE_TRUE;
-                } else if (source->state == (NodeState)STATE_FALSE) {
-                    node->state = (NodeState)STATE_FALSE;
-                } else {
-                    resolve_node_recursive(source);
-                }
+        if (!nodes[i]) {
+            free(saved_index);
+            return -1;
+        }
+        saved_index[i] = nodes[i]->index;
+        nodes[i]->index = i;
+    }
+
+    int result = dag_graph_resolve(&view);
+
+    // Owning graphs keep a dense copy of the states; bring it in step
+    for (size_t i = 0; i < node_count; i++) {
+        DAGGraph *owner = nodes[i]->graph;
+        nodes[i]->index = saved_index[i];
+        if (owner) {
+            if (owner->frozen && owner->states) {
+                owner->states[nodes[i]->index] = (uint8_t)nodes[i]->state;
+            }
+            dag_index_states_stale(owner);
+        }
+    }
+
+    free(saved_index);
+    dag_graph_release_csr(&view);
+    return result;
+}
+
+DAGGraph* dag_graph_create(size_t node_hint) {
+    return dag_graph_create_in(NULL, node_hint);
+}
+
+DAGGraph* dag_graph_create_in(const PolyAllocator *allocator, size_t node_hint) {
+    if (!allocator) allocator = poly_allocator_default();
+
+    DAGGraph *graph = (DAGGraph *)poly_calloc(allocator, sizeof(DAGGraph));
+    if (!graph) {
+        return NULL;
+    }
+    graph->allocator = allocator;
+
+    if (node_hint > 0) {
+        graph->nodes = (DAGNode **)poly_alloc(allocator, node_hint * sizeof(DAGNode *));
+        if (!graph->nodes) {
+            poly_release(allocator, graph, sizeof(DAGGraph));
+            return NULL;
+        }
+        graph->node_capacity = node_hint;
+    }
+
+    return graph;
+}
+
+int dag_graph_reserve(DAGGraph *graph, size_t node_count) {
+    if (!graph || node_count > UINT32_MAX) {
+        return -1;
+    }
+    if (node_count <= graph->node_capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = graph->node_capacity ? graph->node_capacity : 16;
+    while (new_capacity < node_count) {
+        new_capacity *= 2;
+    }
+    DAGNode **grown = (DAGNode **)poly_resize(graph->allocator, graph->nodes,
+                                              graph->node_capacity * sizeof(DAGNode *),
+                                              new_capacity * sizeof(DAGNode *));
+    if (!grown) {
+        return -1;
+    }
+    graph->nodes = grown;
+    graph->node_capacity = new_capacity;
+    return 0;
+}
+
+int dag_graph_add_node(DAGGraph *graph, DAGNode *node) {
+    if (!graph || !node || node->graph || graph->node_count >= UINT32_MAX) {
+        return -1;
+    }
+
+    if (graph->node_count == graph->node_capacity &&
+        dag_graph_reserve(graph, graph->node_count + 1) != 0) {
+        return -1;
+    }
+
+    node->index = graph->node_count;
+    node->graph = graph;
+    graph->nodes[graph->node_count++] = node;
+    dag_graph_mark_changed(graph);
+    dag_index_append(graph, node);
+    return 0;
+}
+
+/**
+ * Check whether a node belongs to the graph via its dense index
+ */
+static inline bool dag_graph_contains(const DAGGraph *graph, const DAGNode *node) {
+    return node && node->index < graph->node_count &&
+           graph->nodes[node->index] == node;
+}
+
+static void dag_graph_release_csr(DAGGraph *graph) {
+    poly_release(graph->allocator, graph->csr_block, graph->csr_size);
+
+    graph->csr_block = NULL;
+    graph->csr_size = 0;
+    graph->out_offsets = NULL;
+    graph->out_targets = NULL;
+    graph->out_weights = NULL;
+    graph->in_offsets = NULL;
+    graph->in_sources = NULL;
+    graph->in_weights = NULL;
+    graph->states = NULL;
+    graph->topo_rank = NULL;
+    graph->edge_count = 0;
+    graph->frozen = false;
+    graph->resolved = false;
+}
+
+/**
+ * Allocate zeroed CSR arrays for the graph's nodes and up to max_edges
+ */
+static int dag_graph_alloc_csr(DAGGraph *graph, size_t max_edges) {
+    if (max_edges >= UINT32_MAX) {
+        return -1;
+    }
+
+    // One block: two offset rows, ranks, four edge arrays, then the states
+    size_t n = graph->node_count;
+    size_t offsets_size = (n + 1) * sizeof(uint32_t);
+    size_t ranks_size = n * sizeof(uint32_t);
+    size_t edges_size = max_edges * sizeof(uint32_t);
+    size_t block_size = 2 * offsets_size + ranks_size + 4 * edges_size + n + DAG_STATE_SLACK;
+
+    char *block = (char *)poly_calloc(graph->allocator, block_size);
+    if (!block) {
+        return -1;
+    }
+
+    graph->csr_block = block;
+    graph->csr_size = block_size;
+    graph->out_offsets = (uint32_t *)block;
+    graph->in_offsets = (uint32_t *)(block + offsets_size);
+    graph->topo_rank = (uint32_t *)(block + 2 * offsets_size);
+    block += 2 * offsets_size + ranks_size;
+    graph->out_targets = (uint32_t *)block;
+    graph->in_sources = (uint32_t *)(block + edges_size);
+    graph->out_weights = (float *)(block + 2 * edges_size);
+    graph->in_weights = (float *)(block + 3 * edges_size);
+    graph->states = (uint8_t *)(block + 4 * edges_size);
+    return 0;
+}
+
+int dag_graph_freeze(DAGGraph *graph) {
+    if (!graph) {
+        return -1;
+    }
+    if (graph->frozen) {
+        return 0;
+    }
+    TRACE_SPAN("dag_graph_freeze");
+
+    dag_graph_release_csr(graph);
+
+    size_t n = graph->node_count;
+
+    // Outgoing list lengths bound the member-to-member edge count
+    size_t max_edges = 0;
+    for (size_t i = 0; i < n; i++) {
+        max_edges += graph->nodes[i]->out_count;
+    }
+    if (dag_graph_alloc_csr(graph, max_edges) != 0) {
+        return -1;
+    }
+
+    // Count member-to-member edges per endpoint
+    size_t edge_count = 0;
+    for (size_t i = 0; i < n; i++) {
+        const DAGNode *node = graph->nodes[i];
+        for (size_t j = 0; j < node->out_count; j++) {
+            const DAGNode *target = node->out_edges[j].target;
+            if (dag_graph_contains(graph, target)) {
+                graph->out_offsets[i + 1]++;
+                graph->in_offsets[target->index + 1]++;
+                edge_count++;
             }
         }
     }
-    
-    for (size_t i = 0; i < node->out_count; i++) {
-        // Find index of the target node
-        DAGNode *target = node->out_edges[i]->target;
-        size_t target_idx = 0;
-        
-        // Find the index of this target node in our nodes array
-        for (size_t j = 0; j < node_count; j++) {
-            if (nodes[j] == target) {
-                target_idx = j;
-                break;
+
+    // Prefix sums turn the counts into row offsets
+    for (size_t i = 0; i < n; i++) {
+        graph->out_offsets[i + 1] += graph->out_offsets[i];
+        graph->in_offsets[i + 1] += graph->in_offsets[i];
+    }
+
+    // Incoming rows are filled through a cursor per target node
+    uint32_t *in_fill = (uint32_t *)malloc((n ? n : 1) * sizeof(uint32_t));
+    if (!in_fill) {
+        dag_graph_release_csr(graph);
+        return -1;
+    }
+
+    if (n > 0) {
+        memcpy(in_fill, graph->in_offsets, n * sizeof(uint32_t));
+    }
+
+    // Scatter edges; incoming rows end up ordered by source index
+    size_t out_pos = 0;
+    for (size_t i = 0; i < n; i++) {
+        const DAGNode *node = graph->nodes[i];
+        for (size_t j = 0; j < node->out_count; j++) {
+            const DAGEdge *edge = &node->out_edges[j];
+            if (!dag_graph_contains(graph, edge->target)) {
+                continue;
             }
+            uint32_t target = (uint32_t)edge->target->index;
+            graph->out_targets[out_pos] = target;
+            graph->out_weights[out_pos] = edge->weight;
+            out_pos++;
+
+            uint32_t in_pos = in_fill[target]++;
+            graph->in_sources[in_pos] = (uint32_t)i;
+            graph->in_weights[in_pos] = edge->weight;
         }
-        
-        // Recursive resolution of dependencies
-        if (!visited[target_idx]) {
-            resolve_node_recursive(nodes, node_count, target_idx, visited, resolved);
-        }
-    }
-    
-    // Now resolve this node's truth value
-    if (!resolved[current]) {
-        // Default to true for root nodes (no incoming edges)
-        if (node->in_count == 0) {
-            node->state = STATE_TRUE;
-        } else {
-            // Determine truth based on weighted incoming edges
-            float true_weight = 0.0f;
-            float false_weight = 0.0f;
-            
-            for (size_t i = 0; i < node->in_count; i++) {
-                // Find the source node
-                DAGNode *source = NULL;
-                
-                // Search for the source node that has this edge
-                for (size_t j = 0; j < node_count; j++) {
-                    for (size_t k = 0; k < nodes[j]->out_count; k++) {
-                        if (nodes[j]->out_edges[k]->target == node) {
-                            source = nodes[j];
-                            break;
-                        }
-                    }
-                    if (source) break;
-                }
-                
-                if (!source) continue;
-                
-                // Accumulate weighted influence from source nodes
-                float edge_weight = node->in_edges[i]->weight;
-                if (source->state == STATE_TRUE) {
-                    true_weight += edge_weight;
-                } else if (source->state == STATE_FALSE) {
-                    false_weight += edge_weight;
+    }
+
+    free(in_fill);
+    graph->edge_count = edge_count;
+    graph->frozen = true;
+    return 0;
+}
+
+int dag_graph_resolve(DAGGraph *graph) {
+    if (!graph) {
+        return -1;
+    }
+    dag_dirty_unpin(graph);
+    if (graph->node_count == 0) {
+        return 0;
+    }
+    TRACE_SPAN("dag_graph_resolve");
+    if (dag_graph_freeze(graph) != 0) {
+        return -1;
+    }
+
+    size_t n = graph->node_count;
+
+    // Unresolved predecessor count per node and the Kahn ready queue
+    uint32_t *pending = (uint32_t *)malloc(n * sizeof(uint32_t));
+    uint32_t *queue = (uint32_t *)malloc(n * sizeof(uint32_t));
+
+    if (!pending || !queue) {
+        free(pending);
+        free(queue);
+        return -1;
+    }
+
+    size_t head = 0;
+    size_t tail = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        pending[i] = graph->in_offsets[i + 1] - graph->in_offsets[i];
+        graph->states[i] = STATE_UNKNOWN;
+        graph->topo_rank[i] = UINT32_MAX;
+        if (pending[i] == 0) {
+            queue[tail++] = (uint32_t)i;
+        }
+    }
+
+    // Single topological pass: a node is resolved once all sources are
+    while (head < tail) {
+        // Every queued node has its sources resolved, so they vote as one batch
+        size_t batch_end = tail;
+        dag_vote_resolve(graph, queue + head, batch_end - head);
+
+        for (; head < batch_end; head++) {
+            uint32_t current = queue[head];
+            graph->topo_rank[current] = (uint32_t)head;
+
+            for (uint32_t e = graph->out_offsets[current];
+                 e < graph->out_offsets[current + 1]; e++) {
+                uint32_t target = graph->out_targets[e];
+                if (--pending[target] == 0) {
+                    queue[tail++] = target;
                 }
             }
-            
-            // Final truth determination based on weighted influences
-            if (true_weight > false_weight) {
-                node->state = STATE_TRUE;
-            } else if (false_weight > true_weight) {
-                node->state = STATE_FALSE;
-            } else {
-                // Equal weights or no resolved inputs
-                node->state = STATE_UNKNOWN;
+        }
+    }
+
+    // Publish results; anything left unvisited sits on (or behind) a cycle
+    for (size_t i = 0; i < n; i++) {
+        graph->nodes[i]->state = (NodeState)graph->states[i];
+    }
+
+    free(pending);
+    free(queue);
+    TRACE_COUNT(TRACE_COUNTER_NODES_VISITED, tail);
+    TRACE_COUNT(TRACE_COUNTER_EDGES_RELAXED, graph->out_offsets[n]);
+    dag_index_states_stale(graph);
+    graph->resolved = (tail == n);
+    return graph->resolved ? 0 : -1;
+}
+
+/**
+ * Shared state of one level-synchronous parallel resolution
+ */
+typedef struct DAGParallelLevel {
+    DAGGraph *graph;
+    atomic_uint *pending;       // Unresolved predecessor count per node
+    const uint32_t *frontier;   // Nodes of the current level
+    uint32_t *next;             // Nodes of the next level
+    atomic_size_t next_count;
+    uint32_t depth;             // Level number, used as topological rank
+} DAGParallelLevel;
+
+/**
+ * Resolve a chunk of the current level and release its successors
+ */
+static void dag_resolve_level_chunk(void *ctx, size_t begin, size_t end, size_t worker) {
+    DAGParallelLevel *level = (DAGParallelLevel *)ctx;
+    DAGGraph *graph = level->graph;
+    uint32_t ready[DAG_PARALLEL_BATCH];
+    size_t ready_count = 0;
+    (void)worker;
+    TRACE_SPAN("dag_resolve_level_chunk");
+
+    // Sources all sit on earlier levels, so their states are final
+    dag_vote_resolve(graph, level->frontier + begin, end - begin);
+
+    for (size_t i = begin; i < end; i++) {
+        uint32_t current = level->frontier[i];
+        graph->topo_rank[current] = level->depth;
+
+        for (uint32_t e = graph->out_offsets[current];
+             e < graph->out_offsets[current + 1]; e++) {
+            uint32_t target = graph->out_targets[e];
+            if (atomic_fetch_sub_explicit(&level->pending[target], 1,
+                                          memory_order_relaxed) != 1) {
+                continue;
+            }
+
+            // Publish ready nodes in batches to keep the shared cursor cool
+            if (ready_count == DAG_PARALLEL_BATCH) {
+                size_t slot = atomic_fetch_add_explicit(&level->next_count, ready_count,
+                                                        memory_order_relaxed);
+                memcpy(&level->next[slot], ready, ready_count * sizeof(uint32_t));
+                ready_count = 0;
             }
+            ready[ready_count++] = target;
+        }
+    }
+
+    if (ready_count > 0) {
+        size_t slot = atomic_fetch_add_explicit(&level->next_count, ready_count,
+                                                memory_order_relaxed);
+        memcpy(&level->next[slot], ready, ready_count * sizeof(uint32_t));
+    }
+}
+
+int dag_graph_resolve_parallel(DAGGraph *graph, size_t thread_count) {
+    if (!graph) {
+        return -1;
+    }
+    if (thread_count == 1 || graph->node_count == 0) {
+        return dag_graph_resolve(graph);
+    }
+
+    ThreadPool *pool = thread_pool_create(thread_count);
+    if (!pool) {
+        return -1;
+    }
+    int result = dag_graph_resolve_parallel_on(graph, pool);
+    thread_pool_destroy(pool);
+    return result;
+}
+
+int dag_graph_resolve_parallel_on(DAGGraph *graph, ThreadPool *pool) {
+    if (!graph) {
+        return -1;
+    }
+    dag_dirty_unpin(graph);
+    if (!pool || thread_pool_size(pool) == 1 || graph->node_count == 0) {
+        return dag_graph_resolve(graph);
+    }
+    TRACE_SPAN("dag_graph_resolve_parallel");
+    if (dag_graph_freeze(graph) != 0) {
+        return -1;
+    }
+
+    size_t n = graph->node_count;
+    atomic_uint *pending = (atomic_uint *)malloc(n * sizeof(atomic_uint));
+    uint32_t *frontier = (uint32_t *)malloc(n * sizeof(uint32_t));
+    uint32_t *next = (uint32_t *)malloc(n * sizeof(uint32_t));
+
+    if (!pending || !frontier || !next) {
+        free(pending);
+        free(frontier);
+        free(next);
+        return -1;
+    }
+
+    // Level 0 holds every node without incoming edges
+    size_t frontier_count = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t in_degree = graph->in_offsets[i + 1] - graph->in_offsets[i];
+        atomic_init(&pending[i], in_degree);
+        graph->states[i] = STATE_UNKNOWN;
+        graph->topo_rank[i] = UINT32_MAX;
+        if (in_degree == 0) {
+            frontier[frontier_count++] = (uint32_t)i;
+        }
+    }
+
+    DAGParallelLevel level;
+    level.graph = graph;
+    level.pending = pending;
+    level.depth = 0;
+    size_t resolved = 0;
+
+    // Each level only reads states written by earlier levels
+    while (frontier_count > 0) {
+        level.frontier = frontier;
+        level.next = next;
+        atomic_init(&level.next_count, 0);
+
+        thread_pool_parallel_for(pool, frontier_count, DAG_PARALLEL_GRAIN,
+                                 dag_resolve_level_chunk, &level);
+
+        resolved += frontier_count;
+        frontier_count = atomic_load(&level.next_count);
+        level.depth++;
+
+        uint32_t *swap = frontier;
+        frontier = next;
+        next = swap;
+    }
+
+    // Publish results; anything left unvisited sits on (or behind) a cycle
+    for (size_t i = 0; i < n; i++) {
+        graph->nodes[i]->state = (NodeState)graph->states[i];
+    }
+
+    free(pending);
+    free(frontier);
+    free(next);
+    TRACE_COUNT(TRACE_COUNTER_NODES_VISITED, resolved);
+    TRACE_COUNT(TRACE_COUNTER_EDGES_RELAXED, graph->out_offsets[n]);
+    dag_index_states_stale(graph);
+    graph->resolved = (resolved == n);
+    return graph->resolved ? 0 : -1;
+}
+
+/**
+ * A state the caller gave a node through dag_graph_mark_dirty()
+ */
+typedef struct DAGDirtyPin {
+    DAGNode *node;
+    NodeState state;
+} DAGDirtyPin;
+
+/**
+ * Nodes waiting for incremental recomputation, as a min-heap on rank
+ *
+ * The pins outlive structural changes: a full resolve falling back from
+ * dag_graph_resolve_dirty() puts them back before updating downstream.
+ */
+typedef struct DAGDirtySet {
+    uint32_t *heap;
+    size_t count;
+    size_t capacity;
+    uint8_t *queued;            // Per-node flag: already in the heap
+    size_t node_count;
+    DAGDirtyPin *pins;
+    size_t pin_count;
+    size_t pin_capacity;
+} DAGDirtySet;
+
+static void dag_dirty_free(const PolyAllocator *allocator, DAGDirtySet *dirty) {
+    if (!dirty) return;
+    poly_release(allocator, dirty->heap, dirty->capacity * sizeof(uint32_t));
+    poly_release(allocator, dirty->queued, dirty->node_count);
+    poly_release(allocator, dirty->pins, dirty->pin_capacity * sizeof(DAGDirtyPin));
+    poly_release(allocator, dirty, sizeof(DAGDirtySet));
+}
+
+/**
+ * Drop the pins; a full resolve recomputes the nodes they name
+ */
+static void dag_dirty_unpin(DAGGraph *graph) {
+    if (graph->dirty) {
+        graph->dirty->pin_count = 0;
+    }
+}
+
+/**
+ * Get the graph's dirty set, sized for the current node count
+ */
+static DAGDirtySet *dag_dirty_get(DAGGraph *graph) {
+    DAGDirtySet *dirty = graph->dirty;
+    if (dirty && dirty->node_count == graph->node_count) {
+        return dirty;
+    }
+
+    // Node count changed: the graph gets fully resolved anyway, so only
+    // the pins carry over
+    uint8_t *queued = (uint8_t *)poly_calloc(graph->allocator,
+                                             graph->node_count ? graph->node_count : 1);
+    if (!queued) {
+        return NULL;
+    }
+    if (!dirty) {
+        dirty = (DAGDirtySet *)poly_calloc(graph->allocator, sizeof(DAGDirtySet));
+        if (!dirty) {
+            poly_release(graph->allocator, queued, graph->node_count ? graph->node_count : 1);
+            return NULL;
         }
-        
-        resolved[current] = true;
+    } else {
+        poly_release(graph->allocator, dirty->queued, dirty->node_count);
     }
-}
\ No newline at end of file
+    dirty->queued = queued;
+    dirty->count = 0;
+    dirty->node_count = graph->node_count;
+    graph->dirty = dirty;
+    return dirty;
+}
+
+static int dag_dirty_pin(DAGGraph *graph, DAGDirtySet *dirty, DAGNode *node) {
+    if (dirty->pin_count == dirty->pin_capacity) {
+        size_t new_capacity = dirty->pin_capacity ? dirty->pin_capacity * 2 : 16;
+        DAGDirtyPin *grown = (DAGDirtyPin *)poly_resize(graph->allocator, dirty->pins,
+                                                        dirty->pin_capacity * sizeof(DAGDirtyPin),
+                                                        new_capacity * sizeof(DAGDirtyPin));
+        if (!grown) {
+            return -1;
+        }
+        dirty->pins = grown;
+        dirty->pin_capacity = new_capacity;
+    }
+    dirty->pins[dirty->pin_count].node = node;
+    dirty->pins[dirty->pin_count].state = node->state;
+    dirty->pin_count++;
+    return 0;
+}
+
+static int dag_dirty_push(DAGGraph *graph, DAGDirtySet *dirty, uint32_t node) {
+    if (dirty->queued[node]) {
+        return 0;
+    }
+
+    if (dirty->count == dirty->capacity) {
+        size_t new_capacity = dirty->capacity ? dirty->capacity * 2 : 64;
+        uint32_t *grown = (uint32_t *)poly_resize(graph->allocator, dirty->heap,
+                                                  dirty->capacity * sizeof(uint32_t),
+                                                  new_capacity * sizeof(uint32_t));
+        if (!grown) {
+            return -1;
+        }
+        dirty->heap = grown;
+        dirty->capacity = new_capacity;
+    }
+
+    // Sift up by topological rank
+    const uint32_t *rank = graph->topo_rank;
+    size_t pos = dirty->count++;
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (rank[dirty->heap[parent]] <= rank[node]) {
+            break;
+        }
+        dirty->heap[pos] = dirty->heap[parent];
+        pos = parent;
+    }
+    dirty->heap[pos] = node;
+    dirty->queued[node] = 1;
+    return 0;
+}
+
+static uint32_t dag_dirty_pop(const DAGGraph *graph, DAGDirtySet *dirty) {
+    const uint32_t *rank = graph->topo_rank;
+    uint32_t top = dirty->heap[0];
+    uint32_t last = dirty->heap[--dirty->count];
+
+    // Sift the last element down from the root
+    size_t pos = 0;
+    for (;;) {
+        size_t child = 2 * pos + 1;
+        if (child >= dirty->count) {
+            break;
+        }
+        if (child + 1 < dirty->count &&
+            rank[dirty->heap[child + 1]] < rank[dirty->heap[child]]) {
+            child++;
+        }
+        if (rank[last] <= rank[dirty->heap[child]]) {
+            break;
+        }
+        dirty->heap[pos] = dirty->heap[child];
+        pos = child;
+    }
+    if (dirty->count > 0) {
+        dirty->heap[pos] = last;
+    }
+
+    dirty->queued[top] = 0;
+    return top;
+}
+
+/**
+ * Queue every successor of a node for recomputation
+ */
+static int dag_dirty_push_successors(DAGGraph *graph, DAGDirtySet *dirty, uint32_t node) {
+    for (uint32_t e = graph->out_offsets[node]; e < graph->out_offsets[node + 1]; e++) {
+        if (dag_dirty_push(graph, dirty, graph->out_targets[e]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int dag_graph_mark_dirty(DAGGraph *graph, DAGNode *node) {
+    if (!graph || !dag_graph_contains(graph, node)) {
+        return -1;
+    }
+
+    DAGDirtySet *dirty = dag_dirty_get(graph);
+    if (!dirty || dag_dirty_pin(graph, dirty, node) != 0) {
+        return -1;
+    }
+
+    // Without a valid resolution the next update is a full resolve
+    if (!graph->frozen || !graph->resolved) {
+        return 0;
+    }
+
+    uint32_t index = (uint32_t)node->index;
+    graph->states[index] = (uint8_t)node->state;
+    dag_index_states_stale(graph);
+    return dag_dirty_push_successors(graph, dirty, index);
+}
+
+int dag_graph_set_edge_weight(DAGGraph *graph, DAGNode *from, DAGNode *to,
+                              float weight) {
+    if (!graph || !dag_graph_contains(graph, from) || !dag_graph_contains(graph, to)) {
+        return -1;
+    }
+
+    // Builder lists first; they are what the next freeze reads
+    bool found = false;
+    for (size_t i = 0; i < from->out_count; i++) {
+        if (from->out_edges[i].target == to) {
+            from->out_edges[i].weight = weight;
+            found = true;
+        }
+    }
+    for (size_t i = 0; i < to->in_count; i++) {
+        if (to->in_edges[i].target == from) {
+            to->in_edges[i].weight = weight;
+        }
+    }
+    if (!found) {
+        return -1;
+    }
+    if (!graph->frozen) {
+        return 0;
+    }
+
+    uint32_t source = (uint32_t)from->index;
+    uint32_t target = (uint32_t)to->index;
+    for (uint32_t e = graph->out_offsets[source]; e < graph->out_offsets[source + 1]; e++) {
+        if (graph->out_targets[e] == target) {
+            graph->out_weights[e] = weight;
+        }
+    }
+    for (uint32_t e = graph->in_offsets[target]; e < graph->in_offsets[target + 1]; e++) {
+        if (graph->in_sources[e] == source) {
+            graph->in_weights[e] = weight;
+        }
+    }
+
+    if (!graph->resolved) {
+        return 0;
+    }
+
+    DAGDirtySet *dirty = dag_dirty_get(graph);
+    return dirty ? dag_dirty_push(graph, dirty, target) : -1;
+}
+
+/**
+ * Recompute queued nodes in rank order until no state changes
+ */
+static long dag_dirty_drain(DAGGraph *graph, DAGDirtySet *dirty) {
+    // Pop in rank order so each node sees its sources' final states
+    long changed = 0;
+    while (dirty->count > 0) {
+        uint32_t current = dag_dirty_pop(graph, dirty);
+        uint8_t state = (uint8_t)dag_vote_node(graph, current);
+        TRACE_COUNT(TRACE_COUNTER_NODES_VISITED, 1);
+
+        // Early stop: an unchanged state cannot affect the successors
+        if (state == graph->states[current]) {
+            continue;
+        }
+
+        graph->states[current] = state;
+        graph->nodes[current]->state = (NodeState)state;
+        changed++;
+
+        if (dag_dirty_push_successors(graph, dirty, current) != 0) {
+            dag_index_states_stale(graph);
+            return -1;
+        }
+    }
+
+    if (changed > 0) {
+        dag_index_states_stale(graph);
+    }
+    return changed;
+}
+
+/**
+ * Resolve everything, then put the pinned states back and update
+ * downstream of them
+ */
+static long dag_dirty_resolve_full(DAGGraph *graph) {
+    NodeState *before = (NodeState *)malloc((graph->node_count + 1) * sizeof(NodeState));
+    if (!before) {
+        return -1;
+    }
+    for (size_t i = 0; i < graph->node_count; i++) {
+        before[i] = graph->nodes[i]->state;
+    }
+
+    // Take the pins out of the way of the resolve, which drops them
+    DAGDirtyPin *pins = NULL;
+    size_t pin_count = 0;
+    size_t pin_capacity = 0;
+    if (graph->dirty) {
+        pins = graph->dirty->pins;
+        pin_count = graph->dirty->pin_count;
+        pin_capacity = graph->dirty->pin_capacity;
+        graph->dirty->pins = NULL;
+        graph->dirty->pin_count = 0;
+        graph->dirty->pin_capacity = 0;
+    }
+
+    long changed = -1;
+    bool resolved = dag_graph_resolve(graph) == 0;
+    DAGDirtySet *dirty = dag_dirty_get(graph);
+    if (dirty) {
+        dirty->count = 0;
+        memset(dirty->queued, 0, dirty->node_count);
+    }
+
+    // Later pins of a node win; a node keeps its pin even on a cycle
+    int failed = 0;
+    for (size_t i = 0; i < pin_count; i++) {
+        DAGNode *node = pins[i].node;
+        if (!dag_graph_contains(graph, node)) {
+            continue;
+        }
+        node->state = pins[i].state;
+        if (graph->frozen && graph->states) {
+            graph->states[node->index] = (uint8_t)pins[i].state;
+        }
+        if (resolved && dirty) {
+            failed |= dag_dirty_push_successors(graph, dirty, (uint32_t)node->index);
+        }
+    }
+    if (pin_count > 0) {
+        dag_index_states_stale(graph);
+    }
+
+    if (resolved && dirty && failed == 0 && dag_dirty_drain(graph, dirty) >= 0) {
+        changed = 0;
+        for (size_t i = 0; i < graph->node_count; i++) {
+            changed += graph->nodes[i]->state != before[i];
+        }
+    }
+
+    poly_release(graph->allocator, pins, pin_capacity * sizeof(DAGDirtyPin));
+    free(before);
+    return changed;
+}
+
+long dag_graph_resolve_dirty(DAGGraph *graph) {
+    if (!graph) {
+        return -1;
+    }
+
+    // Structural changes invalidate ranks; resolve everything instead
+    if (!graph->frozen || !graph->resolved) {
+        return dag_dirty_resolve_full(graph);
+    }
+
+    DAGDirtySet *dirty = graph->dirty;
+    if (!dirty) {
+        return 0;
+    }
+    TRACE_SPAN("dag_graph_resolve_dirty");
+    dirty->pin_count = 0;
+    return dag_dirty_drain(graph, dirty);
+}
+
+// Rows of the node index: categories, then token types, then states
+#define DAG_INDEX_CATEGORIES (TAX_CONTROLLER + 1)
+#define DAG_INDEX_TYPES (TOKEN_OPERATOR + 1)
+#define DAG_INDEX_STATES (STATE_FALSE + 1)
+#define DAG_INDEX_ROWS (DAG_INDEX_CATEGORIES + DAG_INDEX_TYPES + DAG_INDEX_STATES)
+
+#define DAG_SET_WORDS(n) (((n) + 63) / 64)
+
+/**
+ * One bitset per category, token type and state over the node indices
+ *
+ * All rows share one block of word_capacity words each. Category and
+ * type rows follow dag_graph_add_node(); state rows are rebuilt on the
+ * first query after a resolve.
+ */
+struct DAGNodeIndex {
+    uint64_t *bits;
+    size_t word_capacity;
+    size_t node_count;          // Nodes indexed so far
+    bool states_valid;
+};
+
+static inline uint64_t *dag_index_row(const DAGNodeIndex *index, size_t row) {
+    return index->bits + row * index->word_capacity;
+}
+
+static void dag_index_free(const PolyAllocator *allocator, DAGNodeIndex *index) {
+    if (!index) return;
+    poly_release(allocator, index->bits,
+                 DAG_INDEX_ROWS * index->word_capacity * sizeof(uint64_t));
+    poly_release(allocator, index, sizeof(DAGNodeIndex));
+}
+
+/**
+ * Move the rows into a block of at least the given width
+ */
+static bool dag_index_reserve(const PolyAllocator *allocator, DAGNodeIndex *index,
+                              size_t words) {
+    if (words <= index->word_capacity) {
+        return true;
+    }
+    size_t capacity = index->word_capacity ? index->word_capacity : 16;
+    while (capacity < words) {
+        capacity *= 2;
+    }
+
+    uint64_t *bits = (uint64_t *)poly_calloc(allocator,
+                                             DAG_INDEX_ROWS * capacity * sizeof(uint64_t));
+    if (!bits) {
+        return false;
+    }
+    for (size_t row = 0; row < DAG_INDEX_ROWS && index->bits; row++) {
+        memcpy(bits + row * capacity, dag_index_row(index, row),
+               index->word_capacity * sizeof(uint64_t));
+    }
+    poly_release(allocator, index->bits,
+                 DAG_INDEX_ROWS * index->word_capacity * sizeof(uint64_t));
+    index->bits = bits;
+    index->word_capacity = capacity;
+    return true;
+}
+
+static inline void dag_index_set(DAGNodeIndex *index, size_t row, size_t node) {
+    dag_index_row(index, row)[node / 64] |= 1ull << (node % 64);
+}
+
+/**
+ * Index a node's category and type; out-of-range values are not indexed
+ */
+static void dag_index_classify(DAGNodeIndex *index, const DAGNode *node, size_t i) {
+    if ((unsigned)node->category < DAG_INDEX_CATEGORIES) {
+        dag_index_set(index, (size_t)node->category, i);
+    }
+    if ((unsigned)node->type < DAG_INDEX_TYPES) {
+        dag_index_set(index, DAG_INDEX_CATEGORIES + (size_t)node->type, i);
+    }
+}
+
+/**
+ * Get the graph's index, building it if missing or out of step
+ */
+static DAGNodeIndex *dag_index_get(DAGGraph *graph) {
+    DAGNodeIndex *index = graph->index;
+    if (index && index->node_count == graph->node_count) {
+        return index;
+    }
+
+    dag_index_free(graph->allocator, index);
+    graph->index = NULL;
+
+    index = (DAGNodeIndex *)poly_calloc(graph->allocator, sizeof(DAGNodeIndex));
+    if (!index) {
+        return NULL;
+    }
+    if (!dag_index_reserve(graph->allocator, index, DAG_SET_WORDS(graph->node_count))) {
+        poly_release(graph->allocator, index, sizeof(DAGNodeIndex));
+        return NULL;
+    }
+
+    for (size_t i = 0; i < graph->node_count; i++) {
+        dag_index_classify(index, graph->nodes[i], i);
+    }
+    index->node_count = graph->node_count;
+    graph->index = index;
+    return index;
+}
+
+static void dag_index_append(DAGGraph *graph, const DAGNode *node) {
+    DAGNodeIndex *index = graph->index;
+    if (!index) {
+        return;
+    }
+
+    // Anything but the next node in line means the index is out of step
+    size_t i = graph->node_count - 1;
+    if (index->node_count != i ||
+        !dag_index_reserve(graph->allocator, index, DAG_SET_WORDS(i + 1))) {
+        dag_index_free(graph->allocator, index);
+        graph->index = NULL;
+        return;
+    }
+
+    dag_index_classify(index, node, i);
+    index->node_count = i + 1;
+    index->states_valid = false;
+}
+
+static void dag_index_states_stale(DAGGraph *graph) {
+    if (graph->index) {
+        graph->index->states_valid = false;
+    }
+}
+
+/**
+ * Rebuild the state rows from the states published on the nodes
+ */
+static void dag_index_states(const DAGGraph *graph, DAGNodeIndex *index) {
+    if (index->states_valid) {
+        return;
+    }
+
+    uint64_t *rows[DAG_INDEX_STATES];
+    for (size_t s = 0; s < DAG_INDEX_STATES; s++) {
+        rows[s] = dag_index_row(index, DAG_INDEX_CATEGORIES + DAG_INDEX_TYPES + s);
+        memset(rows[s], 0, index->word_capacity * sizeof(uint64_t));
+    }
+
+    // The nodes, not the dense copy, see states written by the caller
+    for (size_t i = 0; i < graph->node_count; i++) {
+        unsigned state = (unsigned)graph->nodes[i]->state;
+        if (state < DAG_INDEX_STATES) {
+            rows[state][i / 64] |= 1ull << (i % 64);
+        }
+    }
+    index->states_valid = true;
+}
+
+DAGNodeSet* dag_node_set_create(size_t node_count) {
+    DAGNodeSet *set = (DAGNodeSet *)malloc(sizeof(DAGNodeSet));
+    if (!set) {
+        return NULL;
+    }
+    set->words = (uint64_t *)calloc(DAG_SET_WORDS(node_count) ? DAG_SET_WORDS(node_count) : 1,
+                                    sizeof(uint64_t));
+    if (!set->words) {
+        free(set);
+        return NULL;
+    }
+    set->node_count = node_count;
+    return set;
+}
+
+void dag_node_set_free(DAGNodeSet *set) {
+    if (!set) return;
+    free(set->words);
+    free(set);
+}
+
+int dag_node_set_add(DAGNodeSet *set, size_t node) {
+    if (!set || node >= set->node_count) {
+        return -1;
+    }
+    set->words[node / 64] |= 1ull << (node % 64);
+    return 0;
+}
+
+bool dag_node_set_contains(const DAGNodeSet *set, size_t node) {
+    return set && node < set->node_count &&
+           (set->words[node / 64] >> (node % 64)) & 1u;
+}
+
+size_t dag_node_set_count(const DAGNodeSet *set) {
+    size_t count = 0;
+    for (size_t w = 0; set && w < DAG_SET_WORDS(set->node_count); w++) {
+        count += (size_t)__builtin_popcountll(set->words[w]);
+    }
+    return count;
+}
+
+size_t dag_node_set_next(const DAGNodeSet *set, size_t from) {
+    if (!set || from >= set->node_count) {
+        return set ? set->node_count : 0;
+    }
+
+    size_t w = from / 64;
+    uint64_t word = set->words[w] & (~0ull << (from % 64));
+    size_t words = DAG_SET_WORDS(set->node_count);
+    while (word == 0) {
+        if (++w == words) {
+            return set->node_count;
+        }
+        word = set->words[w];
+    }
+    return w * 64 + (size_t)__builtin_ctzll(word);
+}
+
+int dag_node_set_and(DAGNodeSet *set, const DAGNodeSet *other) {
+    if (!set || !other || set->node_count != other->node_count) {
+        return -1;
+    }
+    for (size_t w = 0; w < DAG_SET_WORDS(set->node_count); w++) {
+        set->words[w] &= other->words[w];
+    }
+    return 0;
+}
+
+int dag_node_set_or(DAGNodeSet *set, const DAGNodeSet *other) {
+    if (!set || !other || set->node_count != other->node_count) {
+        return -1;
+    }
+    for (size_t w = 0; w < DAG_SET_WORDS(set->node_count); w++) {
+        set->words[w] |= other->words[w];
+    }
+    return 0;
+}
+
+int dag_node_set_and_not(DAGNodeSet *set, const DAGNodeSet *other) {
+    if (!set || !other || set->node_count != other->node_count) {
+        return -1;
+    }
+    for (size_t w = 0; w < DAG_SET_WORDS(set->node_count); w++) {
+        set->words[w] &= ~other->words[w];
+    }
+    return 0;
+}
+
+/**
+ * Copy one index row into a caller's set sized for the graph
+ */
+static int dag_index_select(DAGGraph *graph, size_t row, DAGNodeSet *out) {
+    if (!graph || !out || out->node_count != graph->node_count) {
+        return -1;
+    }
+    DAGNodeIndex *index = dag_index_get(graph);
+    if (!index) {
+        return -1;
+    }
+    if (row >= DAG_INDEX_CATEGORIES + DAG_INDEX_TYPES) {
+        dag_index_states(graph, index);
+    }
+    memcpy(out->words, dag_index_row(index, row),
+           DAG_SET_WORDS(graph->node_count) * sizeof(uint64_t));
+    return 0;
+}
+
+int dag_graph_select_category(DAGGraph *graph, TaxonomyCategory category, DAGNodeSet *out) {
+    if ((unsigned)category >= DAG_INDEX_CATEGORIES) {
+        return -1;
+    }
+    return dag_index_select(graph, (size_t)category, out);
+}
+
+int dag_graph_select_type(DAGGraph *graph, TokenType type, DAGNodeSet *out) {
+    if ((unsigned)type >= DAG_INDEX_TYPES) {
+        return -1;
+    }
+    return dag_index_select(graph, DAG_INDEX_CATEGORIES + (size_t)type, out);
+}
+
+int dag_graph_select_state(DAGGraph *graph, NodeState state, DAGNodeSet *out) {
+    if ((unsigned)state >= DAG_INDEX_STATES) {
+        return -1;
+    }
+    return dag_index_select(graph, DAG_INDEX_CATEGORIES + DAG_INDEX_TYPES + (size_t)state, out);
+}
+
+void dag_graph_states_changed(DAGGraph *graph) {
+    if (!graph) {
+        return;
+    }
+
+    // Incremental updates vote from the dense copy, so refresh it too
+    if (graph->frozen && graph->states) {
+        for (size_t i = 0; i < graph->node_count; i++) {
+            graph->states[i] = (uint8_t)graph->nodes[i]->state;
+        }
+    }
+    dag_index_states_stale(graph);
+}
+
+int dag_graph_select_reachable(DAGGraph *graph, const DAGNodeSet *from, DAGNodeSet *out) {
+    if (!graph || !from || !out || from->node_count != graph->node_count ||
+        out->node_count != graph->node_count || dag_graph_freeze(graph) != 0) {
+        return -1;
+    }
+
+    size_t words = DAG_SET_WORDS(graph->node_count);
+    uint32_t *stack = (uint32_t *)malloc((graph->node_count ? graph->node_count : 1) *
+                                         sizeof(uint32_t));
+    if (!stack) {
+        return -1;
+    }
+
+    // The output doubles as the visited set; seeds are reachable from themselves
+    if (out != from) {
+        memcpy(out->words, from->words, words * sizeof(uint64_t));
+    }
+    size_t top = 0;
+    for (size_t i = dag_node_set_next(out, 0); i < graph->node_count;
+         i = dag_node_set_next(out, i + 1)) {
+        stack[top++] = (uint32_t)i;
+    }
+
+    while (top > 0) {
+        uint32_t current = stack[--top];
+        for (uint32_t e = graph->out_offsets[current];
+             e < graph->out_offsets[current + 1]; e++) {
+            uint32_t target = graph->out_targets[e];
+            uint64_t bit = 1ull << (target % 64);
+            if (!(out->words[target / 64] & bit)) {
+                out->words[target / 64] |= bit;
+                stack[top++] = target;
+            }
+        }
+    }
+
+    free(stack);
+    return 0;
+}
+
+void dag_graph_free(DAGGraph *graph) {
+    if (!graph) {
+        return;
+    }
+
+    for (size_t i = 0; i < graph->node_count; i++) {
+        if (graph->nodes[i]->graph == graph) {
+            graph->nodes[i]->graph = NULL;
+        }
+    }
+
+    dag_graph_release_csr(graph);
+    dag_dirty_free(graph->allocator, graph->dirty);
+    dag_index_free(graph->allocator, graph->index);
+    poly_release(graph->allocator, graph->nodes, graph->node_capacity * sizeof(DAGNode *));
+    poly_release(graph->allocator, graph, sizeof(DAGGraph));
+}
+
+void dag_graph_free_all(DAGGraph *graph) {
+    if (!graph) {
+        return;
+    }
+
+    for (size_t i = 0; i < graph->node_count; i++) {
+        dag_node_free(graph->nodes[i]);
+    }
+
+    // The nodes are gone, so skip the detach pass of dag_graph_free()
+    graph->node_count = 0;
+    dag_graph_free(graph);
+}
+
+// Records per producer log chunk and edges per row sorted in place
+#define DAG_BUILDER_CHUNK 4096
+#define DAG_BUILDER_SORT_INLINE 16
+
+typedef struct DAGBuilderNode {
+    uint32_t index;
+    uint8_t type;
+    uint8_t category;
+} DAGBuilderNode;
+
+typedef struct DAGBuilderEdge {
+    uint32_t from;
+    uint32_t to;
+    float weight;
+} DAGBuilderEdge;
+
+/**
+ * Fixed block of a producer's log; full chunks are never moved
+ */
+typedef struct DAGBuilderChunk {
+    struct DAGBuilderChunk *next;
+    size_t count;
+    union {
+        DAGBuilderNode nodes[DAG_BUILDER_CHUNK];
+        DAGBuilderEdge edges[DAG_BUILDER_CHUNK];
+    } records;
+} DAGBuilderChunk;
+
+struct DAGProducer {
+    DAGBuilder *builder;
+    struct DAGProducer *next;   // Registry link
+    DAGBuilderChunk *nodes;     // Newest chunk first
+    DAGBuilderChunk *edges;
+    bool failed;                // An append could not be recorded
+};
+
+struct DAGBuilder {
+    _Atomic(DAGProducer *) producers;
+    atomic_uint_fast32_t node_count;
+};
+
+DAGBuilder* dag_builder_create(void) {
+    DAGBuilder *builder = (DAGBuilder *)calloc(1, sizeof(DAGBuilder));
+    if (builder) {
+        atomic_init(&builder->producers, NULL);
+        atomic_init(&builder->node_count, 0);
+    }
+    return builder;
+}
+
+DAGProducer* dag_builder_producer(DAGBuilder *builder) {
+    if (!builder) {
+        return NULL;
+    }
+
+    DAGProducer *producer = (DAGProducer *)calloc(1, sizeof(DAGProducer));
+    if (!producer) {
+        return NULL;
+    }
+    producer->builder = builder;
+
+    DAGProducer *head = atomic_load_explicit(&builder->producers, memory_order_relaxed);
+    do {
+        producer->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&builder->producers, &head, producer,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+    return producer;
+}
+
+/**
+ * Get a chunk with room for one more record, starting a new one if full
+ */
+static DAGBuilderChunk *dag_producer_chunk(DAGProducer *producer, DAGBuilderChunk **log) {
+    if (*log && (*log)->count < DAG_BUILDER_CHUNK) {
+        return *log;
+    }
+    DAGBuilderChunk *chunk = (DAGBuilderChunk *)malloc(sizeof(DAGBuilderChunk));
+    if (!chunk) {
+        producer->failed = true;
+        return NULL;
+    }
+    chunk->next = *log;
+    chunk->count = 0;
+    *log = chunk;
+    return chunk;
+}
+
+uint32_t dag_producer_add_node(DAGProducer *producer, TokenType type, TaxonomyCategory category) {
+    if (!producer) {
+        return DAG_BUILDER_NONE;
+    }
+    DAGBuilderChunk *chunk = dag_producer_chunk(producer, &producer->nodes);
+    if (!chunk) {
+        return DAG_BUILDER_NONE;
+    }
+
+    uint_fast32_t index = atomic_fetch_add_explicit(&producer->builder->node_count, 1,
+                                                    memory_order_relaxed);
+    if (index >= DAG_BUILDER_NONE) {
+        producer->failed = true;
+        return DAG_BUILDER_NONE;
+    }
+
+    DAGBuilderNode *record = &chunk->records.nodes[chunk->count++];
+    record->index = (uint32_t)index;
+    record->type = (uint8_t)type;
+    record->category = (uint8_t)category;
+    return (uint32_t)index;
+}
+
+int dag_producer_add_edge(DAGProducer *producer, uint32_t from, uint32_t to, float weight) {
+    if (!producer) {
+        return -1;
+    }
+    DAGBuilderChunk *chunk = dag_producer_chunk(producer, &producer->edges);
+    if (!chunk) {
+        return -1;
+    }
+
+    DAGBuilderEdge *record = &chunk->records.edges[chunk->count++];
+    record->from = from;
+    record->to = to;
+    record->weight = weight;
+    return 0;
+}
+
+/**
+ * Shared state of the parallel compaction passes
+ */
+typedef struct DAGBuilderFinish {
+    DAGGraph *graph;
+    DAGBuilderChunk **node_chunks;
+    DAGBuilderChunk **edge_chunks;
+    atomic_uint *out_cursor;    // Degree counts, then scatter cursors
+    atomic_uint *in_cursor;
+    atomic_bool failed;
+} DAGBuilderFinish;
+
+static void dag_finish_nodes(void *ctx, size_t begin, size_t end, size_t worker) {
+    DAGBuilderFinish *finish = (DAGBuilderFinish *)ctx;
+    (void)worker;
+
+    for (size_t c = begin; c < end; c++) {
+        const DAGBuilderChunk *chunk = finish->node_chunks[c];
+        for (size_t i = 0; i < chunk->count; i++) {
+            const DAGBuilderNode *record = &chunk->records.nodes[i];
+            DAGNode *node = dag_node_create((TokenType)record->type,
+                                            (TaxonomyCategory)record->category);
+            if (!node) {
+                atomic_store_explicit(&finish->failed, true, memory_order_relaxed);
+                continue;
+            }
+            node->index = record->index;
+            node->graph = finish->graph;
+            finish->graph->nodes[record->index] = node;
+        }
+    }
+}
+
+static void dag_finish_count(void *ctx, size_t begin, size_t end, size_t worker) {
+    DAGBuilderFinish *finish = (DAGBuilderFinish *)ctx;
+    size_t n = finish->graph->node_count;
+    (void)worker;
+
+    for (size_t c = begin; c < end; c++) {
+        const DAGBuilderChunk *chunk = finish->edge_chunks[c];
+        for (size_t i = 0; i < chunk->count; i++) {
+            const DAGBuilderEdge *edge = &chunk->records.edges[i];
+            if (edge->from >= n || edge->to >= n) {
+                atomic_store_explicit(&finish->failed, true, memory_order_relaxed);
+                continue;
+            }
+            atomic_fetch_add_explicit(&finish->out_cursor[edge->from], 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&finish->in_cursor[edge->to], 1, memory_order_relaxed);
+        }
+    }
+}
+
+static void dag_finish_scatter(void *ctx, size_t begin, size_t end, size_t worker) {
+    DAGBuilderFinish *finish = (DAGBuilderFinish *)ctx;
+    DAGGraph *graph = finish->graph;
+    (void)worker;
+
+    for (size_t c = begin; c < end; c++) {
+        const DAGBuilderChunk *chunk = finish->edge_chunks[c];
+        for (size_t i = 0; i < chunk->count; i++) {
+            const DAGBuilderEdge *edge = &chunk->records.edges[i];
+            uint32_t out = atomic_fetch_add_explicit(&finish->out_cursor[edge->from], 1,
+                                                     memory_order_relaxed);
+            graph->out_targets[out] = edge->to;
+            graph->out_weights[out] = edge->weight;
+            uint32_t in = atomic_fetch_add_explicit(&finish->in_cursor[edge->to], 1,
+                                                    memory_order_relaxed);
+            graph->in_sources[in] = edge->from;
+            graph->in_weights[in] = edge->weight;
+        }
+    }
+}
+
+typedef struct DAGBuilderPair {
+    uint32_t node;
+    float weight;
+} DAGBuilderPair;
+
+static int dag_builder_pair_compare(const void *a, const void *b) {
+    const DAGBuilderPair *x = (const DAGBuilderPair *)a;
+    const DAGBuilderPair *y = (const DAGBuilderPair *)b;
+    if (x->node != y->node) {
+        return x->node < y->node ? -1 : 1;
+    }
+    return (x->weight > y->weight) - (x->weight < y->weight);
+}
+
+/**
+ * Order one CSR row by neighbour, then weight, whatever the scatter order
+ */
+static bool dag_builder_sort_row(uint32_t *nodes, float *weights, size_t count) {
+    if (count <= DAG_BUILDER_SORT_INLINE) {
+        for (size_t i = 1; i < count; i++) {
+            DAGBuilderPair key = { nodes[i], weights[i] };
+            size_t j = i;
+            while (j > 0) {
+                DAGBuilderPair prev = { nodes[j - 1], weights[j - 1] };
+                if (dag_builder_pair_compare(&prev, &key) <= 0) {
+                    break;
+                }
+                nodes[j] = prev.node;
+                weights[j] = prev.weight;
+                j--;
+            }
+            nodes[j] = key.node;
+            weights[j] = key.weight;
+        }
+        return true;
+    }
+
+    DAGBuilderPair *pairs = (DAGBuilderPair *)malloc(count * sizeof(DAGBuilderPair));
+    if (!pairs) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        pairs[i].node = nodes[i];
+        pairs[i].weight = weights[i];
+    }
+    qsort(pairs, count, sizeof(DAGBuilderPair), dag_builder_pair_compare);
+    for (size_t i = 0; i < count; i++) {
+        nodes[i] = pairs[i].node;
+        weights[i] = pairs[i].weight;
+    }
+    free(pairs);
+    return true;
+}
+
+/**
+ * Copy one CSR row into a node's edge list
+ */
+static bool dag_builder_fill_edges(const DAGGraph *graph, const DAGNode *node,
+                                   const uint32_t *nodes, const float *weights, size_t count,
+                                   DAGEdge **edges, size_t *edge_count, size_t *capacity) {
+    if (count == 0) {
+        return true;
+    }
+    *edges = (DAGEdge *)poly_alloc(node->allocator, count * sizeof(DAGEdge));
+    if (!*edges) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        (*edges)[i].target = graph->nodes[nodes[i]];
+        (*edges)[i].weight = weights[i];
+    }
+    *edge_count = count;
+    *capacity = count;
+    return true;
+}
+
+static void dag_finish_rows(void *ctx, size_t begin, size_t end, size_t worker) {
+    DAGBuilderFinish *finish = (DAGBuilderFinish *)ctx;
+    DAGGraph *graph = finish->graph;
+    (void)worker;
+
+    for (size_t i = begin; i < end; i++) {
+        DAGNode *node = graph->nodes[i];
+        uint32_t out = graph->out_offsets[i];
+        uint32_t out_count = graph->out_offsets[i + 1] - out;
+        uint32_t in = graph->in_offsets[i];
+        uint32_t in_count = graph->in_offsets[i + 1] - in;
+
+        uint32_t *out_targets = graph->out_targets + out;
+        float *out_weights = graph->out_weights + out;
+        uint32_t *in_sources = graph->in_sources + in;
+        float *in_weights = graph->in_weights + in;
+
+        if (!dag_builder_sort_row(out_targets, out_weights, out_count) ||
+            !dag_builder_sort_row(in_sources, in_weights, in_count) ||
+            !dag_builder_fill_edges(graph, node, out_targets, out_weights, out_count,
+                                    &node->out_edges, &node->out_count, &node->out_capacity) ||
+            !dag_builder_fill_edges(graph, node, in_sources, in_weights, in_count,
+                                    &node->in_edges, &node->in_count, &node->in_capacity)) {
+            atomic_store_explicit(&finish->failed, true, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * Collect the chunks of every producer's node or edge log
+ */
+static DAGBuilderChunk **dag_builder_chunks(DAGBuilder *builder, bool edges, size_t *count) {
+    *count = 0;
+    DAGProducer *head = atomic_load_explicit(&builder->producers, memory_order_acquire);
+    for (DAGProducer *p = head; p; p = p->next) {
+        for (DAGBuilderChunk *c = edges ? p->edges : p->nodes; c; c = c->next) {
+            (*count)++;
+        }
+    }
+
+    DAGBuilderChunk **chunks = (DAGBuilderChunk **)malloc((*count ? *count : 1) *
+                                                          sizeof(DAGBuilderChunk *));
+    if (!chunks) {
+        return NULL;
+    }
+    size_t filled = 0;
+    for (DAGProducer *p = head; p; p = p->next) {
+        for (DAGBuilderChunk *c = edges ? p->edges : p->nodes; c; c = c->next) {
+            chunks[filled++] = c;
+        }
+    }
+    return chunks;
+}
+
+DAGGraph* dag_builder_finish(DAGBuilder *builder, size_t thread_count) {
+    if (!builder) {
+        return NULL;
+    }
+
+    ThreadPool *pool = thread_pool_create(thread_count);
+    if (!pool) {
+        return NULL;
+    }
+    DAGGraph *graph = dag_builder_finish_on(builder, pool);
+    thread_pool_destroy(pool);
+    return graph;
+}
+
+DAGGraph* dag_builder_finish_on(DAGBuilder *builder, ThreadPool *pool) {
+    if (!builder) {
+        return NULL;
+    }
+    TRACE_SPAN("dag_builder_finish");
+
+    size_t n = (size_t)atomic_load_explicit(&builder->node_count, memory_order_acquire);
+    DAGProducer *head = atomic_load_explicit(&builder->producers, memory_order_acquire);
+    for (DAGProducer *p = head; p; p = p->next) {
+        if (p->failed) {
+            return NULL;
+        }
+    }
+
+    DAGBuilderFinish finish;
+    size_t node_chunk_count, edge_chunk_count;
+    finish.graph = dag_graph_create(n);
+    finish.node_chunks = dag_builder_chunks(builder, false, &node_chunk_count);
+    finish.edge_chunks = dag_builder_chunks(builder, true, &edge_chunk_count);
+    finish.out_cursor = (atomic_uint *)malloc((n + 1) * sizeof(atomic_uint));
+    finish.in_cursor = (atomic_uint *)malloc((n + 1) * sizeof(atomic_uint));
+    atomic_init(&finish.failed, false);
+
+    // A NULL pool runs every pass inline on the caller
+    DAGGraph *graph = finish.graph;
+    bool ok = graph && finish.node_chunks && finish.edge_chunks && finish.out_cursor &&
+              finish.in_cursor;
+    size_t edge_count = 0;
+    for (size_t c = 0; ok && c < edge_chunk_count; c++) {
+        edge_count += finish.edge_chunks[c]->count;
+    }
+
+    if (ok) {
+        // Every index was handed out exactly once, so each slot gets a node
+        if (n > 0) {
+            memset(graph->nodes, 0, n * sizeof(DAGNode *));
+        }
+        graph->node_count = n;
+        thread_pool_parallel_for(pool, node_chunk_count, 1, dag_finish_nodes, &finish);
+        ok = !atomic_load(&finish.failed) && dag_graph_alloc_csr(graph, edge_count) == 0;
+    }
+
+    if (ok) {
+        for (size_t i = 0; i < n; i++) {
+            atomic_init(&finish.out_cursor[i], 0);
+            atomic_init(&finish.in_cursor[i], 0);
+        }
+        thread_pool_parallel_for(pool, edge_chunk_count, 1, dag_finish_count, &finish);
+        ok = !atomic_load(&finish.failed);
+    }
+
+    if (ok) {
+        // Prefix sums turn the degrees into row offsets and scatter cursors
+        for (size_t i = 0; i < n; i++) {
+            graph->out_offsets[i + 1] = graph->out_offsets[i] +
+                                        atomic_load_explicit(&finish.out_cursor[i],
+                                                             memory_order_relaxed);
+            graph->in_offsets[i + 1] = graph->in_offsets[i] +
+                                       atomic_load_explicit(&finish.in_cursor[i],
+                                                            memory_order_relaxed);
+            atomic_store_explicit(&finish.out_cursor[i], graph->out_offsets[i],
+                                  memory_order_relaxed);
+            atomic_store_explicit(&finish.in_cursor[i], graph->in_offsets[i],
+                                  memory_order_relaxed);
+        }
+        thread_pool_parallel_for(pool, edge_chunk_count, 1, dag_finish_scatter, &finish);
+        thread_pool_parallel_for(pool, n, 0, dag_finish_rows, &finish);
+        ok = !atomic_load(&finish.failed);
+    }
+
+    free(finish.node_chunks);
+    free(finish.edge_chunks);
+    free(finish.out_cursor);
+    free(finish.in_cursor);
+
+    if (!ok) {
+        if (graph) {
+            // Nodes that were never created leave holes to skip
+            size_t kept = 0;
+            for (size_t i = 0; i < graph->node_count; i++) {
+                if (graph->nodes[i]) {
+                    graph->nodes[kept++] = graph->nodes[i];
+                }
+            }
+            graph->node_count = kept;
+        }
+        dag_graph_free_all(graph);
+        return NULL;
+    }
+
+    graph->edge_count = edge_count;
+    graph->frozen = true;
+    return graph;
+}
+
+void dag_builder_free(DAGBuilder *builder) {
+    if (!builder) {
+        return;
+    }
+
+    DAGProducer *producer = atomic_load_explicit(&builder->producers, memory_order_acquire);
+    while (producer) {
+        DAGProducer *next = producer->next;
+        DAGBuilderChunk *logs[2] = { producer->nodes, producer->edges };
+        for (int i = 0; i < 2; i++) {
+            while (logs[i]) {
+                DAGBuilderChunk *chunk = logs[i]->next;
+                free(logs[i]);
+                logs[i] = chunk;
+            }
+        }
+        free(producer);
+        producer = next;
+    }
+    free(builder);
+}
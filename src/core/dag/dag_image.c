@@ -0,0 +1,562 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dag_image.h"
+#include "../io/atomic_file.h"
+
+#define DAG_IMAGE_MAGIC "PBDAGIMG"
+
+// Written as a native integer; reads back differently on the other byte order
+#define DAG_IMAGE_BYTE_ORDER 0x01020304u
+
+// Header flags
+#define DAG_IMAGE_RESOLVED 0x1u
+
+// Sections start on this boundary so the arrays can be used in place
+#define DAG_IMAGE_ALIGN 8
+
+// Categories are stored for every TaxonomyCategory value
+#define DAG_IMAGE_CATEGORY_COUNT (TAX_CONTROLLER + 1)
+
+typedef enum {
+    DAG_IMAGE_NODES,
+    DAG_IMAGE_OUT_OFFSETS,
+    DAG_IMAGE_OUT_TARGETS,
+    DAG_IMAGE_OUT_WEIGHTS,
+    DAG_IMAGE_IN_OFFSETS,
+    DAG_IMAGE_IN_SOURCES,
+    DAG_IMAGE_IN_WEIGHTS,
+    DAG_IMAGE_CATEGORIES,
+    DAG_IMAGE_CATEGORY_NODES,
+    DAG_IMAGE_STRINGS,
+    DAG_IMAGE_SECTION_COUNT
+} DAGImageSectionId;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+} DAGImageSection;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t node_count;
+    uint32_t edge_count;
+    uint32_t category_count;
+    uint32_t flags;
+    uint64_t file_size;
+    DAGImageSection sections[DAG_IMAGE_SECTION_COUNT];
+} DAGImageHeader;
+
+typedef struct {
+    uint8_t type;
+    uint8_t category;
+    uint8_t state;
+    uint8_t reserved;
+    uint32_t rank;
+    uint32_t name_offset;       // Into the string pool; 0 is the empty name
+    uint32_t name_len;
+} DAGImageNode;
+
+typedef struct {
+    uint32_t first;             // Into the category node list
+    uint32_t count;
+    uint32_t name_offset;
+    uint32_t name_len;
+} DAGImageCategory;
+
+struct DAGImage {
+    void *map;
+    size_t map_size;
+    const DAGImageHeader *header;
+    const DAGImageNode *nodes;
+    const uint32_t *out_offsets;
+    const uint32_t *out_targets;
+    const float *out_weights;
+    const uint32_t *in_offsets;
+    const uint32_t *in_sources;
+    const float *in_weights;
+    const DAGImageCategory *categories;
+    const uint32_t *category_nodes;
+    const char *strings;
+};
+
+static const char *const dag_image_category_names[DAG_IMAGE_CATEGORY_COUNT] = {
+    "unknown", "action", "resource", "property", "controller"
+};
+
+static size_t dag_image_align(size_t size) {
+    return (size + DAG_IMAGE_ALIGN - 1) & ~(size_t)(DAG_IMAGE_ALIGN - 1);
+}
+
+/**
+ * Append a NUL-terminated string to the pool being built
+ */
+static bool dag_image_intern(char *pool, size_t *used, const char *text, size_t len,
+                             uint32_t *offset) {
+    if (len == 0) {
+        *offset = 0;
+        return true;
+    }
+    if (*used + len + 1 > UINT32_MAX) {
+        return false;
+    }
+    *offset = (uint32_t)*used;
+    memcpy(pool + *used, text, len);
+    pool[*used + len] = '\0';
+    *used += len + 1;
+    return true;
+}
+
+int dag_image_write(DAGGraph *graph, const char *const *names, const char *path) {
+    if (!graph || !path || dag_graph_freeze(graph) != 0) {
+        return -1;
+    }
+
+    size_t n = graph->node_count;
+    size_t edges = graph->edge_count;
+
+    // Pool size: a leading empty string, then every name with its terminator
+    size_t pool_size = 1;
+    for (size_t i = 0; names && i < n; i++) {
+        if (names[i] && names[i][0]) {
+            pool_size += strlen(names[i]) + 1;
+        }
+    }
+    for (size_t i = 0; i < DAG_IMAGE_CATEGORY_COUNT; i++) {
+        pool_size += strlen(dag_image_category_names[i]) + 1;
+    }
+
+    DAGImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DAG_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = DAG_IMAGE_VERSION;
+    header.byte_order = DAG_IMAGE_BYTE_ORDER;
+    header.node_count = (uint32_t)n;
+    header.edge_count = (uint32_t)edges;
+    header.category_count = DAG_IMAGE_CATEGORY_COUNT;
+    header.flags = graph->resolved ? DAG_IMAGE_RESOLVED : 0;
+
+    size_t sizes[DAG_IMAGE_SECTION_COUNT] = {
+        n * sizeof(DAGImageNode),
+        (n + 1) * sizeof(uint32_t),
+        edges * sizeof(uint32_t),
+        edges * sizeof(float),
+        (n + 1) * sizeof(uint32_t),
+        edges * sizeof(uint32_t),
+        edges * sizeof(float),
+        DAG_IMAGE_CATEGORY_COUNT * sizeof(DAGImageCategory),
+        n * sizeof(uint32_t),
+        pool_size
+    };
+    size_t offset = dag_image_align(sizeof(DAGImageHeader));
+    for (int i = 0; i < DAG_IMAGE_SECTION_COUNT; i++) {
+        header.sections[i].offset = offset;
+        header.sections[i].size = sizes[i];
+        offset = dag_image_align(offset + sizes[i]);
+    }
+    header.file_size = offset;
+
+    char *buffer = (char *)calloc(1, offset);
+    if (!buffer) {
+        return -1;
+    }
+    memcpy(buffer, &header, sizeof(header));
+
+    // CSR rows are copied verbatim from the frozen graph
+    memcpy(buffer + header.sections[DAG_IMAGE_OUT_OFFSETS].offset, graph->out_offsets,
+           sizes[DAG_IMAGE_OUT_OFFSETS]);
+    memcpy(buffer + header.sections[DAG_IMAGE_IN_OFFSETS].offset, graph->in_offsets,
+           sizes[DAG_IMAGE_IN_OFFSETS]);
+    if (edges > 0) {
+        memcpy(buffer + header.sections[DAG_IMAGE_OUT_TARGETS].offset, graph->out_targets,
+               sizes[DAG_IMAGE_OUT_TARGETS]);
+        memcpy(buffer + header.sections[DAG_IMAGE_OUT_WEIGHTS].offset, graph->out_weights,
+               sizes[DAG_IMAGE_OUT_WEIGHTS]);
+        memcpy(buffer + header.sections[DAG_IMAGE_IN_SOURCES].offset, graph->in_sources,
+               sizes[DAG_IMAGE_IN_SOURCES]);
+        memcpy(buffer + header.sections[DAG_IMAGE_IN_WEIGHTS].offset, graph->in_weights,
+               sizes[DAG_IMAGE_IN_WEIGHTS]);
+    }
+
+    char *pool = buffer + header.sections[DAG_IMAGE_STRINGS].offset;
+    size_t pool_used = 1;
+    bool ok = true;
+
+    DAGImageNode *records = (DAGImageNode *)(buffer + header.sections[DAG_IMAGE_NODES].offset);
+    for (size_t i = 0; ok && i < n; i++) {
+        const DAGNode *node = graph->nodes[i];
+        const char *name = names && names[i] ? names[i] : "";
+        records[i].type = (uint8_t)node->type;
+        records[i].category = (uint8_t)node->category;
+        records[i].state = (uint8_t)node->state;
+        records[i].rank = graph->resolved ? graph->topo_rank[i] : UINT32_MAX;
+        records[i].name_len = (uint32_t)strlen(name);
+        ok = dag_image_intern(pool, &pool_used, name, records[i].name_len,
+                              &records[i].name_offset);
+    }
+
+    // Category lists by counting sort, so each list stays in index order
+    DAGImageCategory *categories =
+        (DAGImageCategory *)(buffer + header.sections[DAG_IMAGE_CATEGORIES].offset);
+    uint32_t *category_nodes =
+        (uint32_t *)(buffer + header.sections[DAG_IMAGE_CATEGORY_NODES].offset);
+    uint32_t fill[DAG_IMAGE_CATEGORY_COUNT] = {0};
+    for (size_t i = 0; ok && i < n; i++) {
+        if (graph->nodes[i]->category >= DAG_IMAGE_CATEGORY_COUNT) {
+            ok = false;
+            break;
+        }
+        categories[graph->nodes[i]->category].count++;
+    }
+    for (size_t c = 0, first = 0; ok && c < DAG_IMAGE_CATEGORY_COUNT; c++) {
+        categories[c].first = (uint32_t)first;
+        fill[c] = (uint32_t)first;
+        first += categories[c].count;
+        categories[c].name_len = (uint32_t)strlen(dag_image_category_names[c]);
+        ok = dag_image_intern(pool, &pool_used, dag_image_category_names[c],
+                              categories[c].name_len, &categories[c].name_offset);
+    }
+    for (size_t i = 0; ok && i < n; i++) {
+        category_nodes[fill[graph->nodes[i]->category]++] = (uint32_t)i;
+    }
+
+    AtomicFile file;
+    ok = ok && atomic_file_open(&file, path, 0666) == 0;
+    if (ok) {
+        FILE *stream = atomic_file_stream(&file);
+        ok = stream && fwrite(buffer, 1, offset, stream) == offset;
+        ok = atomic_file_close(&file, ok) == 0;
+    }
+
+    free(buffer);
+    return ok ? 0 : -1;
+}
+
+/**
+ * Check that a section lies inside the file, aligned and of the expected size
+ */
+static bool dag_image_section_valid(const DAGImageHeader *header, DAGImageSectionId id,
+                                    uint64_t expected) {
+    const DAGImageSection *section = &header->sections[id];
+    return section->offset % DAG_IMAGE_ALIGN == 0 &&
+           section->offset <= header->file_size &&
+           section->size <= header->file_size - section->offset &&
+           section->size == expected;
+}
+
+DAGImage *dag_image_open(const char *path) {
+    if (!path) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(DAGImageHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    const DAGImageHeader *header = (const DAGImageHeader *)map;
+    uint64_t n = header->node_count;
+    uint64_t edges = header->edge_count;
+    bool valid = memcmp(header->magic, DAG_IMAGE_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == DAG_IMAGE_VERSION &&
+                 header->byte_order == DAG_IMAGE_BYTE_ORDER &&
+                 header->file_size == size &&
+                 header->category_count == DAG_IMAGE_CATEGORY_COUNT &&
+                 dag_image_section_valid(header, DAG_IMAGE_NODES, n * sizeof(DAGImageNode)) &&
+                 dag_image_section_valid(header, DAG_IMAGE_OUT_OFFSETS, (n + 1) * sizeof(uint32_t)) &&
+                 dag_image_section_valid(header, DAG_IMAGE_OUT_TARGETS, edges * sizeof(uint32_t)) &&
+                 dag_image_section_valid(header, DAG_IMAGE_OUT_WEIGHTS, edges * sizeof(float)) &&
+                 dag_image_section_valid(header, DAG_IMAGE_IN_OFFSETS, (n + 1) * sizeof(uint32_t)) &&
+                 dag_image_section_valid(header, DAG_IMAGE_IN_SOURCES, edges * sizeof(uint32_t)) &&
+                 dag_image_section_valid(header, DAG_IMAGE_IN_WEIGHTS, edges * sizeof(float)) &&
+                 dag_image_section_valid(header, DAG_IMAGE_CATEGORIES,
+                                         DAG_IMAGE_CATEGORY_COUNT * sizeof(DAGImageCategory)) &&
+                 dag_image_section_valid(header, DAG_IMAGE_CATEGORY_NODES, n * sizeof(uint32_t)) &&
+                 dag_image_section_valid(header, DAG_IMAGE_STRINGS,
+                                         header->sections[DAG_IMAGE_STRINGS].size) &&
+                 header->sections[DAG_IMAGE_STRINGS].size > 0;
+
+    DAGImage *image = valid ? (DAGImage *)calloc(1, sizeof(DAGImage)) : NULL;
+    if (!image) {
+        munmap(map, size);
+        return NULL;
+    }
+
+    const char *base = (const char *)map;
+    image->map = map;
+    image->map_size = size;
+    image->header = header;
+    image->nodes = (const DAGImageNode *)(base + header->sections[DAG_IMAGE_NODES].offset);
+    image->out_offsets = (const uint32_t *)(base + header->sections[DAG_IMAGE_OUT_OFFSETS].offset);
+    image->out_targets = (const uint32_t *)(base + header->sections[DAG_IMAGE_OUT_TARGETS].offset);
+    image->out_weights = (const float *)(base + header->sections[DAG_IMAGE_OUT_WEIGHTS].offset);
+    image->in_offsets = (const uint32_t *)(base + header->sections[DAG_IMAGE_IN_OFFSETS].offset);
+    image->in_sources = (const uint32_t *)(base + header->sections[DAG_IMAGE_IN_SOURCES].offset);
+    image->in_weights = (const float *)(base + header->sections[DAG_IMAGE_IN_WEIGHTS].offset);
+    image->categories =
+        (const DAGImageCategory *)(base + header->sections[DAG_IMAGE_CATEGORIES].offset);
+    image->category_nodes =
+        (const uint32_t *)(base + header->sections[DAG_IMAGE_CATEGORY_NODES].offset);
+    image->strings = base + header->sections[DAG_IMAGE_STRINGS].offset;
+    return image;
+}
+
+/**
+ * Check that a pool string is in range and terminated
+ */
+static bool dag_image_string_valid(const DAGImage *image, uint32_t offset, uint32_t len) {
+    uint64_t pool_size = image->header->sections[DAG_IMAGE_STRINGS].size;
+    return (uint64_t)offset + len < pool_size && image->strings[offset + len] == '\0';
+}
+
+/**
+ * Check one CSR direction: monotone rows ending at the edge count, and
+ * every endpoint a node of the image
+ */
+static bool dag_image_rows_valid(const uint32_t *offsets, const uint32_t *endpoints,
+                                 uint32_t node_count, uint32_t edge_count) {
+    if (offsets[0] != 0 || offsets[node_count] != edge_count) {
+        return false;
+    }
+    for (uint32_t i = 0; i < node_count; i++) {
+        if (offsets[i] > offsets[i + 1]) {
+            return false;
+        }
+    }
+    for (uint32_t e = 0; e < edge_count; e++) {
+        if (endpoints[e] >= node_count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool dag_image_verify(const DAGImage *image) {
+    if (!image) {
+        return false;
+    }
+
+    uint32_t n = image->header->node_count;
+    uint32_t edges = image->header->edge_count;
+    if (image->strings[0] != '\0' ||
+        !dag_image_rows_valid(image->out_offsets, image->out_targets, n, edges) ||
+        !dag_image_rows_valid(image->in_offsets, image->in_sources, n, edges)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        const DAGImageNode *node = &image->nodes[i];
+        if (node->category >= DAG_IMAGE_CATEGORY_COUNT || node->state > STATE_FALSE ||
+            node->type > TOKEN_OPERATOR ||
+            !dag_image_string_valid(image, node->name_offset, node->name_len)) {
+            return false;
+        }
+    }
+
+    // The category lists must partition the nodes by their own categories
+    uint64_t listed = 0;
+    for (uint32_t c = 0; c < DAG_IMAGE_CATEGORY_COUNT; c++) {
+        const DAGImageCategory *category = &image->categories[c];
+        if (category->first != listed || category->count > n - listed ||
+            !dag_image_string_valid(image, category->name_offset, category->name_len)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < category->count; i++) {
+            uint32_t node = image->category_nodes[category->first + i];
+            if (node >= n || image->nodes[node].category != c) {
+                return false;
+            }
+        }
+        listed += category->count;
+    }
+    return listed == n;
+}
+
+size_t dag_image_node_count(const DAGImage *image) {
+    return image ? image->header->node_count : 0;
+}
+
+size_t dag_image_edge_count(const DAGImage *image) {
+    return image ? image->header->edge_count : 0;
+}
+
+bool dag_image_resolved(const DAGImage *image) {
+    return image && (image->header->flags & DAG_IMAGE_RESOLVED);
+}
+
+static const DAGImageNode *dag_image_node(const DAGImage *image, size_t node) {
+    return image && node < image->header->node_count ? &image->nodes[node] : NULL;
+}
+
+TokenType dag_image_node_type(const DAGImage *image, size_t node) {
+    const DAGImageNode *record = dag_image_node(image, node);
+    return record ? (TokenType)record->type : TOKEN_UNKNOWN;
+}
+
+TaxonomyCategory dag_image_node_category(const DAGImage *image, size_t node) {
+    const DAGImageNode *record = dag_image_node(image, node);
+    return record ? (TaxonomyCategory)record->category : TAX_UNKNOWN;
+}
+
+NodeState dag_image_node_state(const DAGImage *image, size_t node) {
+    const DAGImageNode *record = dag_image_node(image, node);
+    return record ? (NodeState)record->state : STATE_UNKNOWN;
+}
+
+uint32_t dag_image_node_rank(const DAGImage *image, size_t node) {
+    const DAGImageNode *record = dag_image_node(image, node);
+    return record ? record->rank : UINT32_MAX;
+}
+
+const char *dag_image_node_name(const DAGImage *image, size_t node) {
+    const DAGImageNode *record = dag_image_node(image, node);
+    if (!record || !dag_image_string_valid(image, record->name_offset, record->name_len)) {
+        return "";
+    }
+    return image->strings + record->name_offset;
+}
+
+/**
+ * Locate one CSR row, rejecting rows outside the edge arrays
+ */
+static const uint32_t *dag_image_row(const DAGImage *image, size_t node, bool incoming,
+                                     const float **weights, size_t *count) {
+    if (count) {
+        *count = 0;
+    }
+    if (weights) {
+        *weights = NULL;
+    }
+    if (!image || node >= image->header->node_count) {
+        return NULL;
+    }
+
+    const uint32_t *offsets = incoming ? image->in_offsets : image->out_offsets;
+    uint32_t begin = offsets[node];
+    uint32_t end = offsets[node + 1];
+    if (begin >= end || end > image->header->edge_count) {
+        return NULL;
+    }
+
+    if (count) {
+        *count = end - begin;
+    }
+    if (weights) {
+        *weights = (incoming ? image->in_weights : image->out_weights) + begin;
+    }
+    return (incoming ? image->in_sources : image->out_targets) + begin;
+}
+
+const uint32_t *dag_image_out_edges(const DAGImage *image, size_t node,
+                                    const float **weights, size_t *count) {
+    return dag_image_row(image, node, false, weights, count);
+}
+
+const uint32_t *dag_image_in_edges(const DAGImage *image, size_t node,
+                                   const float **weights, size_t *count) {
+    return dag_image_row(image, node, true, weights, count);
+}
+
+const uint32_t *dag_image_category_nodes(const DAGImage *image, TaxonomyCategory category,
+                                         size_t *count) {
+    if (count) {
+        *count = 0;
+    }
+    if (!image || (unsigned)category >= DAG_IMAGE_CATEGORY_COUNT) {
+        return NULL;
+    }
+
+    const DAGImageCategory *record = &image->categories[category];
+    if (record->count == 0 || record->first > image->header->node_count ||
+        record->count > image->header->node_count - record->first) {
+        return NULL;
+    }
+    if (count) {
+        *count = record->count;
+    }
+    return image->category_nodes + record->first;
+}
+
+const char *dag_image_category_name(const DAGImage *image, TaxonomyCategory category) {
+    if (!image || (unsigned)category >= DAG_IMAGE_CATEGORY_COUNT) {
+        return NULL;
+    }
+
+    const DAGImageCategory *record = &image->categories[category];
+    if (!dag_image_string_valid(image, record->name_offset, record->name_len)) {
+        return NULL;
+    }
+    return image->strings + record->name_offset;
+}
+
+DAGGraph *dag_image_to_graph(const DAGImage *image, const PolyAllocator *allocator) {
+    if (!image) {
+        return NULL;
+    }
+
+    size_t n = image->header->node_count;
+    DAGGraph *graph = dag_graph_create_in(allocator, n);
+    if (!graph) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const DAGImageNode *record = &image->nodes[i];
+        DAGNode *node = dag_node_create_in(graph->allocator, (TokenType)record->type,
+                                           (TaxonomyCategory)record->category);
+        if (!node || dag_graph_add_node(graph, node) != 0) {
+            dag_node_free(node);
+            dag_graph_free_all(graph);
+            return NULL;
+        }
+        node->state = (NodeState)record->state;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const float *weights;
+        size_t count;
+        const uint32_t *targets = dag_image_out_edges(image, i, &weights, &count);
+        DAGNode *node = graph->nodes[i];
+        for (size_t e = 0; e < count; e++) {
+            size_t before = node->out_count;
+            if (targets[e] >= n) {
+                dag_graph_free_all(graph);
+                return NULL;
+            }
+            dag_add_edge(node, graph->nodes[targets[e]], weights[e]);
+            if (node->out_count == before) {
+                dag_graph_free_all(graph);
+                return NULL;
+            }
+        }
+    }
+
+    return graph;
+}
+
+void dag_image_close(DAGImage *image) {
+    if (!image) {
+        return;
+    }
+    munmap(image->map, image->map_size);
+    free(image);
+}
@@ -0,0 +1,185 @@
+/**
+ * @file dag_image.h
+ * @brief Binary graph images memory-mapped without deserialization
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_DAG_IMAGE_H
+#define POLYBUILD_DAG_IMAGE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "dag.h"
+
+// Current image format version; older or newer images are rejected
+#define DAG_IMAGE_VERSION 1
+
+/**
+ * @brief Read-only view of a graph image file
+ *
+ * An image holds a header, a node table, the CSR edge rows of a frozen
+ * graph in both directions, node indices grouped by taxonomy category,
+ * and a string pool for node and category names. Sections are located
+ * by file offsets, so the file is position independent, and the
+ * accessors read straight from the mapping.
+ *
+ * Opening checks the header and section bounds in constant time. Edge
+ * targets are trusted; call dag_image_verify() on images from untrusted
+ * sources. Images are written in host byte order and rejected on hosts
+ * of the other order.
+ */
+typedef struct DAGImage DAGImage;
+
+/**
+ * @brief Write a graph to an image file
+ *
+ * Freezes the graph first if needed. Node states are written as they
+ * stand and topological ranks only if the graph is resolved. The file
+ * is replaced atomically.
+ *
+ * @param graph Graph to write
+ * @param names Name per node index (NULL, or NULL entries, for none)
+ * @param path Image file to write
+ * @return 0 on success, -1 on failure
+ */
+int dag_image_write(DAGGraph *graph, const char *const *names, const char *path);
+
+/**
+ * @brief Map an image file
+ * @param path Image file to open
+ * @return Pointer to the image or NULL if it is missing or malformed
+ */
+DAGImage *dag_image_open(const char *path);
+
+/**
+ * @brief Check every edge row and node record of an image
+ * @param image Image to check
+ * @return true if all edges, names and categories are in range
+ */
+bool dag_image_verify(const DAGImage *image);
+
+/**
+ * @brief Get the number of nodes in an image
+ * @param image Image to inspect
+ * @return Number of nodes
+ */
+size_t dag_image_node_count(const DAGImage *image);
+
+/**
+ * @brief Get the number of edges in an image
+ * @param image Image to inspect
+ * @return Number of edges
+ */
+size_t dag_image_edge_count(const DAGImage *image);
+
+/**
+ * @brief Check whether the image was written from a resolved graph
+ * @param image Image to inspect
+ * @return true if states and topological ranks are resolved ones
+ */
+bool dag_image_resolved(const DAGImage *image);
+
+/**
+ * @brief Get the token type of a node
+ * @param image Image to read
+ * @param node Node index
+ * @return Token type, TOKEN_UNKNOWN if out of range
+ */
+TokenType dag_image_node_type(const DAGImage *image, size_t node);
+
+/**
+ * @brief Get the taxonomy category of a node
+ * @param image Image to read
+ * @param node Node index
+ * @return Category, TAX_UNKNOWN if out of range
+ */
+TaxonomyCategory dag_image_node_category(const DAGImage *image, size_t node);
+
+/**
+ * @brief Get the stored state of a node
+ * @param image Image to read
+ * @param node Node index
+ * @return State, STATE_UNKNOWN if out of range
+ */
+NodeState dag_image_node_state(const DAGImage *image, size_t node);
+
+/**
+ * @brief Get the topological rank of a node
+ * @param image Image to read
+ * @param node Node index
+ * @return Rank, UINT32_MAX if unresolved or out of range
+ */
+uint32_t dag_image_node_rank(const DAGImage *image, size_t node);
+
+/**
+ * @brief Get the name of a node
+ * @param image Image to read
+ * @param node Node index
+ * @return NUL-terminated name in the mapping, "" if it has none
+ */
+const char *dag_image_node_name(const DAGImage *image, size_t node);
+
+/**
+ * @brief Get the outgoing edges of a node
+ * @param image Image to read
+ * @param node Node index
+ * @param weights Receives the edge weights, may be NULL
+ * @param count Receives the number of edges
+ * @return Target node indices in the mapping, NULL if there are none
+ */
+const uint32_t *dag_image_out_edges(const DAGImage *image, size_t node,
+                                    const float **weights, size_t *count);
+
+/**
+ * @brief Get the incoming edges of a node, ordered by source index
+ * @param image Image to read
+ * @param node Node index
+ * @param weights Receives the edge weights, may be NULL
+ * @param count Receives the number of edges
+ * @return Source node indices in the mapping, NULL if there are none
+ */
+const uint32_t *dag_image_in_edges(const DAGImage *image, size_t node,
+                                   const float **weights, size_t *count);
+
+/**
+ * @brief Get the nodes of one taxonomy category, in index order
+ * @param image Image to read
+ * @param category Category to list
+ * @param count Receives the number of nodes
+ * @return Node indices in the mapping, NULL if there are none
+ */
+const uint32_t *dag_image_category_nodes(const DAGImage *image, TaxonomyCategory category,
+                                         size_t *count);
+
+/**
+ * @brief Get the name of a taxonomy category as stored in the image
+ * @param image Image to read
+ * @param category Category to name
+ * @return NUL-terminated name, NULL if the image has no such category
+ */
+const char *dag_image_category_name(const DAGImage *image, TaxonomyCategory category);
+
+/**
+ * @brief Rebuild a mutable graph from an image
+ *
+ * Nodes get the stored types, categories and states, and edges are
+ * added in CSR order, so freezing the new graph reproduces the image.
+ *
+ * @param image Image to copy
+ * @param allocator Allocator for the graph and its nodes (NULL for the
+ *        default)
+ * @return Pointer to the new graph or NULL on failure
+ */
+DAGGraph *dag_image_to_graph(const DAGImage *image, const PolyAllocator *allocator);
+
+/**
+ * @brief Unmap and free an image
+ *
+ * Pointers returned by the accessors become invalid.
+ *
+ * @param image Image to close
+ */
+void dag_image_close(DAGImage *image);
+
+#endif /* POLYBUILD_DAG_IMAGE_H */
@@ -0,0 +1,231 @@
+#include <stdatomic.h>
+#include "dag_vote.h"
+
+// x86 kernels are built with per-function target attributes and picked at runtime
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define DAG_VOTE_X86 1
+#include <immintrin.h>
+#endif
+
+// Lanes every kernel sums over, fixed so results do not depend on the CPU
+#define DAG_VOTE_LANES 8
+
+/**
+ * Sum the weights of in-edges whose source is true and false
+ *
+ * Every kernel adds in the same order: edge e of each full block of
+ * eight goes to lane e % 8, the lanes are reduced pairwise, and the
+ * remaining edges are summed in order and added last. Float addition
+ * is not associative, so this is what keeps near ties resolving the
+ * same way on every host.
+ */
+typedef void (*DAGVoteFn)(const uint8_t *states, const uint32_t *sources,
+                          const float *weights, uint32_t count,
+                          float *true_weight, float *false_weight);
+
+static float dag_vote_reduce(const float *lanes) {
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+           ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+/**
+ * Add the edges after the last full block and the reduced lanes
+ */
+static void dag_vote_finish(const uint8_t *states, const uint32_t *sources,
+                            const float *weights, uint32_t count, uint32_t e,
+                            const float *t_lanes, const float *f_lanes,
+                            float *true_weight, float *false_weight) {
+    float t = 0.0f;
+    float f = 0.0f;
+    for (; e < count; e++) {
+        uint8_t state = states[sources[e]];
+        if (state == STATE_TRUE) {
+            t += weights[e];
+        } else if (state == STATE_FALSE) {
+            f += weights[e];
+        }
+    }
+    *true_weight = dag_vote_reduce(t_lanes) + t;
+    *false_weight = dag_vote_reduce(f_lanes) + f;
+}
+
+static void dag_vote_scalar(const uint8_t *states, const uint32_t *sources,
+                            const float *weights, uint32_t count,
+                            float *true_weight, float *false_weight) {
+    float t[DAG_VOTE_LANES] = { 0.0f };
+    float f[DAG_VOTE_LANES] = { 0.0f };
+    uint32_t e = 0;
+
+    for (; e + DAG_VOTE_LANES <= count; e += DAG_VOTE_LANES) {
+        for (int lane = 0; lane < DAG_VOTE_LANES; lane++) {
+            uint8_t state = states[sources[e + lane]];
+            t[lane] += state == STATE_TRUE ? weights[e + lane] : 0.0f;
+            f[lane] += state == STATE_FALSE ? weights[e + lane] : 0.0f;
+        }
+    }
+    dag_vote_finish(states, sources, weights, count, e, t, f, true_weight, false_weight);
+}
+
+#ifdef DAG_VOTE_X86
+/**
+ * Eight edges per step as two four-lane halves; SSE2 has no gather, so
+ * states are loaded singly
+ */
+__attribute__((target("sse2")))
+static void dag_vote_sse2(const uint8_t *states, const uint32_t *sources,
+                          const float *weights, uint32_t count,
+                          float *true_weight, float *false_weight) {
+    const __m128i want_true = _mm_set1_epi32(STATE_TRUE);
+    const __m128i want_false = _mm_set1_epi32(STATE_FALSE);
+    __m128 t[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+    __m128 f[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+    uint32_t e = 0;
+
+    for (; e + DAG_VOTE_LANES <= count; e += DAG_VOTE_LANES) {
+        for (int half = 0; half < 2; half++) {
+            uint32_t i = e + (uint32_t)half * 4;
+            __m128i state = _mm_set_epi32(states[sources[i + 3]], states[sources[i + 2]],
+                                          states[sources[i + 1]], states[sources[i]]);
+            __m128 weight = _mm_loadu_ps(weights + i);
+            t[half] = _mm_add_ps(t[half], _mm_and_ps(weight, _mm_castsi128_ps(
+                                                         _mm_cmpeq_epi32(state, want_true))));
+            f[half] = _mm_add_ps(f[half], _mm_and_ps(weight, _mm_castsi128_ps(
+                                                         _mm_cmpeq_epi32(state, want_false))));
+        }
+    }
+
+    float t_lanes[DAG_VOTE_LANES], f_lanes[DAG_VOTE_LANES];
+    _mm_storeu_ps(t_lanes, t[0]);
+    _mm_storeu_ps(t_lanes + 4, t[1]);
+    _mm_storeu_ps(f_lanes, f[0]);
+    _mm_storeu_ps(f_lanes + 4, f[1]);
+    dag_vote_finish(states, sources, weights, count, e, t_lanes, f_lanes,
+                    true_weight, false_weight);
+}
+
+/**
+ * Eight edges per step with a hardware gather of the source states
+ *
+ * Each lane gathers the 32-bit word starting at its state byte and
+ * masks the rest off; the CSR block keeps slack after the states so the
+ * last word stays in bounds.
+ */
+__attribute__((target("avx2")))
+static void dag_vote_avx2(const uint8_t *states, const uint32_t *sources,
+                          const float *weights, uint32_t count,
+                          float *true_weight, float *false_weight) {
+    const __m256i byte_mask = _mm256_set1_epi32(0xff);
+    const __m256i want_true = _mm256_set1_epi32(STATE_TRUE);
+    const __m256i want_false = _mm256_set1_epi32(STATE_FALSE);
+    __m256 t = _mm256_setzero_ps();
+    __m256 f = _mm256_setzero_ps();
+    uint32_t e = 0;
+
+    for (; e + DAG_VOTE_LANES <= count; e += DAG_VOTE_LANES) {
+        __m256i index = _mm256_loadu_si256((const __m256i *)(sources + e));
+        __m256i state = _mm256_and_si256(
+            _mm256_i32gather_epi32((const int *)states, index, 1), byte_mask);
+        __m256 weight = _mm256_loadu_ps(weights + e);
+        t = _mm256_add_ps(t, _mm256_and_ps(weight,
+                                           _mm256_castsi256_ps(_mm256_cmpeq_epi32(state, want_true))));
+        f = _mm256_add_ps(f, _mm256_and_ps(weight,
+                                           _mm256_castsi256_ps(_mm256_cmpeq_epi32(state, want_false))));
+    }
+
+    float t_lanes[DAG_VOTE_LANES], f_lanes[DAG_VOTE_LANES];
+    _mm256_storeu_ps(t_lanes, t);
+    _mm256_storeu_ps(f_lanes, f);
+    dag_vote_finish(states, sources, weights, count, e, t_lanes, f_lanes,
+                    true_weight, false_weight);
+}
+#endif
+
+static const char *const dag_vote_names[DAG_VOTE_KERNEL_COUNT] = { "scalar", "sse2", "avx2" };
+
+static const DAGVoteFn dag_vote_kernels[DAG_VOTE_KERNEL_COUNT] = {
+    dag_vote_scalar,
+#ifdef DAG_VOTE_X86
+    dag_vote_sse2,
+    dag_vote_avx2
+#else
+    NULL,
+    NULL
+#endif
+};
+
+// Active kernel, -1 until the first resolve picks one
+static atomic_int dag_vote_active = -1;
+
+bool dag_vote_kernel_supported(DAGVoteKernel kernel) {
+    switch (kernel) {
+    case DAG_VOTE_SCALAR:
+        return true;
+#ifdef DAG_VOTE_X86
+    case DAG_VOTE_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case DAG_VOTE_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+DAGVoteKernel dag_vote_kernel(void) {
+    int active = atomic_load_explicit(&dag_vote_active, memory_order_relaxed);
+    if (active < 0) {
+        // Racing first callers all detect the same kernel
+        active = DAG_VOTE_KERNEL_COUNT - 1;
+        while (!dag_vote_kernel_supported((DAGVoteKernel)active)) {
+            active--;
+        }
+        atomic_store_explicit(&dag_vote_active, active, memory_order_relaxed);
+    }
+    return (DAGVoteKernel)active;
+}
+
+int dag_vote_set_kernel(DAGVoteKernel kernel) {
+    if (!dag_vote_kernel_supported(kernel)) {
+        return -1;
+    }
+    atomic_store_explicit(&dag_vote_active, (int)kernel, memory_order_relaxed);
+    return 0;
+}
+
+const char *dag_vote_kernel_name(DAGVoteKernel kernel) {
+    return (unsigned)kernel < DAG_VOTE_KERNEL_COUNT ? dag_vote_names[kernel] : "unknown";
+}
+
+static NodeState dag_vote_decide(const DAGGraph *graph, DAGVoteFn vote, uint32_t node) {
+    uint32_t begin = graph->in_offsets[node];
+    uint32_t end = graph->in_offsets[node + 1];
+
+    // Default to true for root nodes (no incoming edges)
+    if (begin == end) {
+        return STATE_TRUE;
+    }
+
+    float true_weight, false_weight;
+    vote(graph->states, graph->in_sources + begin, graph->in_weights + begin, end - begin,
+         &true_weight, &false_weight);
+
+    if (true_weight > false_weight) {
+        return STATE_TRUE;
+    } else if (false_weight > true_weight) {
+        return STATE_FALSE;
+    }
+
+    // Equal weights or no resolved inputs
+    return STATE_UNKNOWN;
+}
+
+NodeState dag_vote_node(const DAGGraph *graph, uint32_t node) {
+    return dag_vote_decide(graph, dag_vote_kernels[dag_vote_kernel()], node);
+}
+
+void dag_vote_resolve(DAGGraph *graph, const uint32_t *nodes, size_t count) {
+    DAGVoteFn vote = dag_vote_kernels[dag_vote_kernel()];
+    for (size_t i = 0; i < count; i++) {
+        graph->states[nodes[i]] = (uint8_t)dag_vote_decide(graph, vote, nodes[i]);
+    }
+}
@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "action_cache.h"
+#include "executor.h"
+#include "../io/atomic_file.h"
+
+// Versions the key layout; bump when the hashed fields change
+#define ACTION_CACHE_KEY_TAG "polybuild-action-2"
+
+// Copy granularity
+#define ACTION_CACHE_CHUNK 65536
+
+struct DAGActionCache {
+    char* dir;
+};
+
+/**
+ * Create a directory and its missing parents
+ */
+static int action_cache_mkdirs(const char* path) {
+    char* copy = strdup(path);
+    if (!copy) {
+        return -1;
+    }
+
+    for (char* p = copy + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(copy, 0755) != 0 && errno != EEXIST) {
+                free(copy);
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+
+    int result = (mkdir(copy, 0755) == 0 || errno == EEXIST) ? 0 : -1;
+    free(copy);
+    return result;
+}
+
+/**
+ * Create the directory holding a file, if it has one
+ */
+static int action_cache_mkparent(const char* path) {
+    const char* slash = strrchr(path, '/');
+    if (!slash || slash == path) {
+        return 0;
+    }
+
+    char* parent = strndup(path, (size_t)(slash - path));
+    if (!parent) {
+        return -1;
+    }
+    int result = action_cache_mkdirs(parent);
+    free(parent);
+    return result;
+}
+
+static char* action_cache_join(const char* dir, const char* name) {
+    size_t len = strlen(dir) + strlen(name) + 2;
+    char* path = (char*)malloc(len);
+    if (path) {
+        snprintf(path, len, "%s/%s", dir, name);
+    }
+    return path;
+}
+
+/**
+ * Copy a file through a temporary sibling so readers never see a
+ * partial destination
+ */
+static int action_cache_copy(const char* from, const char* to) {
+    int in = open(from, O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(in, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(in);
+        return -1;
+    }
+
+    AtomicFile atomic;
+    if (atomic_file_open(&atomic, to, st.st_mode & 0777) != 0) {
+        close(in);
+        return -1;
+    }
+    int out = atomic.fd;
+
+    char* buffer = (char*)malloc(ACTION_CACHE_CHUNK);
+    bool ok = buffer != NULL;
+    while (ok) {
+        ssize_t got = read(in, buffer, ACTION_CACHE_CHUNK);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            ok = got == 0;
+            break;
+        }
+        for (ssize_t done = 0; ok && done < got;) {
+            ssize_t put = write(out, buffer + done, (size_t)(got - done));
+            if (put < 0 && errno == EINTR) {
+                continue;
+            }
+            ok = put > 0;
+            done += put > 0 ? put : 0;
+        }
+    }
+
+    free(buffer);
+    close(in);
+    return atomic_file_close(&atomic, ok);
+}
+
+/**
+ * Hash a length-prefixed field so adjacent fields cannot run together
+ */
+static void action_cache_hash_field(Sha256* sha, const void* data, size_t len) {
+    uint8_t prefix[8];
+    for (int i = 0; i < 8; i++) {
+        prefix[i] = (uint8_t)((uint64_t)len >> (8 * i));
+    }
+    sha256_update(sha, prefix, sizeof(prefix));
+    sha256_update(sha, data, len);
+}
+
+static void action_cache_hash_count(Sha256* sha, size_t count) {
+    uint64_t value = (uint64_t)count;
+    uint8_t bytes[8];
+    for (int i = 0; i < 8; i++) {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+    sha256_update(sha, bytes, sizeof(bytes));
+}
+
+/**
+ * Hash the content digest of a file, taken from the index when it has one
+ */
+static int action_cache_hash_file(Sha256* sha, const char* path, FileIndex* index) {
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    int result = index ? file_index_check(index, path, digest, NULL) : sha256_file(path, digest);
+    if (result != 0) {
+        return -1;
+    }
+    sha256_update(sha, digest, sizeof(digest));
+    return 0;
+}
+
+DAGActionCache* dag_action_cache_open(const char* dir) {
+    if (!dir || !dir[0] || action_cache_mkdirs(dir) != 0) {
+        return NULL;
+    }
+
+    DAGActionCache* cache = (DAGActionCache*)calloc(1, sizeof(DAGActionCache));
+    if (!cache) {
+        return NULL;
+    }
+    cache->dir = strdup(dir);
+    if (!cache->dir) {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+int dag_action_cache_key(const BuildAction* action, const DAGActionKey* upstream,
+                         size_t upstream_count, FileIndex* index, DAGActionKey* key) {
+    if (!action || !key || (upstream_count > 0 && !upstream)) {
+        return -1;
+    }
+
+    Sha256 sha;
+    sha256_init(&sha);
+    action_cache_hash_field(&sha, ACTION_CACHE_KEY_TAG, strlen(ACTION_CACHE_KEY_TAG));
+
+    const char* command = action->command ? action->command : "";
+    action_cache_hash_field(&sha, command, strlen(command));
+
+    action_cache_hash_count(&sha, action->output_count);
+    for (size_t i = 0; i < action->output_count; i++) {
+        action_cache_hash_field(&sha, action->outputs[i], strlen(action->outputs[i]));
+    }
+
+    action_cache_hash_count(&sha, action->input_count);
+    for (size_t i = 0; i < action->input_count; i++) {
+        action_cache_hash_field(&sha, action->inputs[i], strlen(action->inputs[i]));
+        if (action_cache_hash_file(&sha, action->inputs[i], index) != 0) {
+            return -1;
+        }
+    }
+
+    action_cache_hash_count(&sha, upstream_count);
+    for (size_t i = 0; i < upstream_count; i++) {
+        sha256_update(&sha, upstream[i].bytes, sizeof(upstream[i].bytes));
+    }
+
+    sha256_final(&sha, key->bytes);
+    return 0;
+}
+
+/**
+ * Path of the entry directory of a key
+ */
+static char* action_cache_entry(const DAGActionCache* cache, const DAGActionKey* key) {
+    char hex[2 * SHA256_DIGEST_SIZE + 1];
+    sha256_to_hex(key->bytes, hex);
+    return action_cache_join(cache->dir, hex);
+}
+
+bool dag_action_cache_restore(DAGActionCache* cache, const DAGActionKey* key,
+                              const BuildAction* action) {
+    if (!cache || !key || !action) {
+        return false;
+    }
+
+    char* entry = action_cache_entry(cache, key);
+    struct stat st;
+    if (!entry || stat(entry, &st) != 0 || !S_ISDIR(st.st_mode)) {
+        free(entry);
+        return false;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < action->output_count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%zu", i);
+        char* stored = action_cache_join(entry, name);
+        ok = stored && action_cache_mkparent(action->outputs[i]) == 0 &&
+             action_cache_copy(stored, action->outputs[i]) == 0;
+        free(stored);
+    }
+
+    free(entry);
+    return ok;
+}
+
+/**
+ * Remove a staging directory holding numbered output files
+ */
+static void action_cache_discard(const char* staging, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%zu", i);
+        char* path = action_cache_join(staging, name);
+        if (path) {
+            unlink(path);
+        }
+        free(path);
+    }
+    rmdir(staging);
+}
+
+int dag_action_cache_store(DAGActionCache* cache, const DAGActionKey* key,
+                           const BuildAction* action) {
+    if (!cache || !key || !action) {
+        return -1;
+    }
+
+    char* entry = action_cache_entry(cache, key);
+    if (!entry) {
+        return -1;
+    }
+
+    // Stage the outputs, then publish the whole entry with one rename; a
+    // fresh name per store keeps concurrent and crashed stores apart
+    size_t entry_len = strlen(entry);
+    char* staging = (char*)malloc(entry_len + 16);
+    if (!staging) {
+        free(entry);
+        return -1;
+    }
+    snprintf(staging, entry_len + 16, "%s.tmp.XXXXXX", entry);
+
+    bool created = mkdtemp(staging) != NULL;
+    bool ok = created && chmod(staging, 0755) == 0;
+    for (size_t i = 0; ok && i < action->output_count; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "%zu", i);
+        char* stored = action_cache_join(staging, name);
+        ok = stored && action_cache_copy(action->outputs[i], stored) == 0;
+        free(stored);
+    }
+
+    if (ok && rename(staging, entry) != 0) {
+        // Another run published the same key first; its outputs are equal
+        ok = errno == EEXIST || errno == ENOTEMPTY;
+        action_cache_discard(staging, action->output_count);
+    } else if (!ok && created) {
+        action_cache_discard(staging, action->output_count);
+    }
+
+    free(staging);
+    free(entry);
+    return ok ? 0 : -1;
+}
+
+void dag_action_cache_close(DAGActionCache* cache) {
+    if (!cache) {
+        return;
+    }
+    free(cache->dir);
+    free(cache);
+}
@@ -0,0 +1,87 @@
+/**
+ * @file action_cache.h
+ * @brief Local content-addressed cache of build action outputs
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_ACTION_CACHE_H
+#define POLYBUILD_ACTION_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "../hash/sha256.h"
+#include "../io/file_index.h"
+
+struct BuildAction;
+
+/**
+ * @brief Digest identifying one action invocation
+ */
+typedef struct DAGActionKey {
+    uint8_t bytes[SHA256_DIGEST_SIZE];
+} DAGActionKey;
+
+/**
+ * @brief On-disk store of action outputs keyed by DAGActionKey
+ *
+ * Each entry is a directory named by the key's hex digest holding one
+ * file per output. Entries are published with a rename, so a crashed
+ * store never leaves a half-written entry behind.
+ */
+typedef struct DAGActionCache DAGActionCache;
+
+/**
+ * @brief Open (creating if needed) a cache directory
+ * @param dir Cache directory
+ * @return Pointer to the cache or NULL on failure
+ */
+DAGActionCache* dag_action_cache_open(const char* dir);
+
+/**
+ * @brief Compute the key of an action
+ *
+ * Hashes the command, the output paths, each input path with the
+ * digest of the file's current contents, and the keys of the upstream
+ * actions in order. Call it once the upstream actions have finished, so
+ * that generated inputs are current. With an index, inputs whose stat
+ * tuple is unchanged reuse their recorded digest instead of being read;
+ * the key is the same either way.
+ *
+ * @param action Action to key
+ * @param upstream Keys of the upstream actions
+ * @param upstream_count Number of upstream keys
+ * @param index File index supplying input digests, may be NULL
+ * @param key Receives the key
+ * @return 0 on success, -1 if an input could not be read
+ */
+int dag_action_cache_key(const struct BuildAction* action, const DAGActionKey* upstream,
+                         size_t upstream_count, FileIndex* index, DAGActionKey* key);
+
+/**
+ * @brief Restore the outputs of a cached action
+ * @param cache Cache to read
+ * @param key Key of the action
+ * @param action Action whose outputs are written
+ * @return true if every output was restored
+ */
+bool dag_action_cache_restore(DAGActionCache* cache, const DAGActionKey* key,
+                              const struct BuildAction* action);
+
+/**
+ * @brief Store the outputs of a finished action
+ * @param cache Cache to write
+ * @param key Key of the action
+ * @param action Action whose outputs are copied in
+ * @return 0 on success, -1 on failure (e.g. a missing output)
+ */
+int dag_action_cache_store(DAGActionCache* cache, const DAGActionKey* key,
+                           const struct BuildAction* action);
+
+/**
+ * @brief Close a cache
+ * @param cache Cache to close
+ */
+void dag_action_cache_close(DAGActionCache* cache);
+
+#endif /* POLYBUILD_ACTION_CACHE_H */
@@ -0,0 +1,470 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "executor.h"
+#include "../parallel/thread_pool.h"
+#include "../trace/trace.h"
+
+extern char** environ;
+
+// Poll interval while an exited child that is not ours is pending
+#define DAG_EXEC_FOREIGN_POLL_NS 1000000L
+
+/**
+ * A spawned command waiting to be reaped
+ */
+typedef struct {
+    pid_t pid;
+    uint32_t node;
+    struct timespec started;
+} DAGExecSlot;
+
+/**
+ * Dispatch state of one execution
+ */
+typedef struct {
+    DAGGraph* graph;
+    const BuildAction* actions;
+    const DAGExecOptions* options;
+    DAGExecOutcome* outcomes;
+    uint32_t* pending;          // Unfinished predecessors per node
+    uint8_t* blocked;           // Set once any predecessor failed
+    double* priority;           // Longest remaining path per node
+    uint32_t* ready;            // Max-heap on priority
+    size_t ready_count;
+    DAGExecSlot* slots;
+    size_t running;
+    bool failed;
+    DAGActionKey* keys;         // Cache key per node, with a cache only
+    uint8_t* keyed;             // Set once the node's key is known
+} DAGExecState;
+
+/**
+ * Order ready nodes by priority, then by index for reproducible runs
+ */
+static bool dag_exec_before(const DAGExecState* state, uint32_t a, uint32_t b) {
+    if (state->priority[a] != state->priority[b]) {
+        return state->priority[a] > state->priority[b];
+    }
+    return a < b;
+}
+
+static void dag_exec_push(DAGExecState* state, uint32_t node) {
+    size_t pos = state->ready_count++;
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!dag_exec_before(state, node, state->ready[parent])) {
+            break;
+        }
+        state->ready[pos] = state->ready[parent];
+        pos = parent;
+    }
+    state->ready[pos] = node;
+}
+
+static uint32_t dag_exec_pop(DAGExecState* state) {
+    uint32_t top = state->ready[0];
+    uint32_t last = state->ready[--state->ready_count];
+
+    size_t pos = 0;
+    for (;;) {
+        size_t child = 2 * pos + 1;
+        if (child >= state->ready_count) {
+            break;
+        }
+        if (child + 1 < state->ready_count &&
+            dag_exec_before(state, state->ready[child + 1], state->ready[child])) {
+            child++;
+        }
+        if (!dag_exec_before(state, state->ready[child], last)) {
+            break;
+        }
+        state->ready[pos] = state->ready[child];
+        pos = child;
+    }
+    if (state->ready_count > 0) {
+        state->ready[pos] = last;
+    }
+    return top;
+}
+
+/**
+ * Estimated run time of a node: history first, then the caller's costs
+ */
+static double dag_exec_cost(const DAGExecState* state, uint32_t node, double fallback) {
+    const DAGExecOptions* options = state->options;
+    const BuildAction* action = &state->actions[node];
+    double seconds;
+
+    if (!action->command) {
+        return 0.0;
+    }
+    if (action->name && dag_exec_history_lookup(options->history, action->name, &seconds)) {
+        return seconds;
+    }
+    return options->costs ? options->costs[node] : fallback;
+}
+
+/**
+ * Longest remaining path per node, summed over node costs, in reverse
+ * topological order; ready doubles as the Kahn queue here
+ */
+static void dag_exec_priorities(DAGExecState* state) {
+    const DAGGraph* graph = state->graph;
+    size_t n = graph->node_count;
+    size_t tail = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        if (state->pending[i] == 0) {
+            state->ready[tail++] = (uint32_t)i;
+        }
+    }
+    for (size_t head = 0; head < tail; head++) {
+        uint32_t current = state->ready[head];
+        for (uint32_t e = graph->out_offsets[current]; e < graph->out_offsets[current + 1]; e++) {
+            uint32_t target = graph->out_targets[e];
+            if (--state->pending[target] == 0) {
+                state->ready[tail++] = target;
+            }
+        }
+    }
+
+    const DAGExecOptions* options = state->options;
+    double fallback = 1.0;
+    if (!options->costs) {
+        dag_exec_history_mean(options->history, &fallback);
+    }
+
+    for (size_t q = tail; q-- > 0;) {
+        uint32_t current = state->ready[q];
+        double tail_cost = 0.0;
+        for (uint32_t e = graph->out_offsets[current]; e < graph->out_offsets[current + 1]; e++) {
+            double next = state->priority[graph->out_targets[e]];
+            if (options->weighted_edges) {
+                next *= graph->out_weights[e];
+            }
+            if (next > tail_cost) {
+                tail_cost = next;
+            }
+        }
+        state->priority[current] = dag_exec_cost(state, current, fallback) + tail_cost;
+    }
+
+    // Restore the in-degrees consumed by the ordering pass
+    for (size_t i = 0; i < n; i++) {
+        state->pending[i] = graph->in_offsets[i + 1] - graph->in_offsets[i];
+    }
+}
+
+static double dag_exec_elapsed(const struct timespec* started) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - started->tv_sec) +
+           (double)(now.tv_nsec - started->tv_nsec) / 1e9;
+}
+
+/**
+ * Record a finished node and release its dependents into the ready heap
+ */
+static void dag_exec_complete(DAGExecState* state, uint32_t node, DAGExecOutcome outcome,
+                              int exit_status, double seconds) {
+    const DAGGraph* graph = state->graph;
+    state->outcomes[node] = outcome;
+
+    bool poisoned = outcome == DAG_EXEC_FAILED || outcome == DAG_EXEC_BLOCKED;
+    if (outcome == DAG_EXEC_FAILED) {
+        state->failed = true;
+    }
+
+    if (state->options->report) {
+        DAGExecReport report = { node, &state->actions[node], outcome, exit_status, seconds };
+        state->options->report(&report, state->options->report_ctx);
+    }
+
+    for (uint32_t e = graph->out_offsets[node]; e < graph->out_offsets[node + 1]; e++) {
+        uint32_t target = graph->out_targets[e];
+        if (poisoned) {
+            state->blocked[target] = 1;
+        }
+        if (--state->pending[target] == 0) {
+            dag_exec_push(state, target);
+        }
+    }
+}
+
+/**
+ * Key a ready node from its action and its upstream keys
+ */
+static bool dag_exec_key(DAGExecState* state, uint32_t node) {
+    const DAGGraph* graph = state->graph;
+    uint32_t begin = graph->in_offsets[node];
+    uint32_t count = graph->in_offsets[node + 1] - begin;
+
+    DAGActionKey* upstream = (DAGActionKey*)malloc((count ? count : 1) * sizeof(DAGActionKey));
+    if (!upstream) {
+        return false;
+    }
+
+    bool ok = true;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        uint32_t source = graph->in_sources[begin + i];
+        ok = state->keyed[source];
+        if (ok) {
+            upstream[i] = state->keys[source];
+        }
+    }
+    ok = ok && dag_action_cache_key(&state->actions[node], upstream, count,
+                                    state->options->index, &state->keys[node]) == 0;
+
+    free(upstream);
+    state->keyed[node] = ok;
+    return ok;
+}
+
+/**
+ * Start a ready node, or finish it at once when nothing needs to run;
+ * returns true if a command was spawned
+ */
+static bool dag_exec_start(DAGExecState* state, uint32_t node) {
+    const BuildAction* action = &state->actions[node];
+
+    if (state->blocked[node]) {
+        dag_exec_complete(state, node, DAG_EXEC_BLOCKED, -1, 0.0);
+        return false;
+    }
+    if (state->graph->states[node] == STATE_FALSE) {
+        dag_exec_complete(state, node, DAG_EXEC_SKIPPED, -1, 0.0);
+        return false;
+    }
+
+    // Ordering nodes are keyed too so upstream changes reach their dependents
+    DAGActionCache* cache = state->options->cache;
+    if (cache && dag_exec_key(state, node) && action->command && action->output_count > 0 &&
+        dag_action_cache_restore(cache, &state->keys[node], action)) {
+        dag_exec_complete(state, node, DAG_EXEC_CACHED, 0, 0.0);
+        return false;
+    }
+
+    if (!action->command) {
+        dag_exec_complete(state, node, DAG_EXEC_SUCCEEDED, 0, 0.0);
+        return false;
+    }
+
+    const char* shell = state->options->shell ? state->options->shell : "/bin/sh";
+    char* argv[] = { (char*)shell, (char*)"-c", (char*)action->command, NULL };
+
+    // Children stay in the caller's process group, under its job control
+    DAGExecSlot* slot = &state->slots[state->running];
+    clock_gettime(CLOCK_MONOTONIC, &slot->started);
+    if (posix_spawn(&slot->pid, shell, NULL, NULL, argv, environ) != 0) {
+        dag_exec_complete(state, node, DAG_EXEC_FAILED, -1, 0.0);
+        return false;
+    }
+
+    slot->node = node;
+    state->running++;
+    TRACE_COUNT(TRACE_COUNTER_ACTIONS_RUN, 1);
+    return true;
+}
+
+/**
+ * Reap one of our children if it has exited, without blocking; returns
+ * its slot, state->running if none has, or -1 on failure
+ */
+static long dag_exec_poll(DAGExecState* state, int* status) {
+    for (size_t s = 0; s < state->running; s++) {
+        pid_t pid;
+        do {
+            pid = waitpid(state->slots[s].pid, status, WNOHANG);
+        } while (pid < 0 && errno == EINTR);
+        if (pid < 0) {
+            return -1;
+        }
+        if (pid == state->slots[s].pid) {
+            return (long)s;
+        }
+    }
+    return (long)state->running;
+}
+
+/**
+ * Wait for one of our children and complete its node
+ *
+ * Only the spawned pids are reaped, so the caller's other children and
+ * concurrent executions keep their exit statuses. waitid() with WNOWAIT
+ * blocks until some child has exited without reaping it; while that is
+ * a child we do not own, we poll our own instead.
+ */
+static int dag_exec_reap(DAGExecState* state) {
+    int status;
+    long found;
+    for (;;) {
+        found = dag_exec_poll(state, &status);
+        if (found < 0) {
+            return -1;
+        }
+        if ((size_t)found < state->running) {
+            break;
+        }
+
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_ALL, 0, &info, WEXITED | WNOWAIT) != 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        bool ours = false;
+        for (size_t s = 0; s < state->running; s++) {
+            ours |= state->slots[s].pid == info.si_pid;
+        }
+        if (!ours) {
+            struct timespec pause = { 0, DAG_EXEC_FOREIGN_POLL_NS };
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    DAGExecSlot slot = state->slots[found];
+    state->slots[found] = state->slots[--state->running];
+
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    int exit_status = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    double seconds = dag_exec_elapsed(&slot.started);
+
+    // Failed runs say little about how long a real build takes
+    const BuildAction* action = &state->actions[slot.node];
+    if (ok && state->options->history && action->name) {
+        dag_exec_history_record(state->options->history, action->name, seconds);
+    }
+    if (ok && state->keyed && state->keyed[slot.node] && action->output_count > 0) {
+        dag_action_cache_store(state->options->cache, &state->keys[slot.node], action);
+    }
+
+    dag_exec_complete(state, slot.node, ok ? DAG_EXEC_SUCCEEDED : DAG_EXEC_FAILED,
+                      exit_status, seconds);
+    return 0;
+}
+
+int dag_graph_execute(DAGGraph* graph, const BuildAction* actions,
+                      const DAGExecOptions* options, DAGExecOutcome* outcomes) {
+    if (!graph || !actions) {
+        return -1;
+    }
+    TRACE_SPAN("dag_graph_execute");
+
+    DAGExecOptions defaults = { 0, false, NULL, NULL, NULL, NULL, false, NULL, NULL, NULL };
+    if (!options) {
+        options = &defaults;
+    }
+
+    // Resolution decides which nodes are skipped and rejects cycles; nodes
+    // or edges added since the last resolve need fresh CSR arrays first
+    if ((!graph->frozen || !graph->resolved) && dag_graph_resolve(graph) != 0) {
+        return -1;
+    }
+
+    size_t n = graph->node_count;
+    if (n == 0) {
+        return 0;
+    }
+
+    size_t jobs = options->jobs ? options->jobs : thread_pool_cpu_count();
+    DAGExecState state;
+    memset(&state, 0, sizeof(state));
+    state.graph = graph;
+    state.actions = actions;
+    state.options = options;
+    state.outcomes = outcomes ? outcomes : (DAGExecOutcome*)malloc(n * sizeof(DAGExecOutcome));
+    state.pending = (uint32_t*)malloc(n * sizeof(uint32_t));
+    state.blocked = (uint8_t*)calloc(n, 1);
+    state.priority = (double*)malloc(n * sizeof(double));
+    state.ready = (uint32_t*)malloc(n * sizeof(uint32_t));
+    state.slots = (DAGExecSlot*)malloc(jobs * sizeof(DAGExecSlot));
+    if (options->cache) {
+        state.keys = (DAGActionKey*)malloc(n * sizeof(DAGActionKey));
+        state.keyed = (uint8_t*)calloc(n, 1);
+    }
+
+    int result = -1;
+    if (state.outcomes && state.pending && state.blocked && state.priority &&
+        state.ready && state.slots && (!options->cache || (state.keys && state.keyed))) {
+        for (size_t i = 0; i < n; i++) {
+            state.outcomes[i] = DAG_EXEC_PENDING;
+            state.pending[i] = graph->in_offsets[i + 1] - graph->in_offsets[i];
+        }
+        dag_exec_priorities(&state);
+
+        for (size_t i = 0; i < n; i++) {
+            if (state.pending[i] == 0) {
+                dag_exec_push(&state, (uint32_t)i);
+            }
+        }
+
+        // Fill free job slots from the heap, then wait for any child
+        for (;;) {
+            bool dispatching = !state.failed || options->keep_going;
+            while (dispatching && state.running < jobs && state.ready_count > 0) {
+                dag_exec_start(&state, dag_exec_pop(&state));
+                dispatching = !state.failed || options->keep_going;
+            }
+            if (state.running == 0) {
+                if (!dispatching || state.ready_count == 0) {
+                    break;
+                }
+                continue;
+            }
+            if (dag_exec_reap(&state) != 0) {
+                state.failed = true;
+                break;
+            }
+        }
+
+        // Publish what ran; states no longer follow the vote rules
+        for (size_t i = 0; i < n; i++) {
+            NodeState node_state;
+            if (state.outcomes[i] == DAG_EXEC_SUCCEEDED ||
+                state.outcomes[i] == DAG_EXEC_CACHED) {
+                node_state = STATE_TRUE;
+            } else if (state.outcomes[i] == DAG_EXEC_FAILED ||
+                       state.outcomes[i] == DAG_EXEC_BLOCKED) {
+                node_state = STATE_FALSE;
+            } else {
+                continue;
+            }
+            if (graph->states[i] != (uint8_t)node_state) {
+                graph->states[i] = (uint8_t)node_state;
+                graph->resolved = false;
+            }
+            graph->nodes[i]->state = node_state;
+        }
+        dag_graph_states_changed(graph);
+
+        result = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (state.outcomes[i] != DAG_EXEC_SUCCEEDED &&
+                state.outcomes[i] != DAG_EXEC_CACHED &&
+                state.outcomes[i] != DAG_EXEC_SKIPPED) {
+                result = -1;
+                break;
+            }
+        }
+    }
+
+    if (state.outcomes != outcomes) {
+        free(state.outcomes);
+    }
+    free(state.pending);
+    free(state.blocked);
+    free(state.priority);
+    free(state.ready);
+    free(state.slots);
+    free(state.keys);
+    free(state.keyed);
+    return result;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file executor.h
+ * @brief Build action executor driven by a resolved DAG
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_EXECUTOR_H
+#define POLYBUILD_EXECUTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "../dag/dag.h"
+#include "history.h"
+#include "action_cache.h"
+
+/**
+ * @brief Build action attached to one graph node
+ *
+ * Mirrors the manifest's ActionType. A NULL command makes the node a
+ * pure ordering point that completes without running anything.
+ */
+typedef struct BuildAction {
+    const char* name;
+    const char* command;        // Run through the shell with -c
+    const char* const* inputs;  // Input file paths
+    size_t input_count;
+    const char* const* outputs; // Output file paths
+    size_t output_count;
+} BuildAction;
+
+/**
+ * @brief What happened to a node during execution
+ */
+typedef enum {
+    DAG_EXEC_PENDING,           // Never became ready (stopped early or cycle)
+    DAG_EXEC_SUCCEEDED,         // Command exited with status 0, or no command
+    DAG_EXEC_FAILED,            // Command failed or could not be started
+    DAG_EXEC_SKIPPED,           // Node resolved to STATE_FALSE
+    DAG_EXEC_BLOCKED,           // An upstream action failed
+    DAG_EXEC_CACHED             // Outputs restored from the action cache
+} DAGExecOutcome;
+
+/**
+ * @brief Completion report for one node
+ */
+typedef struct DAGExecReport {
+    size_t node;                // Node index in the graph
+    const BuildAction* action;
+    DAGExecOutcome outcome;
+    int exit_status;            // Exit code, -1 if the command never ran
+    double seconds;             // Wall-clock run time of the command
+} DAGExecReport;
+
+/**
+ * @brief Callback receiving each node as it completes
+ * @param report Completion report
+ * @param ctx Caller context
+ */
+typedef void (*DAGExecReportFn)(const DAGExecReport* report, void* ctx);
+
+/**
+ * @brief Execution options
+ */
+typedef struct DAGExecOptions {
+    size_t jobs;                // Concurrent commands (0 for one per CPU)
+    bool keep_going;            // Keep running independent actions after a failure
+    const double* costs;        // Estimated cost per node, may be NULL
+    const char* shell;          // Shell running the commands (NULL for /bin/sh)
+    DAGExecReportFn report;     // Completion callback, may be NULL
+    void* report_ctx;           // Context passed to the callback
+    bool weighted_edges;        // Scale each downstream path by its edge weight
+    DAGExecHistory* history;    // Duration estimates, updated as commands finish
+    DAGActionCache* cache;      // Output cache consulted before running, may be NULL
+    FileIndex* index;           // Input digests for cache keys, may be NULL
+} DAGExecOptions;
+
+/**
+ * @brief Run the actions of a graph in dependency order
+ *
+ * The graph is resolved first if needed. An action starts as soon as all
+ * of its predecessors have finished; there is no level barrier. Among
+ * ready actions the one with the longest remaining path (by cost) runs
+ * first, so the critical path drives dispatch. Nodes resolved to
+ * STATE_FALSE are skipped without blocking their dependents.
+ *
+ * A node's cost is its recorded duration in @p options->history when
+ * present, else its entry in @p options->costs, else the history's mean
+ * duration, else 1. With weighted_edges the remaining path through an
+ * edge counts weight times the path behind it, so low-weight branches
+ * yield to important ones. Each command that succeeds updates the
+ * history under its action name.
+ *
+ * With a cache, each action with outputs is keyed once its upstream
+ * actions have finished. On a hit its outputs are restored instead of
+ * running the command; after a successful run they are stored. An
+ * action whose inputs cannot be read, or whose upstream has no key
+ * (skipped or failed), always runs. With an index, only inputs whose
+ * stat tuple changed are read to key them; saving the index is up to
+ * the caller.
+ *
+ * Afterwards succeeded and cached nodes are STATE_TRUE and failed or blocked nodes
+ * STATE_FALSE, so the graph needs resolving again before its states
+ * reflect the vote rules. Commands stay in the caller's process group,
+ * so terminal signals such as SIGINT reach them too. Only the pids this
+ * call spawned are reaped, leaving the caller's other children and
+ * concurrent executions alone.
+ *
+ * @param graph Graph to execute
+ * @param actions One action per node, indexed by node index
+ * @param options Execution options (NULL for defaults)
+ * @param outcomes Receives the outcome per node (may be NULL)
+ * @return 0 if every action that ran succeeded, -1 otherwise
+ */
+int dag_graph_execute(DAGGraph* graph, const BuildAction* actions,
+                      const DAGExecOptions* options, DAGExecOutcome* outcomes);
+
+#endif /* POLYBUILD_EXECUTOR_H */
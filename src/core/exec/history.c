@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "history.h"
+#include "../io/atomic_file.h"
+
+// First line of a history file
+#define HISTORY_MAGIC "polybuild-history 1"
+
+// Weight of a new sample in the running estimate
+#define HISTORY_SMOOTHING 0.3
+
+// Initial slot count of the hash table, doubled at 70% load
+#define HISTORY_INITIAL_CAPACITY 64
+
+typedef struct {
+    char* name;                 // NULL for an empty slot
+    uint64_t hash;
+    double seconds;
+    uint32_t samples;
+} DAGExecHistoryEntry;
+
+struct DAGExecHistory {
+    DAGExecHistoryEntry* entries;
+    size_t capacity;
+    size_t count;
+    double total;               // Sum of all estimates, for the mean
+};
+
+static uint64_t history_hash(const char* name) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Find the slot holding a name, or the empty slot where it would go
+ */
+static DAGExecHistoryEntry* history_slot(const DAGExecHistory* history,
+                                         const char* name, uint64_t hash) {
+    size_t mask = history->capacity - 1;
+    for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+        DAGExecHistoryEntry* entry = &history->entries[i];
+        if (!entry->name || (entry->hash == hash && strcmp(entry->name, name) == 0)) {
+            return entry;
+        }
+    }
+}
+
+static int history_grow(DAGExecHistory* history) {
+    size_t old_capacity = history->capacity;
+    DAGExecHistoryEntry* old_entries = history->entries;
+
+    size_t capacity = old_capacity ? old_capacity * 2 : HISTORY_INITIAL_CAPACITY;
+    DAGExecHistoryEntry* entries = (DAGExecHistoryEntry*)calloc(capacity,
+                                                                sizeof(DAGExecHistoryEntry));
+    if (!entries) {
+        return -1;
+    }
+
+    history->entries = entries;
+    history->capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_entries[i].name) {
+            *history_slot(history, old_entries[i].name, old_entries[i].hash) = old_entries[i];
+        }
+    }
+
+    free(old_entries);
+    return 0;
+}
+
+DAGExecHistory* dag_exec_history_create(void) {
+    DAGExecHistory* history = (DAGExecHistory*)calloc(1, sizeof(DAGExecHistory));
+    if (!history) {
+        return NULL;
+    }
+    if (history_grow(history) != 0) {
+        free(history);
+        return NULL;
+    }
+    return history;
+}
+
+/**
+ * Insert or overwrite an entry with a known estimate
+ */
+static int history_store(DAGExecHistory* history, const char* name,
+                         double seconds, uint32_t samples) {
+    if ((history->count + 1) * 10 > history->capacity * 7 && history_grow(history) != 0) {
+        return -1;
+    }
+
+    uint64_t hash = history_hash(name);
+    DAGExecHistoryEntry* entry = history_slot(history, name, hash);
+    if (entry->name) {
+        history->total -= entry->seconds;
+    } else {
+        entry->name = strdup(name);
+        if (!entry->name) {
+            return -1;
+        }
+        entry->hash = hash;
+        history->count++;
+    }
+
+    entry->seconds = seconds;
+    entry->samples = samples;
+    history->total += seconds;
+    return 0;
+}
+
+DAGExecHistory* dag_exec_history_load(const char* path) {
+    if (!path) {
+        return NULL;
+    }
+
+    DAGExecHistory* history = dag_exec_history_create();
+    if (!history) {
+        return NULL;
+    }
+
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        // No history yet is not an error
+        if (errno == ENOENT) {
+            return history;
+        }
+        dag_exec_history_free(history);
+        return NULL;
+    }
+
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length = getline(&line, &line_capacity, file);
+    bool ok = length > 0 && strncmp(line, HISTORY_MAGIC, strlen(HISTORY_MAGIC)) == 0;
+
+    // Each entry: "<seconds> <samples> <name>"
+    while (ok && (length = getline(&line, &line_capacity, file)) > 0) {
+        if (line[length - 1] == '\n') {
+            line[--length] = '\0';
+        }
+
+        char* end;
+        double seconds = strtod(line, &end);
+        if (end == line || *end != ' ') {
+            continue;
+        }
+        char* name;
+        unsigned long samples = strtoul(end + 1, &name, 10);
+        if (name == end + 1 || *name != ' ' || name[1] == '\0' || seconds < 0.0) {
+            continue;
+        }
+
+        ok = history_store(history, name + 1, seconds, (uint32_t)samples) == 0;
+    }
+
+    free(line);
+    fclose(file);
+    if (!ok) {
+        dag_exec_history_free(history);
+        return NULL;
+    }
+    return history;
+}
+
+int dag_exec_history_save(const DAGExecHistory* history, const char* path) {
+    if (!history || !path) {
+        return -1;
+    }
+
+    AtomicFile atomic;
+    if (atomic_file_open(&atomic, path, 0666) != 0) {
+        return -1;
+    }
+    FILE* file = atomic_file_stream(&atomic);
+
+    bool ok = file && fprintf(file, "%s\n", HISTORY_MAGIC) > 0;
+    for (size_t i = 0; ok && i < history->capacity; i++) {
+        const DAGExecHistoryEntry* entry = &history->entries[i];
+        if (!entry->name || strchr(entry->name, '\n')) {
+            continue;
+        }
+        ok = fprintf(file, "%.17g %u %s\n", entry->seconds, entry->samples, entry->name) > 0;
+    }
+
+    return atomic_file_close(&atomic, ok);
+}
+
+bool dag_exec_history_lookup(const DAGExecHistory* history, const char* name,
+                             double* seconds) {
+    if (!history || !name || !seconds) {
+        return false;
+    }
+
+    const DAGExecHistoryEntry* entry = history_slot(history, name, history_hash(name));
+    if (!entry->name) {
+        return false;
+    }
+    *seconds = entry->seconds;
+    return true;
+}
+
+bool dag_exec_history_mean(const DAGExecHistory* history, double* seconds) {
+    if (!history || !seconds || history->count == 0) {
+        return false;
+    }
+    *seconds = history->total / (double)history->count;
+    return true;
+}
+
+int dag_exec_history_record(DAGExecHistory* history, const char* name, double seconds) {
+    if (!history || !name || !name[0] || seconds < 0.0) {
+        return -1;
+    }
+
+    const DAGExecHistoryEntry* entry = history_slot(history, name, history_hash(name));
+    if (!entry->name) {
+        return history_store(history, name, seconds, 1);
+    }
+
+    double estimate = entry->seconds + (seconds - entry->seconds) * HISTORY_SMOOTHING;
+    uint32_t samples = entry->samples < UINT32_MAX ? entry->samples + 1 : entry->samples;
+    return history_store(history, name, estimate, samples);
+}
+
+size_t dag_exec_history_count(const DAGExecHistory* history) {
+    return history ? history->count : 0;
+}
+
+void dag_exec_history_free(DAGExecHistory* history) {
+    if (!history) {
+        return;
+    }
+
+    for (size_t i = 0; i < history->capacity; i++) {
+        free(history->entries[i].name);
+    }
+    free(history->entries);
+    free(history);
+}
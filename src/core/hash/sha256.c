@@ -0,0 +1,184 @@
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sha256.h"
+
+// Read granularity of sha256_file()
+#define SHA256_FILE_CHUNK 65536
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define SHA256_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * Compress one 64-byte block into the state
+ */
+static void sha256_block(uint32_t state[8], const uint8_t* block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)block[4 * i] << 24 | (uint32_t)block[4 * i + 1] << 16 |
+               (uint32_t)block[4 * i + 2] << 8 | (uint32_t)block[4 * i + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = SHA256_ROTR(w[i - 15], 7) ^ SHA256_ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = SHA256_ROTR(w[i - 2], 17) ^ SHA256_ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = SHA256_ROTR(e, 6) ^ SHA256_ROTR(e, 11) ^ SHA256_ROTR(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+        uint32_t s0 = SHA256_ROTR(a, 2) ^ SHA256_ROTR(a, 13) ^ SHA256_ROTR(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void sha256_init(Sha256* sha) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(sha->state, initial, sizeof(initial));
+    sha->length = 0;
+    sha->block_used = 0;
+}
+
+void sha256_update(Sha256* sha, const void* data, size_t len) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    sha->length += len;
+
+    // Top up a partial block first
+    if (sha->block_used > 0) {
+        size_t take = 64 - sha->block_used < len ? 64 - sha->block_used : len;
+        memcpy(sha->block + sha->block_used, bytes, take);
+        sha->block_used += take;
+        bytes += take;
+        len -= take;
+        if (sha->block_used < 64) {
+            return;
+        }
+        sha256_block(sha->state, sha->block);
+        sha->block_used = 0;
+    }
+
+    // Whole blocks straight from the input
+    while (len >= 64) {
+        sha256_block(sha->state, bytes);
+        bytes += 64;
+        len -= 64;
+    }
+
+    memcpy(sha->block, bytes, len);
+    sha->block_used = len;
+}
+
+void sha256_final(Sha256* sha, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    uint64_t bits = sha->length * 8;
+
+    // Padding: a one bit, zeros, then the big-endian bit length
+    sha->block[sha->block_used++] = 0x80;
+    if (sha->block_used > 56) {
+        memset(sha->block + sha->block_used, 0, 64 - sha->block_used);
+        sha256_block(sha->state, sha->block);
+        sha->block_used = 0;
+    }
+    memset(sha->block + sha->block_used, 0, 56 - sha->block_used);
+    for (int i = 0; i < 8; i++) {
+        sha->block[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+    }
+    sha256_block(sha->state, sha->block);
+
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = (uint8_t)(sha->state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(sha->state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(sha->state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)sha->state[i];
+    }
+}
+
+void sha256_digest(const void* data, size_t len, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    Sha256 sha;
+    sha256_init(&sha);
+    sha256_update(&sha, data, len);
+    sha256_final(&sha, digest);
+}
+
+int sha256_file(const char* path, uint8_t digest[SHA256_DIGEST_SIZE]) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    uint8_t* buffer = (uint8_t*)malloc(SHA256_FILE_CHUNK);
+    if (!buffer || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        free(buffer);
+        close(fd);
+        return -1;
+    }
+
+    Sha256 sha;
+    sha256_init(&sha);
+    int result = 0;
+    for (;;) {
+        ssize_t got = read(fd, buffer, SHA256_FILE_CHUNK);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            result = -1;
+            break;
+        }
+        if (got == 0) {
+            break;
+        }
+        sha256_update(&sha, buffer, (size_t)got);
+    }
+
+    // A file that changed size while being read has no stable digest
+    if (sha.length != (uint64_t)st.st_size) {
+        result = -1;
+    }
+    sha256_final(&sha, digest);
+
+    free(buffer);
+    close(fd);
+    return result;
+}
+
+void sha256_to_hex(const uint8_t digest[SHA256_DIGEST_SIZE], char hex[2 * SHA256_DIGEST_SIZE + 1]) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        hex[2 * i] = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 0x0f];
+    }
+    hex[2 * SHA256_DIGEST_SIZE] = '\0';
+}
@@ -1,325 +1,446 @@
-<!-- polybuild-definition-schema.xsd -->
-<?xml version="1.0" encoding="UTF-8"?>
-<xs:schema xmlns:xs="http://www.w3.org/2001/XMLSchema"
-           xmlns:pbd="http://schema.obinexus.org/polybuild/definition/1.0"
-           targetNamespace="http://schema.obinexus.org/polybuild/definition/1.0"
-           elementFormDefault="qualified">
-
-  <!-- Root element: PolyBuild Definition -->
-  <xs:element name="definition" type="pbd:DefinitionType"/>
-
-  <!-- Definition Type -->
-  <xs:complexType name="DefinitionType">
-    <xs:sequence>
-      <xs:element name="identity" type="pbd:IdentityType"/>
-      <xs:element name="topology" type="pbd:TopologyType"/>
-      <xs:element name="intents" type="pbd:IntentsType" minOccurs="0"/>
-      <xs:element name="actions" type="pbd:ActionsType" minOccurs="0"/>
-      <xs:element name="source" type="pbd:SourceType" minOccurs="0"/>
-      <xs:element name="dependencies" type="pbd:DependenciesType" minOccurs="0"/>
-    </xs:sequence>
-    <xs:attribute name="name" type="xs:string" use="required"/>
-    <xs:attribute name="version" type="xs:string" use="required"/>
-  </xs:complexType>
-
-  <!-- Identity Type -->
-  <xs:complexType name="IdentityType">
-    <xs:sequence>
-      <xs:element name="name" type="xs:string"/>
-      <xs:element name="version" type="xs:string"/>
-      <xs:element name="stability" type="pbd:StabilityType"/>
-      <xs:element name="guid" type="xs:string"/>
-    </xs:sequence>
-  </xs:complexType>
-
-  <!-- Stability Type -->
-  <xs:simpleType name="StabilityType">
-    <xs:restriction base="xs:string">
-      <xs:enumeration value="experimental"/>
-      <xs:enumeration value="beta"/>
-      <xs:enumeration value="stable"/>
-      <xs:enumeration value="legacy"/>
-    </xs:restriction>
-  </xs:simpleType>
-
-  <!-- Topology Type -->
-  <xs:complexType name="TopologyType">
-    <xs:sequence>
-      <xs:element name="fault-tolerance" type="pbd:FaultToleranceType"/>
-      <xs:element name="concurrency" type="pbd:ConcurrencyType"/>
-      <xs:element name="binary-encoding" type="pbd:BinaryEncodingType"/>
-    </xs:sequence>
-    <xs:attribute name="type" type="pbd:TopologyTypeEnum" use="required"/>
-  </xs:complexType>
-
-  <!-- Topology Type Enumeration -->
-  <xs:simpleType name="TopologyTypeEnum">
-    <xs:restriction base="xs:string">
-      <xs:enumeration value="p2p"/>
-      <xs:enumeration value="bus"/>
-      <xs:enumeration value="star"/>
-      <xs:enumeration value="ring"/>
-      <xs:enumeration value="mesh"/>
-    </xs:restriction>
-  </xs:simpleType>
-
-  <!-- Fault Tolerance Type -->
-  <xs:complexType name="FaultToleranceType">
-    <xs:attribute name="level" use="required">
-      <xs:simpleType>
-        <xs:restriction base="xs:integer">
-          <xs:minInclusive value="0"/>
-          <xs:maxInclusive value="12"/>
-        </xs:restriction>
-      </xs:simpleType>
-    </xs:attribute>
-  </xs:complexType>
-
-  <!-- Concurrency Type -->
-  <xs:complexType name="ConcurrencyType">
-    <xs:attribute name="model" type="pbd:ConcurrencyModel" use="required"/>
-  </xs:complexType>
-
-  <!-- Concurrency Model -->
-  <xs:simpleType name="ConcurrencyModel">
-    <xs:restriction base="xs:string">
-      <xs:enumeration value="sequential"/>
-      <xs:enumeration value="parallel"/>
-      <xs:enumeration value="pipeline"/>
-    </xs:restriction>
-  </xs:simpleType>
-
-  <!-- Binary Encoding Type (7-bit pattern) -->
-  <xs:simpleType name="BinaryEncodingType">
-    <xs:restriction base="xs:string">
-      <xs:pattern value="[01]{7}"/>
-    </xs:restriction>
-  </xs:simpleType>
-
-  <!-- Intents Type -->
-  <xs:complexType name="IntentsType">
-    <xs:sequence>
-      <xs:element name="intent" type="pbd:IntentType" maxOccurs="unbounded"/>
-    </xs:sequence>
-  </xs:complexType>
-
-  <!-- Intent Type -->
-  <xs:complexType name="IntentType">
-    <xs:sequence>
-      <xs:element name="stage" type="pbd:IntentStageType" minOccurs="0"/>
-      <xs:element name="priority" type="xs:integer" minOccurs="0"/>
-    </xs:sequence>
-    <xs:attribute name="expression" type="pbd:IntentExpressionType" use="required"/>
-  </xs:complexType>
-
-  <!-- Intent Expression Type (verb-noun-binding pattern) -->
-  <xs:simpleType name="IntentExpressionType">
-    <xs:restriction base="xs:string">
-      <xs:pattern value="(validate|build|compile|link|test|deploy|clean|reroute|configure)\s+(policy|target|source|dependency|artifact|pipeline|configuration|manifest)(\s+\w+)?"/>
-    </xs:restriction>
-  </xs:simpleType>
-
-  <!-- Intent Stage Type -->
-  <xs:simpleType name="IntentStageType">
-    <xs:restriction base="xs:string">
-      <xs:enumeration value="todo"/>
-      <xs:enumeration value="doing"/>
-      <xs:enumeration value="done"/>
-    </xs:restriction>
-  </xs:simpleType>
-
-  <!-- Actions Type -->
-  <xs:complexType name="ActionsType">
-    <xs:sequence>
-      <xs:element name="action" type="pbd:ActionType" maxOccurs="unbounded"/>
-    </xs:sequence>
-  </xs:complexType>
-
-  <!-- Action Type -->
-  <xs:complexType name="ActionType">
-    <xs:sequence>
-      <xs:element name="command" type="xs:string"/>
-      <xs:element name="inputs" type="pbd:InputsType" minOccurs="0"/>
-      <xs:element name="outputs" type="pbd:OutputsType" minOccurs="0"/>
-    </xs:sequence>
-    <xs:attribute name="name" type="xs:string" use="required"/>
-  </xs:complexType>
-
-  <!-- Inputs/Outputs Types -->
-  <xs:complexType name="InputsType">
-    <xs:sequence>
-      <xs:element name="input" maxOccurs="unbounded">
-        <xs:complexType>
-          <xs:attribute name="path" type="xs:string" use="required"/>
-        </xs:complexType>
-      </xs:element>
-    </xs:sequence>
-  </xs:complexType>
-
-  <xs:complexType name="OutputsType">
-    <xs:sequence>
-      <xs:element name="output" maxOccurs="unbounded">
-        <xs:complexType>
-          <xs:attribute name="path" type="xs:string" use="required"/>
-        </xs:complexType>
-      </xs:element>
-    </xs:sequence>
-  </xs:complexType>
-
-  <!-- Source Type -->
-  <xs:complexType name="SourceType">
-    <xs:sequence>
-      <xs:element name="include" type="xs:string" maxOccurs="unbounded"/>
-      <xs:element name="exclude" type="xs:string" minOccurs="0" maxOccurs="unbounded"/>
-    </xs:sequence>
-    <xs:attribute name="root" type="xs:string" use="required"/>
-  </xs:complexType>
-
-  <!-- Dependencies Type -->
-  <xs:complexType name="DependenciesType">
-    <xs:sequence>
-      <xs:element name="dependency" type="pbd:DependencyType" maxOccurs="unbounded"/>
-    </xs:sequence>
-  </xs:complexType>
-
-  <!-- Dependency Type -->
-  <xs:complexType name="DependencyType">
-    <xs:attribute name="name" type="xs:string" use="required"/>
-    <xs:attribute name="version" type="xs:string" use="required"/>
-  </xs:complexType>
-
-</xs:schema>
-
-<!-- Example: complete-polybuild-definition.xml -->
-<?xml version="1.0" encoding="UTF-8"?>
-<pbd:definition 
-    xmlns:pbd="http://schema.obinexus.org/polybuild/definition/1.0"
-    xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance"
-    xsi:schemaLocation="http://schema.obinexus.org/polybuild/definition/1.0 polybuild-definition-schema.xsd"
-    name="intent-driven-component"
-    version="1.0.0">
-    
-    <!-- Component Identity -->
-    <pbd:identity>
-        <pbd:name>intent-resolver-core</pbd:name>
-        <pbd:version>1.0.0</pbd:version>
-        <pbd:stability>stable</pbd:stability>
-        <pbd:guid>550e8400-e29b-41d4-a716-446655440000</pbd:guid>
-    </pbd:identity>
-    
-    <!-- Build Topology Definition (Binary: 0101101) -->
-    <pbd:topology type="star">
-        <pbd:fault-tolerance level="6" />
-        <pbd:concurrency model="parallel" />
-        <pbd:binary-encoding>0101101</pbd:binary-encoding>
-    </pbd:topology>
-    
-    <!-- Intent-Driven Declarations -->
-    <pbd:intents>
-        <pbd:intent expression="validate policy live">
-            <pbd:stage>todo</pbd:stage>
-            <pbd:priority>100</pbd:priority>
-        </pbd:intent>
-        
-        <pbd:intent expression="reroute pipeline beta">
-            <pbd:stage>todo</pbd:stage>
-            <pbd:priority>80</pbd:priority>
-        </pbd:intent>
-        
-        <pbd:intent expression="build target release">
-            <pbd:stage>todo</pbd:stage>
-            <pbd:priority>90</pbd:priority>
-        </pbd:intent>
-        
-        <pbd:intent expression="compile source optimized">
-            <pbd:stage>todo</pbd:stage>
-            <pbd:priority>85</pbd:priority>
-        </pbd:intent>
-        
-        <pbd:intent expression="test artifact comprehensive">
-            <pbd:stage>todo</pbd:stage>
-            <pbd:priority>70</pbd:priority>
-        </pbd:intent>
-    </pbd:intents>
-    
-    <!-- Source Definition -->
-    <pbd:source root="./src">
-        <pbd:include>**/*.c</pbd:include>
-        <pbd:include>**/*.h</pbd:include>
-        <pbd:include>intent/**/*.xml</pbd:include>
-        <pbd:exclude>**/test/**</pbd:exclude>
-        <pbd:exclude>**/deprecated/**</pbd:exclude>
-    </pbd:source>
-    
-    <!-- Dependency Relationships -->
-    <pbd:dependencies>
-        <pbd:dependency name="dag-core" version="^1.0.0" />
-        <pbd:dependency name="xml-parser" version="~2.1.0" />
-        <pbd:dependency name="semantic-validator" version="^1.2.0" />
-    </pbd:dependencies>
-    
-    <!-- Build Actions (Mapped from Intents) -->
-    <pbd:actions>
-        <pbd:action name="validate-semantics">
-            <pbd:command>$(VALIDATOR) $(XML_MANIFEST) --strict</pbd:command>
-            <pbd:inputs>
-                <pbd:input path="$(MANIFEST_FILES)" />
-            </pbd:inputs>
-            <pbd:outputs>
-                <pbd:output path="$(BUILD_DIR)/validation.report" />
-            </pbd:outputs>
-        </pbd:action>
-        
-        <pbd:action name="resolve-intents">
-            <pbd:command>$(INTENT_RESOLVER) $(INTENT_MANIFEST) --topology=0101101</pbd:command>
-            <pbd:inputs>
-                <pbd:input path="$(INTENT_FILES)" />
-            </pbd:inputs>
-            <pbd:outputs>
-                <pbd:output path="$(BUILD_DIR)/resolved_intents.dag" />
-            </pbd:outputs>
-        </pbd:action>
-        
-        <pbd:action name="compile-with-topology">
-            <pbd:command>$(COMPILER) $(SOURCE) -o $(OUTPUT) --topology-aware</pbd:command>
-            <pbd:inputs>
-                <pbd:input path="$(SOURCE_FILES)" />
-            </pbd:inputs>
-            <pbd:outputs>
-                <pbd:output path="$(BUILD_DIR)/$(TARGET).o" />
-            </pbd:outputs>
-        </pbd:action>
-    </pbd:actions>
-</pbd:definition>
-
-<!-- polybuild.in configuration file -->
-# PolyBuild Intent-Driven Configuration
-# Topology Binary Encoding: 0101101 (Star/Parallel/FT6)
-
-@directive [plugin:intent-resolver]
-input.manifest = polybuild-definition.xml
-input.topology_encoding = 0101101
-input.semantic_validation = strict
-
-@directive [plugin:xml-validator]
-input.schema = polybuild-definition-schema.xsd
-input.namespace = http://schema.obinexus.org/polybuild/definition/1.0
-
-# Intent Resolution Pipeline
-action.parse_intents
-action.validate_semantics  
-action.resolve_dependencies
-action.execute_todo_stage
-action.transition_doing_stage
-action.complete_done_stage
-
-# Topology-Aware Build Actions
-action.compile_with_star_topology
-action.parallel_link_phase
-action.fault_tolerant_test
-
-# Semantic Layer Enforcement
-semantic.strict_validation = true
-semantic.namespace_aware = true
-semantic.verb_noun_patterns = true
-semantic.stage_transitions = true
+/*
+ * intent_dag_integration.h - Integration between Intent Resolution and DAG
+ * OBINexus Computing - PolyBuild Architecture
+ */
+
+#ifndef POLYBUILD_INTENT_DAG_H
+#define POLYBUILD_INTENT_DAG_H
+
+#include "../dag/dag.h"
+#include "../trie/trie.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+// =============================================================================
+// INTENT-DAG INTEGRATION TYPES
+// =============================================================================
+
+typedef enum {
+    INTENT_VERB_VALIDATE = 0,
+    INTENT_VERB_BUILD = 1,
+    INTENT_VERB_COMPILE = 2,
+    INTENT_VERB_LINK = 3,
+    INTENT_VERB_TEST = 4,
+    INTENT_VERB_DEPLOY = 5,
+    INTENT_VERB_CLEAN = 6,
+    INTENT_VERB_REROUTE = 7,
+    INTENT_VERB_CONFIGURE = 8
+} IntentVerb;
+
+typedef enum {
+    INTENT_NOUN_POLICY = 0,
+    INTENT_NOUN_TARGET = 1,
+    INTENT_NOUN_SOURCE = 2,
+    INTENT_NOUN_DEPENDENCY = 3,
+    INTENT_NOUN_ARTIFACT = 4,
+    INTENT_NOUN_PIPELINE = 5,
+    INTENT_NOUN_CONFIGURATION = 6,
+    INTENT_NOUN_MANIFEST = 7
+} IntentNoun;
+
+typedef enum {
+    INTENT_STAGE_TODO = 0,
+    INTENT_STAGE_DOING = 1,
+    INTENT_STAGE_DONE = 2
+} IntentStage;
+
+typedef struct {
+    IntentVerb verb;
+    IntentNoun noun;
+    char* binding_value;
+    IntentStage stage;
+    uint32_t priority;
+    bool triggers_action;
+    char* semantic_context;
+    DAGNode* dag_representation;  // Link to DAG node
+    char* build_action;           // Action name generated for the intent
+} IntentResolution;
+
+typedef struct {
+    uint8_t encoding;         // Bit i is character i of "0101101"
+    uint8_t topology_type;    // Decoded from bits 2-3
+    uint8_t fault_tolerance;  // Decoded from bit 4
+    uint8_t concurrency_model;// Decoded from bits 5-6
+    bool semantic_validation; // Decoded from bit 0
+} TopologyDecoding;
+
+// =============================================================================
+// TOPOLOGY DECODING FUNCTIONS
+// =============================================================================
+
+// Number of distinct 7-bit topology encodings
+#define TOPOLOGY_ENCODING_COUNT 128
+
+/**
+ * @brief Fully decoded constraints of one topology encoding
+ *
+ * @c state_map gives the state a node takes under the topology, indexed
+ * by category * 3 + state: with semantic validation, uncategorized nodes
+ * fail; with fault tolerance, failed nodes are reopened. Entry 15 is
+ * padding.
+ */
+typedef struct {
+    uint8_t topology_type;
+    uint8_t fault_tolerance;
+    uint8_t concurrency_model;
+    bool semantic_validation;
+    uint8_t state_map[16];
+} TopologyConstraints;
+
+/**
+ * @brief Pack a binary topology string into its encoding
+ * @param binary_str Binary string like "0101101"
+ * @param encoding Receives the encoding, bit i from character i
+ * @return true if the string is exactly 7 binary digits
+ */
+bool topology_encoding_parse(const char* binary_str, uint8_t* encoding);
+
+/**
+ * @brief Look up the decoded constraints of an encoding
+ * @param encoding 7-bit encoding, higher bits are ignored
+ * @return Entry of the static table, never NULL
+ */
+const TopologyConstraints* topology_constraints(uint8_t encoding);
+
+/**
+ * @brief Apply an encoding's constraints to flat node arrays
+ *
+ * One table lookup per node and no branches, so the loop vectorizes.
+ *
+ * @param encoding 7-bit encoding
+ * @param categories TaxonomyCategory per node
+ * @param states NodeState per node, updated in place
+ * @param count Number of nodes
+ */
+void topology_apply_states(uint8_t encoding, const uint8_t* categories, uint8_t* states,
+                           size_t count);
+
+/**
+ * @brief Decode binary topology string into structured format
+ * @param binary_str Binary string like "0101101"
+ * @return Decoded topology specification
+ */
+TopologyDecoding* decode_topology_binary(const char* binary_str);
+
+/**
+ * @brief Apply topology constraints to DAG resolution
+ *
+ * Each node's state is replaced by the constraint table's state_map
+ * entry for its category and state.
+ *
+ * @param dag_nodes Array of DAG nodes
+ * @param node_count Number of nodes
+ * @param topology Topology specification
+ * @return 0 on success, -1 on failure
+ */
+int apply_topology_constraints(DAGNode* dag_nodes[], size_t node_count, 
+                              TopologyDecoding* topology);
+
+// =============================================================================
+// INTENT RESOLUTION FUNCTIONS  
+// =============================================================================
+
+/**
+ * @brief Parse intent expression into structured resolution
+ * @param expression String like "validate policy live"
+ * @param topology Topology context for resolution
+ * @return Parsed intent resolution structure
+ */
+IntentResolution* parse_intent_expression(const char* expression, 
+                                        TopologyDecoding* topology);
+
+/**
+ * @brief Intent expression parsed in place
+ *
+ * The binding is a span of the parsed text, so parsing allocates nothing.
+ */
+typedef struct {
+    IntentVerb verb;
+    IntentNoun noun;
+    const char* binding;        // Binding word in the expression, NULL if none
+    size_t binding_len;
+} IntentExpression;
+
+/**
+ * @brief Look up a verb keyword through a perfect hash
+ * @param text Keyword (not NUL-terminated)
+ * @param len Length of the keyword
+ * @param verb Receives the verb
+ * @return true if the text is exactly a verb keyword
+ */
+bool intent_verb_lookup(const char* text, size_t len, IntentVerb* verb);
+
+/**
+ * @brief Look up a noun keyword through a perfect hash
+ * @param text Keyword (not NUL-terminated)
+ * @param len Length of the keyword
+ * @param noun Receives the noun
+ * @return true if the text is exactly a noun keyword
+ */
+bool intent_noun_lookup(const char* text, size_t len, IntentNoun* noun);
+
+/**
+ * @brief Parse "verb noun [binding]" without allocating
+ *
+ * Accepts exactly the schema's IntentExpressionType pattern: words are
+ * runs of [A-Za-z0-9_] separated by whitespace, with nothing before the
+ * verb or after the last word.
+ *
+ * @param text Expression (not NUL-terminated)
+ * @param len Length of the expression
+ * @param expression Receives the parsed expression
+ * @return true if the expression is valid
+ */
+bool intent_expression_parse(const char* text, size_t len, IntentExpression* expression);
+
+/**
+ * @brief Parse an array of NUL-terminated expressions
+ * @param texts Expressions to parse
+ * @param count Number of expressions
+ * @param expressions Receives one parsed expression per input
+ * @param valid Receives whether each input parsed, may be NULL
+ * @return Number of valid expressions
+ */
+size_t intent_expression_parse_batch(const char* const* texts, size_t count,
+                                     IntentExpression* expressions, bool* valid);
+
+/**
+ * @brief Create DAG node from intent resolution
+ *
+ * The node is stored in @c intent->dag_representation but belongs to
+ * the caller: free it with dag_node_free() or hand it to a graph.
+ * free_intent_resolution() leaves it alone.
+ *
+ * @param intent Intent to convert to DAG node
+ * @return DAG node representing the intent
+ */
+DAGNode* create_dag_from_intent(IntentResolution* intent);
+
+/**
+ * @brief Resolve intent through stage transitions (TODO->DOING->DONE)
+ * @param intent Intent to resolve
+ * @param topology Topology context
+ * @return true if intent completed, false if still processing
+ */
+bool resolve_intent_stages(IntentResolution* intent, TopologyDecoding* topology);
+
+/**
+ * @brief Create trie pattern for intent verb-noun matching
+ * @param root Trie root node
+ * @param intent Intent to create pattern for
+ * @return 0 on success, -1 on failure
+ */
+int insert_intent_pattern(TrieNode* root, IntentResolution* intent);
+
+// =============================================================================
+// XML SEMANTIC ENFORCEMENT
+// =============================================================================
+
+typedef struct {
+    char* namespace_uri;
+    char* element_name;
+    char** allowed_values;
+    size_t value_count;
+    bool required;
+} SemanticRule;
+
+typedef struct {
+    SemanticRule* rules;
+    size_t rule_count;
+    bool strict_validation;
+    char* schema_version;
+} SemanticValidator;
+
+/**
+ * @brief Create semantic validator for XML manifests
+ * @return Initialized semantic validator
+ */
+SemanticValidator* create_semantic_validator(void);
+
+/**
+ * @brief Validate intent against semantic rules
+ * @param intent Intent to validate
+ * @param validator Semantic validator
+ * @return true if valid, false if validation failed
+ */
+bool validate_intent_semantics(IntentResolution* intent, SemanticValidator* validator);
+
+/**
+ * @brief Validate topology encoding against semantic rules
+ * @param topology Topology to validate
+ * @param validator Semantic validator
+ * @return true if valid, false if validation failed
+ */
+bool validate_topology_semantics(TopologyDecoding* topology, SemanticValidator* validator);
+
+// =============================================================================
+// INTEGRATION WORKFLOW FUNCTIONS
+// =============================================================================
+
+struct ManifestError;
+
+/**
+ * @brief Complete intent-driven build workflow
+ * @param xml_manifest Path to XML manifest file
+ * @param output_dag Resulting DAG structure
+ * @param dag_size Receives the number of nodes
+ * @param error Receives the reason for a failure with its manifest line
+ *        (0 if not tied to a line), may be NULL
+ * @return 0 on success, error code on failure
+ */
+int execute_intent_workflow(const char* xml_manifest, DAGNode*** output_dag, size_t* dag_size,
+                            struct ManifestError* error);
+
+/**
+ * @brief Apply parallel processing based on topology
+ *
+ * Each intent goes through four stages: its expression is parsed, its
+ * verb and noun are validated, it is resolved to a DAG node under the
+ * topology's constraints, and actionable intents get a build_action
+ * named verb_noun[_binding]. Finished intents are INTENT_STAGE_DONE with
+ * a STATE_TRUE node; an intent failing a stage, or whose node the
+ * constraints fail, is left where it stopped.
+ *
+ * The concurrency model picks the schedule: sequential runs intents one
+ * after another, parallel fans them out over a thread pool, and
+ * pipeline runs each stage on its own thread, connected by bounded
+ * queues so the stages overlap. The parallel model creates and joins a
+ * thread pool on every call; callers processing batches repeatedly
+ * should keep a pool and use apply_parallel_intent_processing_on().
+ *
+ * Intents without a dag_representation get one from
+ * create_dag_from_intent(), so the caller owns those nodes: free each
+ * with dag_node_free(), or add it to a graph that frees it, before or
+ * after free_intent_resolution().
+ *
+ * @param intents Array of intent resolutions
+ * @param intent_count Number of intents
+ * @param topology Topology specification
+ * @return 0 on success, -1 if any intent failed
+ */
+int apply_parallel_intent_processing(IntentResolution** intents, size_t intent_count,
+                                   TopologyDecoding* topology);
+
+/**
+ * @brief Apply parallel processing on a caller-owned pool
+ *
+ * Same as apply_parallel_intent_processing(); the parallel model fans
+ * out over @p pool instead of a pool created for the call, so repeated
+ * batches share its threads; batches on several threads take turns on
+ * it. The other models ignore the pool.
+ *
+ * @param intents Array of intent resolutions
+ * @param intent_count Number of intents
+ * @param topology Topology specification
+ * @param pool Pool for the parallel model (NULL runs it on the caller)
+ * @return 0 on success, -1 if any intent failed
+ */
+int apply_parallel_intent_processing_on(IntentResolution** intents, size_t intent_count,
+                                        TopologyDecoding* topology, ThreadPool* pool);
+
+/**
+ * @brief Generate build actions from resolved intents
+ * @param intents Array of resolved intents  
+ * @param intent_count Number of intents
+ * @param output_actions Generated build actions
+ * @return Number of actions generated
+ */
+size_t generate_build_actions(IntentResolution** intents, size_t intent_count,
+                            char*** output_actions);
+
+// =============================================================================
+// UTILITY FUNCTIONS
+// =============================================================================
+
+/**
+ * @brief Convert intent verb to string representation
+ * @param verb Intent verb enum
+ * @return String representation
+ */
+const char* intent_verb_to_string(IntentVerb verb);
+
+/**
+ * @brief Convert intent noun to string representation  
+ * @param noun Intent noun enum
+ * @return String representation
+ */
+const char* intent_noun_to_string(IntentNoun noun);
+
+/**
+ * @brief Convert intent stage to string representation
+ * @param stage Intent stage enum
+ * @return String representation
+ */
+const char* intent_stage_to_string(IntentStage stage);
+
+/**
+ * @brief Print intent resolution for debugging
+ * @param intent Intent to print
+ */
+void print_intent_resolution(IntentResolution* intent);
+
+/**
+ * @brief Print topology decoding for debugging
+ * @param topology Topology to print
+ */
+void print_topology_decoding(TopologyDecoding* topology);
+
+/**
+ * @brief Free intent resolution structure
+ *
+ * Frees the intent and its strings. The dag_representation node is not
+ * freed: it may belong to a graph, and otherwise belongs to whoever
+ * called create_dag_from_intent() or apply_parallel_intent_processing().
+ *
+ * @param intent Intent to free
+ */
+void free_intent_resolution(IntentResolution* intent);
+
+/**
+ * @brief Free topology decoding structure
+ * @param topology Topology to free
+ */
+void free_topology_decoding(TopologyDecoding* topology);
+
+/**
+ * @brief Free semantic validator structure
+ * @param validator Validator to free
+ */
+void free_semantic_validator(SemanticValidator* validator);
+
+#endif /* POLYBUILD_INTENT_DAG_H */
+
+/*
+ * Example Usage:
+ * 
+ * // 1. Decode topology from binary
+ * TopologyDecoding* topology = decode_topology_binary("0101101");
+ * 
+ * // 2. Parse intent expressions
+ * IntentResolution* intent1 = parse_intent_expression("validate policy live", topology);
+ * IntentResolution* intent2 = parse_intent_expression("build target release", topology);
+ * 
+ * // 3. Create DAG from intents
+ * DAGNode* dag1 = create_dag_from_intent(intent1);
+ * DAGNode* dag2 = create_dag_from_intent(intent2);
+ * 
+ * // 4. Apply topology constraints
+ * DAGNode* dag_nodes[] = {dag1, dag2};
+ * apply_topology_constraints(dag_nodes, 2, topology);
+ * 
+ * // 5. Resolve through stages
+ * while (!resolve_intent_stages(intent1, topology)) {
+ *     // Continue processing until DONE
+ * }
+ * 
+ * // 6. Generate build actions
+ * IntentResolution* intents[] = {intent1, intent2};
+ * char** actions;
+ * size_t action_count = generate_build_actions(intents, 2, &actions);
+ *
+ * // 7. Release; the intents' nodes are the caller's
+ * dag_node_free(intent1->dag_representation);
+ * dag_node_free(intent2->dag_representation);
+ * free_intent_resolution(intent1);
+ * free_intent_resolution(intent2);
+ */
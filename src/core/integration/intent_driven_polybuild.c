@@ -1,280 +1,708 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "intent_dag_integration.h"
+#include "manifest.h"
+#include "../parallel/thread_pool.h"
+#include "../parallel/bounded_queue.h"
+#include "../trace/trace.h"
+
+static const char* const intent_verb_names[] = {
+    "validate", "build", "compile", "link", "test", "deploy", "clean", "reroute", "configure"
+};
+
+static const char* const intent_noun_names[] = {
+    "policy", "target", "source", "dependency", "artifact", "pipeline", "configuration", "manifest"
+};
+
+static const char* const intent_stage_names[] = { "todo", "doing", "done" };
+
+#define INTENT_VERB_COUNT (sizeof(intent_verb_names) / sizeof(intent_verb_names[0]))
+#define INTENT_NOUN_COUNT (sizeof(intent_noun_names) / sizeof(intent_noun_names[0]))
+
+const char* intent_verb_to_string(IntentVerb verb) {
+    return (size_t)verb < INTENT_VERB_COUNT ? intent_verb_names[verb] : "unknown";
+}
+
+const char* intent_noun_to_string(IntentNoun noun) {
+    return (size_t)noun < INTENT_NOUN_COUNT ? intent_noun_names[noun] : "unknown";
+}
+
+const char* intent_stage_to_string(IntentStage stage) {
+    return (size_t)stage < 3 ? intent_stage_names[stage] : "unknown";
+}
+
 /*
- * intent_dag_integration.h - Integration between Intent Resolution and DAG
- * OBINexus Computing - PolyBuild Architecture
+ * Decoded constraints for all 128 encodings, expanded at compile time.
+ * Bit i of an encoding is character i of its binary string: bit 0 is
+ * semantic validation, bits 2-3 the topology type, bit 4 fault tolerance
+ * and bits 5-6 the concurrency model.
  */
+#define TOPOLOGY_BIT(e, i) (((e) >> (i)) & 1)
+
+// State of a node of category c in state s under encoding e
+#define TOPOLOGY_STATE(e, c, s)                                            \
+    (TOPOLOGY_BIT(e, 0) && (c) == TAX_UNKNOWN ? STATE_FALSE :              \
+     TOPOLOGY_BIT(e, 4) && (s) == STATE_FALSE ? STATE_UNKNOWN : (s))
+
+#define TOPOLOGY_CATEGORY(e, c) \
+    TOPOLOGY_STATE(e, c, 0), TOPOLOGY_STATE(e, c, 1), TOPOLOGY_STATE(e, c, 2)
+
+#define TOPOLOGY_ENTRY(e)                                                   \
+    { TOPOLOGY_BIT(e, 2) << 1 | TOPOLOGY_BIT(e, 3), TOPOLOGY_BIT(e, 4),    \
+      TOPOLOGY_BIT(e, 5) << 1 | TOPOLOGY_BIT(e, 6), TOPOLOGY_BIT(e, 0),    \
+      { TOPOLOGY_CATEGORY(e, TAX_UNKNOWN), TOPOLOGY_CATEGORY(e, TAX_ACTION), \
+        TOPOLOGY_CATEGORY(e, TAX_RESOURCE), TOPOLOGY_CATEGORY(e, TAX_PROPERTY), \
+        TOPOLOGY_CATEGORY(e, TAX_CONTROLLER), STATE_UNKNOWN } }
+
+#define TOPOLOGY_ROW4(e) \
+    TOPOLOGY_ENTRY(e), TOPOLOGY_ENTRY((e) + 1), TOPOLOGY_ENTRY((e) + 2), TOPOLOGY_ENTRY((e) + 3)
+#define TOPOLOGY_ROW16(e) \
+    TOPOLOGY_ROW4(e), TOPOLOGY_ROW4((e) + 4), TOPOLOGY_ROW4((e) + 8), TOPOLOGY_ROW4((e) + 12)
+
+static const TopologyConstraints topology_table[TOPOLOGY_ENCODING_COUNT] = {
+    TOPOLOGY_ROW16(0), TOPOLOGY_ROW16(16), TOPOLOGY_ROW16(32), TOPOLOGY_ROW16(48),
+    TOPOLOGY_ROW16(64), TOPOLOGY_ROW16(80), TOPOLOGY_ROW16(96), TOPOLOGY_ROW16(112)
+};
+
+bool topology_encoding_parse(const char* binary_str, uint8_t* encoding) {
+    if (!binary_str) {
+        return false;
+    }
+
+    unsigned bits = 0;
+    for (int i = 0; i < 7; i++) {
+        unsigned digit = (unsigned)(unsigned char)binary_str[i] - '0';
+        if (digit > 1) {
+            return false;
+        }
+        bits |= digit << i;
+    }
+    if (binary_str[7] != '\0') {
+        return false;
+    }
+    if (encoding) {
+        *encoding = (uint8_t)bits;
+    }
+    return true;
+}
+
+const TopologyConstraints* topology_constraints(uint8_t encoding) {
+    return &topology_table[encoding & (TOPOLOGY_ENCODING_COUNT - 1)];
+}
+
+void topology_apply_states(uint8_t encoding, const uint8_t* categories, uint8_t* states,
+                           size_t count) {
+    const uint8_t* map = topology_constraints(encoding)->state_map;
+    for (size_t i = 0; i < count; i++) {
+        // Masking keeps out-of-range values inside the map
+        states[i] = map[(categories[i] * 3u + states[i]) & 15u];
+    }
+}
+
+TopologyDecoding* decode_topology_binary(const char* binary_str) {
+    uint8_t encoding;
+    if (!topology_encoding_parse(binary_str, &encoding)) {
+        return NULL;
+    }
+
+    TopologyDecoding* topology = (TopologyDecoding*)calloc(1, sizeof(TopologyDecoding));
+    if (!topology) {
+        return NULL;
+    }
+
+    const TopologyConstraints* constraints = topology_constraints(encoding);
+    topology->encoding = encoding;
+    topology->topology_type = constraints->topology_type;
+    topology->fault_tolerance = constraints->fault_tolerance;
+    topology->concurrency_model = constraints->concurrency_model;
+    topology->semantic_validation = constraints->semantic_validation;
+    return topology;
+}
+
+int apply_topology_constraints(DAGNode* dag_nodes[], size_t node_count,
+                               TopologyDecoding* topology) {
+    if ((!dag_nodes && node_count > 0) || !topology) {
+        return -1;
+    }
+
+    const uint8_t* map = topology_constraints(topology->encoding)->state_map;
+    for (size_t i = 0; i < node_count; i++) {
+        DAGNode* node = dag_nodes[i];
+        node->state = (NodeState)map[((unsigned)node->category * 3u + (unsigned)node->state) & 15u];
+    }
+    return 0;
+}
+
+void free_topology_decoding(TopologyDecoding* topology) {
+    free(topology);
+}
 
-#ifndef POLYBUILD_INTENT_DAG_H
-#define POLYBUILD_INTENT_DAG_H
-
-#include "dag.h"
-#include "trie.h"
-#include <stdint.h>
-#include <stdbool.h>
-
-// =============================================================================
-// INTENT-DAG INTEGRATION TYPES
-// =============================================================================
-
-typedef enum {
-    INTENT_VERB_VALIDATE = 0,
-    INTENT_VERB_BUILD = 1,
-    INTENT_VERB_COMPILE = 2,
-    INTENT_VERB_LINK = 3,
-    INTENT_VERB_TEST = 4,
-    INTENT_VERB_DEPLOY = 5,
-    INTENT_VERB_CLEAN = 6,
-    INTENT_VERB_REROUTE = 7,
-    INTENT_VERB_CONFIGURE = 8
-} IntentVerb;
-
-typedef enum {
-    INTENT_NOUN_POLICY = 0,
-    INTENT_NOUN_TARGET = 1,
-    INTENT_NOUN_SOURCE = 2,
-    INTENT_NOUN_DEPENDENCY = 3,
-    INTENT_NOUN_ARTIFACT = 4,
-    INTENT_NOUN_PIPELINE = 5,
-    INTENT_NOUN_CONFIGURATION = 6,
-    INTENT_NOUN_MANIFEST = 7
-} IntentNoun;
+/*
+ * Perfect hash over both keyword sets: (len + 10 * first + 13 * last) & 15
+ * maps the nine verbs and the eight nouns to distinct slots. The
+ * multipliers were found by exhaustive search; a keyword whose length or
+ * bytes differ from its slot's entry is rejected with one memcmp.
+ */
+#define INTENT_HASH_SLOTS 16
+#define INTENT_KEYWORD_MAX 13
+
+static const int8_t intent_verb_slots[INTENT_HASH_SLOTS] = {
+    INTENT_VERB_TEST, -1, -1, INTENT_VERB_DEPLOY, -1, INTENT_VERB_VALIDATE, INTENT_VERB_COMPILE, -1,
+    INTENT_VERB_CONFIGURE, INTENT_VERB_CLEAN, -1, INTENT_VERB_LINK, INTENT_VERB_REROUTE,
+    INTENT_VERB_BUILD, -1, -1
+};
+
+static const int8_t intent_noun_slots[INTENT_HASH_SLOTS] = {
+    -1, INTENT_NOUN_CONFIGURATION, INTENT_NOUN_TARGET, -1, -1, INTENT_NOUN_SOURCE,
+    INTENT_NOUN_ARTIFACT, INTENT_NOUN_DEPENDENCY, -1, INTENT_NOUN_PIPELINE, -1, INTENT_NOUN_POLICY,
+    -1, -1, INTENT_NOUN_MANIFEST, -1
+};
+
+// Character classes of the expression grammar: XSD \w (ASCII) and \s
+#define INTENT_CHAR_WORD 1
+#define INTENT_CHAR_SPACE 2
+
+static const uint8_t intent_char_class[256] = {
+    ['\t'] = INTENT_CHAR_SPACE, ['\n'] = INTENT_CHAR_SPACE, ['\r'] = INTENT_CHAR_SPACE,
+    [' '] = INTENT_CHAR_SPACE,
+    // Word characters, INTENT_CHAR_WORD
+    ['0'] = 1, ['1'] = 1, ['2'] = 1, ['3'] = 1, ['4'] = 1, ['5'] = 1, ['6'] = 1, ['7'] = 1,
+    ['8'] = 1, ['9'] = 1, ['_'] = 1,
+    ['A'] = 1, ['B'] = 1, ['C'] = 1, ['D'] = 1, ['E'] = 1, ['F'] = 1, ['G'] = 1, ['H'] = 1,
+    ['I'] = 1, ['J'] = 1, ['K'] = 1, ['L'] = 1, ['M'] = 1, ['N'] = 1, ['O'] = 1, ['P'] = 1,
+    ['Q'] = 1, ['R'] = 1, ['S'] = 1, ['T'] = 1, ['U'] = 1, ['V'] = 1, ['W'] = 1, ['X'] = 1,
+    ['Y'] = 1, ['Z'] = 1,
+    ['a'] = 1, ['b'] = 1, ['c'] = 1, ['d'] = 1, ['e'] = 1, ['f'] = 1, ['g'] = 1, ['h'] = 1,
+    ['i'] = 1, ['j'] = 1, ['k'] = 1, ['l'] = 1, ['m'] = 1, ['n'] = 1, ['o'] = 1, ['p'] = 1,
+    ['q'] = 1, ['r'] = 1, ['s'] = 1, ['t'] = 1, ['u'] = 1, ['v'] = 1, ['w'] = 1, ['x'] = 1,
+    ['y'] = 1, ['z'] = 1
+};
+
+static inline unsigned intent_hash(const char* text, size_t len) {
+    return (unsigned)(len + 10u * (unsigned char)text[0] + 13u * (unsigned char)text[len - 1]) &
+           (INTENT_HASH_SLOTS - 1);
+}
 
-typedef enum {
-    INTENT_STAGE_TODO = 0,
-    INTENT_STAGE_DOING = 1,
-    INTENT_STAGE_DONE = 2
-} IntentStage;
+/**
+ * Probe one perfect-hash table, confirming the keyword in its slot
+ */
+static int intent_keyword(const int8_t* slots, const char* const* names, const char* text,
+                          size_t len) {
+    if (len == 0 || len > INTENT_KEYWORD_MAX) {
+        return -1;
+    }
+    int index = slots[intent_hash(text, len)];
+    if (index < 0 || strlen(names[index]) != len || memcmp(names[index], text, len) != 0) {
+        return -1;
+    }
+    return index;
+}
+
+bool intent_verb_lookup(const char* text, size_t len, IntentVerb* verb) {
+    int index = text ? intent_keyword(intent_verb_slots, intent_verb_names, text, len) : -1;
+    if (index >= 0 && verb) {
+        *verb = (IntentVerb)index;
+    }
+    return index >= 0;
+}
+
+bool intent_noun_lookup(const char* text, size_t len, IntentNoun* noun) {
+    int index = text ? intent_keyword(intent_noun_slots, intent_noun_names, text, len) : -1;
+    if (index >= 0 && noun) {
+        *noun = (IntentNoun)index;
+    }
+    return index >= 0;
+}
+
+bool intent_expression_parse(const char* text, size_t len, IntentExpression* expression) {
+    if (!text || !expression) {
+        return false;
+    }
+
+    // Split into at most three words, each preceded by whitespace but the first
+    const char* words[3];
+    size_t lengths[3];
+    size_t count = 0;
+    size_t i = 0;
+    while (i < len) {
+        if (count > 0) {
+            size_t gap = i;
+            while (i < len && intent_char_class[(unsigned char)text[i]] == INTENT_CHAR_SPACE) {
+                i++;
+            }
+            if (i == gap || i == len) {
+                return false;
+            }
+        }
+        size_t start = i;
+        while (i < len && intent_char_class[(unsigned char)text[i]] == INTENT_CHAR_WORD) {
+            i++;
+        }
+        if (i == start || count == 3) {
+            return false;
+        }
+        words[count] = text + start;
+        lengths[count++] = i - start;
+    }
 
-typedef struct {
     IntentVerb verb;
     IntentNoun noun;
-    char* binding_value;
-    IntentStage stage;
-    uint32_t priority;
-    bool triggers_action;
-    char* semantic_context;
-    DAGNode* dag_representation;  // Link to DAG node
-} IntentResolution;
-
-typedef struct {
-    char binary_encoding[8];  // "0101101"
-    uint8_t topology_type;    // Decoded from bits 2-3
-    uint8_t fault_tolerance;  // Decoded from bit 4
-    uint8_t concurrency_model;// Decoded from bits 5-6
-    bool semantic_validation; // Decoded from bit 0
-} TopologyDecoding;
-
-// =============================================================================
-// TOPOLOGY DECODING FUNCTIONS
-// =============================================================================
+    if (count < 2 || !intent_verb_lookup(words[0], lengths[0], &verb) ||
+        !intent_noun_lookup(words[1], lengths[1], &noun)) {
+        return false;
+    }
+
+    expression->verb = verb;
+    expression->noun = noun;
+    expression->binding = count == 3 ? words[2] : NULL;
+    expression->binding_len = count == 3 ? lengths[2] : 0;
+    return true;
+}
+
+size_t intent_expression_parse_batch(const char* const* texts, size_t count,
+                                     IntentExpression* expressions, bool* valid) {
+    if (!texts || !expressions) {
+        return 0;
+    }
+
+    size_t parsed = 0;
+    for (size_t i = 0; i < count; i++) {
+        bool ok = texts[i] && intent_expression_parse(texts[i], strlen(texts[i]), &expressions[i]);
+        if (valid) {
+            valid[i] = ok;
+        }
+        parsed += ok;
+    }
+    return parsed;
+}
 
 /**
- * @brief Decode binary topology string into structured format
- * @param binary_str Binary string like "0101101"
- * @return Decoded topology specification
+ * Whether a verb runs something rather than steering resolution
  */
-TopologyDecoding* decode_topology_binary(const char* binary_str);
+static bool intent_verb_acts(IntentVerb verb) {
+    return verb != INTENT_VERB_VALIDATE && verb != INTENT_VERB_REROUTE &&
+           verb != INTENT_VERB_CONFIGURE;
+}
+
+IntentResolution* parse_intent_expression(const char* expression, TopologyDecoding* topology) {
+    (void)topology;
+    IntentExpression parsed;
+    if (!expression || !intent_expression_parse(expression, strlen(expression), &parsed)) {
+        return NULL;
+    }
+
+    IntentResolution* intent = (IntentResolution*)calloc(1, sizeof(IntentResolution));
+    if (!intent) {
+        return NULL;
+    }
+    intent->verb = parsed.verb;
+    intent->noun = parsed.noun;
+    intent->stage = INTENT_STAGE_TODO;
+    intent->triggers_action = intent_verb_acts(parsed.verb);
+    intent->semantic_context = strdup(expression);
+    if (parsed.binding) {
+        intent->binding_value = strndup(parsed.binding, parsed.binding_len);
+    }
+    if (!intent->semantic_context || (parsed.binding && !intent->binding_value)) {
+        free_intent_resolution(intent);
+        return NULL;
+    }
+    return intent;
+}
+
+void free_intent_resolution(IntentResolution* intent) {
+    if (!intent) {
+        return;
+    }
+    free(intent->build_action);
+    free(intent->binding_value);
+    free(intent->semantic_context);
+    free(intent);
+}
+
+DAGNode* create_dag_from_intent(IntentResolution* intent) {
+    if (!intent) {
+        return NULL;
+    }
+
+    // Intents that run something act; the rest steer resolution
+    DAGNode* node = dag_node_create(TOKEN_IDENTIFIER,
+                                    intent->triggers_action ? TAX_ACTION : TAX_CONTROLLER);
+    if (node) {
+        node->state = intent->stage == INTENT_STAGE_DONE ? STATE_TRUE : STATE_UNKNOWN;
+        intent->dag_representation = node;
+    }
+    return node;
+}
 
 /**
- * @brief Apply topology constraints to DAG resolution
- * @param dag_nodes Array of DAG nodes
- * @param node_count Number of nodes
- * @param topology Topology specification
- * @return 0 on success, -1 on failure
+ * Report a workflow failure that is not tied to a manifest line
  */
-int apply_topology_constraints(DAGNode* dag_nodes[], size_t node_count, 
-                              TopologyDecoding* topology);
-
-// =============================================================================
-// INTENT RESOLUTION FUNCTIONS  
-// =============================================================================
+static void intent_workflow_error(ManifestError* error, const char* message) {
+    if (error) {
+        error->line = 0;
+        snprintf(error->message, sizeof(error->message), "%s", message);
+    }
+}
+
+int execute_intent_workflow(const char* xml_manifest, DAGNode*** output_dag, size_t* dag_size,
+                            ManifestError* error) {
+    if (!xml_manifest || !output_dag || !dag_size) {
+        return -1;
+    }
+
+    TRACE_SPAN("execute_intent_workflow");
+    DAGGraph* graph = dag_graph_create(0);
+    ManifestGraph builder;
+    ManifestSink sink;
+    if (!graph || manifest_graph_init(&builder, graph, &sink) != 0) {
+        dag_graph_free(graph);
+        intent_workflow_error(error, "out of memory");
+        return -1;
+    }
+
+    int result = manifest_read_file(xml_manifest, &sink, error);
+    if (result == 0 && manifest_graph_finish(&builder) != 0) {
+        intent_workflow_error(error, "cannot build the dependency graph");
+        result = -1;
+    }
+    if (result == 0 && dag_graph_resolve(graph) != 0) {
+        intent_workflow_error(error, "dependency cycle in manifest");
+        result = -1;
+    }
+
+    // The builder reads the graph's node count, so it goes first
+    manifest_graph_free(&builder);
+
+    DAGNode** nodes = NULL;
+    if (result == 0) {
+        nodes = (DAGNode**)malloc((graph->node_count ? graph->node_count : 1) * sizeof(DAGNode*));
+        if (!nodes) {
+            intent_workflow_error(error, "out of memory");
+            result = -1;
+        }
+    }
+    if (result == 0) {
+        memcpy(nodes, graph->nodes, graph->node_count * sizeof(DAGNode*));
+        *output_dag = nodes;
+        *dag_size = graph->node_count;
+        dag_graph_free(graph);
+    } else {
+        dag_graph_free_all(graph);
+    }
+    return result;
+}
+
+// Chunks each pipeline queue holds before its producer waits
+#define INTENT_PIPELINE_DEPTH 16
+
+// Intents handed between pipeline stages at a time
+#define INTENT_PIPELINE_CHUNK 64
 
-/**
- * @brief Parse intent expression into structured resolution
- * @param expression String like "validate policy live"
- * @param topology Topology context for resolution
- * @return Parsed intent resolution structure
- */
-IntentResolution* parse_intent_expression(const char* expression, 
-                                        TopologyDecoding* topology);
+typedef enum {
+    INTENT_PHASE_PARSE,
+    INTENT_PHASE_VALIDATE,
+    INTENT_PHASE_RESOLVE,
+    INTENT_PHASE_GENERATE,
+    INTENT_PHASE_COUNT
+} IntentPhase;
+
+// Span names of the pipeline's stages
+static const char* const intent_phase_names[INTENT_PHASE_COUNT] = {
+    "intent_parse", "intent_validate", "intent_resolve", "intent_generate"
+};
 
 /**
- * @brief Create DAG node from intent resolution
- * @param intent Intent to convert to DAG node
- * @return DAG node representing the intent
+ * Intents being processed and the constraints they are resolved under
  */
-DAGNode* create_dag_from_intent(IntentResolution* intent);
+typedef struct IntentBatch {
+    IntentResolution** intents;
+    const TopologyConstraints* constraints;
+    atomic_size_t failures;
+} IntentBatch;
 
 /**
- * @brief Resolve intent through stage transitions (TODO->DOING->DONE)
- * @param intent Intent to resolve
- * @param topology Topology context
- * @return true if intent completed, false if still processing
+ * Refresh verb, noun and binding from the intent's expression
  */
-bool resolve_intent_stages(IntentResolution* intent, TopologyDecoding* topology);
+static bool intent_phase_parse(IntentResolution* intent) {
+    if (!intent->semantic_context) {
+        return true;
+    }
+    IntentExpression parsed;
+    if (!intent_expression_parse(intent->semantic_context, strlen(intent->semantic_context),
+                                 &parsed)) {
+        return false;
+    }
+    intent->verb = parsed.verb;
+    intent->noun = parsed.noun;
+    if (parsed.binding && !intent->binding_value) {
+        intent->binding_value = strndup(parsed.binding, parsed.binding_len);
+        return intent->binding_value != NULL;
+    }
+    return true;
+}
+
+static bool intent_phase_validate(IntentResolution* intent) {
+    if ((unsigned)intent->verb >= INTENT_VERB_COUNT || (unsigned)intent->noun >= INTENT_NOUN_COUNT) {
+        return false;
+    }
+    intent->triggers_action = intent_verb_acts(intent->verb);
+    intent->stage = INTENT_STAGE_DOING;
+    return true;
+}
+
+static bool intent_phase_resolve(IntentResolution* intent, const TopologyConstraints* constraints) {
+    // A node made here is the caller's to free, like any from create_dag_from_intent()
+    DAGNode* node = intent->dag_representation;
+    if (!node && !(node = create_dag_from_intent(intent))) {
+        return false;
+    }
+    node->state = (NodeState)constraints->state_map[((unsigned)node->category * 3u +
+                                                     (unsigned)node->state) & 15u];
+    return node->state != STATE_FALSE;
+}
+
+static bool intent_phase_generate(IntentResolution* intent) {
+    if (intent->triggers_action && !intent->build_action) {
+        const char* verb = intent_verb_to_string(intent->verb);
+        const char* noun = intent_noun_to_string(intent->noun);
+        const char* binding = intent->binding_value;
+        size_t len = strlen(verb) + strlen(noun) + (binding ? strlen(binding) + 1 : 0) + 2;
+        intent->build_action = (char*)malloc(len);
+        if (!intent->build_action) {
+            return false;
+        }
+        if (binding) {
+            snprintf(intent->build_action, len, "%s_%s_%s", verb, noun, binding);
+        } else {
+            snprintf(intent->build_action, len, "%s_%s", verb, noun);
+        }
+    }
+    intent->stage = INTENT_STAGE_DONE;
+    intent->dag_representation->state = STATE_TRUE;
+    return true;
+}
+
+static bool intent_phase_run(IntentBatch* batch, IntentPhase phase, IntentResolution* intent) {
+    switch (phase) {
+    case INTENT_PHASE_PARSE:
+        return intent_phase_parse(intent);
+    case INTENT_PHASE_VALIDATE:
+        return intent_phase_validate(intent);
+    case INTENT_PHASE_RESOLVE:
+        return intent_phase_resolve(intent, batch->constraints);
+    default:
+        return intent_phase_generate(intent);
+    }
+}
 
 /**
- * @brief Create trie pattern for intent verb-noun matching
- * @param root Trie root node
- * @param intent Intent to create pattern for
- * @return 0 on success, -1 on failure
+ * Run every stage on a range of intents, for the pool or inline
  */
-int insert_intent_pattern(TrieNode* root, IntentResolution* intent);
-
-// =============================================================================
-// XML SEMANTIC ENFORCEMENT
-// =============================================================================
-
-typedef struct {
-    char* namespace_uri;
-    char* element_name;
-    char** allowed_values;
-    size_t value_count;
-    bool required;
-} SemanticRule;
-
-typedef struct {
-    SemanticRule* rules;
-    size_t rule_count;
-    bool strict_validation;
-    char* schema_version;
-} SemanticValidator;
+static void intent_process_range(void* ctx, size_t begin, size_t end, size_t worker) {
+    (void)worker;
+    TRACE_SPAN("intent_process_range");
+    IntentBatch* batch = (IntentBatch*)ctx;
+    for (size_t i = begin; i < end; i++) {
+        IntentResolution* intent = batch->intents[i];
+        int phase = INTENT_PHASE_PARSE;
+        while (phase < INTENT_PHASE_COUNT && intent_phase_run(batch, (IntentPhase)phase, intent)) {
+            phase++;
+        }
+        if (phase < INTENT_PHASE_COUNT) {
+            atomic_fetch_add_explicit(&batch->failures, 1, memory_order_relaxed);
+        }
+    }
+}
 
 /**
- * @brief Create semantic validator for XML manifests
- * @return Initialized semantic validator
+ * Intents travelling down the pipeline together; each stage drops the
+ * ones it fails
  */
-SemanticValidator* create_semantic_validator(void);
+typedef struct IntentChunk {
+    IntentResolution* intents[INTENT_PIPELINE_CHUNK];
+    size_t count;
+} IntentChunk;
 
 /**
- * @brief Validate intent against semantic rules
- * @param intent Intent to validate
- * @param validator Semantic validator
- * @return true if valid, false if validation failed
+ * Run one stage over a chunk, compacting away failed intents
  */
-bool validate_intent_semantics(IntentResolution* intent, SemanticValidator* validator);
+static void intent_phase_chunk(IntentBatch* batch, IntentPhase phase, IntentChunk* chunk) {
+    TRACE_SPAN(intent_phase_names[phase]);
+    size_t kept = 0;
+    for (size_t i = 0; i < chunk->count; i++) {
+        IntentResolution* intent = chunk->intents[i];
+        if (intent_phase_run(batch, phase, intent)) {
+            chunk->intents[kept++] = intent;
+        } else {
+            atomic_fetch_add_explicit(&batch->failures, 1, memory_order_relaxed);
+        }
+    }
+    chunk->count = kept;
+}
 
 /**
- * @brief Validate topology encoding against semantic rules
- * @param topology Topology to validate
- * @param validator Semantic validator
- * @return true if valid, false if validation failed
+ * One pipeline stage: its own thread, fed by the previous stage's queue
  */
-bool validate_topology_semantics(TopologyDecoding* topology, SemanticValidator* validator);
-
-// =============================================================================
-// INTEGRATION WORKFLOW FUNCTIONS
-// =============================================================================
+typedef struct IntentStageWorker {
+    IntentBatch* batch;
+    IntentPhase phase;
+    BoundedQueue* in;
+    BoundedQueue* out;          // NULL for the last stage
+    pthread_t thread;
+} IntentStageWorker;
+
+static void* intent_stage_main(void* arg) {
+    IntentStageWorker* worker = (IntentStageWorker*)arg;
+    void* item;
+    while (bounded_queue_pop(worker->in, &item)) {
+        IntentChunk* chunk = (IntentChunk*)item;
+        intent_phase_chunk(worker->batch, worker->phase, chunk);
+        if (worker->out && chunk->count > 0) {
+            bounded_queue_push(worker->out, chunk);
+        }
+    }
+    if (worker->out) {
+        bounded_queue_close(worker->out);
+    }
+    return NULL;
+}
 
 /**
- * @brief Complete intent-driven build workflow
- * @param xml_manifest Path to XML manifest file
- * @param output_dag Resulting DAG structure
- * @return 0 on success, error code on failure
+ * Parse on the calling thread and hand chunks down a chain of stage
+ * threads; returns -1 if the chain could not be set up
  */
-int execute_intent_workflow(const char* xml_manifest, DAGNode*** output_dag, size_t* dag_size);
+static int intent_process_pipeline(IntentBatch* batch, size_t count) {
+    size_t chunk_count = (count + INTENT_PIPELINE_CHUNK - 1) / INTENT_PIPELINE_CHUNK;
+    IntentChunk* chunks = (IntentChunk*)malloc((chunk_count ? chunk_count : 1) * sizeof(IntentChunk));
+    BoundedQueue* queues[INTENT_PHASE_COUNT - 1] = { NULL };
+    IntentStageWorker workers[INTENT_PHASE_COUNT - 1];
+    size_t started = 0;
+    int result = chunks ? 0 : -1;
+
+    for (size_t i = 0; i < INTENT_PHASE_COUNT - 1 && result == 0; i++) {
+        queues[i] = bounded_queue_create(INTENT_PIPELINE_DEPTH);
+        result = queues[i] ? 0 : -1;
+    }
+    for (size_t i = 0; i < INTENT_PHASE_COUNT - 1 && result == 0; i++) {
+        IntentStageWorker* worker = &workers[i];
+        worker->batch = batch;
+        worker->phase = (IntentPhase)(i + 1);
+        worker->in = queues[i];
+        worker->out = i + 2 < INTENT_PHASE_COUNT ? queues[i + 1] : NULL;
+        if (pthread_create(&worker->thread, NULL, intent_stage_main, worker) != 0) {
+            result = -1;
+            break;
+        }
+        started++;
+    }
+
+    // A chain that failed to start must not touch any intent
+    for (size_t c = 0; c < chunk_count && result == 0; c++) {
+        IntentChunk* chunk = &chunks[c];
+        size_t begin = c * INTENT_PIPELINE_CHUNK;
+        chunk->count = count - begin < INTENT_PIPELINE_CHUNK ? count - begin : INTENT_PIPELINE_CHUNK;
+        memcpy(chunk->intents, batch->intents + begin, chunk->count * sizeof(IntentResolution*));
+        intent_phase_chunk(batch, INTENT_PHASE_PARSE, chunk);
+        if (chunk->count > 0) {
+            bounded_queue_push(queues[0], chunk);
+        }
+    }
+
+    // Closing the first queue drains the chain stage by stage
+    if (queues[0]) {
+        bounded_queue_close(queues[0]);
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    for (size_t i = 0; i < INTENT_PHASE_COUNT - 1; i++) {
+        bounded_queue_destroy(queues[i]);
+    }
+    free(chunks);
+    return result;
+}
 
-/**
- * @brief Apply parallel processing based on topology
- * @param intents Array of intent resolutions
- * @param intent_count Number of intents
- * @param topology Topology specification
- * @return 0 on success, -1 on failure
- */
 int apply_parallel_intent_processing(IntentResolution** intents, size_t intent_count,
-                                   TopologyDecoding* topology);
+                                     TopologyDecoding* topology) {
+    if (!topology || topology->concurrency_model != MANIFEST_CONCURRENCY_PARALLEL) {
+        return apply_parallel_intent_processing_on(intents, intent_count, topology, NULL);
+    }
+
+    // Without a pool the loop runs inline, as the sequential model
+    ThreadPool* pool = thread_pool_create(0);
+    int result = apply_parallel_intent_processing_on(intents, intent_count, topology, pool);
+    thread_pool_destroy(pool);
+    return result;
+}
+
+int apply_parallel_intent_processing_on(IntentResolution** intents, size_t intent_count,
+                                        TopologyDecoding* topology, ThreadPool* pool) {
+    if ((!intents && intent_count > 0) || !topology) {
+        return -1;
+    }
+    for (size_t i = 0; i < intent_count; i++) {
+        if (!intents[i]) {
+            return -1;
+        }
+    }
+
+    TRACE_SPAN("apply_parallel_intent_processing");
+    TRACE_COUNT(TRACE_COUNTER_INTENTS, intent_count);
+    IntentBatch batch;
+    batch.intents = intents;
+    batch.constraints = topology_constraints(topology->encoding);
+    atomic_init(&batch.failures, 0);
+
+    switch (topology->concurrency_model) {
+    case MANIFEST_CONCURRENCY_PARALLEL:
+        thread_pool_parallel_for(pool, intent_count, 0, intent_process_range, &batch);
+        break;
+    case MANIFEST_CONCURRENCY_PIPELINE:
+        if (intent_process_pipeline(&batch, intent_count) != 0) {
+            intent_process_range(&batch, 0, intent_count, 0);
+        }
+        break;
+    default:
+        intent_process_range(&batch, 0, intent_count, 0);
+        break;
+    }
+    return atomic_load(&batch.failures) == 0 ? 0 : -1;
+}
 
-/**
- * @brief Generate build actions from resolved intents
- * @param intents Array of resolved intents  
- * @param intent_count Number of intents
- * @param output_actions Generated build actions
- * @return Number of actions generated
- */
 size_t generate_build_actions(IntentResolution** intents, size_t intent_count,
-                            char*** output_actions);
-
-// =============================================================================
-// UTILITY FUNCTIONS
-// =============================================================================
-
-/**
- * @brief Convert intent verb to string representation
- * @param verb Intent verb enum
- * @return String representation
- */
-const char* intent_verb_to_string(IntentVerb verb);
-
-/**
- * @brief Convert intent noun to string representation  
- * @param noun Intent noun enum
- * @return String representation
- */
-const char* intent_noun_to_string(IntentNoun noun);
-
-/**
- * @brief Convert intent stage to string representation
- * @param stage Intent stage enum
- * @return String representation
- */
-const char* intent_stage_to_string(IntentStage stage);
-
-/**
- * @brief Print intent resolution for debugging
- * @param intent Intent to print
- */
-void print_intent_resolution(IntentResolution* intent);
-
-/**
- * @brief Print topology decoding for debugging
- * @param topology Topology to print
- */
-void print_topology_decoding(TopologyDecoding* topology);
-
-/**
- * @brief Free intent resolution structure
- * @param intent Intent to free
- */
-void free_intent_resolution(IntentResolution* intent);
-
-/**
- * @brief Free topology decoding structure
- * @param topology Topology to free
- */
-void free_topology_decoding(TopologyDecoding* topology);
-
-/**
- * @brief Free semantic validator structure
- * @param validator Validator to free
- */
-void free_semantic_validator(SemanticValidator* validator);
-
-#endif /* POLYBUILD_INTENT_DAG_H */
-
-/*
- * Example Usage:
- * 
- * // 1. Decode topology from binary
- * TopologyDecoding* topology = decode_topology_binary("0101101");
- * 
- * // 2. Parse intent expressions
- * IntentResolution* intent1 = parse_intent_expression("validate policy live", topology);
- * IntentResolution* intent2 = parse_intent_expression("build target release", topology);
- * 
- * // 3. Create DAG from intents
- * DAGNode* dag1 = create_dag_from_intent(intent1);
- * DAGNode* dag2 = create_dag_from_intent(intent2);
- * 
- * // 4. Apply topology constraints
- * DAGNode* dag_nodes[] = {dag1, dag2};
- * apply_topology_constraints(dag_nodes, 2, topology);
- * 
- * // 5. Resolve through stages
- * while (!resolve_intent_stages(intent1, topology)) {
- *     // Continue processing until DONE
- * }
- * 
- * // 6. Generate build actions
- * IntentResolution* intents[] = {intent1, intent2};
- * char** actions;
- * size_t action_count = generate_build_actions(intents, 2, &actions);
- */
+                              char*** output_actions) {
+    if (!output_actions) {
+        return 0;
+    }
+    *output_actions = NULL;
+
+    size_t count = 0;
+    for (size_t i = 0; intents && i < intent_count; i++) {
+        count += intents[i] && intents[i]->build_action;
+    }
+    char** actions = count ? (char**)malloc(count * sizeof(char*)) : NULL;
+    if (!actions) {
+        return 0;
+    }
+
+    size_t generated = 0;
+    for (size_t i = 0; i < intent_count; i++) {
+        if (!intents[i] || !intents[i]->build_action) {
+            continue;
+        }
+        if (!(actions[generated] = strdup(intents[i]->build_action))) {
+            while (generated > 0) {
+                free(actions[--generated]);
+            }
+            free(actions);
+            return 0;
+        }
+        generated++;
+    }
+    *output_actions = actions;
+    return generated;
+}
@@ -0,0 +1,1106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include "manifest.h"
+#include "../trace/trace.h"
+
+// Initial capacity of growable arrays, doubled on demand
+#define MANIFEST_INITIAL_CAPACITY 16
+
+// Deepest element of the schema is definition/actions/action/inputs/input
+#define MANIFEST_MAX_DEPTH 8
+
+typedef enum {
+    MANIFEST_DEFINITION,
+    MANIFEST_IDENTITY,
+    MANIFEST_NAME,
+    MANIFEST_VERSION,
+    MANIFEST_STABILITY,
+    MANIFEST_GUID,
+    MANIFEST_TOPOLOGY,
+    MANIFEST_FAULT_TOLERANCE,
+    MANIFEST_CONCURRENCY,
+    MANIFEST_BINARY_ENCODING,
+    MANIFEST_INTENTS,
+    MANIFEST_INTENT,
+    MANIFEST_STAGE,
+    MANIFEST_PRIORITY,
+    MANIFEST_ACTIONS,
+    MANIFEST_ACTION,
+    MANIFEST_COMMAND,
+    MANIFEST_INPUTS,
+    MANIFEST_INPUT,
+    MANIFEST_OUTPUTS,
+    MANIFEST_OUTPUT,
+    MANIFEST_SOURCE,
+    MANIFEST_INCLUDE,
+    MANIFEST_EXCLUDE,
+    MANIFEST_DEPENDENCIES,
+    MANIFEST_DEPENDENCY,
+    MANIFEST_ELEMENT_COUNT
+} ManifestElement;
+
+/**
+ * Schema of one element: where it may appear and what it holds
+ */
+typedef struct {
+    const char* name;
+    ManifestElement parent;     // MANIFEST_ELEMENT_COUNT for the root
+    uint8_t position;           // Place in the parent's sequence
+    bool required;
+    bool repeated;
+    bool text;                  // Simple content
+    const char* attributes[3];  // All required, NULL-terminated
+} ManifestElementSpec;
+
+static const ManifestElementSpec manifest_schema[MANIFEST_ELEMENT_COUNT] = {
+    { "definition", MANIFEST_ELEMENT_COUNT, 0, true, false, false, { "name", "version", NULL } },
+    { "identity", MANIFEST_DEFINITION, 0, true, false, false, { NULL } },
+    { "name", MANIFEST_IDENTITY, 0, true, false, true, { NULL } },
+    { "version", MANIFEST_IDENTITY, 1, true, false, true, { NULL } },
+    { "stability", MANIFEST_IDENTITY, 2, true, false, true, { NULL } },
+    { "guid", MANIFEST_IDENTITY, 3, true, false, true, { NULL } },
+    { "topology", MANIFEST_DEFINITION, 1, true, false, false, { "type", NULL } },
+    { "fault-tolerance", MANIFEST_TOPOLOGY, 0, true, false, false, { "level", NULL } },
+    { "concurrency", MANIFEST_TOPOLOGY, 1, true, false, false, { "model", NULL } },
+    { "binary-encoding", MANIFEST_TOPOLOGY, 2, true, false, true, { NULL } },
+    { "intents", MANIFEST_DEFINITION, 2, false, false, false, { NULL } },
+    { "intent", MANIFEST_INTENTS, 0, true, true, false, { "expression", NULL } },
+    { "stage", MANIFEST_INTENT, 0, false, false, true, { NULL } },
+    { "priority", MANIFEST_INTENT, 1, false, false, true, { NULL } },
+    { "actions", MANIFEST_DEFINITION, 3, false, false, false, { NULL } },
+    { "action", MANIFEST_ACTIONS, 0, true, true, false, { "name", NULL } },
+    { "command", MANIFEST_ACTION, 0, true, false, true, { NULL } },
+    { "inputs", MANIFEST_ACTION, 1, false, false, false, { NULL } },
+    { "input", MANIFEST_INPUTS, 0, true, true, false, { "path", NULL } },
+    { "outputs", MANIFEST_ACTION, 2, false, false, false, { NULL } },
+    { "output", MANIFEST_OUTPUTS, 0, true, true, false, { "path", NULL } },
+    { "source", MANIFEST_DEFINITION, 4, false, false, false, { "root", NULL } },
+    { "include", MANIFEST_SOURCE, 0, true, true, true, { NULL } },
+    { "exclude", MANIFEST_SOURCE, 1, false, true, true, { NULL } },
+    { "dependencies", MANIFEST_DEFINITION, 5, false, false, false, { NULL } },
+    { "dependency", MANIFEST_DEPENDENCIES, 0, true, true, false, { "name", "version", NULL } }
+};
+
+static const char* const manifest_stability_names[] = { "experimental", "beta", "stable", "legacy" };
+static const char* const manifest_topology_names[] = { "p2p", "bus", "star", "ring", "mesh" };
+static const char* const manifest_concurrency_names[] = { "sequential", "parallel", "pipeline" };
+static const char* const manifest_stage_names[] = { "todo", "doing", "done" };
+
+/**
+ * Open element and the children it has had so far
+ */
+typedef struct {
+    ManifestElement element;
+    uint32_t seen;              // Bit per child position
+    uint8_t last;               // Highest child position so far
+} ManifestFrame;
+
+/**
+ * Growable list of owned strings
+ */
+typedef struct {
+    char** items;
+    size_t count;
+    size_t capacity;
+} ManifestStrings;
+
+/**
+ * Parse state: the open elements and the record being assembled
+ */
+typedef struct {
+    XmlReader* reader;
+    const ManifestSink* sink;
+    ManifestError* error;
+
+    ManifestFrame stack[MANIFEST_MAX_DEPTH];
+    size_t depth;
+
+    // Namespace bindings of the root element
+    char prefix[64];
+    bool prefixed;
+    bool default_namespace;
+
+    // Character data of the open simple-content element
+    char* text;
+    size_t text_len;
+    size_t text_capacity;
+
+    ManifestIdentity identity;
+    ManifestTopology topology;
+    IntentResolution* intent;
+    char* action_name;
+    char* command;
+    ManifestStrings inputs;
+    ManifestStrings outputs;
+    char* source_root;
+
+    // Owned copies behind the const strings of identity
+    char* owned[5];
+} ManifestParse;
+
+static int manifest_fail(ManifestParse* parse, const char* format, ...) {
+    if (parse->error) {
+        parse->error->line = xml_reader_line(parse->reader);
+        va_list args;
+        va_start(args, format);
+        vsnprintf(parse->error->message, sizeof(parse->error->message), format, args);
+        va_end(args);
+    }
+    return -1;
+}
+
+static int manifest_enum(const char* const* names, size_t count, const char* text) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(names[i], text) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+#define MANIFEST_ENUM(names, text) manifest_enum(names, sizeof(names) / sizeof(names[0]), text)
+
+static char* manifest_span_dup(XmlSpan span) {
+    return strndup(span.data, span.len);
+}
+
+/**
+ * Parse an xs:integer within [min, max]
+ */
+static bool manifest_integer(const char* text, long long min, long long max, long long* value) {
+    const char* p = text;
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+') {
+        p++;
+    }
+    if (!*p) {
+        return false;
+    }
+
+    long long result = 0;
+    for (; *p; p++) {
+        if (*p < '0' || *p > '9' || result > (max + 1LL) / 10 + 1) {
+            return false;
+        }
+        result = result * 10 + (*p - '0');
+    }
+    result = negative ? -result : result;
+    if (result < min || result > max) {
+        return false;
+    }
+    *value = result;
+    return true;
+}
+
+static int manifest_strings_push(ManifestStrings* list, char* item) {
+    if (!item) {
+        return -1;
+    }
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : MANIFEST_INITIAL_CAPACITY;
+        char** grown = (char**)realloc(list->items, capacity * sizeof(char*));
+        if (!grown) {
+            free(item);
+            return -1;
+        }
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = item;
+    return 0;
+}
+
+static void manifest_strings_clear(ManifestStrings* list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->items[i]);
+    }
+    list->count = 0;
+}
+
+/**
+ * Append character data of the open simple-content element
+ */
+static int manifest_text_append(ManifestParse* parse, XmlSpan text) {
+    if (parse->text_len + text.len + 1 > parse->text_capacity) {
+        size_t capacity = parse->text_capacity ? parse->text_capacity : 256;
+        while (capacity < parse->text_len + text.len + 1) {
+            capacity *= 2;
+        }
+        char* grown = (char*)realloc(parse->text, capacity);
+        if (!grown) {
+            return -1;
+        }
+        parse->text = grown;
+        parse->text_capacity = capacity;
+    }
+    memcpy(parse->text + parse->text_len, text.data, text.len);
+    parse->text_len += text.len;
+    parse->text[parse->text_len] = '\0';
+    return 0;
+}
+
+/**
+ * Trimmed character data of the element just closed
+ */
+static const char* manifest_text(ManifestParse* parse) {
+    if (!parse->text) {
+        return "";
+    }
+    char* text = parse->text;
+    size_t len = parse->text_len;
+    while (len > 0 && strchr(" \t\r\n", text[len - 1])) {
+        len--;
+    }
+    text[len] = '\0';
+    while (*text && strchr(" \t\r\n", *text)) {
+        text++;
+    }
+    return text;
+}
+
+/**
+ * Look up the attribute of an event by local name
+ */
+static const XmlAttribute* manifest_attribute(const XmlEvent* event, const char* name) {
+    for (size_t i = 0; i < event->attribute_count; i++) {
+        if (event->attributes[i].prefix.len == 0 && xml_span_equals(event->attributes[i].name, name)) {
+            return &event->attributes[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Check that the element is in the manifest namespace and carries
+ * exactly its attributes
+ */
+static int manifest_check_tag(ManifestParse* parse, const XmlEvent* event,
+                              const ManifestElementSpec* spec) {
+    bool qualified = event->prefix.len > 0
+        ? parse->prefixed && event->prefix.len == strlen(parse->prefix) &&
+          memcmp(event->prefix.data, parse->prefix, event->prefix.len) == 0
+        : parse->default_namespace;
+    if (!qualified) {
+        return manifest_fail(parse, "<%s> is not in the manifest namespace", spec->name);
+    }
+
+    for (size_t i = 0; i < event->attribute_count; i++) {
+        const XmlAttribute* attribute = &event->attributes[i];
+        // Namespace declarations and foreign (prefixed) attributes pass through
+        if (attribute->prefix.len > 0 || xml_span_equals(attribute->name, "xmlns")) {
+            continue;
+        }
+        size_t known = 0;
+        while (spec->attributes[known] && !xml_span_equals(attribute->name, spec->attributes[known])) {
+            known++;
+        }
+        if (!spec->attributes[known]) {
+            return manifest_fail(parse, "unexpected attribute %.*s on <%s>",
+                                 (int)attribute->name.len, attribute->name.data, spec->name);
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (event->attributes[j].prefix.len == 0 &&
+                event->attributes[j].name.len == attribute->name.len &&
+                memcmp(event->attributes[j].name.data, attribute->name.data,
+                       attribute->name.len) == 0) {
+                return manifest_fail(parse, "duplicate attribute %s on <%s>",
+                                     spec->attributes[known], spec->name);
+            }
+        }
+    }
+
+    for (size_t i = 0; spec->attributes[i]; i++) {
+        if (!manifest_attribute(event, spec->attributes[i])) {
+            return manifest_fail(parse, "<%s> is missing attribute %s", spec->name,
+                                 spec->attributes[i]);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Record the namespace bindings declared on the root element
+ */
+static int manifest_bind_namespace(ManifestParse* parse, const XmlEvent* event) {
+    for (size_t i = 0; i < event->attribute_count; i++) {
+        const XmlAttribute* attribute = &event->attributes[i];
+        if (!xml_span_equals(attribute->value, MANIFEST_NAMESPACE)) {
+            continue;
+        }
+        if (attribute->prefix.len == 0 && xml_span_equals(attribute->name, "xmlns")) {
+            parse->default_namespace = true;
+        } else if (xml_span_equals(attribute->prefix, "xmlns") &&
+                   attribute->name.len < sizeof(parse->prefix)) {
+            memcpy(parse->prefix, attribute->name.data, attribute->name.len);
+            parse->prefix[attribute->name.len] = '\0';
+            parse->prefixed = true;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Keep an owned copy of an identity string
+ */
+static const char* manifest_own(ManifestParse* parse, size_t slot, const char* text) {
+    free(parse->owned[slot]);
+    parse->owned[slot] = strdup(text);
+    return parse->owned[slot];
+}
+
+static int manifest_start(ManifestParse* parse, const XmlEvent* event) {
+    ManifestElement parent = parse->depth ? parse->stack[parse->depth - 1].element
+                                          : MANIFEST_ELEMENT_COUNT;
+    ManifestElement element = MANIFEST_ELEMENT_COUNT;
+    for (int i = 0; i < MANIFEST_ELEMENT_COUNT; i++) {
+        if (manifest_schema[i].parent == parent && xml_span_equals(event->name, manifest_schema[i].name)) {
+            element = (ManifestElement)i;
+            break;
+        }
+    }
+    if (element == MANIFEST_ELEMENT_COUNT) {
+        if (parent == MANIFEST_ELEMENT_COUNT) {
+            return manifest_fail(parse, "root element must be <definition>");
+        }
+        return manifest_fail(parse, "unexpected element <%.*s> in <%s>", (int)event->name.len,
+                             event->name.data, manifest_schema[parent].name);
+    }
+    const ManifestElementSpec* spec = &manifest_schema[element];
+
+    if (parent == MANIFEST_ELEMENT_COUNT) {
+        manifest_bind_namespace(parse, event);
+    } else {
+        // Sequence order holds everywhere but the definition's sections,
+        // which the shipped example manifest reorders
+        ManifestFrame* frame = &parse->stack[parse->depth - 1];
+        uint32_t bit = 1u << spec->position;
+        if ((frame->seen & bit) && !spec->repeated) {
+            return manifest_fail(parse, "<%s> may appear only once", spec->name);
+        }
+        if (parent != MANIFEST_DEFINITION && frame->seen && spec->position < frame->last) {
+            return manifest_fail(parse, "<%s> is out of order in <%s>", spec->name,
+                                 manifest_schema[parent].name);
+        }
+        // ...but intents are parsed against the topology's decoding
+        if (element == MANIFEST_INTENTS &&
+            !(frame->seen & (1u << manifest_schema[MANIFEST_TOPOLOGY].position))) {
+            return manifest_fail(parse, "<intents> must follow <topology>");
+        }
+        frame->seen |= bit;
+        if (spec->position > frame->last) {
+            frame->last = spec->position;
+        }
+    }
+    if (parse->depth == MANIFEST_MAX_DEPTH) {
+        return manifest_fail(parse, "elements nested too deeply");
+    }
+    if (manifest_check_tag(parse, event, spec) != 0) {
+        return -1;
+    }
+
+    ManifestFrame* frame = &parse->stack[parse->depth++];
+    frame->element = element;
+    frame->seen = 0;
+    frame->last = 0;
+    parse->text_len = 0;
+    if (parse->text) {
+        parse->text[0] = '\0';
+    }
+
+    char* value = NULL;
+    long long level;
+    int index;
+    switch (element) {
+    case MANIFEST_DEFINITION:
+        value = manifest_span_dup(manifest_attribute(event, "name")->value);
+        parse->identity.definition_name = manifest_own(parse, 0, value ? value : "");
+        free(value);
+        value = manifest_span_dup(manifest_attribute(event, "version")->value);
+        parse->identity.definition_version = manifest_own(parse, 1, value ? value : "");
+        if (!parse->identity.definition_name || !parse->identity.definition_version) {
+            free(value);
+            return manifest_fail(parse, "out of memory");
+        }
+        break;
+    case MANIFEST_TOPOLOGY:
+        value = manifest_span_dup(manifest_attribute(event, "type")->value);
+        index = value ? MANIFEST_ENUM(manifest_topology_names, value) : -1;
+        if (index < 0) {
+            free(value);
+            return manifest_fail(parse, "invalid topology type");
+        }
+        parse->topology.type = (ManifestTopologyType)index;
+        break;
+    case MANIFEST_FAULT_TOLERANCE:
+        value = manifest_span_dup(manifest_attribute(event, "level")->value);
+        if (!value || !manifest_integer(value, 0, 12, &level)) {
+            free(value);
+            return manifest_fail(parse, "fault-tolerance level must be 0 to 12");
+        }
+        parse->topology.fault_tolerance = (unsigned)level;
+        break;
+    case MANIFEST_CONCURRENCY:
+        value = manifest_span_dup(manifest_attribute(event, "model")->value);
+        index = value ? MANIFEST_ENUM(manifest_concurrency_names, value) : -1;
+        if (index < 0) {
+            free(value);
+            return manifest_fail(parse, "invalid concurrency model");
+        }
+        parse->topology.concurrency = (ManifestConcurrency)index;
+        break;
+    case MANIFEST_INTENT:
+        value = manifest_span_dup(manifest_attribute(event, "expression")->value);
+        parse->intent = value ? parse_intent_expression(value, &parse->topology.decoding) : NULL;
+        if (!parse->intent) {
+            int result = manifest_fail(parse, "invalid intent expression \"%s\"", value ? value : "");
+            free(value);
+            return result;
+        }
+        break;
+    case MANIFEST_ACTION:
+        free(parse->command);
+        parse->command = NULL;
+        manifest_strings_clear(&parse->inputs);
+        manifest_strings_clear(&parse->outputs);
+        free(parse->action_name);
+        parse->action_name = manifest_span_dup(manifest_attribute(event, "name")->value);
+        if (!parse->action_name) {
+            return manifest_fail(parse, "out of memory");
+        }
+        break;
+    case MANIFEST_INPUT:
+    case MANIFEST_OUTPUT:
+        if (manifest_strings_push(element == MANIFEST_INPUT ? &parse->inputs : &parse->outputs,
+                                  manifest_span_dup(manifest_attribute(event, "path")->value)) != 0) {
+            return manifest_fail(parse, "out of memory");
+        }
+        break;
+    case MANIFEST_SOURCE:
+        free(parse->source_root);
+        parse->source_root = manifest_span_dup(manifest_attribute(event, "root")->value);
+        if (!parse->source_root) {
+            return manifest_fail(parse, "out of memory");
+        }
+        break;
+    case MANIFEST_DEPENDENCY:
+        if (parse->sink->dependency) {
+            char* name = manifest_span_dup(manifest_attribute(event, "name")->value);
+            char* version = manifest_span_dup(manifest_attribute(event, "version")->value);
+            ManifestDependency dependency = { name, version };
+            bool ok = name && version && parse->sink->dependency(&dependency, parse->sink->ctx);
+            free(name);
+            free(version);
+            if (!ok) {
+                return manifest_fail(parse, "dependency rejected");
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    free(value);
+    return 0;
+}
+
+static int manifest_end(ManifestParse* parse) {
+    ManifestFrame* frame = &parse->stack[--parse->depth];
+    ManifestElement element = frame->element;
+
+    // Every required child must have appeared
+    for (int i = 0; i < MANIFEST_ELEMENT_COUNT; i++) {
+        const ManifestElementSpec* child = &manifest_schema[i];
+        if (child->parent == element && child->required && !(frame->seen & (1u << child->position))) {
+            return manifest_fail(parse, "<%s> is missing <%s>", manifest_schema[element].name,
+                                 child->name);
+        }
+    }
+
+    const ManifestSink* sink = parse->sink;
+    const char* text = manifest_text(parse);
+    long long priority;
+    int index;
+    bool ok = true;
+
+    switch (element) {
+    case MANIFEST_NAME:
+        ok = (parse->identity.name = manifest_own(parse, 2, text)) != NULL;
+        break;
+    case MANIFEST_VERSION:
+        ok = (parse->identity.version = manifest_own(parse, 3, text)) != NULL;
+        break;
+    case MANIFEST_GUID:
+        ok = (parse->identity.guid = manifest_own(parse, 4, text)) != NULL;
+        break;
+    case MANIFEST_STABILITY:
+        index = MANIFEST_ENUM(manifest_stability_names, text);
+        if (index < 0) {
+            return manifest_fail(parse, "invalid stability \"%s\"", text);
+        }
+        parse->identity.stability = (ManifestStability)index;
+        break;
+    case MANIFEST_IDENTITY:
+        if (sink->identity && !sink->identity(&parse->identity, sink->ctx)) {
+            return manifest_fail(parse, "identity rejected");
+        }
+        break;
+    case MANIFEST_BINARY_ENCODING: {
+        TopologyDecoding* decoding = decode_topology_binary(text);
+        if (!decoding) {
+            return manifest_fail(parse, "binary-encoding must be 7 binary digits");
+        }
+        parse->topology.decoding = *decoding;
+        free_topology_decoding(decoding);
+        break;
+    }
+    case MANIFEST_TOPOLOGY:
+        if (sink->topology && !sink->topology(&parse->topology, sink->ctx)) {
+            return manifest_fail(parse, "topology rejected");
+        }
+        break;
+    case MANIFEST_STAGE:
+        index = MANIFEST_ENUM(manifest_stage_names, text);
+        if (index < 0) {
+            return manifest_fail(parse, "invalid stage \"%s\"", text);
+        }
+        parse->intent->stage = (IntentStage)index;
+        break;
+    case MANIFEST_PRIORITY:
+        if (!manifest_integer(text, 0, UINT32_MAX, &priority)) {
+            return manifest_fail(parse, "invalid priority \"%s\"", text);
+        }
+        parse->intent->priority = (uint32_t)priority;
+        break;
+    case MANIFEST_INTENT:
+        ok = !sink->intent || sink->intent(parse->intent, sink->ctx);
+        free_intent_resolution(parse->intent);
+        parse->intent = NULL;
+        if (!ok) {
+            return manifest_fail(parse, "intent rejected");
+        }
+        break;
+    case MANIFEST_COMMAND:
+        free(parse->command);
+        ok = (parse->command = strdup(text)) != NULL;
+        break;
+    case MANIFEST_ACTION:
+        if (sink->action) {
+            BuildAction action = {
+                parse->action_name,
+                parse->command,
+                (const char* const*)parse->inputs.items,
+                parse->inputs.count,
+                (const char* const*)parse->outputs.items,
+                parse->outputs.count
+            };
+            if (!sink->action(&action, sink->ctx)) {
+                return manifest_fail(parse, "action rejected");
+            }
+        }
+        break;
+    case MANIFEST_INCLUDE:
+    case MANIFEST_EXCLUDE:
+        if (sink->source) {
+            ManifestSourceRule rule = { parse->source_root, text, element == MANIFEST_EXCLUDE };
+            if (!sink->source(&rule, sink->ctx)) {
+                return manifest_fail(parse, "source rule rejected");
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    parse->text_len = 0;
+    return ok ? 0 : manifest_fail(parse, "out of memory");
+}
+
+int manifest_read(XmlReader* reader, const ManifestSink* sink, ManifestError* error) {
+    if (error) {
+        error->line = 0;
+        error->message[0] = '\0';
+    }
+    if (!reader || !sink) {
+        return -1;
+    }
+    TRACE_SPAN("manifest_read");
+
+    ManifestParse parse;
+    memset(&parse, 0, sizeof(parse));
+    parse.reader = reader;
+    parse.sink = sink;
+    parse.error = error;
+
+    int result = 0;
+    XmlEvent event;
+    while (result == 0) {
+        XmlEventType type = xml_reader_next(reader, &event);
+        if (type == XML_EVENT_EOF) {
+            break;
+        }
+        if (type == XML_EVENT_ERROR) {
+            result = manifest_fail(&parse, "%s", xml_reader_error(reader));
+        } else if (type == XML_EVENT_START) {
+            if (parse.depth > 0 && manifest_schema[parse.stack[parse.depth - 1].element].text) {
+                result = manifest_fail(&parse, "<%s> holds text only",
+                                       manifest_schema[parse.stack[parse.depth - 1].element].name);
+            } else {
+                result = manifest_start(&parse, &event);
+            }
+        } else if (type == XML_EVENT_END) {
+            result = manifest_end(&parse);
+        } else if (manifest_schema[parse.stack[parse.depth - 1].element].text) {
+            if (manifest_text_append(&parse, event.text) != 0) {
+                result = manifest_fail(&parse, "out of memory");
+            }
+        } else {
+            for (size_t i = 0; i < event.text.len; i++) {
+                if (!strchr(" \t\r\n", event.text.data[i])) {
+                    result = manifest_fail(&parse, "unexpected text in <%s>",
+                                           manifest_schema[parse.stack[parse.depth - 1].element].name);
+                    break;
+                }
+            }
+        }
+    }
+
+    free(parse.text);
+    free_intent_resolution(parse.intent);
+    free(parse.action_name);
+    free(parse.command);
+    manifest_strings_clear(&parse.inputs);
+    manifest_strings_clear(&parse.outputs);
+    free(parse.inputs.items);
+    free(parse.outputs.items);
+    free(parse.source_root);
+    for (size_t i = 0; i < sizeof(parse.owned) / sizeof(parse.owned[0]); i++) {
+        free(parse.owned[i]);
+    }
+    return result;
+}
+
+int manifest_read_file(const char* path, const ManifestSink* sink, ManifestError* error) {
+    XmlReader* reader = xml_reader_open(path, 0);
+    if (!reader) {
+        if (error) {
+            error->line = 0;
+            snprintf(error->message, sizeof(error->message), "cannot open manifest");
+        }
+        return -1;
+    }
+
+    int result = manifest_read(reader, sink, error);
+    xml_reader_close(reader);
+    return result;
+}
+
+static char** manifest_copy_strings(const char* const* items, size_t count) {
+    char** copy = (char**)calloc(count ? count : 1, sizeof(char*));
+    for (size_t i = 0; copy && i < count; i++) {
+        copy[i] = strdup(items[i]);
+        if (!copy[i]) {
+            for (size_t j = 0; j < i; j++) {
+                free(copy[j]);
+            }
+            free(copy);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+static void manifest_free_action(BuildAction* action) {
+    free((char*)action->name);
+    free((char*)action->command);
+    for (size_t i = 0; i < action->input_count; i++) {
+        free((char*)action->inputs[i]);
+    }
+    for (size_t i = 0; i < action->output_count; i++) {
+        free((char*)action->outputs[i]);
+    }
+    free((char**)action->inputs);
+    free((char**)action->outputs);
+}
+
+/**
+ * Add a node with its action; the builder takes the action's strings,
+ * and the node is freed if it cannot be added
+ */
+static bool manifest_graph_add(ManifestGraph* builder, DAGNode* node, const BuildAction* action) {
+    DAGGraph* graph = builder->graph;
+    if (graph->node_count == builder->action_capacity) {
+        size_t capacity = builder->action_capacity ? builder->action_capacity * 2
+                                                   : MANIFEST_INITIAL_CAPACITY;
+        BuildAction* grown = (BuildAction*)realloc(builder->actions, capacity * sizeof(BuildAction));
+        if (!grown) {
+            dag_node_free(node);
+            return false;
+        }
+        builder->actions = grown;
+        builder->action_capacity = capacity;
+    }
+    if (!node || dag_graph_add_node(graph, node) != 0) {
+        dag_node_free(node);
+        return false;
+    }
+    builder->actions[node->index] = *action;
+    return true;
+}
+
+static bool manifest_graph_topology(const ManifestTopology* topology, void* ctx) {
+    ManifestGraph* builder = (ManifestGraph*)ctx;
+    builder->topology = *topology;
+    builder->has_topology = true;
+    return true;
+}
+
+static bool manifest_graph_intent(const IntentResolution* intent, void* ctx) {
+    ManifestGraph* builder = (ManifestGraph*)ctx;
+    if (builder->intent_count == builder->intent_capacity) {
+        size_t capacity = builder->intent_capacity ? builder->intent_capacity * 2
+                                                   : MANIFEST_INITIAL_CAPACITY;
+        IntentResolution** grown =
+            (IntentResolution**)realloc(builder->intents, capacity * sizeof(IntentResolution*));
+        if (!grown) {
+            return false;
+        }
+        builder->intents = grown;
+        builder->intent_capacity = capacity;
+    }
+
+    IntentResolution* copy = (IntentResolution*)malloc(sizeof(IntentResolution));
+    if (!copy) {
+        return false;
+    }
+    *copy = *intent;
+    copy->semantic_context = intent->semantic_context ? strdup(intent->semantic_context) : NULL;
+    copy->binding_value = intent->binding_value ? strdup(intent->binding_value) : NULL;
+    copy->build_action = intent->build_action ? strdup(intent->build_action) : NULL;
+    BuildAction action = { copy->semantic_context ? strdup(copy->semantic_context) : NULL,
+                           NULL, NULL, 0, NULL, 0 };
+    if ((intent->semantic_context && (!copy->semantic_context || !action.name)) ||
+        (intent->binding_value && !copy->binding_value) ||
+        (intent->build_action && !copy->build_action) ||
+        !manifest_graph_add(builder, create_dag_from_intent(copy), &action)) {
+        free((char*)action.name);
+        free_intent_resolution(copy);
+        return false;
+    }
+    builder->intents[builder->intent_count++] = copy;
+    return true;
+}
+
+static bool manifest_graph_action(const BuildAction* action, void* ctx) {
+    ManifestGraph* builder = (ManifestGraph*)ctx;
+    BuildAction copy = {
+        strdup(action->name),
+        action->command ? strdup(action->command) : NULL,
+        (const char* const*)manifest_copy_strings(action->inputs, action->input_count),
+        action->input_count,
+        (const char* const*)manifest_copy_strings(action->outputs, action->output_count),
+        action->output_count
+    };
+    if (!copy.name || (action->command && !copy.command) || !copy.inputs || !copy.outputs ||
+        !manifest_graph_add(builder, dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION), &copy)) {
+        if (!copy.inputs) {
+            copy.input_count = 0;
+        }
+        if (!copy.outputs) {
+            copy.output_count = 0;
+        }
+        manifest_free_action(&copy);
+        return false;
+    }
+    return true;
+}
+
+static bool manifest_graph_dependency(const ManifestDependency* dependency, void* ctx) {
+    ManifestGraph* builder = (ManifestGraph*)ctx;
+    BuildAction action = { strdup(dependency->name), NULL, NULL, 0, NULL, 0 };
+    if (!action.name ||
+        !manifest_graph_add(builder, dag_node_create(TOKEN_IDENTIFIER, TAX_RESOURCE), &action)) {
+        free((char*)action.name);
+        return false;
+    }
+    return true;
+}
+
+int manifest_graph_init(ManifestGraph* builder, DAGGraph* graph, ManifestSink* sink) {
+    if (!builder || !graph || !sink || graph->node_count > 0) {
+        return -1;
+    }
+
+    memset(builder, 0, sizeof(*builder));
+    builder->graph = graph;
+
+    memset(sink, 0, sizeof(*sink));
+    sink->topology = manifest_graph_topology;
+    sink->intent = manifest_graph_intent;
+    sink->action = manifest_graph_action;
+    sink->dependency = manifest_graph_dependency;
+    sink->ctx = builder;
+    return 0;
+}
+
+static uint64_t manifest_hash_more(uint64_t hash, const char* text) {
+    // FNV-1a
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t manifest_hash(const char* text) {
+    return manifest_hash_more(14695981039346656037ULL, text);
+}
+
+// Empty slot of the link set; node indices stay below UINT32_MAX
+#define MANIFEST_NO_LINK UINT64_MAX
+
+/**
+ * Open-addressing set of the (from, to) node pairs linked so far
+ */
+typedef struct {
+    uint64_t* pairs;
+    size_t capacity;
+    size_t count;
+} ManifestLinks;
+
+static size_t manifest_links_slot(const ManifestLinks* links, uint64_t pair) {
+    size_t slot = (size_t)((pair * 11400714819323198485ULL) >> 32) & (links->capacity - 1);
+    while (links->pairs[slot] != MANIFEST_NO_LINK && links->pairs[slot] != pair) {
+        slot = (slot + 1) & (links->capacity - 1);
+    }
+    return slot;
+}
+
+static bool manifest_links_reserve(ManifestLinks* links, size_t count) {
+    size_t capacity = links->capacity ? links->capacity : 16;
+    while (capacity < 2 * count) {
+        capacity *= 2;
+    }
+    if (capacity == links->capacity) {
+        return true;
+    }
+
+    uint64_t* pairs = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+    if (!pairs) {
+        return false;
+    }
+    memset(pairs, 0xff, capacity * sizeof(uint64_t));
+    ManifestLinks grown = { pairs, capacity, links->count };
+    for (size_t i = 0; i < links->capacity; i++) {
+        if (links->pairs[i] != MANIFEST_NO_LINK) {
+            pairs[manifest_links_slot(&grown, links->pairs[i])] = links->pairs[i];
+        }
+    }
+    free(links->pairs);
+    *links = grown;
+    return true;
+}
+
+/**
+ * Add an edge unless the pair is already connected
+ */
+static bool manifest_graph_link(DAGGraph* graph, ManifestLinks* links, uint32_t from, uint32_t to) {
+    if (from == to) {
+        return true;
+    }
+    if (!manifest_links_reserve(links, links->count + 1)) {
+        return false;
+    }
+    uint64_t pair = ((uint64_t)from << 32) | to;
+    size_t slot = manifest_links_slot(links, pair);
+    if (links->pairs[slot] == pair) {
+        return true;
+    }
+
+    DAGNode* source = graph->nodes[from];
+    size_t before = source->out_count;
+    dag_add_edge(source, graph->nodes[to], 1.0f);
+    if (source->out_count == before) {
+        return false;
+    }
+    links->pairs[slot] = pair;
+    links->count++;
+    return true;
+}
+
+/**
+ * Find the manifest action named "<verb>-<binding>"
+ */
+static uint32_t manifest_find_action(const ManifestGraph* builder, const uint32_t* slots,
+                                     size_t capacity, const char* verb, const char* binding) {
+    size_t verb_len = strlen(verb);
+    uint64_t hash = manifest_hash_more(manifest_hash_more(manifest_hash(verb), "-"), binding);
+    for (size_t slot = (size_t)hash & (capacity - 1); slots[slot] != UINT32_MAX;
+         slot = (slot + 1) & (capacity - 1)) {
+        const char* name = builder->actions[slots[slot]].name;
+        if (strncmp(name, verb, verb_len) == 0 && name[verb_len] == '-' &&
+            strcmp(name + verb_len + 1, binding) == 0) {
+            return slots[slot];
+        }
+    }
+    return UINT32_MAX;
+}
+
+int manifest_graph_finish(ManifestGraph* builder) {
+    if (!builder || !builder->graph) {
+        return -1;
+    }
+
+    TRACE_SPAN("manifest_graph_finish");
+    DAGGraph* graph = builder->graph;
+    size_t n = graph->node_count;
+
+    // Open-addressing table from output path to producing node
+    size_t outputs = 0;
+    size_t inputs = 0;
+    for (size_t i = 0; i < n; i++) {
+        outputs += builder->actions[i].output_count;
+        inputs += builder->actions[i].input_count;
+    }
+    size_t capacity = 16;
+    while (capacity < 2 * outputs) {
+        capacity *= 2;
+    }
+    uint32_t* slots = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    if (!slots) {
+        return -1;
+    }
+    memset(slots, 0xff, capacity * sizeof(uint32_t));
+
+    // Output slots store the node index; the path is found through it
+    const char** slot_paths = (const char**)calloc(capacity, sizeof(char*));
+    if (!slot_paths) {
+        free(slots);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < builder->actions[i].output_count; j++) {
+            const char* path = builder->actions[i].outputs[j];
+            size_t slot = (size_t)manifest_hash(path) & (capacity - 1);
+            while (slots[slot] != UINT32_MAX && strcmp(slot_paths[slot], path) != 0) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            // The first producer of a path wins
+            if (slots[slot] == UINT32_MAX) {
+                slots[slot] = (uint32_t)i;
+                slot_paths[slot] = path;
+            }
+        }
+    }
+
+    ManifestLinks links = { NULL, 0, 0 };
+    bool ok = manifest_links_reserve(&links, inputs + 2 * builder->intent_count);
+    for (size_t i = 0; ok && i < n; i++) {
+        for (size_t j = 0; ok && j < builder->actions[i].input_count; j++) {
+            const char* path = builder->actions[i].inputs[j];
+            size_t slot = (size_t)manifest_hash(path) & (capacity - 1);
+            while (slots[slot] != UINT32_MAX && strcmp(slot_paths[slot], path) != 0) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            if (slots[slot] != UINT32_MAX) {
+                ok = manifest_graph_link(graph, &links, slots[slot], (uint32_t)i);
+            }
+        }
+    }
+    free(slots);
+    free(slot_paths);
+
+    // Manifest actions by name, and one list of them per verb they
+    // start with ("compile-...")
+    capacity = 16;
+    while (capacity < 2 * n) {
+        capacity *= 2;
+    }
+    uint32_t heads[INTENT_VERB_CONFIGURE + 1];
+    uint32_t hubs[INTENT_VERB_CONFIGURE + 1];
+    uint32_t* next = (uint32_t*)malloc((n ? n : 1) * sizeof(uint32_t));
+    slots = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    if (!next || !slots) {
+        free(next);
+        free(slots);
+        free(links.pairs);
+        return -1;
+    }
+    memset(heads, 0xff, sizeof(heads));
+    memset(hubs, 0xff, sizeof(hubs));
+    memset(slots, 0xff, capacity * sizeof(uint32_t));
+    for (size_t i = n; ok && i-- > 0;) {
+        const BuildAction* action = &builder->actions[i];
+        if (!action->command) {
+            continue;
+        }
+        size_t slot = (size_t)manifest_hash(action->name) & (capacity - 1);
+        while (slots[slot] != UINT32_MAX &&
+               strcmp(builder->actions[slots[slot]].name, action->name) != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        // Walking backwards, the last write is the first action of a name
+        slots[slot] = (uint32_t)i;
+
+        size_t len = strcspn(action->name, "-");
+        for (int verb = 0; verb <= INTENT_VERB_CONFIGURE; verb++) {
+            const char* name = intent_verb_to_string((IntentVerb)verb);
+            if (strlen(name) == len && strncmp(action->name, name, len) == 0) {
+                next[i] = heads[verb];
+                heads[verb] = (uint32_t)i;
+                break;
+            }
+        }
+    }
+
+    // A bound intent precedes its own action; the others precede every
+    // action of their verb through one hub node per verb
+    for (size_t i = 0; ok && i < builder->intent_count; i++) {
+        const IntentResolution* intent = builder->intents[i];
+        const char* verb = intent_verb_to_string(intent->verb);
+        uint32_t from = (uint32_t)intent->dag_representation->index;
+        uint32_t to = intent->binding_value
+                          ? manifest_find_action(builder, slots, capacity, verb, intent->binding_value)
+                          : UINT32_MAX;
+        if (to == UINT32_MAX && heads[intent->verb] != UINT32_MAX) {
+            if (hubs[intent->verb] == UINT32_MAX) {
+                BuildAction hub = { strdup(verb), NULL, NULL, 0, NULL, 0 };
+                if (!hub.name ||
+                    !manifest_graph_add(builder, dag_node_create(TOKEN_IDENTIFIER, TAX_CONTROLLER),
+                                        &hub)) {
+                    free((char*)hub.name);
+                    ok = false;
+                    break;
+                }
+                hubs[intent->verb] = (uint32_t)(graph->node_count - 1);
+                for (uint32_t j = heads[intent->verb]; ok && j != UINT32_MAX; j = next[j]) {
+                    ok = manifest_graph_link(graph, &links, hubs[intent->verb], j);
+                }
+            }
+            to = hubs[intent->verb];
+        }
+        if (to != UINT32_MAX) {
+            ok = ok && manifest_graph_link(graph, &links, from, to);
+        }
+    }
+    free(next);
+    free(slots);
+    free(links.pairs);
+    return ok ? 0 : -1;
+}
+
+void manifest_graph_free(ManifestGraph* builder) {
+    if (!builder) {
+        return;
+    }
+
+    size_t n = builder->graph ? builder->graph->node_count : 0;
+    for (size_t i = 0; builder->actions && i < n; i++) {
+        manifest_free_action(&builder->actions[i]);
+    }
+    for (size_t i = 0; i < builder->intent_count; i++) {
+        free_intent_resolution(builder->intents[i]);
+    }
+    free(builder->actions);
+    free(builder->intents);
+    memset(builder, 0, sizeof(*builder));
+}
@@ -1,11 +1,13 @@
 #include "../dag/dag.h"
 #include "../trie/trie.h"
+#include "../trie/scanner.h"
 #include "trie_dag.h"
+#include "../trace/trace.h"
 #include <stdlib.h>
 #include <string.h>
 
-// Maximum number of DAG nodes to create from trie matches
-#define MAX_MATCHES 100
+// Initial capacity of growable match storage, doubled on demand
+#define TRIE_DAG_INITIAL_CAPACITY 16
 
 /**
  * Initialize the trie-dag integration
@@ -18,43 +20,210 @@ int trie_dag_init(void) {
     return (trie_result == 0 && dag_result == 0) ? 0 : -1;
 }
 
+/**
+ * Forwards scanner matches to a match sink
+ */
+typedef struct {
+    TrieDagMatchFn fn;
+    void* ctx;
+} TrieDagForward;
+
+static bool forward_match(const TrieScanMatch* match, void* ctx) {
+    TrieDagForward* forward = (TrieDagForward*)ctx;
+    TrieDagMatch out = {
+        match->offset,
+        match->length,
+        match->rule->category,
+        match->rule->weight,
+        match->rule,
+        NULL
+    };
+    return forward->fn(&out, forward->ctx);
+}
+
+long trie_dag_scan_with(const TrieScanner* scanner, const char* text, size_t len,
+                        TrieDagMatchFn fn, void* ctx) {
+    if (!scanner || !text || !fn) {
+        return -1;
+    }
+
+    TrieDagForward forward = { fn, ctx };
+    return trie_scanner_scan(scanner, text, len, forward_match, &forward);
+}
+
+long trie_dag_scan(TrieNode* root, const char* text, size_t len,
+                   TrieDagMatchFn fn, void* ctx) {
+    if (!root || !text || !fn) {
+        return -1;
+    }
+
+    // Compile every pattern into one automaton and scan the text once
+    TRACE_SPAN("trie_dag_scan");
+    TrieScanner* scanner = trie_scanner_create(root);
+    if (!scanner) {
+        return -1;
+    }
+
+    long delivered = trie_dag_scan_with(scanner, text, len, fn, ctx);
+    trie_scanner_free(scanner);
+    return delivered;
+}
+
+bool trie_dag_graph_append(const TrieDagMatch* match, void* ctx) {
+    DAGGraph* graph = (DAGGraph*)ctx;
+    if (!graph || !match) {
+        return false;
+    }
+
+    DAGNode* node = dag_node_create_in(graph->allocator, TOKEN_STRING, match->category);
+    if (!node) {
+        return false;
+    }
+    if (dag_graph_add_node(graph, node) != 0) {
+        dag_node_free(node);
+        return false;
+    }
+    return true;
+}
+
+void trie_dag_match_buffer_init(TrieDagMatchBuffer* buffer,
+                                const PolyAllocator* allocator) {
+    if (!buffer) {
+        return;
+    }
+
+    buffer->matches = NULL;
+    buffer->count = 0;
+    buffer->capacity = 0;
+    buffer->allocator = allocator ? allocator : poly_allocator_default();
+}
+
+bool trie_dag_match_buffer_append(const TrieDagMatch* match, void* ctx) {
+    TrieDagMatchBuffer* buffer = (TrieDagMatchBuffer*)ctx;
+    if (!buffer || !match) {
+        return false;
+    }
+
+    if (buffer->count == buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : TRIE_DAG_INITIAL_CAPACITY;
+        TrieDagMatch* matches = (TrieDagMatch*)poly_resize(buffer->allocator, buffer->matches,
+                                                           buffer->capacity * sizeof(TrieDagMatch),
+                                                           capacity * sizeof(TrieDagMatch));
+        if (!matches) {
+            return false;
+        }
+        buffer->matches = matches;
+        buffer->capacity = capacity;
+    }
+
+    buffer->matches[buffer->count++] = *match;
+    return true;
+}
+
+void trie_dag_match_buffer_clear(TrieDagMatchBuffer* buffer) {
+    if (buffer) {
+        buffer->count = 0;
+    }
+}
+
+void trie_dag_match_buffer_free(TrieDagMatchBuffer* buffer) {
+    if (!buffer) {
+        return;
+    }
+
+    poly_release(buffer->allocator, buffer->matches,
+                 buffer->capacity * sizeof(TrieDagMatch));
+    buffer->matches = NULL;
+    buffer->count = 0;
+    buffer->capacity = 0;
+}
+
+/**
+ * Sink appending one DAG node per match to a growable array
+ */
+typedef struct {
+    const PolyAllocator* allocator;
+    DAGNode** result;
+    size_t count;
+    size_t capacity;            // Slots, one always kept for the terminator
+    bool failed;                // Stopped the scan for lack of memory
+} TrieDagCollect;
+
+static bool collect_match_node(const TrieDagMatch* match, void* ctx) {
+    TrieDagCollect* collect = (TrieDagCollect*)ctx;
+
+    if (collect->count + 1 == collect->capacity) {
+        size_t capacity = collect->capacity * 2;
+        DAGNode** result = (DAGNode**)poly_resize(collect->allocator, collect->result,
+                                                  collect->capacity * sizeof(DAGNode*),
+                                                  capacity * sizeof(DAGNode*));
+        if (!result) {
+            collect->failed = true;
+            return false;
+        }
+        collect->result = result;
+        collect->capacity = capacity;
+    }
+
+    // Create a DAG node for this match
+    DAGNode* node = dag_node_create_in(collect->allocator, TOKEN_STRING, match->category);
+    if (!node) {
+        collect->failed = true;
+        return false;
+    }
+    collect->result[collect->count++] = node;
+    return true;
+}
+
 /**
  * Create DAG nodes from trie matches
  */
 DAGNode** create_dag_from_trie_matches(TrieNode* root, const char* text, size_t len) {
+    return create_dag_from_trie_matches_in(NULL, root, text, len);
+}
+
+/**
+ * Create DAG nodes from trie matches, drawing from an allocator
+ */
+DAGNode** create_dag_from_trie_matches_in(const PolyAllocator* allocator,
+                                          TrieNode* root, const char* text, size_t len) {
     if (!root || !text || len == 0) {
         return NULL;
     }
 
-    // Allocate result array 
-    DAGNode** result = (DAGNode**)calloc(MAX_MATCHES + 1, sizeof(DAGNode*));
-    if (!result) {
+    TRACE_SPAN("create_dag_from_trie_matches");
+    TrieDagCollect collect = { allocator, NULL, 0, TRIE_DAG_INITIAL_CAPACITY, false };
+    collect.result = (DAGNode**)poly_alloc(allocator, collect.capacity * sizeof(DAGNode*));
+    if (!collect.result) {
         return NULL;
     }
 
-    // Match count
-    size_t match_count = 0;
-
-    // Process each character position as a potential start
-    for (size_t i = 0; i < len && match_count < MAX_MATCHES; i++) {
-        // Try to match at each remaining length 
-        for (size_t j = 1; j <= len - i && match_count < MAX_MATCHES; j++) {
-            // For each character, check all children of root
-            for (int k = 0; k < 256 && match_count < MAX_MATCHES; k++) {
-                TrieNode* child = root->children[k];
-                if (child && trie_match_node(child, text + i, j)) {
-                    // Create a DAG node for this match
-                    DAGNode* node = dag_node_create(TOKEN_STRING, child->category);
-                    if (node) {
-                        result[match_count++] = node;
-                    }
-                }
-            }
+    // A sink stopped by a failed allocation would leave a truncated array
+    if (trie_dag_scan(root, text, len, collect_match_node, &collect) < 0 || collect.failed) {
+        for (size_t i = 0; i < collect.count; i++) {
+            dag_node_free(collect.result[i]);
         }
+        poly_release(allocator, collect.result, collect.capacity * sizeof(DAGNode*));
+        return NULL;
     }
 
     // NULL terminate the array
-    result[match_count] = NULL;
+    collect.result[collect.count] = NULL;
+
+    return collect.result;
+}
+
+/**
+ * Free a match array returned by create_dag_from_trie_matches
+ */
+void trie_dag_free_matches(DAGNode** matches) {
+    if (!matches) {
+        return;
+    }
+
+    for (size_t i = 0; matches[i]; i++) {
+        dag_node_free(matches[i]);
+    }
 
-    return result;
+    free(matches);
 }
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "atomic_file.h"
+
+// Sequence number keeping temporary names unique across threads
+static atomic_ulong atomic_file_sequence;
+
+int atomic_file_open(AtomicFile* file, const char* path, mode_t mode) {
+    if (!file || !path) {
+        return -1;
+    }
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+
+    size_t path_len = strlen(path);
+    file->temp = (char*)malloc(path_len + 64);
+    if (!file->temp) {
+        return -1;
+    }
+
+    // A name taken by a stale or concurrent writer is skipped, never reused
+    for (int attempt = 0; attempt < 16 && file->fd < 0; attempt++) {
+        unsigned long sequence = atomic_fetch_add_explicit(&atomic_file_sequence, 1,
+                                                           memory_order_relaxed);
+        snprintf(file->temp, path_len + 64, "%s.tmp.%ld.%lu", path, (long)getpid(), sequence);
+        file->fd = open(file->temp, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, mode);
+        if (file->fd < 0 && errno != EEXIST) {
+            break;
+        }
+    }
+    if (file->fd < 0) {
+        free(file->temp);
+        file->temp = NULL;
+        return -1;
+    }
+
+    file->path = path;
+    return 0;
+}
+
+FILE* atomic_file_stream(AtomicFile* file) {
+    if (!file || file->fd < 0) {
+        return NULL;
+    }
+    if (!file->stream) {
+        file->stream = fdopen(file->fd, "wb");
+    }
+    return file->stream;
+}
+
+/**
+ * Flush the directory entry of a renamed file; best effort, since the
+ * target has been replaced either way
+ */
+static void atomic_file_sync_parent(const char* path) {
+    const char* slash = strrchr(path, '/');
+    char* parent = NULL;
+    if (slash) {
+        size_t len = slash == path ? 1 : (size_t)(slash - path);
+        parent = (char*)malloc(len + 1);
+        if (!parent) {
+            return;
+        }
+        memcpy(parent, path, len);
+        parent[len] = '\0';
+    }
+
+    int fd = open(parent ? parent : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    free(parent);
+}
+
+int atomic_file_close(AtomicFile* file, bool commit) {
+    if (!file || !file->temp) {
+        return -1;
+    }
+
+    // The contents must be on disk before the rename can expose them, or a
+    // crash could leave the target empty; the stream owns the descriptor
+    if (file->stream) {
+        commit = commit && fflush(file->stream) == 0 && fsync(file->fd) == 0;
+        commit = fclose(file->stream) == 0 && commit;
+    } else if (file->fd >= 0) {
+        commit = commit && fsync(file->fd) == 0;
+        commit = close(file->fd) == 0 && commit;
+    }
+
+    if (!commit || rename(file->temp, file->path) != 0) {
+        unlink(file->temp);
+        commit = false;
+    } else {
+        atomic_file_sync_parent(file->path);
+    }
+
+    free(file->temp);
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+    return commit ? 0 : -1;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file atomic_file.h
+ * @brief Replace files atomically through a temporary file and rename
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_ATOMIC_FILE_H
+#define POLYBUILD_ATOMIC_FILE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ * @brief A file being written beside its target
+ *
+ * The contents go to a temporary file in the target's directory, named
+ * uniquely per process and call, and replace the target by rename only
+ * once complete. Readers see either the old file or the new one, never
+ * a partial write, and concurrent writers of one target do not share a
+ * temporary file.
+ */
+typedef struct AtomicFile {
+    const char* path;           // Target, borrowed until atomic_file_close()
+    char* temp;
+    int fd;
+    FILE* stream;               // Opened by atomic_file_stream(), if asked for
+} AtomicFile;
+
+/**
+ * @brief Create the temporary file for a target
+ * @param file File to initialize
+ * @param path Target path; must stay valid until atomic_file_close()
+ * @param mode Permissions of the new file, before the umask
+ * @return 0 on success, -1 on failure (nothing to close)
+ */
+int atomic_file_open(AtomicFile* file, const char* path, mode_t mode);
+
+/**
+ * @brief Get a binary stdio stream over the temporary file
+ *
+ * Write either through the stream or through @c file->fd, not both.
+ *
+ * @param file Open file
+ * @return Stream owned by the file, or NULL on failure
+ */
+FILE* atomic_file_stream(AtomicFile* file);
+
+/**
+ * @brief Finish the file, replacing the target or discarding the write
+ *
+ * On commit the contents are synced to disk before the rename and the
+ * target's directory after it, so a crash leaves either the old file or
+ * the complete new one.
+ *
+ * @param file Open file; released either way
+ * @param commit Whether every write succeeded and the target should be
+ *        replaced
+ * @return 0 if the target was replaced, -1 otherwise
+ */
+int atomic_file_close(AtomicFile* file, bool commit);
+
+#endif /* POLYBUILD_ATOMIC_FILE_H */
@@ -0,0 +1,498 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "file_index.h"
+#include "atomic_file.h"
+
+#define FILE_INDEX_MAGIC "PBFINDEX"
+#define FILE_INDEX_VERSION 1
+
+// Initial slot count of the overlay table, doubled at 70% load
+#define FILE_INDEX_INITIAL_CAPACITY 64
+
+/**
+ * On-disk header, followed by the records and the string pool
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+    uint64_t strings_size;
+    int64_t written_sec;        // When the index was written, for racy checks
+    int64_t written_nsec;
+} FileIndexHeader;
+
+/**
+ * On-disk record, sorted by path
+ */
+typedef struct {
+    uint64_t path_offset;       // Into the string pool
+    uint32_t path_len;
+    uint32_t reserved;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t size;
+    uint64_t inode;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+} FileIndexRecord;
+
+/**
+ * Record checked or changed since the index was opened
+ */
+typedef struct {
+    char* path;                 // NULL for an empty slot
+    size_t path_len;
+    uint64_t hash;
+    FileIndexRecord record;
+    bool deleted;               // File vanished; dropped on save
+    bool on_disk;               // Path also has a mapped record
+} FileIndexEntry;
+
+struct FileIndex {
+    char* path;
+
+    // Mapped index file, if any
+    void* map;
+    size_t map_size;
+    const FileIndexHeader* header;
+    const FileIndexRecord* records;
+    const char* strings;
+
+    // Overlay of new and updated records
+    FileIndexEntry* entries;
+    size_t capacity;
+    size_t entry_count;
+
+    size_t live_count;
+    size_t rehashed;
+};
+
+static uint64_t file_index_hash(const char* path) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char* p = (const unsigned char*)path; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static FileIndexEntry* file_index_slot(const FileIndex* index, const char* path, uint64_t hash) {
+    size_t mask = index->capacity - 1;
+    for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask) {
+        FileIndexEntry* entry = &index->entries[i];
+        if (!entry->path || (entry->hash == hash && strcmp(entry->path, path) == 0)) {
+            return entry;
+        }
+    }
+}
+
+static int file_index_grow(FileIndex* index) {
+    size_t old_capacity = index->capacity;
+    FileIndexEntry* old_entries = index->entries;
+
+    size_t capacity = old_capacity ? old_capacity * 2 : FILE_INDEX_INITIAL_CAPACITY;
+    FileIndexEntry* entries = (FileIndexEntry*)calloc(capacity, sizeof(FileIndexEntry));
+    if (!entries) {
+        return -1;
+    }
+
+    index->entries = entries;
+    index->capacity = capacity;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_entries[i].path) {
+            *file_index_slot(index, old_entries[i].path, old_entries[i].hash) = old_entries[i];
+        }
+    }
+
+    free(old_entries);
+    return 0;
+}
+
+/**
+ * Binary search of the mapped records; out-of-range records end the search
+ */
+static const FileIndexRecord* file_index_find_mapped(const FileIndex* index, const char* path) {
+    if (!index->header) {
+        return NULL;
+    }
+
+    size_t path_len = strlen(path);
+    size_t low = 0;
+    size_t high = (size_t)index->header->count;
+
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        const FileIndexRecord* record = &index->records[mid];
+        if (record->path_offset > index->header->strings_size ||
+            record->path_len > index->header->strings_size - record->path_offset) {
+            return NULL;
+        }
+
+        const char* name = index->strings + record->path_offset;
+        size_t common = path_len < record->path_len ? path_len : record->path_len;
+        int order = memcmp(path, name, common);
+        if (order == 0) {
+            order = (path_len > record->path_len) - (path_len < record->path_len);
+        }
+        if (order == 0) {
+            return record;
+        }
+        if (order < 0) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Map an index file, leaving the index empty if it is missing or invalid
+ */
+static void file_index_map(FileIndex* index) {
+    int fd = open(index->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(FileIndexHeader)) {
+        close(fd);
+        return;
+    }
+
+    void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return;
+    }
+
+    const FileIndexHeader* header = (const FileIndexHeader*)map;
+    size_t size = (size_t)st.st_size;
+    size_t body = size - sizeof(FileIndexHeader);
+    bool valid = memcmp(header->magic, FILE_INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+                 header->version == FILE_INDEX_VERSION &&
+                 header->record_size == sizeof(FileIndexRecord) &&
+                 header->count <= body / sizeof(FileIndexRecord) &&
+                 header->strings_size == body - header->count * sizeof(FileIndexRecord);
+    if (!valid) {
+        munmap(map, size);
+        return;
+    }
+
+    index->map = map;
+    index->map_size = size;
+    index->header = header;
+    index->records = (const FileIndexRecord*)(header + 1);
+    index->strings = (const char*)(index->records + header->count);
+    index->live_count = (size_t)header->count;
+}
+
+static void file_index_unmap(FileIndex* index) {
+    if (index->map) {
+        munmap(index->map, index->map_size);
+    }
+    index->map = NULL;
+    index->map_size = 0;
+    index->header = NULL;
+    index->records = NULL;
+    index->strings = NULL;
+}
+
+static void file_index_clear_overlay(FileIndex* index) {
+    for (size_t i = 0; i < index->capacity; i++) {
+        free(index->entries[i].path);
+        index->entries[i].path = NULL;
+    }
+    index->entry_count = 0;
+}
+
+FileIndex* file_index_open(const char* path) {
+    if (!path) {
+        return NULL;
+    }
+
+    FileIndex* index = (FileIndex*)calloc(1, sizeof(FileIndex));
+    if (!index) {
+        return NULL;
+    }
+    index->path = strdup(path);
+    if (!index->path || file_index_grow(index) != 0) {
+        free(index->path);
+        free(index);
+        return NULL;
+    }
+
+    file_index_map(index);
+    return index;
+}
+
+/**
+ * Record a path in the overlay, keeping the live count in step
+ */
+static int file_index_put(FileIndex* index, const char* path, const FileIndexRecord* record,
+                          bool deleted) {
+    if ((index->entry_count + 1) * 10 > index->capacity * 7 && file_index_grow(index) != 0) {
+        return -1;
+    }
+
+    uint64_t hash = file_index_hash(path);
+    FileIndexEntry* entry = file_index_slot(index, path, hash);
+    bool was_live;
+    if (entry->path) {
+        was_live = !entry->deleted;
+    } else {
+        entry->path = strdup(path);
+        if (!entry->path) {
+            return -1;
+        }
+        entry->path_len = strlen(path);
+        entry->hash = hash;
+        entry->on_disk = file_index_find_mapped(index, path) != NULL;
+        was_live = entry->on_disk;
+        index->entry_count++;
+    }
+
+    if (record) {
+        entry->record = *record;
+    }
+    entry->deleted = deleted;
+    if (was_live && deleted) {
+        index->live_count--;
+    } else if (!was_live && !deleted) {
+        index->live_count++;
+    }
+    return 0;
+}
+
+int file_index_check(FileIndex* index, const char* path,
+                     uint8_t digest[SHA256_DIGEST_SIZE], bool* changed) {
+    if (!index || !path || !digest) {
+        return -1;
+    }
+
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        file_index_put(index, path, NULL, true);
+        return -1;
+    }
+
+    FileIndexRecord current;
+    memset(&current, 0, sizeof(current));
+    current.mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    current.mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    current.size = (uint64_t)st.st_size;
+    current.inode = (uint64_t)st.st_ino;
+
+    // The overlay holds this session's view; the mapped table the last one
+    const FileIndexRecord* known = NULL;
+    bool racy = false;
+    const FileIndexEntry* entry = file_index_slot(index, path, file_index_hash(path));
+    if (entry->path) {
+        known = entry->deleted ? NULL : &entry->record;
+    } else {
+        known = file_index_find_mapped(index, path);
+        // Written in the same tick as the index: may have changed unseen
+        racy = known && (known->mtime_sec > index->header->written_sec ||
+                         (known->mtime_sec == index->header->written_sec &&
+                          known->mtime_nsec >= index->header->written_nsec));
+    }
+
+    if (known && !racy && known->mtime_sec == current.mtime_sec &&
+        known->mtime_nsec == current.mtime_nsec && known->size == current.size &&
+        known->inode == current.inode) {
+        memcpy(digest, known->digest, SHA256_DIGEST_SIZE);
+        if (changed) {
+            *changed = false;
+        }
+        return 0;
+    }
+
+    if (sha256_file(path, current.digest) != 0) {
+        return -1;
+    }
+    index->rehashed++;
+
+    if (changed) {
+        *changed = !known || memcmp(known->digest, current.digest, SHA256_DIGEST_SIZE) != 0;
+    }
+    memcpy(digest, current.digest, SHA256_DIGEST_SIZE);
+    return file_index_put(index, path, &current, false);
+}
+
+size_t file_index_rehash_count(const FileIndex* index) {
+    return index ? index->rehashed : 0;
+}
+
+size_t file_index_count(const FileIndex* index) {
+    return index ? index->live_count : 0;
+}
+
+static int file_index_entry_compare(const void* a, const void* b) {
+    const FileIndexEntry* left = *(const FileIndexEntry* const*)a;
+    const FileIndexEntry* right = *(const FileIndexEntry* const*)b;
+    return strcmp(left->path, right->path);
+}
+
+int file_index_save(FileIndex* index) {
+    if (!index) {
+        return -1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    // Overlay records in path order, ready to merge with the mapped ones
+    size_t overlay_count = 0;
+    FileIndexEntry** overlay = (FileIndexEntry**)malloc(
+        (index->entry_count ? index->entry_count : 1) * sizeof(FileIndexEntry*));
+    FileIndexRecord* records = (FileIndexRecord*)malloc(
+        (index->live_count ? index->live_count : 1) * sizeof(FileIndexRecord));
+    size_t strings_capacity = 4096;
+    size_t strings_size = 0;
+    char* strings = (char*)malloc(strings_capacity);
+    if (!overlay || !records || !strings) {
+        free(overlay);
+        free(records);
+        free(strings);
+        return -1;
+    }
+    // Deleted entries are kept so they still shadow their mapped records
+    for (size_t i = 0; i < index->capacity; i++) {
+        if (index->entries[i].path) {
+            overlay[overlay_count++] = &index->entries[i];
+        }
+    }
+    qsort(overlay, overlay_count, sizeof(FileIndexEntry*), file_index_entry_compare);
+
+    size_t mapped_count = index->header ? (size_t)index->header->count : 0;
+    size_t mapped = 0;
+    size_t next = 0;
+    size_t count = 0;
+    bool ok = true;
+
+    while (ok && (mapped < mapped_count || next < overlay_count)) {
+        const char* path;
+        size_t path_len;
+        FileIndexRecord record;
+
+        const FileIndexRecord* disk = mapped < mapped_count ? &index->records[mapped] : NULL;
+        if (disk && (disk->path_offset > index->header->strings_size ||
+                     disk->path_len > index->header->strings_size - disk->path_offset)) {
+            // Corrupt record; drop it rather than the whole index
+            mapped++;
+            continue;
+        }
+        const char* disk_path = disk ? index->strings + disk->path_offset : NULL;
+
+        int order;
+        if (!disk) {
+            order = 1;
+        } else if (next == overlay_count) {
+            order = -1;
+        } else {
+            const char* other = overlay[next]->path;
+            size_t other_len = overlay[next]->path_len;
+            size_t common = disk->path_len < other_len ? disk->path_len : other_len;
+            order = memcmp(disk_path, other, common);
+            if (order == 0) {
+                order = (disk->path_len > other_len) - (disk->path_len < other_len);
+            }
+        }
+
+        // A mapped record shadowed by the overlay is replaced or deleted
+        if (order == 0) {
+            mapped++;
+        }
+        if (order >= 0 && overlay[next]->deleted) {
+            next++;
+            continue;
+        }
+
+        if (order < 0) {
+            record = *disk;
+            path = disk_path;
+            path_len = disk->path_len;
+            mapped++;
+        } else {
+            record = overlay[next]->record;
+            path = overlay[next]->path;
+            path_len = overlay[next]->path_len;
+            next++;
+        }
+
+        while (strings_size + path_len > strings_capacity) {
+            strings_capacity *= 2;
+            char* grown = (char*)realloc(strings, strings_capacity);
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            strings = grown;
+        }
+        if (!ok || count == index->live_count) {
+            ok = false;
+            break;
+        }
+
+        memcpy(strings + strings_size, path, path_len);
+        record.path_offset = strings_size;
+        record.path_len = (uint32_t)path_len;
+        record.reserved = 0;
+        strings_size += path_len;
+        records[count++] = record;
+    }
+
+    AtomicFile atomic;
+    ok = ok && atomic_file_open(&atomic, index->path, 0666) == 0;
+    if (ok) {
+        FileIndexHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, FILE_INDEX_MAGIC, sizeof(header.magic));
+        header.version = FILE_INDEX_VERSION;
+        header.record_size = sizeof(FileIndexRecord);
+        header.count = count;
+        header.strings_size = strings_size;
+        header.written_sec = (int64_t)now.tv_sec;
+        header.written_nsec = (int64_t)now.tv_nsec;
+
+        FILE* file = atomic_file_stream(&atomic);
+        ok = file && fwrite(&header, sizeof(header), 1, file) == 1 &&
+             (count == 0 || fwrite(records, sizeof(FileIndexRecord), count, file) == count) &&
+             (strings_size == 0 || fwrite(strings, 1, strings_size, file) == strings_size);
+        ok = atomic_file_close(&atomic, ok) == 0;
+    }
+
+    free(overlay);
+    free(records);
+    free(strings);
+    if (!ok) {
+        return -1;
+    }
+
+    // The saved file is now the base; start a fresh overlay over it
+    file_index_unmap(index);
+    file_index_clear_overlay(index);
+    index->live_count = 0;
+    file_index_map(index);
+    return 0;
+}
+
+void file_index_close(FileIndex* index) {
+    if (!index) {
+        return;
+    }
+
+    file_index_unmap(index);
+    file_index_clear_overlay(index);
+    free(index->entries);
+    free(index->path);
+    free(index);
+}
@@ -0,0 +1,403 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "file_scan.h"
+
+// Inputs per chunk when the pool picks its own grain would be too coarse
+#define FILE_SCAN_BATCH_GRAIN 16
+
+// Initial capacity of shard match and segment arrays, doubled on demand
+#define FILE_SCAN_SHARD_CAPACITY 64
+
+int file_scan_map(const char* path, FileScanMapping* mapping) {
+    if (!path || !mapping) {
+        return -1;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return -1;
+    }
+
+    mapping->data = NULL;
+    mapping->size = (size_t)st.st_size;
+
+    // mmap rejects empty lengths; an empty file is simply an empty view
+    if (mapping->size > 0) {
+        void* data = mmap(NULL, mapping->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+#ifdef MADV_SEQUENTIAL
+        madvise(data, mapping->size, MADV_SEQUENTIAL);
+#endif
+        mapping->data = (const char*)data;
+    }
+
+    // The mapping keeps the file referenced on its own
+    close(fd);
+    return 0;
+}
+
+void file_scan_unmap(FileScanMapping* mapping) {
+    if (!mapping) {
+        return;
+    }
+
+    if (mapping->data) {
+        munmap((void*)mapping->data, mapping->size);
+    }
+    mapping->data = NULL;
+    mapping->size = 0;
+}
+
+/**
+ * Tags matches with their source file and remembers when the sink stops
+ */
+typedef struct {
+    TrieDagMatchFn fn;
+    void* ctx;
+    const char* source;
+    bool stopped;
+} FileScanForward;
+
+static bool file_scan_forward(const TrieDagMatch* match, void* ctx) {
+    FileScanForward* forward = (FileScanForward*)ctx;
+    TrieDagMatch tagged = *match;
+    tagged.source = forward->source;
+
+    if (!forward->fn(&tagged, forward->ctx)) {
+        forward->stopped = true;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Map, scan and unmap one file
+ */
+static long file_scan_file(const TrieScanner* scanner, const char* path,
+                           FileScanForward* forward) {
+    FileScanMapping mapping;
+    if (file_scan_map(path, &mapping) != 0) {
+        return -1;
+    }
+
+    forward->source = path;
+    long delivered = trie_dag_scan_with(scanner, mapping.data ? mapping.data : "",
+                                        mapping.size, file_scan_forward, forward);
+    file_scan_unmap(&mapping);
+    return delivered;
+}
+
+long file_scan_path(const TrieScanner* scanner, const char* path,
+                    TrieDagMatchFn fn, void* ctx) {
+    if (!scanner || !path || !fn) {
+        return -1;
+    }
+
+    FileScanForward forward = { fn, ctx, path, false };
+    return file_scan_file(scanner, path, &forward);
+}
+
+static int file_scan_skip_dots(const struct dirent* entry) {
+    const char* name = entry->d_name;
+    return !(name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')));
+}
+
+/**
+ * Depth-first walk in sorted order; returns false once the sink stops
+ */
+static bool file_scan_walk(const TrieScanner* scanner, const char* dir,
+                           const FileScanOptions* options, FileScanForward* forward,
+                           long* total) {
+    struct dirent** entries = NULL;
+    int count = scandir(dir, &entries, file_scan_skip_dots, alphasort);
+    if (count < 0) {
+        return true;
+    }
+
+    size_t dir_len = strlen(dir);
+    bool running = true;
+
+    for (int i = 0; i < count; i++) {
+        struct dirent* entry = entries[i];
+        if (!running) {
+            free(entry);
+            continue;
+        }
+
+        size_t name_len = strlen(entry->d_name);
+        char* path = (char*)malloc(dir_len + name_len + 2);
+        if (!path) {
+            free(entry);
+            continue;
+        }
+        memcpy(path, dir, dir_len);
+        path[dir_len] = '/';
+        memcpy(path + dir_len + 1, entry->d_name, name_len + 1);
+
+        // d_type saves a stat per entry where the file system reports it
+        bool is_dir = false;
+        bool is_file = false;
+        if (entry->d_type == DT_UNKNOWN) {
+            struct stat st;
+            if (lstat(path, &st) == 0) {
+                is_dir = S_ISDIR(st.st_mode);
+                is_file = S_ISREG(st.st_mode);
+            }
+        } else {
+            is_dir = entry->d_type == DT_DIR;
+            is_file = entry->d_type == DT_REG;
+        }
+
+        if ((is_dir || is_file) &&
+            (!options->filter || options->filter(path, is_dir, options->filter_ctx))) {
+            if (is_dir) {
+                running = file_scan_walk(scanner, path, options, forward, total);
+            } else {
+                long delivered = file_scan_file(scanner, path, forward);
+                if (delivered > 0) {
+                    *total += delivered;
+                }
+                running = !forward->stopped;
+            }
+        }
+
+        free(path);
+        free(entry);
+    }
+
+    free(entries);
+    return running;
+}
+
+long file_scan_tree(const TrieScanner* scanner, const char* root,
+                    const FileScanOptions* options, TrieDagMatchFn fn, void* ctx) {
+    if (!scanner || !root || !fn) {
+        return -1;
+    }
+
+    FileScanOptions defaults = { NULL, NULL };
+    if (!options) {
+        options = &defaults;
+    }
+
+    struct stat st;
+    if (stat(root, &st) != 0) {
+        return -1;
+    }
+
+    FileScanForward forward = { fn, ctx, NULL, false };
+    if (S_ISREG(st.st_mode)) {
+        return file_scan_file(scanner, root, &forward);
+    }
+    if (!S_ISDIR(st.st_mode) || access(root, R_OK | X_OK) != 0) {
+        return -1;
+    }
+
+    long total = 0;
+    file_scan_walk(scanner, root, options, &forward, &total);
+    return total;
+}
+
+/**
+ * Matches of one contiguous run of inputs within a shard
+ */
+typedef struct {
+    size_t first_input;
+    size_t worker;              // Shard holding the matches
+    size_t match_begin;
+    size_t match_end;
+} FileScanSegment;
+
+/**
+ * Worker-local match categories; only the owning worker writes to it
+ *
+ * Nodes are only created when the shards are merged, on the calling
+ * thread, so they can come from the graph's allocator.
+ */
+typedef struct {
+    uint8_t* categories;
+    size_t match_count;
+    size_t match_capacity;
+    FileScanSegment* segments;
+    size_t segment_count;
+    size_t segment_capacity;
+    bool failed;
+} FileScanShard;
+
+typedef struct {
+    const TrieScanner* scanner;
+    const FileScanInput* inputs;
+    FileScanShard* shards;
+    atomic_bool failed;
+} FileScanBatch;
+
+static bool file_scan_shard_append(const TrieDagMatch* match, void* ctx) {
+    FileScanShard* shard = (FileScanShard*)ctx;
+
+    if (shard->match_count == shard->match_capacity) {
+        size_t capacity = shard->match_capacity ? shard->match_capacity * 2
+                                                : FILE_SCAN_SHARD_CAPACITY;
+        uint8_t* categories = (uint8_t*)realloc(shard->categories, capacity);
+        if (!categories) {
+            shard->failed = true;
+            return false;
+        }
+        shard->categories = categories;
+        shard->match_capacity = capacity;
+    }
+
+    shard->categories[shard->match_count++] = (uint8_t)match->category;
+    return true;
+}
+
+static void file_scan_batch_range(void* ctx, size_t begin, size_t end, size_t worker) {
+    FileScanBatch* batch = (FileScanBatch*)ctx;
+    FileScanShard* shard = &batch->shards[worker];
+
+    if (shard->segment_count == shard->segment_capacity) {
+        size_t capacity = shard->segment_capacity ? shard->segment_capacity * 2
+                                                  : FILE_SCAN_SHARD_CAPACITY;
+        FileScanSegment* segments = (FileScanSegment*)realloc(
+            shard->segments, capacity * sizeof(FileScanSegment));
+        if (!segments) {
+            atomic_store_explicit(&batch->failed, true, memory_order_relaxed);
+            return;
+        }
+        shard->segments = segments;
+        shard->segment_capacity = capacity;
+    }
+
+    FileScanSegment* segment = &shard->segments[shard->segment_count++];
+    segment->first_input = begin;
+    segment->worker = worker;
+    segment->match_begin = shard->match_count;
+
+    for (size_t i = begin; i < end && !shard->failed; i++) {
+        const FileScanInput* input = &batch->inputs[i];
+        if (input->text) {
+            trie_dag_scan_with(batch->scanner, input->text, input->len,
+                               file_scan_shard_append, shard);
+        } else if (input->path) {
+            file_scan_path(batch->scanner, input->path, file_scan_shard_append, shard);
+        }
+    }
+
+    segment->match_end = shard->match_count;
+    if (shard->failed) {
+        atomic_store_explicit(&batch->failed, true, memory_order_relaxed);
+    }
+}
+
+static int file_scan_segment_compare(const void* a, const void* b) {
+    const FileScanSegment* left = *(const FileScanSegment* const*)a;
+    const FileScanSegment* right = *(const FileScanSegment* const*)b;
+    return (left->first_input > right->first_input) - (left->first_input < right->first_input);
+}
+
+/**
+ * Turn the shards into nodes in input order, adding all of them or none
+ */
+static long file_scan_batch_merge(const FileScanBatch* batch, FileScanSegment** order,
+                                  size_t segment_count, DAGGraph* graph) {
+    size_t total = 0;
+    for (size_t s = 0; s < segment_count; s++) {
+        total += order[s]->match_end - order[s]->match_begin;
+    }
+
+    // Create every node first; once the graph has room, adding cannot fail
+    DAGNode** nodes = (DAGNode**)malloc((total ? total : 1) * sizeof(DAGNode*));
+    if (!nodes) {
+        return -1;
+    }
+    size_t created = 0;
+    bool failed = false;
+    for (size_t s = 0; s < segment_count && !failed; s++) {
+        const FileScanShard* shard = &batch->shards[order[s]->worker];
+        for (size_t i = order[s]->match_begin; i < order[s]->match_end && !failed; i++) {
+            DAGNode* node = dag_node_create_in(graph->allocator, TOKEN_STRING,
+                                               (TaxonomyCategory)shard->categories[i]);
+            failed = !node;
+            if (node) {
+                nodes[created++] = node;
+            }
+        }
+    }
+
+    if (failed || dag_graph_reserve(graph, graph->node_count + total) != 0) {
+        for (size_t i = 0; i < created; i++) {
+            dag_node_free(nodes[i]);
+        }
+        free(nodes);
+        return -1;
+    }
+
+    for (size_t i = 0; i < total; i++) {
+        dag_graph_add_node(graph, nodes[i]);
+    }
+    free(nodes);
+    return (long)total;
+}
+
+long file_scan_batch(const TrieScanner* scanner, const FileScanInput* inputs, size_t count,
+                     ThreadPool* pool, DAGGraph* graph) {
+    if (!scanner || (!inputs && count > 0) || !graph) {
+        return -1;
+    }
+
+    size_t workers = thread_pool_size(pool);
+    FileScanBatch batch;
+    batch.scanner = scanner;
+    batch.inputs = inputs;
+    batch.shards = (FileScanShard*)calloc(workers, sizeof(FileScanShard));
+    atomic_init(&batch.failed, false);
+    if (!batch.shards) {
+        return -1;
+    }
+
+    thread_pool_parallel_for(pool, count, FILE_SCAN_BATCH_GRAIN,
+                             file_scan_batch_range, &batch);
+
+    // Chunks start at distinct inputs, so sorting the segments restores input order
+    size_t segment_count = 0;
+    for (size_t w = 0; w < workers; w++) {
+        segment_count += batch.shards[w].segment_count;
+    }
+    FileScanSegment** order = (FileScanSegment**)malloc(
+        (segment_count ? segment_count : 1) * sizeof(FileScanSegment*));
+
+    long added = -1;
+    if (order && !atomic_load(&batch.failed)) {
+        size_t n = 0;
+        for (size_t w = 0; w < workers; w++) {
+            for (size_t s = 0; s < batch.shards[w].segment_count; s++) {
+                order[n++] = &batch.shards[w].segments[s];
+            }
+        }
+        qsort(order, segment_count, sizeof(FileScanSegment*), file_scan_segment_compare);
+
+        added = file_scan_batch_merge(&batch, order, segment_count, graph);
+    }
+
+    for (size_t w = 0; w < workers; w++) {
+        free(batch.shards[w].categories);
+        free(batch.shards[w].segments);
+    }
+    free(batch.shards);
+    free(order);
+    return added;
+}
@@ -0,0 +1,624 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "xml_reader.h"
+
+// Smallest window that still holds every fixed markup prefix
+#define XML_READER_MIN_BUFFER 256
+
+struct XmlReader {
+    // Input: a file descriptor, or a caller-owned buffer when fd < 0
+    int fd;
+    const char* source;
+    size_t source_len;
+    size_t source_pos;
+
+    // Window over the input; bytes before start are consumed
+    char* buffer;
+    size_t capacity;
+    size_t start;
+    size_t end;
+    bool eof;
+
+    size_t line;                // Line at the start of the window
+    size_t event_line;
+    const char* error;
+    bool finished;
+    XmlEventType final;
+
+    XmlAttribute attributes[XML_READER_MAX_ATTRIBUTES];
+
+    // Hashes of the qualified names of the open elements
+    uint64_t stack[XML_READER_MAX_DEPTH];
+    size_t depth;
+    bool seen_root;
+
+    // End event owed for an empty-element tag
+    bool pending_end;
+    XmlSpan pending_prefix;
+    XmlSpan pending_name;
+};
+
+static XmlReader* xml_reader_alloc(size_t buffer_size) {
+    if (buffer_size == 0) {
+        buffer_size = XML_READER_BUFFER_SIZE;
+    }
+    if (buffer_size < XML_READER_MIN_BUFFER) {
+        buffer_size = XML_READER_MIN_BUFFER;
+    }
+
+    XmlReader* reader = (XmlReader*)calloc(1, sizeof(XmlReader));
+    if (!reader) {
+        return NULL;
+    }
+    reader->buffer = (char*)malloc(buffer_size);
+    if (!reader->buffer) {
+        free(reader);
+        return NULL;
+    }
+    reader->capacity = buffer_size;
+    reader->fd = -1;
+    reader->line = 1;
+    reader->event_line = 1;
+    return reader;
+}
+
+XmlReader* xml_reader_open(const char* path, size_t buffer_size) {
+    if (!path) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    XmlReader* reader = xml_reader_alloc(buffer_size);
+    if (!reader) {
+        close(fd);
+        return NULL;
+    }
+    reader->fd = fd;
+    return reader;
+}
+
+XmlReader* xml_reader_create(const char* text, size_t len, size_t buffer_size) {
+    if (!text && len > 0) {
+        return NULL;
+    }
+
+    XmlReader* reader = xml_reader_alloc(buffer_size);
+    if (reader) {
+        reader->source = text;
+        reader->source_len = len;
+    }
+    return reader;
+}
+
+/**
+ * Move unconsumed bytes to the front and read more behind them
+ * Returns 1 if bytes were added, 0 at end of input, -1 on failure
+ */
+static int xml_reader_fill(XmlReader* reader) {
+    if (reader->eof) {
+        return 0;
+    }
+
+    if (reader->start > 0) {
+        memmove(reader->buffer, reader->buffer + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+    if (reader->end == reader->capacity) {
+        reader->error = "token exceeds the read window";
+        return -1;
+    }
+
+    size_t room = reader->capacity - reader->end;
+    if (reader->fd < 0) {
+        size_t left = reader->source_len - reader->source_pos;
+        size_t take = left < room ? left : room;
+        memcpy(reader->buffer + reader->end, reader->source + reader->source_pos, take);
+        reader->source_pos += take;
+        reader->end += take;
+        reader->eof = reader->source_pos == reader->source_len;
+        return take > 0 ? 1 : 0;
+    }
+
+    for (;;) {
+        ssize_t got = read(reader->fd, reader->buffer + reader->end, room);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            reader->error = "read failed";
+            return -1;
+        }
+        if (got == 0) {
+            reader->eof = true;
+            return 0;
+        }
+        reader->end += (size_t)got;
+        return 1;
+    }
+}
+
+/**
+ * Find a delimiter in the unconsumed window, starting @p from bytes in
+ * Returns its offset from the window start, or -1 if it is not there yet
+ */
+static long xml_reader_find(const XmlReader* reader, size_t from, const char* delimiter) {
+    const char* base = reader->buffer + reader->start;
+    size_t available = reader->end - reader->start;
+    size_t len = strlen(delimiter);
+
+    while (from + len <= available) {
+        const char* hit = (const char*)memchr(base + from, delimiter[0], available - from - len + 1);
+        if (!hit) {
+            return -1;
+        }
+        if (memcmp(hit, delimiter, len) == 0) {
+            return (long)(hit - base);
+        }
+        from = (size_t)(hit - base) + 1;
+    }
+    return -1;
+}
+
+/**
+ * Find the '>' closing a start tag, skipping quoted attribute values
+ */
+static long xml_reader_find_tag_end(const XmlReader* reader) {
+    const char* base = reader->buffer + reader->start;
+    size_t available = reader->end - reader->start;
+    char quote = 0;
+
+    for (size_t i = 1; i < available; i++) {
+        if (quote) {
+            if (base[i] == quote) {
+                quote = 0;
+            }
+        } else if (base[i] == '"' || base[i] == '\'') {
+            quote = base[i];
+        } else if (base[i] == '>') {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Consume a token, counting the lines it spans
+ */
+static char* xml_reader_consume(XmlReader* reader, size_t len) {
+    char* token = reader->buffer + reader->start;
+    reader->event_line = reader->line;
+    for (const char* p = token; (p = (const char*)memchr(p, '\n', (size_t)(token + len - p)));
+         p++) {
+        reader->line++;
+    }
+    reader->start += len;
+    return token;
+}
+
+static bool xml_is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static size_t xml_encode_utf8(unsigned long code, char* out) {
+    if (code < 0x80) {
+        out[0] = (char)code;
+        return 1;
+    }
+    if (code < 0x800) {
+        out[0] = (char)(0xc0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3f));
+        return 2;
+    }
+    if (code < 0x10000) {
+        out[0] = (char)(0xe0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (code & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (code & 0x3f));
+    return 4;
+}
+
+/**
+ * Decode entity and character references in place; the result is never
+ * longer than the input
+ */
+static bool xml_decode(char* text, size_t* len) {
+    static const struct {
+        const char* name;
+        char value;
+    } entities[] = {
+        { "lt", '<' }, { "gt", '>' }, { "amp", '&' }, { "quot", '"' }, { "apos", '\'' }
+    };
+
+    size_t in = 0;
+    size_t out = 0;
+    while (in < *len) {
+        if (text[in] != '&') {
+            text[out++] = text[in++];
+            continue;
+        }
+
+        const char* semicolon = (const char*)memchr(text + in, ';', *len - in);
+        if (!semicolon) {
+            return false;
+        }
+        const char* name = text + in + 1;
+        size_t name_len = (size_t)(semicolon - name);
+
+        if (name_len > 1 && name[0] == '#') {
+            bool hex = name[1] == 'x';
+            size_t digits = hex ? 2 : 1;
+            if (digits == name_len) {
+                return false;
+            }
+            unsigned long code = 0;
+            for (size_t i = digits; i < name_len; i++) {
+                char c = name[i];
+                int digit;
+                if (c >= '0' && c <= '9') {
+                    digit = c - '0';
+                } else if (hex && c >= 'a' && c <= 'f') {
+                    digit = c - 'a' + 10;
+                } else if (hex && c >= 'A' && c <= 'F') {
+                    digit = c - 'A' + 10;
+                } else {
+                    return false;
+                }
+                code = code * (hex ? 16 : 10) + (unsigned long)digit;
+                if (code > 0x10ffff) {
+                    return false;
+                }
+            }
+            if (code == 0 || (code >= 0xd800 && code <= 0xdfff)) {
+                return false;
+            }
+            out += xml_encode_utf8(code, text + out);
+        } else {
+            size_t i = 0;
+            size_t count = sizeof(entities) / sizeof(entities[0]);
+            while (i < count && !(strlen(entities[i].name) == name_len &&
+                                  memcmp(entities[i].name, name, name_len) == 0)) {
+                i++;
+            }
+            if (i == count) {
+                return false;
+            }
+            text[out++] = entities[i].value;
+        }
+        in = (size_t)(semicolon - text) + 1;
+    }
+
+    *len = out;
+    return true;
+}
+
+static uint64_t xml_name_hash(const char* name, size_t len) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ (unsigned char)name[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Split a qualified name at its first colon
+ */
+static void xml_split_name(const char* name, size_t len, XmlSpan* prefix, XmlSpan* local) {
+    const char* colon = (const char*)memchr(name, ':', len);
+    if (colon) {
+        prefix->data = name;
+        prefix->len = (size_t)(colon - name);
+        local->data = colon + 1;
+        local->len = len - prefix->len - 1;
+    } else {
+        prefix->data = name;
+        prefix->len = 0;
+        local->data = name;
+        local->len = len;
+    }
+}
+
+static XmlEventType xml_reader_fail(XmlReader* reader, XmlEvent* event, const char* error) {
+    if (!reader->error) {
+        reader->error = error;
+    }
+    reader->finished = true;
+    reader->final = XML_EVENT_ERROR;
+    event->type = XML_EVENT_ERROR;
+    return XML_EVENT_ERROR;
+}
+
+/**
+ * Parse a start tag spanning tag[0..len], '<' and '>' included
+ */
+static XmlEventType xml_reader_start_tag(XmlReader* reader, char* tag, size_t len,
+                                         XmlEvent* event) {
+    size_t end = len - 1;
+    size_t i = 1;
+    while (i < end && !xml_is_space(tag[i]) && tag[i] != '/') {
+        i++;
+    }
+    if (i == 1) {
+        return xml_reader_fail(reader, event, "missing element name");
+    }
+    size_t name_len = i - 1;
+
+    bool empty = false;
+    size_t count = 0;
+    for (;;) {
+        while (i < end && xml_is_space(tag[i])) {
+            i++;
+        }
+        if (i == end) {
+            break;
+        }
+        if (tag[i] == '/') {
+            if (i + 1 != end) {
+                return xml_reader_fail(reader, event, "malformed empty-element tag");
+            }
+            empty = true;
+            break;
+        }
+
+        size_t attr_start = i;
+        while (i < end && tag[i] != '=' && !xml_is_space(tag[i])) {
+            i++;
+        }
+        size_t attr_len = i - attr_start;
+        while (i < end && xml_is_space(tag[i])) {
+            i++;
+        }
+        if (attr_len == 0 || i == end || tag[i] != '=') {
+            return xml_reader_fail(reader, event, "malformed attribute");
+        }
+        i++;
+        while (i < end && xml_is_space(tag[i])) {
+            i++;
+        }
+        if (i == end || (tag[i] != '"' && tag[i] != '\'')) {
+            return xml_reader_fail(reader, event, "unquoted attribute value");
+        }
+        char quote = tag[i++];
+        const char* close = (const char*)memchr(tag + i, quote, end - i);
+        if (!close) {
+            return xml_reader_fail(reader, event, "unterminated attribute value");
+        }
+        size_t value_len = (size_t)(close - (tag + i));
+        if (memchr(tag + i, '<', value_len) || !xml_decode(tag + i, &value_len)) {
+            return xml_reader_fail(reader, event, "invalid attribute value");
+        }
+        if (count == XML_READER_MAX_ATTRIBUTES) {
+            return xml_reader_fail(reader, event, "too many attributes");
+        }
+
+        XmlAttribute* attribute = &reader->attributes[count++];
+        xml_split_name(tag + attr_start, attr_len, &attribute->prefix, &attribute->name);
+        attribute->value.data = tag + i;
+        attribute->value.len = value_len;
+        i = (size_t)(close - tag) + 1;
+    }
+
+    if (reader->depth == 0 && reader->seen_root) {
+        return xml_reader_fail(reader, event, "content after the root element");
+    }
+    if (reader->depth == XML_READER_MAX_DEPTH) {
+        return xml_reader_fail(reader, event, "elements nested too deeply");
+    }
+    reader->stack[reader->depth++] = xml_name_hash(tag + 1, name_len);
+    reader->seen_root = true;
+
+    event->type = XML_EVENT_START;
+    xml_split_name(tag + 1, name_len, &event->prefix, &event->name);
+    event->attributes = reader->attributes;
+    event->attribute_count = count;
+    event->depth = reader->depth;
+
+    if (empty) {
+        reader->pending_end = true;
+        reader->pending_prefix = event->prefix;
+        reader->pending_name = event->name;
+    }
+    return XML_EVENT_START;
+}
+
+/**
+ * Parse an end tag spanning tag[0..len]
+ */
+static XmlEventType xml_reader_end_tag(XmlReader* reader, char* tag, size_t len,
+                                       XmlEvent* event) {
+    size_t end = len - 1;
+    size_t i = 2;
+    while (i < end && !xml_is_space(tag[i])) {
+        i++;
+    }
+    size_t name_len = i - 2;
+    while (i < end && xml_is_space(tag[i])) {
+        i++;
+    }
+    if (name_len == 0 || i != end) {
+        return xml_reader_fail(reader, event, "malformed end tag");
+    }
+    if (reader->depth == 0 ||
+        reader->stack[reader->depth - 1] != xml_name_hash(tag + 2, name_len)) {
+        return xml_reader_fail(reader, event, "mismatched end tag");
+    }
+
+    event->type = XML_EVENT_END;
+    xml_split_name(tag + 2, name_len, &event->prefix, &event->name);
+    event->attributes = NULL;
+    event->attribute_count = 0;
+    event->depth = reader->depth--;
+    return XML_EVENT_END;
+}
+
+XmlEventType xml_reader_next(XmlReader* reader, XmlEvent* event) {
+    if (!reader || !event) {
+        return XML_EVENT_ERROR;
+    }
+    memset(event, 0, sizeof(*event));
+    if (reader->finished) {
+        event->type = reader->final;
+        return reader->final;
+    }
+
+    if (reader->pending_end) {
+        reader->pending_end = false;
+        event->type = XML_EVENT_END;
+        event->prefix = reader->pending_prefix;
+        event->name = reader->pending_name;
+        event->depth = reader->depth--;
+        return XML_EVENT_END;
+    }
+
+    for (;;) {
+        size_t available = reader->end - reader->start;
+
+        // Enough bytes to tell every markup prefix apart, or the tail of the input
+        if (available < 9 && !reader->eof) {
+            if (xml_reader_fill(reader) < 0) {
+                return xml_reader_fail(reader, event, "read failed");
+            }
+            continue;
+        }
+        if (available == 0) {
+            if (reader->depth > 0) {
+                return xml_reader_fail(reader, event, "unexpected end of document");
+            }
+            if (!reader->seen_root) {
+                return xml_reader_fail(reader, event, "no root element");
+            }
+            reader->finished = true;
+            reader->final = XML_EVENT_EOF;
+            event->type = XML_EVENT_EOF;
+            return XML_EVENT_EOF;
+        }
+
+        const char* base = reader->buffer + reader->start;
+        long close;
+        size_t skip;
+
+        if (base[0] != '<') {
+            close = xml_reader_find(reader, 0, "<");
+            if (close < 0 && !reader->eof) {
+                if (xml_reader_fill(reader) < 0) {
+                    return xml_reader_fail(reader, event, "read failed");
+                }
+                continue;
+            }
+
+            size_t len = close < 0 ? available : (size_t)close;
+            char* text = xml_reader_consume(reader, len);
+            if (reader->depth == 0) {
+                for (size_t i = 0; i < len; i++) {
+                    if (!xml_is_space(text[i])) {
+                        return xml_reader_fail(reader, event, "text outside the root element");
+                    }
+                }
+                continue;
+            }
+            if (!xml_decode(text, &len)) {
+                return xml_reader_fail(reader, event, "invalid entity reference");
+            }
+            event->type = XML_EVENT_TEXT;
+            event->text.data = text;
+            event->text.len = len;
+            event->depth = reader->depth;
+            return XML_EVENT_TEXT;
+        }
+
+        // Markup: find where the token ends before deciding what it is
+        bool comment = available >= 4 && memcmp(base, "<!--", 4) == 0;
+        bool cdata = available >= 9 && memcmp(base, "<![CDATA[", 9) == 0;
+        if (comment) {
+            close = xml_reader_find(reader, 4, "-->");
+            skip = 3;
+        } else if (cdata) {
+            close = xml_reader_find(reader, 9, "]]>");
+            skip = 3;
+        } else if (available >= 2 && base[1] == '?') {
+            close = xml_reader_find(reader, 2, "?>");
+            skip = 2;
+        } else if (available >= 2 && (base[1] == '!' || base[1] == '/')) {
+            close = xml_reader_find(reader, 2, ">");
+            skip = 1;
+        } else {
+            close = xml_reader_find_tag_end(reader);
+            skip = 1;
+        }
+
+        if (close < 0) {
+            if (reader->eof) {
+                return xml_reader_fail(reader, event, "unterminated markup");
+            }
+            if (xml_reader_fill(reader) < 0) {
+                return xml_reader_fail(reader, event, "read failed");
+            }
+            continue;
+        }
+
+        size_t len = (size_t)close + skip;
+        char* token = xml_reader_consume(reader, len);
+
+        if (comment || token[1] == '?') {
+            continue;
+        }
+        if (cdata) {
+            if (reader->depth == 0) {
+                return xml_reader_fail(reader, event, "text outside the root element");
+            }
+            event->type = XML_EVENT_TEXT;
+            event->text.data = token + 9;
+            event->text.len = len - 12;
+            event->depth = reader->depth;
+            return XML_EVENT_TEXT;
+        }
+        if (token[1] == '!') {
+            // Document type declarations are skipped; internal subsets are not supported
+            if (memchr(token, '[', len) || reader->seen_root) {
+                return xml_reader_fail(reader, event, "unsupported markup declaration");
+            }
+            continue;
+        }
+        if (token[1] == '/') {
+            return xml_reader_end_tag(reader, token, len, event);
+        }
+        return xml_reader_start_tag(reader, token, len, event);
+    }
+}
+
+size_t xml_reader_line(const XmlReader* reader) {
+    return reader ? reader->event_line : 0;
+}
+
+const char* xml_reader_error(const XmlReader* reader) {
+    return reader ? reader->error : NULL;
+}
+
+bool xml_span_equals(XmlSpan span, const char* text) {
+    return strlen(text) == span.len && memcmp(span.data, text, span.len) == 0;
+}
+
+void xml_reader_close(XmlReader* reader) {
+    if (!reader) {
+        return;
+    }
+    if (reader->fd >= 0) {
+        close(reader->fd);
+    }
+    free(reader->buffer);
+    free(reader);
+}
@@ -0,0 +1,254 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "arena.h"
+
+// Default size of each arena block
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+// Every allocation is aligned for any fundamental type
+#define ARENA_ALIGNMENT (sizeof(max_align_t))
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;
+    size_t used;
+    max_align_t data[];
+} ArenaBlock;
+
+typedef struct ArenaCleanup {
+    struct ArenaCleanup* next;
+    void (*cleanup)(void*);
+    void* data;
+} ArenaCleanup;
+
+struct PolyArena {
+    PolyAllocator allocator;
+    ArenaBlock* blocks;         // Current block first
+    ArenaCleanup* cleanups;     // Most recent registration first
+    size_t block_size;
+    size_t bytes_used;
+    void* last_alloc;           // Most recent allocation, resizable in place
+};
+
+static void* heap_alloc(void* ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void* heap_resize(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    (void)ctx;
+    (void)old_size;
+    return realloc(ptr, new_size);
+}
+
+static void heap_release(void* ctx, void* ptr, size_t size) {
+    (void)ctx;
+    (void)size;
+    free(ptr);
+}
+
+static const PolyAllocator heap_allocator = {
+    heap_alloc, heap_resize, heap_release, NULL, NULL
+};
+
+const PolyAllocator* poly_allocator_default(void) {
+    return &heap_allocator;
+}
+
+void* poly_alloc(const PolyAllocator* allocator, size_t size) {
+    if (!allocator) allocator = &heap_allocator;
+    return allocator->alloc(allocator->ctx, size);
+}
+
+void* poly_calloc(const PolyAllocator* allocator, size_t size) {
+    void* ptr = poly_alloc(allocator, size);
+    if (ptr) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+void* poly_resize(const PolyAllocator* allocator, void* ptr,
+                  size_t old_size, size_t new_size) {
+    if (!allocator) allocator = &heap_allocator;
+    return allocator->resize(allocator->ctx, ptr, old_size, new_size);
+}
+
+void poly_release(const PolyAllocator* allocator, void* ptr, size_t size) {
+    if (!ptr) return;
+    if (!allocator) allocator = &heap_allocator;
+    allocator->release(allocator->ctx, ptr, size);
+}
+
+char* poly_strdup(const PolyAllocator* allocator, const char* str) {
+    if (!str) return NULL;
+    size_t len = strlen(str) + 1;
+    char* copy = (char*)poly_alloc(allocator, len);
+    if (copy) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+/**
+ * Allocator adapters that forward to the owning arena
+ */
+static void* arena_alloc_cb(void* ctx, size_t size) {
+    return poly_arena_alloc((PolyArena*)ctx, size);
+}
+
+static void* arena_resize_cb(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    PolyArena* arena = (PolyArena*)ctx;
+
+    // The newest allocation can usually grow in place
+    if (ptr && ptr == arena->last_alloc) {
+        ArenaBlock* block = arena->blocks;
+        size_t offset = (size_t)((char*)ptr - (char*)block->data);
+        size_t aligned = (new_size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+        if (aligned >= new_size && offset + aligned <= block->size) {
+            block->used = offset + aligned;
+            arena->bytes_used += new_size > old_size ? new_size - old_size : 0;
+            return ptr;
+        }
+    }
+
+    void* grown = poly_arena_alloc(arena, new_size);
+    if (grown && ptr) {
+        memcpy(grown, ptr, old_size < new_size ? old_size : new_size);
+    }
+    return grown;
+}
+
+static void arena_release_cb(void* ctx, void* ptr, size_t size) {
+    // Individual objects live until the arena is reset
+    (void)ctx;
+    (void)ptr;
+    (void)size;
+}
+
+static int arena_defer_cb(void* ctx, void (*cleanup)(void*), void* data) {
+    return poly_arena_defer((PolyArena*)ctx, cleanup, data);
+}
+
+static ArenaBlock* arena_block_create(size_t size) {
+    ArenaBlock* block = (ArenaBlock*)malloc(sizeof(ArenaBlock) + size);
+    if (block) {
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+    }
+    return block;
+}
+
+PolyArena* poly_arena_create(size_t block_size) {
+    PolyArena* arena = (PolyArena*)calloc(1, sizeof(PolyArena));
+    if (!arena) {
+        return NULL;
+    }
+
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->blocks = arena_block_create(arena->block_size);
+    if (!arena->blocks) {
+        free(arena);
+        return NULL;
+    }
+
+    arena->allocator.alloc = arena_alloc_cb;
+    arena->allocator.resize = arena_resize_cb;
+    arena->allocator.release = arena_release_cb;
+    arena->allocator.defer = arena_defer_cb;
+    arena->allocator.ctx = arena;
+    return arena;
+}
+
+const PolyAllocator* poly_arena_allocator(PolyArena* arena) {
+    return arena ? &arena->allocator : NULL;
+}
+
+void* poly_arena_alloc(PolyArena* arena, size_t size) {
+    if (!arena) {
+        return NULL;
+    }
+
+    size_t aligned = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    if (aligned < size) {
+        return NULL;
+    }
+
+    ArenaBlock* block = arena->blocks;
+    if (block->size - block->used < aligned) {
+        // Oversized requests get a dedicated block
+        size_t block_size = aligned > arena->block_size ? aligned : arena->block_size;
+        block = arena_block_create(block_size);
+        if (!block) {
+            return NULL;
+        }
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    void* ptr = (char*)block->data + block->used;
+    block->used += aligned;
+    arena->bytes_used += size;
+    arena->last_alloc = ptr;
+    return ptr;
+}
+
+int poly_arena_defer(PolyArena* arena, void (*cleanup)(void*), void* data) {
+    if (!arena || !cleanup) {
+        return -1;
+    }
+
+    ArenaCleanup* entry = (ArenaCleanup*)poly_arena_alloc(arena, sizeof(ArenaCleanup));
+    if (!entry) {
+        return -1;
+    }
+
+    entry->cleanup = cleanup;
+    entry->data = data;
+    entry->next = arena->cleanups;
+    arena->cleanups = entry;
+
+    // Keep the cleanup record from being grown over
+    arena->last_alloc = NULL;
+    return 0;
+}
+
+size_t poly_arena_bytes_used(const PolyArena* arena) {
+    return arena ? arena->bytes_used : 0;
+}
+
+/**
+ * Run registered cleanups and free every block except the last (oldest)
+ */
+static void arena_release_all(PolyArena* arena) {
+    for (ArenaCleanup* entry = arena->cleanups; entry; entry = entry->next) {
+        entry->cleanup(entry->data);
+    }
+    arena->cleanups = NULL;
+
+    ArenaBlock* block = arena->blocks;
+    while (block->next) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+
+    block->used = 0;
+    arena->blocks = block;
+    arena->bytes_used = 0;
+    arena->last_alloc = NULL;
+}
+
+void poly_arena_reset(PolyArena* arena) {
+    if (!arena) return;
+    arena_release_all(arena);
+}
+
+void poly_arena_destroy(PolyArena* arena) {
+    if (!arena) return;
+    arena_release_all(arena);
+    free(arena->blocks);
+    free(arena);
+}
@@ -0,0 +1,137 @@
+/**
+ * @file arena.h
+ * @brief Pluggable allocator context and arena allocator for PolyBuild
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_ARENA_H
+#define POLYBUILD_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Allocator context used by DAG, trie and integration objects
+ *
+ * A NULL allocator pointer anywhere in the API means the heap allocator
+ * returned by poly_allocator_default().
+ */
+typedef struct PolyAllocator {
+    void* (*alloc)(void* ctx, size_t size);
+    void* (*resize)(void* ctx, void* ptr, size_t old_size, size_t new_size);
+    void (*release)(void* ctx, void* ptr, size_t size);
+    // Register cleanup run on bulk release; NULL if memory is freed per object
+    int (*defer)(void* ctx, void (*cleanup)(void*), void* data);
+    void* ctx;
+} PolyAllocator;
+
+/**
+ * @brief Bump-pointer arena that releases all of its objects at once
+ */
+typedef struct PolyArena PolyArena;
+
+/**
+ * @brief Get the malloc-backed default allocator
+ * @return Pointer to the shared default allocator
+ */
+const PolyAllocator* poly_allocator_default(void);
+
+/**
+ * @brief Allocate memory through an allocator
+ * @param allocator Allocator to draw from (NULL for the default)
+ * @param size Number of bytes
+ * @return Pointer to the memory or NULL on failure
+ */
+void* poly_alloc(const PolyAllocator* allocator, size_t size);
+
+/**
+ * @brief Allocate zeroed memory through an allocator
+ * @param allocator Allocator to draw from (NULL for the default)
+ * @param size Number of bytes
+ * @return Pointer to the zeroed memory or NULL on failure
+ */
+void* poly_calloc(const PolyAllocator* allocator, size_t size);
+
+/**
+ * @brief Resize memory obtained from an allocator
+ * @param allocator Allocator the memory came from (NULL for the default)
+ * @param ptr Existing block or NULL
+ * @param old_size Current size of the block
+ * @param new_size Requested size
+ * @return Pointer to the resized block or NULL on failure (block intact)
+ */
+void* poly_resize(const PolyAllocator* allocator, void* ptr,
+                  size_t old_size, size_t new_size);
+
+/**
+ * @brief Release memory obtained from an allocator
+ * @param allocator Allocator the memory came from (NULL for the default)
+ * @param ptr Block to release
+ * @param size Size of the block
+ */
+void poly_release(const PolyAllocator* allocator, void* ptr, size_t size);
+
+/**
+ * @brief Duplicate a string through an allocator
+ * @param allocator Allocator to draw from (NULL for the default)
+ * @param str String to copy
+ * @return Pointer to the copy or NULL on failure
+ */
+char* poly_strdup(const PolyAllocator* allocator, const char* str);
+
+/**
+ * @brief Create an arena
+ * @param block_size Size of each backing block (0 for the default)
+ * @return Pointer to the new arena or NULL on failure
+ */
+PolyArena* poly_arena_create(size_t block_size);
+
+/**
+ * @brief Get the allocator interface of an arena
+ * @param arena Arena to wrap
+ * @return Allocator drawing from the arena; valid while the arena lives
+ */
+const PolyAllocator* poly_arena_allocator(PolyArena* arena);
+
+/**
+ * @brief Allocate memory from an arena
+ * @param arena Arena to draw from
+ * @param size Number of bytes
+ * @return Pointer to maximally aligned memory or NULL on failure
+ */
+void* poly_arena_alloc(PolyArena* arena, size_t size);
+
+/**
+ * @brief Register a cleanup to run when the arena is reset or destroyed
+ *
+ * Cleanups run in reverse registration order. Used for resources the
+ * arena does not own directly, such as compiled regular expressions.
+ *
+ * @param arena Arena to attach the cleanup to
+ * @param cleanup Cleanup function
+ * @param data Argument passed to the cleanup
+ * @return 0 on success, -1 on failure
+ */
+int poly_arena_defer(PolyArena* arena, void (*cleanup)(void*), void* data);
+
+/**
+ * @brief Get the number of bytes handed out by an arena
+ * @param arena Arena to inspect
+ * @return Bytes allocated since creation or the last reset
+ */
+size_t poly_arena_bytes_used(const PolyArena* arena);
+
+/**
+ * @brief Release every object of the arena but keep its first block
+ * @param arena Arena to reset
+ */
+void poly_arena_reset(PolyArena* arena);
+
+/**
+ * @brief Release every object of the arena and the arena itself
+ * @param arena Arena to destroy
+ */
+void poly_arena_destroy(PolyArena* arena);
+
+#endif /* POLYBUILD_ARENA_H */
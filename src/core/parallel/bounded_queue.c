@@ -0,0 +1,87 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "bounded_queue.h"
+
+struct BoundedQueue {
+    void** items;               // Ring of capacity slots
+    size_t capacity;
+    size_t head;                // Index of the oldest item
+    size_t count;
+    bool closed;
+
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+};
+
+BoundedQueue* bounded_queue_create(size_t capacity) {
+    if (capacity == 0) {
+        return NULL;
+    }
+
+    BoundedQueue* queue = (BoundedQueue*)calloc(1, sizeof(BoundedQueue));
+    if (!queue) {
+        return NULL;
+    }
+    queue->items = (void**)malloc(capacity * sizeof(void*));
+    if (!queue->items || pthread_mutex_init(&queue->lock, NULL) != 0) {
+        free(queue->items);
+        free(queue);
+        return NULL;
+    }
+    pthread_cond_init(&queue->not_empty, NULL);
+    pthread_cond_init(&queue->not_full, NULL);
+    queue->capacity = capacity;
+    return queue;
+}
+
+bool bounded_queue_push(BoundedQueue* queue, void* item) {
+    pthread_mutex_lock(&queue->lock);
+    while (!queue->closed && queue->count == queue->capacity) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    }
+    bool pushed = !queue->closed;
+    if (pushed) {
+        size_t tail = queue->head + queue->count;
+        queue->items[tail < queue->capacity ? tail : tail - queue->capacity] = item;
+        queue->count++;
+        pthread_cond_signal(&queue->not_empty);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return pushed;
+}
+
+bool bounded_queue_pop(BoundedQueue* queue, void** item) {
+    pthread_mutex_lock(&queue->lock);
+    while (!queue->closed && queue->count == 0) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+    bool popped = queue->count > 0;
+    if (popped) {
+        *item = queue->items[queue->head];
+        queue->head = queue->head + 1 < queue->capacity ? queue->head + 1 : 0;
+        queue->count--;
+        pthread_cond_signal(&queue->not_full);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return popped;
+}
+
+void bounded_queue_close(BoundedQueue* queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = true;
+    pthread_cond_broadcast(&queue->not_empty);
+    pthread_cond_broadcast(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void bounded_queue_destroy(BoundedQueue* queue) {
+    if (!queue) {
+        return;
+    }
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    pthread_mutex_destroy(&queue->lock);
+    free(queue->items);
+    free(queue);
+}
@@ -0,0 +1,61 @@
+/**
+ * @file bounded_queue.h
+ * @brief Blocking fixed-capacity queue connecting pipeline stages
+ * @author OBINexus Computing
+ */
+
+#ifndef POLYBUILD_BOUNDED_QUEUE_H
+#define POLYBUILD_BOUNDED_QUEUE_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief First-in first-out queue of pointers with a fixed capacity
+ *
+ * Producers block while the queue is full and consumers while it is
+ * empty, so a fast stage cannot run arbitrarily far ahead of a slow one.
+ * Any number of threads may push and pop concurrently.
+ */
+typedef struct BoundedQueue BoundedQueue;
+
+/**
+ * @brief Create a queue
+ * @param capacity Maximum number of queued items (at least 1)
+ * @return Pointer to the new queue or NULL on failure
+ */
+BoundedQueue* bounded_queue_create(size_t capacity);
+
+/**
+ * @brief Append an item, waiting for room
+ * @param queue Queue to push onto
+ * @param item Item to append
+ * @return true if queued, false if the queue was closed
+ */
+bool bounded_queue_push(BoundedQueue* queue, void* item);
+
+/**
+ * @brief Remove the oldest item, waiting for one
+ * @param queue Queue to pop from
+ * @param item Receives the item
+ * @return true if an item was removed, false once the queue is closed
+ *         and drained
+ */
+bool bounded_queue_pop(BoundedQueue* queue, void** item);
+
+/**
+ * @brief Close the queue
+ *
+ * Further pushes fail; items already queued can still be popped.
+ *
+ * @param queue Queue to close
+ */
+void bounded_queue_close(BoundedQueue* queue);
+
+/**
+ * @brief Free a queue no thread is using
+ * @param queue Queue to destroy
+ */
+void bounded_queue_destroy(BoundedQueue* queue);
+
+#endif /* POLYBUILD_BOUNDED_QUEUE_H */
@@ -0,0 +1,215 @@
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+// Chunks handed out per worker when the caller does not choose a grain
+#define THREAD_POOL_CHUNKS_PER_WORKER 8
+
+typedef struct ThreadPoolWorker {
+    struct ThreadPool* pool;
+    size_t slot;
+    pthread_t thread;
+} ThreadPoolWorker;
+
+struct ThreadPool {
+    size_t size;
+    ThreadPoolWorker* workers;  // size - 1 background workers
+
+    pthread_mutex_t call_lock;  // Held by the one caller running a job
+    pthread_mutex_t lock;
+    pthread_cond_t start;       // Signalled when a new job is published
+    pthread_cond_t finish;      // Signalled when the last worker leaves a job
+    unsigned long generation;
+    size_t active;              // Background workers still inside the job
+    bool stopping;
+
+    // Current job
+    ThreadPoolRangeFn fn;
+    void* ctx;
+    size_t count;
+    size_t grain;
+    atomic_size_t next;
+};
+
+// Pool whose job the current thread is running, and its slot there
+static _Thread_local const ThreadPool* thread_pool_current;
+static _Thread_local size_t thread_pool_current_slot;
+
+size_t thread_pool_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t)count : 1;
+}
+
+/**
+ * Claim chunks of the current job until none are left
+ */
+static void thread_pool_run_chunks(ThreadPool* pool, size_t slot) {
+    for (;;) {
+        size_t begin = atomic_fetch_add_explicit(&pool->next, pool->grain,
+                                                 memory_order_relaxed);
+        if (begin >= pool->count) {
+            return;
+        }
+        size_t end = pool->count - begin < pool->grain ? pool->count : begin + pool->grain;
+        pool->fn(pool->ctx, begin, end, slot);
+    }
+}
+
+static void* thread_pool_worker_main(void* arg) {
+    ThreadPoolWorker* worker = (ThreadPoolWorker*)arg;
+    ThreadPool* pool = worker->pool;
+    unsigned long seen = 0;
+    thread_pool_current = pool;
+    thread_pool_current_slot = worker->slot;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stopping && pool->generation == seen) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stopping) {
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        thread_pool_run_chunks(pool, worker->slot);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) {
+            pthread_cond_signal(&pool->finish);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+ThreadPool* thread_pool_create(size_t thread_count) {
+    ThreadPool* pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->size = thread_count ? thread_count : thread_pool_cpu_count();
+    atomic_init(&pool->next, 0);
+
+    if (pthread_mutex_init(&pool->lock, NULL) != 0) {
+        free(pool);
+        return NULL;
+    }
+    if (pthread_mutex_init(&pool->call_lock, NULL) != 0) {
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->finish, NULL);
+
+    if (pool->size > 1) {
+        pool->workers = (ThreadPoolWorker*)calloc(pool->size - 1, sizeof(ThreadPoolWorker));
+        if (!pool->workers) {
+            pool->size = 1;
+            thread_pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    // A pool that could not start every thread runs with the ones it has
+    size_t started = 0;
+    for (size_t i = 0; i + 1 < pool->size; i++) {
+        ThreadPoolWorker* worker = &pool->workers[started];
+        worker->pool = pool;
+        worker->slot = started + 1;
+        if (pthread_create(&worker->thread, NULL, thread_pool_worker_main, worker) != 0) {
+            break;
+        }
+        started++;
+    }
+    pool->size = started + 1;
+
+    return pool;
+}
+
+size_t thread_pool_size(const ThreadPool* pool) {
+    return pool ? pool->size : 1;
+}
+
+void thread_pool_parallel_for(ThreadPool* pool, size_t count, size_t grain,
+                              ThreadPoolRangeFn fn, void* ctx) {
+    if (!fn || count == 0) {
+        return;
+    }
+
+    size_t size = thread_pool_size(pool);
+    if (grain == 0) {
+        grain = count / (size * THREAD_POOL_CHUNKS_PER_WORKER);
+        if (grain == 0) grain = 1;
+    }
+
+    // A loop body calling back into its own pool would overwrite the
+    // running job, so the nested loop runs inline on its thread
+    if (pool && thread_pool_current == pool) {
+        fn(ctx, 0, count, thread_pool_current_slot);
+        return;
+    }
+
+    // Not worth waking anyone for a single chunk
+    if (size == 1 || count <= grain) {
+        fn(ctx, 0, count, 0);
+        return;
+    }
+
+    // Callers on other threads take turns for the whole job
+    pthread_mutex_lock(&pool->call_lock);
+    const ThreadPool* outer = thread_pool_current;
+    size_t outer_slot = thread_pool_current_slot;
+    thread_pool_current = pool;
+    thread_pool_current_slot = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->fn = fn;
+    pool->ctx = ctx;
+    pool->count = count;
+    pool->grain = grain;
+    atomic_store_explicit(&pool->next, 0, memory_order_relaxed);
+    pool->active = size - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    thread_pool_run_chunks(pool, 0);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->finish, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    thread_pool_current = outer;
+    thread_pool_current_slot = outer_slot;
+    pthread_mutex_unlock(&pool->call_lock);
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i + 1 < pool->size; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    pthread_cond_destroy(&pool->start);
+    pthread_cond_destroy(&pool->finish);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->call_lock);
+    free(pool->workers);
+    free(pool);
+}
@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "trace.h"
+#include "../io/atomic_file.h"
+
+static const char* const trace_counter_names[TRACE_COUNTER_COUNT] = {
+    "regex_execs", "patterns_inserted", "matches", "nodes_visited", "edges_relaxed",
+    "intents", "actions_run"
+};
+
+typedef struct TraceEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t duration;
+} TraceEvent;
+
+/**
+ * Span ring and counters of one thread
+ *
+ * Only the owning thread writes, clearing the ring itself when it sees
+ * that trace_start() began a new generation; readers skip rings of an
+ * older generation. head counts every span appended in the generation
+ * and is published with release order. A thread that exits retires its
+ * ring and the next new thread adopts it, so short-lived threads do not
+ * pile up rings; their spans share one exported timeline.
+ */
+typedef struct TraceRing {
+    struct TraceRing* next;         // Registry link, never unlinked
+    uint32_t tid;
+    atomic_bool retired;
+    atomic_uint generation;         // Generation the contents belong to
+    atomic_size_t head;
+    _Atomic uint64_t counters[TRACE_COUNTER_COUNT];
+    TraceEvent events[TRACE_RING_CAPACITY];
+} TraceRing;
+
+static _Atomic(TraceRing*) trace_rings;
+static atomic_uint trace_next_tid;
+static atomic_bool trace_recording;
+static atomic_uint trace_generation;
+static _Atomic uint64_t trace_origin;
+
+static _Thread_local TraceRing* trace_thread_ring;
+static pthread_once_t trace_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static bool trace_key_valid;
+
+static uint64_t trace_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+static void trace_ring_retire(void* ring) {
+    atomic_store_explicit(&((TraceRing*)ring)->retired, true, memory_order_release);
+}
+
+static void trace_key_create(void) {
+    trace_key_valid = pthread_key_create(&trace_key, trace_ring_retire) == 0;
+}
+
+/**
+ * Clear the calling thread's ring if a newer trace_start() has run
+ */
+static TraceRing* trace_ring_sync(TraceRing* ring) {
+    unsigned generation = atomic_load_explicit(&trace_generation, memory_order_acquire);
+    if (atomic_load_explicit(&ring->generation, memory_order_relaxed) != generation) {
+        atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+        for (int i = 0; i < TRACE_COUNTER_COUNT; i++) {
+            atomic_store_explicit(&ring->counters[i], 0, memory_order_relaxed);
+        }
+        atomic_store_explicit(&ring->generation, generation, memory_order_release);
+    }
+    return ring;
+}
+
+/**
+ * Check whether a ring holds spans and counters of the current trace
+ */
+static bool trace_ring_current(const TraceRing* ring) {
+    return atomic_load_explicit(&ring->generation, memory_order_acquire) ==
+           atomic_load_explicit(&trace_generation, memory_order_relaxed);
+}
+
+/**
+ * Find the calling thread's ring, adopting a retired one or adding one
+ */
+static TraceRing* trace_ring(void) {
+    TraceRing* ring = trace_thread_ring;
+    if (ring) {
+        return trace_ring_sync(ring);
+    }
+
+    for (ring = atomic_load_explicit(&trace_rings, memory_order_acquire); ring; ring = ring->next) {
+        bool retired = true;
+        if (atomic_compare_exchange_strong_explicit(&ring->retired, &retired, false,
+                                                    memory_order_acquire,
+                                                    memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    if (!ring) {
+        ring = (TraceRing*)calloc(1, sizeof(TraceRing));
+        if (!ring) {
+            return NULL;
+        }
+        ring->tid = atomic_fetch_add_explicit(&trace_next_tid, 1, memory_order_relaxed) + 1;
+        TraceRing* head = atomic_load_explicit(&trace_rings, memory_order_relaxed);
+        do {
+            ring->next = head;
+        } while (!atomic_compare_exchange_weak_explicit(&trace_rings, &head, ring,
+                                                        memory_order_release,
+                                                        memory_order_relaxed));
+    }
+
+    pthread_once(&trace_key_once, trace_key_create);
+    if (trace_key_valid) {
+        pthread_setspecific(trace_key, ring);
+    }
+    trace_thread_ring = ring;
+    return trace_ring_sync(ring);
+}
+
+void trace_start(void) {
+    // Rings belong to their threads; each clears its own on its next record
+    atomic_store_explicit(&trace_recording, false, memory_order_relaxed);
+    atomic_store_explicit(&trace_origin, trace_now(), memory_order_relaxed);
+    atomic_fetch_add_explicit(&trace_generation, 1, memory_order_release);
+    atomic_store_explicit(&trace_recording, true, memory_order_release);
+}
+
+void trace_stop(void) {
+    atomic_store_explicit(&trace_recording, false, memory_order_release);
+}
+
+bool trace_active(void) {
+    return atomic_load_explicit(&trace_recording, memory_order_relaxed);
+}
+
+TraceSpan trace_span_begin(const char* name) {
+    TraceSpan span = { NULL, 0 };
+    if (atomic_load_explicit(&trace_recording, memory_order_relaxed)) {
+        span.name = name;
+        span.start = trace_now();
+    }
+    return span;
+}
+
+void trace_span_end(TraceSpan* span) {
+    if (!span->name) {
+        return;
+    }
+    uint64_t end = trace_now();
+    TraceRing* ring = trace_ring();
+    if (!ring) {
+        return;
+    }
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    TraceEvent* event = &ring->events[head % TRACE_RING_CAPACITY];
+    event->name = span->name;
+    event->start = span->start;
+    event->duration = end - span->start;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void trace_count(TraceCounter counter, uint64_t amount) {
+    if (!atomic_load_explicit(&trace_recording, memory_order_relaxed) ||
+        (unsigned)counter >= TRACE_COUNTER_COUNT) {
+        return;
+    }
+    TraceRing* ring = trace_ring();
+    if (ring) {
+        // Single writer, so a plain load and store need no locked add
+        _Atomic uint64_t* value = &ring->counters[counter];
+        atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + amount,
+                              memory_order_relaxed);
+    }
+}
+
+uint64_t trace_counter_total(TraceCounter counter) {
+    if ((unsigned)counter >= TRACE_COUNTER_COUNT) {
+        return 0;
+    }
+    uint64_t total = 0;
+    for (TraceRing* ring = atomic_load_explicit(&trace_rings, memory_order_acquire); ring;
+         ring = ring->next) {
+        if (trace_ring_current(ring)) {
+            total += atomic_load_explicit(&ring->counters[counter], memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+const char* trace_counter_name(TraceCounter counter) {
+    return (unsigned)counter < TRACE_COUNTER_COUNT ? trace_counter_names[counter] : "unknown";
+}
+
+size_t trace_span_count(void) {
+    size_t count = 0;
+    for (TraceRing* ring = atomic_load_explicit(&trace_rings, memory_order_acquire); ring;
+         ring = ring->next) {
+        if (trace_ring_current(ring)) {
+            size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+            count += head < TRACE_RING_CAPACITY ? head : TRACE_RING_CAPACITY;
+        }
+    }
+    return count;
+}
+
+/**
+ * Write a span name as a JSON string
+ */
+static bool trace_write_name(FILE* file, const char* name) {
+    bool ok = fputc('"', file) != EOF;
+    for (const char* c = name; ok && *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            ok = fputc('\\', file) != EOF;
+        }
+        ok = ok && ((unsigned char)*c < 0x20 ? fprintf(file, "\\u%04x", *c) > 0
+                                             : fputc(*c, file) != EOF);
+    }
+    return ok && fputc('"', file) != EOF;
+}
+
+static bool trace_write_ring(FILE* file, const TraceRing* ring, long pid, uint64_t origin,
+                             bool* first) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t count = head < TRACE_RING_CAPACITY ? head : TRACE_RING_CAPACITY;
+    bool ok = fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%u,"
+                      "\"args\":{\"name\":\"polybuild-%u\"}}",
+                      *first ? "" : ",", pid, ring->tid, ring->tid) > 0;
+    *first = false;
+
+    uint64_t last = origin;
+    for (size_t i = head - count; ok && i < head; i++) {
+        const TraceEvent* event = &ring->events[i % TRACE_RING_CAPACITY];
+        uint64_t start = event->start > origin ? event->start : origin;
+        if (start + event->duration > last) {
+            last = start + event->duration;
+        }
+        ok = fputs(",\n{\"name\":", file) != EOF && trace_write_name(file, event->name) &&
+             fprintf(file, ",\"cat\":\"polybuild\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                     "\"pid\":%ld,\"tid\":%u}",
+                     (double)(start - origin) / 1000.0, (double)event->duration / 1000.0, pid,
+                     ring->tid) > 0;
+    }
+
+    // Counters close the thread's timeline with their totals
+    ok = ok && fprintf(file, ",\n{\"name\":\"counters\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%ld,"
+                       "\"tid\":%u,\"args\":{",
+                       (double)(last - origin) / 1000.0, pid, ring->tid) > 0;
+    for (int i = 0; ok && i < TRACE_COUNTER_COUNT; i++) {
+        ok = fprintf(file, "%s\"%s\":%llu", i ? "," : "", trace_counter_names[i],
+                     (unsigned long long)atomic_load_explicit(&ring->counters[i],
+                                                              memory_order_relaxed)) > 0;
+    }
+    return ok && fputs("}}", file) != EOF;
+}
+
+int trace_export_chrome(const char* path) {
+    if (!path) {
+        return -1;
+    }
+
+    AtomicFile atomic;
+    if (atomic_file_open(&atomic, path, 0666) != 0) {
+        return -1;
+    }
+    FILE* file = atomic_file_stream(&atomic);
+
+    long pid = (long)getpid();
+    uint64_t origin = atomic_load_explicit(&trace_origin, memory_order_relaxed);
+    bool first = true;
+    bool ok = file && fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file) != EOF;
+    for (TraceRing* ring = atomic_load_explicit(&trace_rings, memory_order_acquire); ok && ring;
+         ring = ring->next) {
+        if (trace_ring_current(ring)) {
+            ok = trace_write_ring(file, ring, pid, origin, &first);
+        }
+    }
+    ok = ok && fputs("\n]}\n", file) != EOF;
+    return atomic_file_close(&atomic, ok);
+}
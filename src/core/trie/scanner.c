@@ -0,0 +1,348 @@
+#include "scanner.h"
+#include "../trace/trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Sentinel for "no rule" and "no state"
+#define SCANNER_NONE UINT32_MAX
+
+// Largest dense transition table built before falling back to fail links
+#define SCANNER_DENSE_LIMIT (32u * 1024u * 1024u)
+
+struct TrieScanner {
+    const TrieNode** rules;     // Literal rules first, then regex rules
+    size_t literal_count;
+    size_t rule_count;
+
+    // Bytes that never occur in a literal share class 0
+    uint8_t byte_class[256];
+    uint32_t class_count;
+
+    // Aho-Corasick automaton, state 0 is the root
+    uint32_t state_count;
+    uint32_t* fail;
+    uint32_t* out_rule;         // Rule ending at this state, or SCANNER_NONE
+    uint32_t* dict_link;        // Nearest state on the fail chain with a rule
+    uint32_t* edge_offsets;     // Goto edges per state, sorted by class
+    uint8_t* edge_class;
+    uint32_t* edge_target;
+    uint32_t* delta;            // Dense transitions, NULL when too large
+};
+
+/**
+ * Collects rules into the scanner's rule table
+ */
+typedef struct {
+    TrieScanner* scanner;
+    bool literals;              // Which kind this pass collects
+} ScannerCollect;
+
+static bool scanner_collect_rule(TrieNode* node, void* ctx) {
+    ScannerCollect* collect = (ScannerCollect*)ctx;
+    if (node->compiled != collect->literals) {
+        collect->scanner->rules[collect->scanner->rule_count++] = node;
+    }
+    return true;
+}
+
+/**
+ * Follow a goto edge during construction and sparse scanning
+ */
+static uint32_t scanner_goto(const TrieScanner* scanner, uint32_t state, uint8_t cls) {
+    for (uint32_t e = scanner->edge_offsets[state]; e < scanner->edge_offsets[state + 1]; e++) {
+        if (scanner->edge_class[e] == cls) {
+            return scanner->edge_target[e];
+        }
+        if (scanner->edge_class[e] > cls) {
+            break;
+        }
+    }
+    return SCANNER_NONE;
+}
+
+/**
+ * Build the goto trie, fail links and (when small enough) the DFA
+ */
+static bool scanner_build_automaton(TrieScanner* scanner) {
+    // Byte classes keep the transition tables narrow
+    size_t max_states = 1;
+    for (size_t r = 0; r < scanner->literal_count; r++) {
+        const TrieNode* rule = scanner->rules[r];
+        for (size_t i = 0; i < rule->pattern_len; i++) {
+            scanner->byte_class[(uint8_t)rule->pattern_str[i]] = 1;
+        }
+        max_states += rule->pattern_len;
+    }
+    scanner->class_count = 1;
+    for (int b = 0; b < 256; b++) {
+        if (scanner->byte_class[b]) {
+            scanner->byte_class[b] = (uint8_t)scanner->class_count++;
+        }
+    }
+    if (max_states >= SCANNER_NONE) {
+        return false;
+    }
+
+    // Construction-only sibling lists
+    uint32_t* first_child = (uint32_t*)malloc(max_states * sizeof(uint32_t));
+    uint32_t* next_sibling = (uint32_t*)malloc(max_states * sizeof(uint32_t));
+    uint8_t* state_class = (uint8_t*)malloc(max_states);
+    uint32_t* queue = (uint32_t*)malloc(max_states * sizeof(uint32_t));
+    scanner->out_rule = (uint32_t*)malloc(max_states * sizeof(uint32_t));
+    scanner->fail = (uint32_t*)calloc(max_states, sizeof(uint32_t));
+    scanner->dict_link = (uint32_t*)malloc(max_states * sizeof(uint32_t));
+    scanner->edge_offsets = (uint32_t*)calloc(max_states + 1, sizeof(uint32_t));
+    scanner->edge_class = (uint8_t*)malloc(max_states);
+    scanner->edge_target = (uint32_t*)malloc(max_states * sizeof(uint32_t));
+
+    bool ok = first_child && next_sibling && state_class && queue &&
+              scanner->out_rule && scanner->fail && scanner->dict_link &&
+              scanner->edge_offsets && scanner->edge_class && scanner->edge_target;
+
+    if (ok) {
+        uint32_t count = 1;
+        first_child[0] = SCANNER_NONE;
+        scanner->out_rule[0] = SCANNER_NONE;
+
+        for (size_t r = 0; r < scanner->literal_count; r++) {
+            const TrieNode* rule = scanner->rules[r];
+            uint32_t state = 0;
+            for (size_t i = 0; i < rule->pattern_len; i++) {
+                uint8_t cls = scanner->byte_class[(uint8_t)rule->pattern_str[i]];
+                uint32_t child = first_child[state];
+                while (child != SCANNER_NONE && state_class[child] != cls) {
+                    child = next_sibling[child];
+                }
+                if (child == SCANNER_NONE) {
+                    child = count++;
+                    state_class[child] = cls;
+                    first_child[child] = SCANNER_NONE;
+                    scanner->out_rule[child] = SCANNER_NONE;
+                    next_sibling[child] = first_child[state];
+                    first_child[state] = child;
+                }
+                state = child;
+            }
+            if (scanner->out_rule[state] == SCANNER_NONE) {
+                scanner->out_rule[state] = (uint32_t)r;
+            }
+        }
+        scanner->state_count = count;
+
+        // Flatten the sibling lists into class-sorted edge rows
+        uint32_t edge = 0;
+        for (uint32_t s = 0; s < count; s++) {
+            scanner->edge_offsets[s] = edge;
+            for (uint32_t child = first_child[s]; child != SCANNER_NONE;
+                 child = next_sibling[child]) {
+                uint32_t pos = edge++;
+                while (pos > scanner->edge_offsets[s] &&
+                       scanner->edge_class[pos - 1] > state_class[child]) {
+                    scanner->edge_class[pos] = scanner->edge_class[pos - 1];
+                    scanner->edge_target[pos] = scanner->edge_target[pos - 1];
+                    pos--;
+                }
+                scanner->edge_class[pos] = state_class[child];
+                scanner->edge_target[pos] = child;
+            }
+        }
+        scanner->edge_offsets[count] = edge;
+
+        // Breadth-first fail links; shallower states are always done first
+        size_t head = 0;
+        size_t tail = 0;
+        scanner->dict_link[0] = SCANNER_NONE;
+        queue[tail++] = 0;
+        while (head < tail) {
+            uint32_t s = queue[head++];
+            for (uint32_t e = scanner->edge_offsets[s]; e < scanner->edge_offsets[s + 1]; e++) {
+                uint32_t child = scanner->edge_target[e];
+                uint8_t cls = scanner->edge_class[e];
+                uint32_t fallback = 0;
+                if (s != 0) {
+                    uint32_t f = scanner->fail[s];
+                    for (;;) {
+                        uint32_t next = scanner_goto(scanner, f, cls);
+                        if (next != SCANNER_NONE) {
+                            fallback = next;
+                            break;
+                        }
+                        if (f == 0) {
+                            break;
+                        }
+                        f = scanner->fail[f];
+                    }
+                }
+                scanner->fail[child] = fallback;
+                scanner->dict_link[child] = scanner->out_rule[fallback] != SCANNER_NONE
+                                          ? fallback : scanner->dict_link[fallback];
+                queue[tail++] = child;
+            }
+        }
+
+        // Dense DFA rows, filled in the same breadth-first order
+        size_t table_size = (size_t)count * scanner->class_count;
+        if (table_size <= SCANNER_DENSE_LIMIT / sizeof(uint32_t)) {
+            scanner->delta = (uint32_t*)malloc(table_size * sizeof(uint32_t));
+        }
+        if (scanner->delta) {
+            for (size_t q = 0; q < tail; q++) {
+                uint32_t s = queue[q];
+                uint32_t* row = &scanner->delta[(size_t)s * scanner->class_count];
+                const uint32_t* fail_row = &scanner->delta[(size_t)scanner->fail[s] *
+                                                           scanner->class_count];
+                for (uint32_t c = 0; c < scanner->class_count; c++) {
+                    uint32_t next = scanner_goto(scanner, s, (uint8_t)c);
+                    row[c] = next != SCANNER_NONE ? next : (s == 0 ? 0 : fail_row[c]);
+                }
+            }
+        }
+    }
+
+    free(first_child);
+    free(next_sibling);
+    free(state_class);
+    free(queue);
+    return ok;
+}
+
+TrieScanner* trie_scanner_create(TrieNode* root) {
+    if (!root) {
+        return NULL;
+    }
+
+    TRACE_SPAN("trie_scanner_create");
+    TrieScanner* scanner = (TrieScanner*)calloc(1, sizeof(TrieScanner));
+    if (!scanner) {
+        return NULL;
+    }
+
+    size_t total = trie_for_each(root, NULL, NULL);
+    scanner->rules = (const TrieNode**)malloc((total ? total : 1) * sizeof(TrieNode*));
+    if (!scanner->rules) {
+        free(scanner);
+        return NULL;
+    }
+
+    // Literals first so rule indices in the automaton stay dense
+    ScannerCollect collect = { scanner, true };
+    trie_for_each(root, scanner_collect_rule, &collect);
+    scanner->literal_count = scanner->rule_count;
+    collect.literals = false;
+    trie_for_each(root, scanner_collect_rule, &collect);
+
+    if (!scanner_build_automaton(scanner)) {
+        trie_scanner_free(scanner);
+        return NULL;
+    }
+
+    return scanner;
+}
+
+size_t trie_scanner_rule_count(const TrieScanner* scanner) {
+    return scanner ? scanner->rule_count : 0;
+}
+
+/**
+ * Aho-Corasick pass reporting every literal occurrence
+ */
+static bool scanner_scan_literals(const TrieScanner* scanner, const char* text, size_t len,
+                                  TrieScanFn fn, void* ctx, long* reported) {
+    const uint8_t* bytes = (const uint8_t*)text;
+    uint32_t state = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t cls = scanner->byte_class[bytes[i]];
+
+        if (scanner->delta) {
+            state = scanner->delta[(size_t)state * scanner->class_count + cls];
+        } else {
+            for (;;) {
+                uint32_t next = scanner_goto(scanner, state, cls);
+                if (next != SCANNER_NONE) {
+                    state = next;
+                    break;
+                }
+                if (state == 0) {
+                    break;
+                }
+                state = scanner->fail[state];
+            }
+        }
+
+        uint32_t hit = scanner->out_rule[state] != SCANNER_NONE ? state
+                                                                : scanner->dict_link[state];
+        while (hit != SCANNER_NONE) {
+            const TrieNode* rule = scanner->rules[scanner->out_rule[hit]];
+            TrieScanMatch match = { i + 1 - rule->pattern_len, rule->pattern_len, rule };
+            (*reported)++;
+            if (!fn(&match, ctx)) {
+                return false;
+            }
+            hit = scanner->dict_link[hit];
+        }
+    }
+
+    return true;
+}
+
+/**
+ * One left-to-right pass per regex rule, matching the text in place
+ */
+static bool scanner_scan_regexes(const TrieScanner* scanner, const char* text, size_t len,
+                                 TrieScanFn fn, void* ctx, long* reported) {
+    for (size_t r = scanner->literal_count; r < scanner->rule_count; r++) {
+        const TrieNode* rule = scanner->rules[r];
+        size_t pos = 0;
+        size_t start;
+        size_t end;
+
+        while (pos < len && trie_search(rule, text, pos, len, &start, &end)) {
+            if (end > start) {
+                TrieScanMatch match = { start, end - start, rule };
+                (*reported)++;
+                if (!fn(&match, ctx)) {
+                    return false;
+                }
+            }
+
+            // Step past the match, or one byte past an empty one
+            pos = end > start ? end : start + 1;
+        }
+    }
+
+    return true;
+}
+
+long trie_scanner_scan(const TrieScanner* scanner, const char* text, size_t len,
+                       TrieScanFn fn, void* ctx) {
+    if (!scanner || !text || !fn) {
+        return -1;
+    }
+
+    TRACE_SPAN("trie_scanner_scan");
+    long reported = 0;
+    if (scanner->literal_count == 0 ||
+        scanner_scan_literals(scanner, text, len, fn, ctx, &reported)) {
+        scanner_scan_regexes(scanner, text, len, fn, ctx, &reported);
+    }
+
+    TRACE_COUNT(TRACE_COUNTER_MATCHES, reported);
+    return reported;
+}
+
+void trie_scanner_free(TrieScanner* scanner) {
+    if (!scanner) {
+        return;
+    }
+
+    free(scanner->rules);
+    free(scanner->fail);
+    free(scanner->out_rule);
+    free(scanner->dict_link);
+    free(scanner->edge_offsets);
+    free(scanner->edge_class);
+    free(scanner->edge_target);
+    free(scanner->delta);
+    free(scanner);
+}
@@ -1,8 +1,18 @@
 #include "trie.h"
 #include "taxonomy.h"
+#include "../trace/trace.h"
 #include <stdlib.h>
 #include <string.h>
 
+// Initial child array capacity, doubled on demand
+#define TRIE_CHILD_INITIAL_CAPACITY 2
+
+// Spans copied on the stack when the C library lacks REG_STARTEND
+#define TRIE_STACK_SPAN 256
+
+// Largest span given to one regexec call; glibc's regoff_t is an int
+#define TRIE_REGEX_WINDOW ((size_t)1 << (sizeof(regoff_t) * 8 - 2))
+
 /**
  * Initialize the trie subsystem
  * Returns 0 on success, non-zero on failure
@@ -15,70 +25,458 @@ int trie_init(void) {
 TrieNode* trie_node_create(const char *pattern_str,
                            TaxonomyCategory cat,
                            float weight) {
-    TrieNode *node = (TrieNode*)calloc(1, sizeof(TrieNode));
+    return trie_node_create_in(NULL, pattern_str, cat, weight);
+}
+
+/**
+ * Arena cleanup for the libc-owned state of a compiled pattern
+ */
+static void trie_node_cleanup(void *data) {
+    regfree(&((TrieNode*)data)->pattern);
+}
+
+/**
+ * Check whether a pattern contains no extended regex metacharacters
+ */
+static bool trie_pattern_is_literal(const char *pattern_str) {
+    return pattern_str[strcspn(pattern_str, ".[]()*+?{}|^$\\")] == '\0';
+}
+
+/**
+ * Attach a pattern to a node, compiling it unless it is a plain literal
+ */
+static bool trie_node_set_pattern(TrieNode *node, const char *pattern_str) {
+    const PolyAllocator *allocator = node->allocator;
+    size_t len = strlen(pattern_str);
+
+    node->pattern_str = (char*)poly_alloc(allocator, len + 1);
+    if (!node->pattern_str) {
+        return false;
+    }
+    memcpy(node->pattern_str, pattern_str, len + 1);
+    node->pattern_len = len;
+
+    if (trie_pattern_is_literal(pattern_str)) {
+        node->compiled = false;
+        return true;
+    }
+
+    // Compile the regex pattern
+    if (regcomp(&node->pattern, pattern_str, REG_EXTENDED) != 0) {
+        poly_release(allocator, node->pattern_str, len + 1);
+        node->pattern_str = NULL;
+        return false;
+    }
+    node->compiled = true;
+
+    // Bulk allocators release the regex together with their memory
+    if (allocator->defer &&
+        allocator->defer(allocator->ctx, trie_node_cleanup, node) != 0) {
+        regfree(&node->pattern);
+        poly_release(allocator, node->pattern_str, len + 1);
+        node->pattern_str = NULL;
+        node->compiled = false;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Create a node without a pattern (internal branch point)
+ */
+static TrieNode* trie_node_alloc(const PolyAllocator *allocator) {
+    TrieNode *node = (TrieNode*)poly_calloc(allocator, sizeof(TrieNode));
+    if (node) {
+        node->allocator = allocator;
+    }
+    return node;
+}
+
+TrieNode* trie_node_create_in(const PolyAllocator *allocator,
+                              const char *pattern_str,
+                              TaxonomyCategory cat,
+                              float weight) {
+    if (!pattern_str) return NULL;
+    if (!allocator) allocator = poly_allocator_default();
+
+    TrieNode *node = trie_node_alloc(allocator);
     if (!node) return NULL;
-    
-    node->pattern_str = strdup(pattern_str);
+
     node->category = cat;
     node->weight = weight;
     node->terminal = false;
-    
-    // Compile the regex pattern
-    if (regcomp(&node->pattern, pattern_str, REG_EXTENDED) != 0) {
-        free(node->pattern_str);
-        free(node);
+
+    if (!trie_node_set_pattern(node, pattern_str)) {
+        poly_release(allocator, node, sizeof(TrieNode));
         return NULL;
     }
-    
+
     return node;
 }
 
 bool trie_match_node(TrieNode *node, const char *text, size_t len) {
-    if (!node || !text || len == 0) {
+    size_t match_len;
+    return trie_match_prefix(node, text, len, &match_len) && match_len == len;
+}
+
+/**
+ * Run the compiled regex once over a span of at most TRIE_REGEX_WINDOW bytes
+ */
+static bool trie_regex_exec(const TrieNode *node, const char *span, size_t span_len,
+                            int flags, size_t *match_start, size_t *match_end) {
+    regmatch_t match;
+    TRACE_COUNT(TRACE_COUNTER_REGEX_EXECS, 1);
+
+#ifdef REG_STARTEND
+    // The span is passed in place; no terminator or copy needed
+    match.rm_so = 0;
+    match.rm_eo = (regoff_t)span_len;
+    if (regexec(&node->pattern, span, 1, &match, flags | REG_STARTEND) != 0) {
         return false;
     }
-    
-    // Create a null-terminated copy of the text segment for regex matching
-    char *text_copy = (char *)malloc(len + 1);
-    if (!text_copy) {
+#else
+    // Without REG_STARTEND the span needs a terminated copy
+    char buffer[TRIE_STACK_SPAN];
+    char *copy = span_len < sizeof(buffer) ? buffer : (char *)malloc(span_len + 1);
+    if (!copy) {
         return false;
     }
-    
-    memcpy(text_copy, text, len);
-    text_copy[len] = '\0';
-    
-    // Execute the compiled regex against the text
-    regmatch_t match;
-    int result = regexec(&node->pattern, text_copy, 1, &match, 0);
-    
-    // Check if we have a match at the start of the string that consumes the entire input
-    // Fix sign comparison with explicit cast
-    bool matches = (result == 0 && match.rm_so == 0 && 
-                   (size_t)match.rm_eo == len);
-    
-    free(text_copy);
-    return matches;
+    memcpy(copy, span, span_len);
+    copy[span_len] = '\0';
+
+    int status = regexec(&node->pattern, copy, 1, &match, flags);
+    if (copy != buffer) {
+        free(copy);
+    }
+    if (status != 0) {
+        return false;
+    }
+#endif
+
+    *match_start = (size_t)match.rm_so;
+    *match_end = (size_t)match.rm_eo;
+    return true;
+}
+
+/**
+ * Search text[start, len) window by window and report absolute offsets
+ */
+static bool trie_regex_search(const TrieNode *node, const char *text,
+                              size_t start, size_t len,
+                              size_t *match_start, size_t *match_end) {
+    size_t window = start;
+
+    do {
+        size_t span_len = len - window < TRIE_REGEX_WINDOW ? len - window : TRIE_REGEX_WINDOW;
+        int flags = window > 0 ? REG_NOTBOL : 0;
+
+        if (trie_regex_exec(node, text + window, span_len, flags, match_start, match_end)) {
+            *match_start += window;
+            *match_end += window;
+            return true;
+        }
+        window += span_len;
+    } while (window < len);
+
+    return false;
+}
+
+bool trie_match_prefix(const TrieNode *node, const char *text, size_t len,
+                       size_t *match_len) {
+    if (!node || !text || len == 0 || !node->pattern_str || !match_len) {
+        return false;
+    }
+
+    // Literal patterns need no regex engine at all
+    if (!node->compiled) {
+        if (len < node->pattern_len ||
+            memcmp(text, node->pattern_str, node->pattern_len) != 0) {
+            return false;
+        }
+        *match_len = node->pattern_len;
+        return true;
+    }
+
+    // Leftmost-longest: a match at offset 0 wins and is the longest there
+    size_t match_start;
+    size_t match_end;
+    if (!trie_regex_search(node, text, 0, len, &match_start, &match_end) ||
+        match_start != 0 || match_end == 0) {
+        return false;
+    }
+
+    *match_len = match_end;
+    return true;
+}
+
+bool trie_search(const TrieNode *node, const char *text, size_t start, size_t len,
+                 size_t *match_start, size_t *match_end) {
+    if (!node || !text || start > len || !node->pattern_str ||
+        !match_start || !match_end) {
+        return false;
+    }
+
+    if (!node->compiled) {
+        if (node->pattern_len == 0 || len - start < node->pattern_len) {
+            return false;
+        }
+        const char *end = text + len - node->pattern_len;
+        for (const char *p = text + start; p <= end; p++) {
+            p = (const char *)memchr(p, node->pattern_str[0], (size_t)(end - p) + 1);
+            if (!p) {
+                return false;
+            }
+            if (memcmp(p, node->pattern_str, node->pattern_len) == 0) {
+                *match_start = (size_t)(p - text);
+                *match_end = *match_start + node->pattern_len;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    return trie_regex_search(node, text, start, len, match_start, match_end);
+}
+
+/**
+ * Find the position of the child whose label starts with the given byte,
+ * or the position where such a child would be inserted
+ */
+static size_t trie_child_position(const TrieNode *node, uint8_t key, bool *found) {
+    size_t low = 0;
+    size_t high = node->child_count;
+
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (node->child_keys[mid] < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    *found = low < node->child_count && node->child_keys[low] == key;
+    return low;
+}
+
+static TrieNode* trie_find_child(const TrieNode *node, uint8_t key) {
+    bool found;
+    size_t pos = trie_child_position(node, key, &found);
+    return found ? node->children[pos] : NULL;
+}
+
+/**
+ * Insert a child into the sorted child array, growing it if needed
+ */
+static bool trie_add_child(TrieNode *node, TrieNode *child) {
+    uint8_t key = (uint8_t)child->label[0];
+    bool found;
+    size_t pos = trie_child_position(node, key, &found);
+
+    if (node->child_count == node->child_capacity) {
+        size_t old_capacity = node->child_capacity;
+        size_t new_capacity = old_capacity ? old_capacity * 2 : TRIE_CHILD_INITIAL_CAPACITY;
+        if (new_capacity > 256) new_capacity = 256;
+
+        // Both arrays share child_capacity, so neither may change size
+        // unless both can; the keys are copied rather than resized
+        uint8_t *keys = (uint8_t*)poly_alloc(node->allocator, new_capacity);
+        if (!keys) {
+            return false;
+        }
+
+        TrieNode **children = (TrieNode**)poly_resize(node->allocator, node->children,
+                                                      old_capacity * sizeof(TrieNode*),
+                                                      new_capacity * sizeof(TrieNode*));
+        if (!children) {
+            poly_release(node->allocator, keys, new_capacity);
+            return false;
+        }
+        if (node->child_keys) {
+            memcpy(keys, node->child_keys, node->child_count);
+            poly_release(node->allocator, node->child_keys, old_capacity);
+        }
+        node->child_keys = keys;
+        node->children = children;
+        node->child_capacity = (uint16_t)new_capacity;
+    }
+
+    size_t tail = node->child_count - pos;
+    memmove(&node->child_keys[pos + 1], &node->child_keys[pos], tail);
+    memmove(&node->children[pos + 1], &node->children[pos], tail * sizeof(TrieNode*));
+    node->child_keys[pos] = key;
+    node->children[pos] = child;
+    node->child_count++;
+    return true;
+}
+
+/**
+ * Split a child's edge after prefix_len bytes, returning the new
+ * intermediate node that now sits between parent and child
+ */
+static TrieNode* trie_split_edge(TrieNode *parent, TrieNode *child, size_t prefix_len) {
+    TrieNode *middle = trie_node_alloc(parent->allocator);
+    if (!middle) {
+        return NULL;
+    }
+
+    middle->label = child->label;
+    middle->label_len = prefix_len;
+    middle->category = TAX_UNKNOWN;
+
+    // The first label byte is unchanged, so middle takes child's slot
+    bool found;
+    size_t pos = trie_child_position(parent, (uint8_t)child->label[0], &found);
+
+    child->label += prefix_len;
+    child->label_len -= prefix_len;
+    if (!trie_add_child(middle, child)) {
+        child->label -= prefix_len;
+        child->label_len += prefix_len;
+        poly_release(parent->allocator, middle, sizeof(TrieNode));
+        return NULL;
+    }
+
+    parent->children[pos] = middle;
+    return middle;
 }
 
 void trie_insert(TrieNode *root,
                  const char *pattern_str,
                  TaxonomyCategory cat,
                  float weight) {
-    if (!root || !pattern_str) {
+    if (!root || !pattern_str || !pattern_str[0]) {
         return;
     }
-    
-    // Calculate first character for indexing
-    unsigned char first_char = (unsigned char)pattern_str[0];
-    
-    // If child doesn't exist, create it
-    if (!root->children[first_char]) {
-        root->children[first_char] = trie_node_create(pattern_str, cat, weight);
-        if (root->children[first_char]) {
-            root->children[first_char]->terminal = true;
+
+    TrieNode *node = root;
+    const char *rest = pattern_str;
+    size_t remaining = strlen(pattern_str);
+
+    // Walk the whole pattern, following and splitting compressed edges
+    while (remaining > 0) {
+        TrieNode *child = trie_find_child(node, (uint8_t)rest[0]);
+
+        if (!child) {
+            // New branch: one leaf carries the whole remaining suffix
+            TrieNode *leaf = trie_node_create_in(root->allocator, pattern_str, cat, weight);
+            if (!leaf) {
+                return;
+            }
+            leaf->terminal = true;
+            leaf->label = leaf->pattern_str + (rest - pattern_str);
+            leaf->label_len = remaining;
+            if (!trie_add_child(node, leaf)) {
+                trie_free(leaf);
+                return;
+            }
+            TRACE_COUNT(TRACE_COUNTER_PATTERNS_INSERTED, 1);
+            return;
+        }
+
+        size_t common = 0;
+        while (common < child->label_len && common < remaining &&
+               child->label[common] == rest[common]) {
+            common++;
         }
+
+        if (common < child->label_len) {
+            child = trie_split_edge(node, child, common);
+            if (!child) {
+                return;
+            }
+        }
+
+        node = child;
+        rest += common;
+        remaining -= common;
+    }
+
+    // The pattern ends on an existing branch point
+    if (node->terminal || node == root) {
+        return;
+    }
+    if (trie_node_set_pattern(node, pattern_str)) {
+        node->category = cat;
+        node->weight = weight;
+        node->terminal = true;
+        TRACE_COUNT(TRACE_COUNTER_PATTERNS_INSERTED, 1);
+    }
+}
+
+TrieNode* trie_lookup(TrieNode *root, const char *pattern_str) {
+    if (!root || !pattern_str || !pattern_str[0]) {
+        return NULL;
+    }
+
+    TrieNode *node = root;
+    const char *rest = pattern_str;
+    size_t remaining = strlen(pattern_str);
+
+    while (remaining > 0) {
+        node = trie_find_child(node, (uint8_t)rest[0]);
+        if (!node || node->label_len > remaining ||
+            memcmp(node->label, rest, node->label_len) != 0) {
+            return NULL;
+        }
+        rest += node->label_len;
+        remaining -= node->label_len;
+    }
+
+    return node->terminal ? node : NULL;
+}
+
+/**
+ * Depth-first walk over terminal nodes; returns false once stopped
+ */
+static bool trie_walk(TrieNode *node, TrieVisitFn fn, void *ctx, size_t *visited) {
+    if (node->terminal) {
+        (*visited)++;
+        if (fn && !fn(node, ctx)) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < node->child_count; i++) {
+        if (!trie_walk(node->children[i], fn, ctx, visited)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t trie_for_each(TrieNode *root, TrieVisitFn fn, void *ctx) {
+    size_t visited = 0;
+    if (!root) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < root->child_count; i++) {
+        if (!trie_walk(root->children[i], fn, ctx, &visited)) {
+            break;
+        }
+    }
+    return visited;
+}
+
+void trie_free(TrieNode *root) {
+    if (!root || root->allocator->defer) {
+        return;
+    }
+
+    for (size_t i = 0; i < root->child_count; i++) {
+        trie_free(root->children[i]);
+    }
+
+    if (root->compiled) {
+        regfree(&root->pattern);
+    }
+    if (root->pattern_str) {
+        poly_release(root->allocator, root->pattern_str, root->pattern_len + 1);
     }
-    
-    // More complex implementation would handle nested patterns
-    // but this minimal version satisfies the function signature
+    poly_release(root->allocator, root->child_keys, root->child_capacity);
+    poly_release(root->allocator, root->children,
+                 root->child_capacity * sizeof(TrieNode*));
+    poly_release(root->allocator, root, sizeof(TrieNode));
 }
@@ -12,19 +12,43 @@
 #include <stdlib.h>
 #include <regex.h>
 #include "taxonomy.h"
+#include "../memory/arena.h"
 
 /**
  * @brief Trie node for pattern matching
+ *
+ * The trie is keyed on the full pattern string and path compressed: the
+ * edge into a node carries a multi-byte label, and single-child chains
+ * collapse into one edge. Children live in a sorted array indexed by the
+ * first byte of their label. Only terminal nodes own a pattern, and
+ * patterns without regex metacharacters are matched literally without
+ * compiling a regex.
  */
 typedef struct TrieNode {
-    char* pattern_str;
-    regex_t pattern;
+    char* pattern_str;          // Full pattern, NULL for internal nodes
+    size_t pattern_len;
+    regex_t pattern;            // Valid only when compiled is set
+    bool compiled;
     TaxonomyCategory category;
     float weight;
     bool terminal;
-    struct TrieNode* children[256]; // One for each possible byte
+    const char* label;          // Edge label into this node (not owned)
+    size_t label_len;
+    uint8_t* child_keys;        // First label byte per child, ascending
+    struct TrieNode** children;
+    uint16_t child_count;
+    uint16_t child_capacity;
+    const PolyAllocator* allocator;
 } TrieNode;
 
+/**
+ * @brief Visitor called for each terminal node of a trie
+ * @param node Terminal node
+ * @param ctx Caller context
+ * @return true to continue the walk, false to stop
+ */
+typedef bool (*TrieVisitFn)(TrieNode* node, void* ctx);
+
 /**
  * @brief Initialize the trie subsystem
  * @return 0 on success, non-zero on failure
@@ -42,8 +66,28 @@ TrieNode* trie_node_create(const char* pattern_str,
                            TaxonomyCategory cat,
                            float weight);
 
+/**
+ * @brief Create a new trie node drawing from an allocator
+ *
+ * Nodes later inserted below this one use the same allocator. With an
+ * arena the compiled pattern is released when the arena is reset.
+ *
+ * @param allocator Allocator to draw from (NULL for the default)
+ * @param pattern_str Regular expression pattern string
+ * @param cat Taxonomy category for classification
+ * @param weight Pattern importance weight
+ * @return Pointer to the newly created node or NULL on failure
+ */
+TrieNode* trie_node_create_in(const PolyAllocator* allocator,
+                              const char* pattern_str,
+                              TaxonomyCategory cat,
+                              float weight);
+
 /**
  * @brief Check if text matches the node's pattern
+ *
+ * Works directly on the span without copying it; see trie_match_prefix().
+ *
  * @param node The trie node to check against
  * @param text Text to match
  * @param len Length of the text
@@ -51,8 +95,46 @@ TrieNode* trie_node_create(const char* pattern_str,
  */
 bool trie_match_node(TrieNode* node, const char* text, size_t len);
 
+/**
+ * @brief Find the longest match of the node's pattern at the start of a span
+ *
+ * Regex patterns run on the span in place through REG_STARTEND where the
+ * C library provides it, so no allocation happens per call. Literal
+ * patterns compare bytes directly.
+ *
+ * @param node The trie node to check against
+ * @param text Start of the span (need not be NUL-terminated)
+ * @param len Length of the span
+ * @param match_len Receives the length of the longest non-empty match
+ * @return True if a non-empty match starts at the first byte
+ */
+bool trie_match_prefix(const TrieNode* node, const char* text, size_t len,
+                       size_t* match_len);
+
+/**
+ * @brief Find the leftmost-longest match of the node's pattern in a span
+ *
+ * Where regoff_t is 32 bits, regex spans are searched in 1 GB windows
+ * and a match straddling a window edge is not found.
+ *
+ * @param node The trie node to search with
+ * @param text Text holding the span (need not be NUL-terminated)
+ * @param start Offset where the search starts
+ * @param len Offset where the span ends
+ * @param match_start Receives the offset of the match
+ * @param match_end Receives the offset one past the match
+ * @return True if a match was found
+ */
+bool trie_search(const TrieNode* node, const char* text, size_t start, size_t len,
+                 size_t* match_start, size_t* match_end);
+
 /**
  * @brief Insert a pattern into the trie
+ *
+ * Walks the whole pattern string, splitting compressed edges where the
+ * new pattern diverges. Re-inserting a pattern keeps its first category
+ * and weight; patterns that fail to compile are not inserted.
+ *
  * @param root Root node of the trie
  * @param pattern_str Pattern string to insert
  * @param cat Taxonomy category for the pattern
@@ -63,4 +145,31 @@ void trie_insert(TrieNode* root,
                  TaxonomyCategory cat,
                  float weight);
 
+/**
+ * @brief Find the node holding exactly the given pattern
+ * @param root Root node of the trie
+ * @param pattern_str Pattern string to look up
+ * @return Terminal node for the pattern or NULL if absent
+ */
+TrieNode* trie_lookup(TrieNode* root, const char* pattern_str);
+
+/**
+ * @brief Visit every pattern below the root in lexicographic order
+ * @param root Root node of the trie (its own pattern is not visited)
+ * @param fn Visitor
+ * @param ctx Context passed to the visitor
+ * @return Number of terminal nodes visited
+ */
+size_t trie_for_each(TrieNode* root, TrieVisitFn fn, void* ctx);
+
+/**
+ * @brief Free a trie and all of its descendants
+ *
+ * Tries drawn from an arena are owned by the arena; this is a no-op
+ * for them.
+ *
+ * @param root Root node of the trie
+ */
+void trie_free(TrieNode* root);
+
 #endif /* POLYBUILD_TRIE_H */
@@ -1,12 +1,2203 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <pthread.h>
+#include <stdatomic.h>
 // #include <polybuild/dag.h>
 // #include <polybuild/trie.h>
 // #include <polybuild/trie_dag.h>
 
 
 #include "polybuild/dag.h"
+#include "polybuild/dag_image.h"
+#include "polybuild/dag_vote.h"
 #include "polybuild/trie.h"
 #include "polybuild/trie_dag.h"
+#include "polybuild/arena.h"
+#include "polybuild/scanner.h"
+#include "polybuild/file_scan.h"
+#include "polybuild/atomic_file.h"
+#include "polybuild/executor.h"
+#include "polybuild/history.h"
+#include "polybuild/action_cache.h"
+#include "polybuild/file_index.h"
+#include "polybuild/sha256.h"
+#include "polybuild/manifest.h"
+#include "polybuild/trace.h"
+
+/**
+ * Build a diamond in a DAGGraph and resolve it over the CSR arrays
+ */
+static int test_dag_graph(void) {
+    DAGGraph* graph = dag_graph_create(0);
+    if (!graph) {
+        return 1;
+    }
+    
+    DAGNode* nodes[4];
+    for (size_t i = 0; i < 4; i++) {
+        nodes[i] = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+        if (!nodes[i] || dag_graph_add_node(graph, nodes[i]) != 0) {
+            return 1;
+        }
+    }
+    
+    dag_add_edge(nodes[0], nodes[1], 1.0f);
+    dag_add_edge(nodes[0], nodes[2], -1.0f);
+    dag_add_edge(nodes[1], nodes[3], 1.0f);
+    dag_add_edge(nodes[2], nodes[3], 2.0f);
+    
+    if (dag_graph_resolve(graph) != 0 || graph->edge_count != 4 ||
+        graph->in_offsets[3] != 2 || graph->in_sources[2] != 1 ||
+        nodes[1]->state != STATE_TRUE || nodes[2]->state != STATE_FALSE ||
+        nodes[3]->state != STATE_FALSE) {
+        return 1;
+    }
+    
+    // Adding an edge invalidates the frozen form and the resolved states
+    dag_add_edge(nodes[1], nodes[3], 2.0f);
+    if (graph->frozen || graph->resolved || dag_graph_resolve(graph) != 0 ||
+        graph->edge_count != 5 || nodes[3]->state != STATE_TRUE) {
+        return 1;
+    }
+    
+    dag_graph_free(graph);
+    int result = nodes[0]->graph == NULL ? 0 : 1;
+    for (size_t i = 0; i < 4; i++) {
+        dag_node_free(nodes[i]);
+    }
+    return result;
+}
+
+/**
+ * Build a graph, a trie and matches inside one arena and drop them at once
+ */
+static int test_arena(void) {
+    PolyArena* arena = poly_arena_create(4096);
+    if (!arena) {
+        return 1;
+    }
+    const PolyAllocator* allocator = poly_arena_allocator(arena);
+    
+    for (int round = 0; round < 2; round++) {
+        DAGGraph* graph = dag_graph_create_in(allocator, 0);
+        DAGNode* previous = NULL;
+        for (int i = 0; i < 100; i++) {
+            DAGNode* node = dag_node_create_in(allocator, TOKEN_IDENTIFIER, TAX_ACTION);
+            if (!node || dag_graph_add_node(graph, node) != 0) {
+                return 1;
+            }
+            if (previous) {
+                dag_add_edge(previous, node, 1.0f);
+            }
+            previous = node;
+        }
+        if (dag_graph_resolve(graph) != 0 || graph->edge_count != 99 ||
+            previous->state != STATE_TRUE) {
+            return 1;
+        }
+        
+        TrieNode* root = trie_node_create_in(allocator, "root", TAX_UNKNOWN, 1.0f);
+        if (!root) {
+            return 1;
+        }
+        trie_insert(root, "make", TAX_ACTION, 1.0f);
+        DAGNode** matches = create_dag_from_trie_matches_in(allocator, root, "make", 4);
+        if (!matches || !matches[0] || matches[1] ||
+            matches[0]->category != TAX_ACTION) {
+            return 1;
+        }
+        
+        if (poly_arena_bytes_used(arena) == 0) {
+            return 1;
+        }
+        poly_arena_reset(arena);
+    }
+    
+    poly_arena_destroy(arena);
+    return 0;
+}
+
+/**
+ * Deterministic pseudo-random numbers for synthetic graphs
+ */
+static unsigned int test_random(unsigned int* seed) {
+    *seed = *seed * 1103515245u + 12345u;
+    return (*seed >> 16) & 0x7fff;
+}
+
+/**
+ * Build a wide random DAG with supporting and inhibiting edges
+ */
+static DAGGraph* test_random_graph(size_t node_count, size_t edges_per_node,
+                                   unsigned int seed) {
+    DAGGraph* graph = dag_graph_create(node_count);
+    if (!graph) {
+        return NULL;
+    }
+    for (size_t i = 0; i < node_count; i++) {
+        DAGNode* node = dag_node_create(TOKEN_IDENTIFIER, (TaxonomyCategory)(i % 5));
+        if (!node || dag_graph_add_node(graph, node) != 0) {
+            return NULL;
+        }
+    }
+    for (size_t i = 1; i < node_count; i++) {
+        for (size_t j = 0; j < edges_per_node; j++) {
+            size_t from = test_random(&seed) % i;
+            float weight = (float)((int)(test_random(&seed) % 7) - 2);
+            dag_add_edge(graph->nodes[from], graph->nodes[i], weight);
+        }
+    }
+    return graph;
+}
+
+/**
+ * Resolves one graph repeatedly on a pool shared with other threads
+ */
+typedef struct {
+    ThreadPool* pool;
+    const uint8_t* expected;
+    int result;
+} TestSharedResolve;
+
+static void* test_shared_resolve_run(void* arg) {
+    TestSharedResolve* task = (TestSharedResolve*)arg;
+    DAGGraph* graph = test_random_graph(20000, 3, 42);
+    for (int round = 0; round < 3 && task->result == 0; round++) {
+        if (!graph || dag_graph_resolve_parallel_on(graph, task->pool) != 0 ||
+            memcmp(task->expected, graph->states, graph->node_count) != 0) {
+            task->result = 1;
+        }
+    }
+    dag_graph_free_all(graph);
+    return NULL;
+}
+
+/**
+ * Counts the indices of a loop, with each outer index running an inner
+ * loop on the same pool
+ */
+typedef struct {
+    ThreadPool* pool;
+    _Atomic size_t outer;
+    _Atomic size_t inner;
+} TestNestedLoop;
+
+static void test_nested_inner(void* ctx, size_t begin, size_t end, size_t worker) {
+    TestNestedLoop* loop = (TestNestedLoop*)ctx;
+    (void)worker;
+    loop->inner += end - begin;
+}
+
+static void test_nested_outer(void* ctx, size_t begin, size_t end, size_t worker) {
+    TestNestedLoop* loop = (TestNestedLoop*)ctx;
+    (void)worker;
+    for (size_t i = begin; i < end; i++) {
+        loop->outer++;
+        thread_pool_parallel_for(loop->pool, 100, 1, test_nested_inner, loop);
+    }
+}
+
+/**
+ * The parallel resolver must agree with the sequential one node for node
+ */
+static int test_parallel_resolve(void) {
+    DAGGraph* graph = test_random_graph(20000, 3, 42);
+    if (!graph || dag_graph_resolve(graph) != 0) {
+        return 1;
+    }
+    
+    uint8_t* expected = (uint8_t*)malloc(graph->node_count);
+    if (!expected) {
+        return 1;
+    }
+    memcpy(expected, graph->states, graph->node_count);
+    
+    int result = 0;
+    if (dag_graph_resolve_parallel(graph, 4) != 0 ||
+        memcmp(expected, graph->states, graph->node_count) != 0) {
+        result = 1;
+    }
+
+    // Repeated resolves can share one caller-owned pool
+    ThreadPool* pool = thread_pool_create(4);
+    for (int round = 0; round < 3 && result == 0; round++) {
+        if (!pool || dag_graph_resolve_parallel_on(graph, pool) != 0 ||
+            memcmp(expected, graph->states, graph->node_count) != 0) {
+            result = 1;
+        }
+    }
+
+    // Threads sharing the pool take turns instead of mixing their jobs
+    pthread_t threads[2];
+    TestSharedResolve tasks[2];
+    size_t started = 0;
+    for (; pool && started < 2; started++) {
+        tasks[started] = (TestSharedResolve){ pool, expected, 0 };
+        if (pthread_create(&threads[started], NULL, test_shared_resolve_run, &tasks[started]) != 0) {
+            result = 1;
+            break;
+        }
+    }
+    for (size_t t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+        result |= tasks[t].result;
+    }
+
+    // A loop body calling back into its pool runs the inner loop inline
+    TestNestedLoop nested = { pool, 0, 0 };
+    thread_pool_parallel_for(pool, 64, 1, test_nested_outer, &nested);
+    if (nested.outer != 64 || nested.inner != 64 * 100) {
+        result = 1;
+    }
+    thread_pool_destroy(pool);
+    for (size_t i = 0; i < graph->node_count && result == 0; i++) {
+        if (graph->nodes[i]->state != (NodeState)expected[i]) {
+            result = 1;
+        }
+    }
+    
+    free(expected);
+    dag_graph_free_all(graph);
+    return result;
+}
+
+/**
+ * Every vote kernel the CPU supports must resolve graphs like scalar,
+ * near ties included
+ */
+static int test_vote_kernels(void) {
+    DAGVoteKernel active = dag_vote_kernel();
+    DAGGraph* graph = test_random_graph(2000, 150, 11);
+    if (!graph || dag_vote_set_kernel(DAG_VOTE_SCALAR) != 0 || dag_graph_resolve(graph) != 0) {
+        return 1;
+    }
+
+    uint8_t* expected = (uint8_t*)malloc(graph->node_count);
+    if (!expected) {
+        return 1;
+    }
+    memcpy(expected, graph->states, graph->node_count);
+
+    int result = 0;
+    for (int k = 0; k < DAG_VOTE_KERNEL_COUNT && result == 0; k++) {
+        if (!dag_vote_kernel_supported((DAGVoteKernel)k)) {
+            continue;
+        }
+        if (dag_vote_set_kernel((DAGVoteKernel)k) != 0 ||
+            dag_graph_resolve(graph) != 0 ||
+            memcmp(expected, graph->states, graph->node_count) != 0 ||
+            dag_graph_resolve_parallel(graph, 4) != 0 ||
+            memcmp(expected, graph->states, graph->node_count) != 0) {
+            result = 1;
+        }
+    }
+
+    // A near tie only the summation order decides: a sequential sum drops
+    // every 1.0 added to 2^24, the eight-lane order keeps fourteen of them
+    DAGGraph* tie = dag_graph_create(18);
+    for (size_t i = 0; tie && i < 18; i++) {
+        DAGNode* node = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+        if (!node || dag_graph_add_node(tie, node) != 0) {
+            result = 1;
+            break;
+        }
+    }
+    if (!tie || result != 0) {
+        result = 1;
+    } else {
+        DAGNode* inhibited = tie->nodes[16];
+        DAGNode* target = tie->nodes[17];
+        dag_add_edge(tie->nodes[0], inhibited, -1.0f);
+        for (size_t i = 0; i < 16; i++) {
+            dag_add_edge(tie->nodes[i], target, i == 0 ? 16777216.0f : 1.0f);
+        }
+        dag_add_edge(inhibited, target, 16777220.0f);
+    }
+    for (int k = 0; k < DAG_VOTE_KERNEL_COUNT && result == 0; k++) {
+        if (!dag_vote_kernel_supported((DAGVoteKernel)k)) {
+            continue;
+        }
+        if (dag_vote_set_kernel((DAGVoteKernel)k) != 0 ||
+            dag_graph_resolve(tie) != 0 ||
+            tie->states[16] != STATE_FALSE || tie->states[17] != STATE_TRUE) {
+            result = 1;
+        }
+    }
+    dag_graph_free_all(tie);
+
+    if (dag_vote_set_kernel(DAG_VOTE_KERNEL_COUNT) == 0 ||
+        strcmp(dag_vote_kernel_name(DAG_VOTE_AVX2), "avx2") != 0) {
+        result = 1;
+    }
+
+    dag_vote_set_kernel(active);
+    free(expected);
+    dag_graph_free_all(graph);
+    return result;
+}
+
+/**
+ * Index queries must agree with a linear walk and follow graph changes
+ */
+static int test_node_query(void) {
+    DAGGraph* graph = test_random_graph(3000, 2, 5);
+    if (!graph || dag_graph_resolve(graph) != 0) {
+        return 1;
+    }
+
+    size_t n = graph->node_count;
+    DAGNodeSet* actions = dag_node_set_create(n);
+    DAGNodeSet* live = dag_node_set_create(n);
+    DAGNodeSet* reach = dag_node_set_create(n);
+    int result = 0;
+    if (!actions || !live || !reach ||
+        dag_graph_select_category(graph, TAX_ACTION, actions) != 0 ||
+        dag_graph_select_state(graph, STATE_TRUE, live) != 0 ||
+        dag_node_set_and(actions, live) != 0) {
+        result = 1;
+    }
+
+    size_t expected = 0;
+    for (size_t i = 0; i < n && result == 0; i++) {
+        bool match = graph->nodes[i]->category == TAX_ACTION &&
+                     graph->nodes[i]->state == STATE_TRUE;
+        expected += match;
+        if (dag_node_set_contains(actions, i) != match) {
+            result = 1;
+        }
+    }
+    if (expected == 0 || dag_node_set_count(actions) != expected) {
+        result = 1;
+    }
+
+    // Reachability from one node against a walk over its edge lists
+    uint8_t* seen = (uint8_t*)calloc(n, 1);
+    size_t* stack = (size_t*)malloc(n * sizeof(size_t));
+    size_t top = 0;
+    if (!seen || !stack || dag_node_set_add(reach, 10) != 0 ||
+        dag_graph_select_reachable(graph, reach, reach) != 0) {
+        result = 1;
+    } else {
+        seen[10] = 1;
+        stack[top++] = 10;
+        while (top > 0) {
+            DAGNode* node = graph->nodes[stack[--top]];
+            for (size_t e = 0; e < node->out_count; e++) {
+                size_t target = node->out_edges[e].target->index;
+                if (!seen[target]) {
+                    seen[target] = 1;
+                    stack[top++] = target;
+                }
+            }
+        }
+        size_t count = 0;
+        for (size_t i = dag_node_set_next(reach, 0); i < n; i = dag_node_set_next(reach, i + 1)) {
+            result |= !seen[i];
+            count++;
+        }
+        for (size_t i = 0; i < n; i++) {
+            count -= seen[i];
+        }
+        result |= count != 0;
+    }
+    free(seen);
+    free(stack);
+
+    // Added nodes join the index without a rebuild
+    DAGNode* number = dag_node_create(TOKEN_NUMBER, TAX_RESOURCE);
+    DAGNodeSet* numbers = dag_node_set_create(n + 1);
+    if (!number || !numbers || dag_graph_add_node(graph, number) != 0 ||
+        dag_graph_select_type(graph, TOKEN_NUMBER, numbers) != 0 ||
+        dag_node_set_count(numbers) != 1 || dag_node_set_next(numbers, 0) != n ||
+        dag_graph_select_category(graph, TAX_RESOURCE, actions) == 0) {
+        result = 1;
+    }
+
+    // States of a resolve older than the added node come from the nodes
+    if (numbers && (dag_graph_select_state(graph, STATE_UNKNOWN, numbers) != 0 ||
+                    !dag_node_set_contains(numbers, n))) {
+        result = 1;
+    }
+
+    dag_node_set_free(actions);
+    dag_node_set_free(live);
+    dag_node_set_free(reach);
+    dag_node_set_free(numbers);
+    dag_graph_free_all(graph);
+
+    // States written after a resolve reach queries on a resolved graph
+    graph = dag_graph_create(2);
+    DAGNode* a = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+    DAGNode* b = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+    DAGNodeSet* failed = dag_node_set_create(2);
+    if (!graph || !a || !b || !failed ||
+        dag_graph_add_node(graph, a) != 0 || dag_graph_add_node(graph, b) != 0) {
+        dag_node_free(a);
+        dag_node_free(b);
+        dag_node_set_free(failed);
+        dag_graph_free_all(graph);
+        return 1;
+    }
+    dag_add_edge(a, b, -1.0f);
+    if (dag_graph_resolve(graph) != 0 ||
+        dag_graph_select_state(graph, STATE_FALSE, failed) != 0 ||
+        dag_node_set_count(failed) != 1) {
+        result = 1;
+    }
+    b->state = STATE_TRUE;
+    dag_graph_states_changed(graph);
+    if (dag_graph_select_state(graph, STATE_FALSE, failed) != 0 ||
+        dag_node_set_count(failed) != 0) {
+        result = 1;
+    }
+
+    // ...and after a dag_resolve() over the graph's own nodes
+    b->state = STATE_TRUE;
+    if (dag_graph_resolve(graph) != 0 ||
+        dag_resolve((DAGNode*[]){ b }, 1) != 0 ||
+        dag_graph_select_state(graph, STATE_FALSE, failed) != 0 ||
+        dag_node_set_count(failed) != 0 || graph->states[b->index] != STATE_TRUE) {
+        result = 1;
+    }
+
+    dag_node_set_free(failed);
+    dag_graph_free_all(graph);
+    return result;
+}
+
+typedef struct TestProducerTask {
+    DAGBuilder* builder;
+    const DAGGraph* source;
+    size_t begin;
+    size_t end;
+    int result;
+} TestProducerTask;
+
+/**
+ * Append the in-edges of a slice of the source graph's nodes
+ */
+static void* test_producer_run(void* arg) {
+    TestProducerTask* task = (TestProducerTask*)arg;
+    DAGProducer* producer = dag_builder_producer(task->builder);
+    task->result = producer ? 0 : 1;
+    for (size_t i = task->begin; i < task->end && task->result == 0; i++) {
+        const DAGNode* node = task->source->nodes[i];
+        for (size_t e = 0; e < node->in_count; e++) {
+            if (dag_producer_add_edge(producer, (uint32_t)node->in_edges[e].target->index,
+                                      (uint32_t)i, node->in_edges[e].weight) != 0) {
+                task->result = 1;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Edges appended from several threads must resolve like a serial build
+ */
+static int test_concurrent_builder(void) {
+    enum { PRODUCERS = 4 };
+    DAGGraph* expected = test_random_graph(20000, 3, 42);
+    DAGBuilder* builder = dag_builder_create();
+    DAGProducer* nodes = dag_builder_producer(builder);
+    if (!expected || !nodes || dag_graph_resolve(expected) != 0) {
+        return 1;
+    }
+    for (size_t i = 0; i < expected->node_count; i++) {
+        if (dag_producer_add_node(nodes, TOKEN_IDENTIFIER, (TaxonomyCategory)(i % 5)) != i) {
+            return 1;
+        }
+    }
+
+    pthread_t threads[PRODUCERS];
+    TestProducerTask tasks[PRODUCERS];
+    int result = 0;
+    for (size_t t = 0; t < PRODUCERS; t++) {
+        tasks[t].builder = builder;
+        tasks[t].source = expected;
+        tasks[t].begin = expected->node_count * t / PRODUCERS;
+        tasks[t].end = expected->node_count * (t + 1) / PRODUCERS;
+        if (pthread_create(&threads[t], NULL, test_producer_run, &tasks[t]) != 0) {
+            return 1;
+        }
+    }
+    for (size_t t = 0; t < PRODUCERS; t++) {
+        pthread_join(threads[t], NULL);
+        result |= tasks[t].result;
+    }
+
+    DAGGraph* graph = dag_builder_finish(builder, 4);
+    if (result != 0 || !graph || graph->node_count != expected->node_count ||
+        graph->edge_count != expected->edge_count || dag_graph_resolve(graph) != 0 ||
+        memcmp(graph->states, expected->states, graph->node_count) != 0) {
+        result = 1;
+    }
+    for (size_t i = 0; graph && i < graph->node_count && result == 0; i++) {
+        if (graph->nodes[i]->in_count != expected->nodes[i]->in_count ||
+            graph->nodes[i]->out_count != expected->nodes[i]->out_count) {
+            result = 1;
+        }
+    }
+    dag_graph_free_all(graph);
+
+    // An edge to a node nobody added fails the whole build
+    if (dag_producer_add_edge(nodes, 0, (uint32_t)expected->node_count, 1.0f) != 0 ||
+        dag_builder_finish_on(builder, NULL) != NULL) {
+        result = 1;
+    }
+
+    dag_builder_free(builder);
+    dag_graph_free_all(expected);
+    return result;
+}
+
+/**
+ * Incremental updates must match a full resolve and stop early
+ */
+static int test_incremental_resolve(void) {
+    DAGGraph* graph = test_random_graph(5000, 3, 7);
+    if (!graph || dag_graph_resolve(graph) != 0) {
+        return 1;
+    }
+    
+    // Re-weight a few edges, update incrementally, compare with a full pass
+    unsigned int seed = 99;
+    for (int round = 0; round < 20; round++) {
+        DAGNode* to = graph->nodes[1 + test_random(&seed) % (graph->node_count - 1)];
+        DAGNode* from = to->in_edges[0].target;
+        float weight = (float)((int)(test_random(&seed) % 7) - 3);
+        if (dag_graph_set_edge_weight(graph, from, to, weight) != 0 ||
+            dag_graph_resolve_dirty(graph) < 0) {
+            return 1;
+        }
+    }
+    
+    uint8_t* incremental = (uint8_t*)malloc(graph->node_count);
+    if (!incremental) {
+        return 1;
+    }
+    memcpy(incremental, graph->states, graph->node_count);
+    int result = dag_graph_resolve(graph) != 0 ||
+                 memcmp(incremental, graph->states, graph->node_count) != 0;
+    free(incremental);
+    dag_graph_free_all(graph);
+    if (result != 0) {
+        return 1;
+    }
+    
+    // Flipping a root changes its chain but not an independent branch
+    graph = dag_graph_create(0);
+    DAGNode* nodes[4];
+    for (size_t i = 0; i < 4; i++) {
+        nodes[i] = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+        if (!nodes[i] || dag_graph_add_node(graph, nodes[i]) != 0) {
+            return 1;
+        }
+    }
+    dag_add_edge(nodes[0], nodes[1], 1.0f);
+    dag_add_edge(nodes[1], nodes[2], 1.0f);
+    dag_add_edge(nodes[3], nodes[2], 5.0f);
+    if (dag_graph_resolve(graph) != 0) {
+        return 1;
+    }
+    
+    nodes[0]->state = STATE_FALSE;
+    if (dag_graph_mark_dirty(graph, nodes[0]) != 0 ||
+        dag_graph_resolve_dirty(graph) != 1 ||
+        nodes[1]->state != STATE_FALSE || nodes[2]->state != STATE_TRUE) {
+        return 1;
+    }
+    
+    // A marked leaf changes no successor but must still reach state queries
+    DAGNodeSet* failed = dag_node_set_create(4);
+    result = !failed || dag_graph_select_state(graph, STATE_FALSE, failed) != 0 ||
+             dag_node_set_count(failed) != 2;
+    nodes[2]->state = STATE_FALSE;
+    result |= dag_graph_mark_dirty(graph, nodes[2]) != 0 ||
+              dag_graph_resolve_dirty(graph) != 0 ||
+              dag_graph_select_state(graph, STATE_FALSE, failed) != 0 ||
+              dag_node_set_count(failed) != 3 || !dag_node_set_contains(failed, 2);
+
+    // A state flip after an edge edit survives the fallback full resolve
+    nodes[0]->state = STATE_TRUE;
+    dag_graph_states_changed(graph);
+    dag_add_edge(nodes[0], nodes[3], 1.0f);
+    nodes[0]->state = STATE_FALSE;
+    result |= dag_graph_mark_dirty(graph, nodes[0]) != 0 ||
+              dag_graph_resolve_dirty(graph) < 0 ||
+              nodes[0]->state != STATE_FALSE || nodes[1]->state != STATE_FALSE ||
+              nodes[3]->state != STATE_FALSE || nodes[2]->state != STATE_FALSE;
+
+    dag_node_set_free(failed);
+    dag_graph_free_all(graph);
+    return result;
+}
+
+/**
+ * Heap allocator that refuses every request once its budget is spent
+ * and tracks the bytes it has outstanding by the sizes it is told
+ */
+typedef struct {
+    size_t budget;
+    size_t live;
+} TestBudget;
+
+static void* test_budget_alloc(void* ctx, size_t size) {
+    TestBudget* budget = (TestBudget*)ctx;
+    if (budget->budget == 0) {
+        return NULL;
+    }
+    budget->budget--;
+    void* ptr = malloc(size);
+    budget->live += ptr ? size : 0;
+    return ptr;
+}
+
+static void* test_budget_resize(void* ctx, void* ptr, size_t old_size, size_t new_size) {
+    TestBudget* budget = (TestBudget*)ctx;
+    if (budget->budget == 0) {
+        return NULL;
+    }
+    budget->budget--;
+    void* resized = realloc(ptr, new_size);
+    if (resized) {
+        budget->live += new_size - old_size;
+    }
+    return resized;
+}
+
+static void test_budget_release(void* ctx, void* ptr, size_t size) {
+    TestBudget* budget = (TestBudget*)ctx;
+    if (ptr) {
+        budget->live -= size;
+    }
+    free(ptr);
+}
+
+/**
+ * Patterns sharing prefixes split compressed edges and stay retrievable
+ */
+static int test_compressed_trie(void) {
+    TrieNode* root = trie_node_create("root", TAX_UNKNOWN, 1.0f);
+    if (!root) {
+        return 1;
+    }
+    
+    const char* patterns[] = {"compile", "compiler", "comp", "config", "c[0-9]+", "link"};
+    for (size_t i = 0; i < 6; i++) {
+        trie_insert(root, patterns[i], (TaxonomyCategory)(1 + i % 4), 1.0f);
+    }
+    trie_insert(root, "compile", TAX_CONTROLLER, 9.0f);
+    trie_insert(root, "broken(", TAX_ACTION, 1.0f);
+    
+    int result = 0;
+    for (size_t i = 0; i < 6 && result == 0; i++) {
+        TrieNode* node = trie_lookup(root, patterns[i]);
+        if (!node || node->category != (TaxonomyCategory)(1 + i % 4) ||
+            strcmp(node->pattern_str, patterns[i]) != 0) {
+            result = 1;
+        }
+    }
+    
+    // "co" is a branch point, not a pattern; two children hang off the root
+    if (trie_lookup(root, "co") || trie_lookup(root, "broken(") ||
+        trie_lookup(root, "compiles") || trie_for_each(root, NULL, NULL) != 6 ||
+        root->child_count != 2 || root->children[0]->label_len != 1) {
+        result = 1;
+    }
+    
+    // Literals skip the regex engine, real expressions still use it
+    TrieNode* regex = trie_lookup(root, "c[0-9]+");
+    TrieNode* literal = trie_lookup(root, "config");
+    if (!regex || !literal || !regex->compiled || literal->compiled ||
+        !trie_match_node(regex, "c42", 3) || !trie_match_node(literal, "config", 6) ||
+        trie_match_node(literal, "confi", 5)) {
+        result = 1;
+    }
+    trie_free(root);
+    
+    // Child arrays growing under memory pressure keep their sizes in step
+    for (size_t calls = 0; calls < 64 && result == 0; calls++) {
+        TestBudget budget = { calls, 0 };
+        PolyAllocator failing = { test_budget_alloc, test_budget_resize, test_budget_release,
+                                  NULL, &budget };
+        TrieNode* small = trie_node_create_in(&failing, "root", TAX_UNKNOWN, 1.0f);
+        const char* words[] = {"alpha", "beta", "gamma", "delta", "epsilon", "zeta"};
+        for (size_t i = 0; small && i < 6; i++) {
+            trie_insert(small, words[i], TAX_ACTION, 1.0f);
+        }
+        trie_free(small);
+        if (budget.live != 0) {
+            result = 1;
+        }
+    }
+    return result;
+}
+
+/**
+ * Records matches of a scan for inspection
+ */
+typedef struct {
+    TrieScanMatch matches[64];
+    size_t count;
+} TestScanLog;
+
+static bool test_log_match(const TrieScanMatch* match, void* ctx) {
+    TestScanLog* log = (TestScanLog*)ctx;
+    if (log->count < 64) {
+        log->matches[log->count] = *match;
+    }
+    log->count++;
+    return true;
+}
+
+static bool test_has_match(const TestScanLog* log, size_t offset, size_t length,
+                           const char* pattern) {
+    for (size_t i = 0; i < log->count && i < 64; i++) {
+        if (log->matches[i].offset == offset && log->matches[i].length == length &&
+            strcmp(log->matches[i].rule->pattern_str, pattern) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Overlapping literals and regex runs are all found in one scan
+ */
+static int test_span_match(void) {
+    TrieNode* number = trie_node_create("[0-9]+", TAX_PROPERTY, 1.0f);
+    TrieNode* word = trie_node_create("build", TAX_ACTION, 1.0f);
+    if (!number || !word) {
+        return 1;
+    }
+    
+    // Matches must stop at len, not at the terminator
+    const char* text = "427x90";
+    size_t match_len = 0;
+    int result = 0;
+    if (!trie_match_prefix(number, text, 2, &match_len) || match_len != 2 ||
+        !trie_match_prefix(number, text, 5, &match_len) || match_len != 3 ||
+        trie_match_prefix(number, text + 3, 2, &match_len) ||
+        !trie_match_node(number, text, 3) || trie_match_node(number, text, 4)) {
+        result = 1;
+    }
+    
+    size_t start = 0;
+    size_t end = 0;
+    if (!trie_search(number, text, 3, 5, &start, &end) ||
+        start != 4 || end != 5) {
+        result = 1;
+    }
+    
+    const char* line = "rebuild builder";
+    if (!trie_search(word, line, 3, strlen(line), &start, &end) || start != 8 ||
+        !trie_match_prefix(word, line + 8, 7, &match_len) || match_len != 5 ||
+        trie_match_node(word, line + 8, 7)) {
+        result = 1;
+    }
+    
+    trie_free(number);
+    trie_free(word);
+    return result;
+}
+
+static int test_match_sink(void) {
+    TrieNode* root = trie_node_create("root", TAX_UNKNOWN, 1.0f);
+    if (!root) {
+        return 1;
+    }
+    trie_insert(root, "ab", TAX_ACTION, 2.0f);
+    
+    // Far more matches than the old fixed cap of 100
+    size_t repeats = 500;
+    char* text = (char*)malloc(repeats * 2 + 1);
+    if (!text) {
+        trie_free(root);
+        return 1;
+    }
+    for (size_t i = 0; i < repeats; i++) {
+        memcpy(text + i * 2, "ab", 2);
+    }
+    text[repeats * 2] = '\0';
+    
+    int result = 0;
+    TrieDagMatchBuffer buffer;
+    trie_dag_match_buffer_init(&buffer, NULL);
+    long found = trie_dag_scan(root, text, repeats * 2, trie_dag_match_buffer_append, &buffer);
+    if (found != (long)repeats || buffer.count != repeats) {
+        result = 1;
+    }
+    for (size_t i = 0; i < buffer.count; i++) {
+        if (buffer.matches[i].offset != i * 2 || buffer.matches[i].length != 2 ||
+            buffer.matches[i].category != TAX_ACTION || buffer.matches[i].weight != 2.0f) {
+            result = 1;
+        }
+    }
+    trie_dag_match_buffer_free(&buffer);
+    
+    DAGNode** nodes = create_dag_from_trie_matches(root, text, repeats * 2);
+    size_t count = 0;
+    while (nodes && nodes[count]) {
+        count++;
+    }
+    if (count != repeats) {
+        result = 1;
+    }
+    trie_dag_free_matches(nodes);
+    
+    // Running out of memory mid-scan fails the call instead of truncating
+    TestBudget budget = { 50, 0 };
+    PolyAllocator failing = { test_budget_alloc, test_budget_resize, test_budget_release,
+                              NULL, &budget };
+    if (create_dag_from_trie_matches_in(&failing, root, text, repeats * 2) != NULL ||
+        budget.budget != 0 || budget.live != 0) {
+        result = 1;
+    }
+    
+    free(text);
+    trie_free(root);
+    return result;
+}
+
+static bool test_skip_dir(const char* path, bool is_dir, void* ctx) {
+    (void)ctx;
+    size_t len = strlen(path);
+    return !is_dir || len < 5 || strcmp(path + len - 5, "/skip") != 0;
+}
+
+static bool test_count_source(const TrieDagMatch* match, void* ctx) {
+    size_t len = match->source ? strlen(match->source) : 0;
+    if (len >= 5 && strcmp(match->source + len - 5, "a.txt") == 0) {
+        (*(size_t*)ctx)++;
+    }
+    return true;
+}
+
+static int test_write_file(const char* dir, const char* name, const char* text) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return 1;
+    }
+    fputs(text, file);
+    fclose(file);
+    return 0;
+}
+
+static int test_file_scan(void) {
+    char dir[] = "/tmp/polybuild_testXXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+    
+    char sub[256];
+    char skip[256];
+    snprintf(sub, sizeof(sub), "%s/sub", dir);
+    snprintf(skip, sizeof(skip), "%s/skip", dir);
+    int result = 0;
+    if (mkdir(sub, 0700) != 0 || mkdir(skip, 0700) != 0 ||
+        test_write_file(dir, "a.txt", "build and rebuild") != 0 ||
+        test_write_file(dir, "empty.txt", "") != 0 ||
+        test_write_file(sub, "b.txt", "build") != 0 ||
+        test_write_file(skip, "c.txt", "build") != 0) {
+        result = 1;
+    }
+    
+    TrieNode* root = trie_node_create("root", TAX_UNKNOWN, 1.0f);
+    TrieScanner* scanner = NULL;
+    if (root) {
+        trie_insert(root, "build", TAX_ACTION, 1.0f);
+        scanner = trie_scanner_create(root);
+    }
+    
+    DAGGraph* graph = dag_graph_create(0);
+    FileScanOptions options = { test_skip_dir, NULL };
+    if (!scanner || !graph ||
+        file_scan_tree(scanner, dir, &options, trie_dag_graph_append, graph) != 3 ||
+        graph->node_count != 3 || graph->nodes[0]->category != TAX_ACTION) {
+        result = 1;
+    }
+    
+    size_t from_a = 0;
+    if (!scanner || file_scan_tree(scanner, dir, NULL, test_count_source, &from_a) != 4 ||
+        from_a != 2) {
+        result = 1;
+    }
+    
+    char missing[300];
+    snprintf(missing, sizeof(missing), "%s/missing", dir);
+    if (!scanner || file_scan_tree(scanner, missing, NULL, test_count_source, &from_a) != -1) {
+        result = 1;
+    }
+    
+    dag_graph_free_all(graph);
+    trie_scanner_free(scanner);
+    trie_free(root);
+    
+    const char* files[] = {"a.txt", "empty.txt", "sub/b.txt", "skip/c.txt", "sub", "skip"};
+    for (size_t i = 0; i < 6; i++) {
+        char path[300];
+        snprintf(path, sizeof(path), "%s/%s", dir, files[i]);
+        remove(path);
+    }
+    rmdir(dir);
+    return result;
+}
+
+static int test_batch_scan(void) {
+    TrieNode* root = trie_node_create("root", TAX_UNKNOWN, 1.0f);
+    if (!root) {
+        return 1;
+    }
+    trie_insert(root, "build", TAX_ACTION, 1.0f);
+    trie_insert(root, "lib", TAX_RESOURCE, 1.0f);
+    TrieScanner* scanner = trie_scanner_create(root);
+    
+    const char* texts[] = {"build lib", "lib", "", "lib build build", "none"};
+    FileScanInput inputs[200];
+    for (size_t i = 0; i < 200; i++) {
+        inputs[i].path = NULL;
+        inputs[i].text = texts[i % 5];
+        inputs[i].len = strlen(texts[i % 5]);
+    }
+    // Missing files are skipped
+    inputs[7].text = NULL;
+    inputs[7].path = "/nonexistent/polybuild";
+    
+    // Sequential reference in input order
+    DAGGraph* expected = dag_graph_create(0);
+    for (size_t i = 0; scanner && expected && i < 200; i++) {
+        if (inputs[i].text) {
+            trie_dag_scan_with(scanner, inputs[i].text, inputs[i].len,
+                               trie_dag_graph_append, expected);
+        }
+    }
+    
+    ThreadPool* pool = thread_pool_create(4);
+    DAGGraph* graph = dag_graph_create(0);
+    int result = 0;
+    long added = file_scan_batch(scanner, inputs, 200, pool, graph);
+    if (!expected || !graph || added != (long)expected->node_count ||
+        graph->node_count != expected->node_count) {
+        result = 1;
+    } else {
+        for (size_t i = 0; i < graph->node_count; i++) {
+            if (graph->nodes[i]->category != expected->nodes[i]->category) {
+                result = 1;
+            }
+        }
+    }
+    
+    // Arena-backed graphs get arena nodes, released with the arena
+    PolyArena* arena = poly_arena_create(0);
+    DAGGraph* arena_graph = arena ? dag_graph_create_in(poly_arena_allocator(arena), 0) : NULL;
+    if (!arena_graph ||
+        file_scan_batch(scanner, inputs, 200, pool, arena_graph) != added) {
+        result = 1;
+    }
+    for (size_t i = 0; arena_graph && i < arena_graph->node_count; i++) {
+        if (arena_graph->nodes[i]->allocator != arena_graph->allocator) {
+            result = 1;
+        }
+    }
+    poly_arena_destroy(arena);
+
+    // Running out of memory mid-merge leaves the graph as it was
+    TestBudget budget = { 20, 0 };
+    PolyAllocator failing = { test_budget_alloc, test_budget_resize, test_budget_release,
+                              NULL, &budget };
+    DAGGraph* small = dag_graph_create_in(&failing, 0);
+    DAGNode* first = dag_node_create_in(&failing, TOKEN_IDENTIFIER, TAX_ACTION);
+    if (!small || !first || dag_graph_add_node(small, first) != 0) {
+        result = 1;
+    } else {
+        size_t live = budget.live;
+        if (file_scan_batch(scanner, inputs, 200, pool, small) != -1 ||
+            small->node_count != 1 || small->nodes[0] != first || budget.live != live) {
+            result = 1;
+        }
+    }
+    dag_graph_free_all(small);
+
+    thread_pool_destroy(pool);
+    dag_graph_free_all(graph);
+    dag_graph_free_all(expected);
+    trie_scanner_free(scanner);
+    trie_free(root);
+    return result;
+}
+
+typedef struct {
+    size_t order[16];
+    DAGExecOutcome outcome[16];
+    size_t count;
+} TestExecLog;
+
+static void test_log_exec(const DAGExecReport* report, void* ctx) {
+    TestExecLog* log = (TestExecLog*)ctx;
+    if (log->count < 16) {
+        log->order[log->count] = report->node;
+        log->outcome[log->count] = report->outcome;
+        log->count++;
+    }
+}
+
+static size_t test_exec_position(const TestExecLog* log, size_t node) {
+    for (size_t i = 0; i < log->count; i++) {
+        if (log->order[i] == node) {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+/**
+ * Wait up to about five seconds for a file to appear
+ */
+static bool test_wait_for_file(const char* path) {
+    for (int i = 0; i < 500; i++) {
+        if (access(path, F_OK) == 0) {
+            return true;
+        }
+        struct timespec pause = { 0, 10000000L };
+        nanosleep(&pause, NULL);
+    }
+    return false;
+}
+
+/**
+ * Ctrl-C on a build driver must reach the commands it is running
+ */
+static int test_exec_interrupt(void) {
+    char dir[] = "/tmp/polybuild_interruptXXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+    char started[64];
+    char interrupted[64];
+    char command[256];
+    snprintf(started, sizeof(started), "%s/started", dir);
+    snprintf(interrupted, sizeof(interrupted), "%s/interrupted", dir);
+    snprintf(command, sizeof(command),
+             "trap 'touch %s; exit 1' INT; touch %s; sleep 10", interrupted, started);
+
+    // The driver leads its own group, standing in for a terminal's foreground job
+    pid_t driver = fork();
+    if (driver == 0) {
+        setpgid(0, 0);
+        DAGGraph* graph = dag_graph_create(1);
+        DAGNode* node = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+        if (!graph || !node || dag_graph_add_node(graph, node) != 0) {
+            _exit(2);
+        }
+        BuildAction action[1] = { { "long", command, NULL, 0, NULL, 0 } };
+        dag_graph_execute(graph, action, NULL, NULL);
+        _exit(0);
+    }
+
+    int result = driver < 0 || !test_wait_for_file(started);
+    if (driver > 0) {
+        kill(-driver, SIGINT);
+        waitpid(driver, NULL, 0);
+    }
+    result |= !test_wait_for_file(interrupted);
+
+    remove(started);
+    remove(interrupted);
+    rmdir(dir);
+    return result;
+}
+
+static int test_executor(void) {
+    // w is independent; x -> y -> z is the critical path
+    DAGGraph* graph = dag_graph_create(4);
+    if (!graph) {
+        return 1;
+    }
+    DAGNode* nodes[4];
+    for (size_t i = 0; i < 4; i++) {
+        nodes[i] = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+        if (!nodes[i] || dag_graph_add_node(graph, nodes[i]) != 0) {
+            return 1;
+        }
+    }
+    dag_add_edge(nodes[1], nodes[2], 1.0f);
+    dag_add_edge(nodes[2], nodes[3], 1.0f);
+    
+    BuildAction actions[4] = {
+        { "w", NULL, NULL, 0, NULL, 0 },
+        { "x", "exit 0", NULL, 0, NULL, 0 },
+        { "y", "exit 0", NULL, 0, NULL, 0 },
+        { "z", "exit 0", NULL, 0, NULL, 0 }
+    };
+    TestExecLog log = { .count = 0 };
+    DAGExecOptions options = { 1, false, NULL, NULL, test_log_exec, &log, false, NULL, NULL, NULL };
+    DAGExecOutcome outcomes[4];
+    
+    // A child of our own exits during the run and must still be ours to reap
+    pid_t own = fork();
+    if (own == 0) {
+        _exit(7);
+    }
+
+    int result = 0;
+    if (dag_graph_execute(graph, actions, &options, outcomes) != 0 || log.count != 4 ||
+        log.order[0] != 1 || log.order[1] != 2 || outcomes[0] != DAG_EXEC_SUCCEEDED ||
+        outcomes[3] != DAG_EXEC_SUCCEEDED || nodes[3]->state != STATE_TRUE) {
+        result = 1;
+    }
+    int own_status;
+    if (own < 0 || waitpid(own, &own_status, 0) != own ||
+        !WIFEXITED(own_status) || WEXITSTATUS(own_status) != 7) {
+        result = 1;
+    }
+    
+    // A failing action blocks its dependents but not independent work
+    actions[1].command = "exit 3";
+    log.count = 0;
+    options.jobs = 2;
+    options.keep_going = true;
+    if (dag_graph_execute(graph, actions, &options, outcomes) != -1 ||
+        outcomes[0] != DAG_EXEC_SUCCEEDED || outcomes[1] != DAG_EXEC_FAILED ||
+        outcomes[2] != DAG_EXEC_BLOCKED || outcomes[3] != DAG_EXEC_BLOCKED ||
+        nodes[1]->state != STATE_FALSE ||
+        test_exec_position(&log, 2) < test_exec_position(&log, 1)) {
+        result = 1;
+    }
+    
+    // Without keep_going nothing new starts after the failure
+    log.count = 0;
+    options.jobs = 1;
+    options.keep_going = false;
+    if (dag_graph_execute(graph, actions, &options, outcomes) != -1 ||
+        outcomes[0] != DAG_EXEC_PENDING || outcomes[1] != DAG_EXEC_FAILED ||
+        log.count != 1) {
+        result = 1;
+    }
+    
+    // Nodes and edges added after a resolve are scheduled, not read past
+    actions[1].command = "exit 0";
+    DAGNode* late = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+    if (dag_graph_resolve(graph) != 0 || !late || dag_graph_add_node(graph, late) != 0) {
+        dag_node_free(late);
+        dag_graph_free_all(graph);
+        return 1;
+    }
+    dag_add_edge(nodes[3], late, 1.0f);
+    BuildAction more[5] = {
+        actions[0], actions[1], actions[2], actions[3], { "v", "exit 0", NULL, 0, NULL, 0 }
+    };
+    DAGExecOutcome more_outcomes[5];
+    log.count = 0;
+    if (dag_graph_execute(graph, more, &options, more_outcomes) != 0 || log.count != 5 ||
+        more_outcomes[4] != DAG_EXEC_SUCCEEDED ||
+        test_exec_position(&log, 4) < test_exec_position(&log, 3)) {
+        result = 1;
+    }
+    dag_graph_free_all(graph);
+    
+    // State queries see what an execution published
+    DAGGraph* single = dag_graph_create(1);
+    DAGNode* only = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+    DAGNodeSet* failed = dag_node_set_create(1);
+    BuildAction fails[1] = { { "f", "false", NULL, 0, NULL, 0 } };
+    DAGExecOutcome fails_outcome[1];
+    if (!single || !only || !failed || dag_graph_add_node(single, only) != 0 ||
+        dag_graph_resolve(single) != 0 ||
+        dag_graph_select_state(single, STATE_FALSE, failed) != 0 ||
+        dag_node_set_count(failed) != 0 ||
+        dag_graph_execute(single, fails, &options, fails_outcome) != -1 ||
+        dag_graph_select_state(single, STATE_FALSE, failed) != 0 ||
+        !dag_node_set_contains(failed, 0)) {
+        result = 1;
+    }
+    dag_node_set_free(failed);
+    dag_graph_free_all(single);
+    return result | test_exec_interrupt();
+}
+
+static int test_exec_history(void) {
+    char path[] = "/tmp/polybuild_historyXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+    remove(path);
+    
+    DAGExecHistory* history = dag_exec_history_load(path);
+    if (!history || dag_exec_history_count(history) != 0) {
+        return 1;
+    }
+    
+    // Two independent actions; the history says "slow" takes longer
+    dag_exec_history_record(history, "fast", 1.0);
+    dag_exec_history_record(history, "slow link step", 5.0);
+    dag_exec_history_record(history, "slow link step", 10.0);
+    
+    int result = 0;
+    double seconds = 0.0;
+    if (!dag_exec_history_lookup(history, "slow link step", &seconds) ||
+        seconds <= 5.0 || seconds >= 10.0 ||
+        dag_exec_history_save(history, path) != 0) {
+        result = 1;
+    }
+    dag_exec_history_free(history);
+    
+    history = dag_exec_history_load(path);
+    double reloaded = 0.0;
+    if (!history || dag_exec_history_count(history) != 2 ||
+        !dag_exec_history_lookup(history, "slow link step", &reloaded) || reloaded != seconds) {
+        result = 1;
+    }
+    
+    DAGGraph* graph = dag_graph_create(2);
+    DAGNode* fast = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+    DAGNode* slow = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+    if (!graph || dag_graph_add_node(graph, fast) != 0 || dag_graph_add_node(graph, slow) != 0) {
+        return 1;
+    }
+    BuildAction actions[2] = {
+        { "fast", "exit 0", NULL, 0, NULL, 0 },
+        { "slow link step", "exit 0", NULL, 0, NULL, 0 }
+    };
+    TestExecLog log = { .count = 0 };
+    DAGExecOptions options = { 1, false, NULL, NULL, test_log_exec, &log, false, history, NULL, NULL };
+    if (dag_graph_execute(graph, actions, &options, NULL) != 0 || log.count != 2 ||
+        log.order[0] != 1 || !dag_exec_history_lookup(history, "fast", &seconds) ||
+        seconds >= 1.0) {
+        result = 1;
+    }
+    
+    dag_graph_free_all(graph);
+    dag_exec_history_free(history);
+    remove(path);
+    return result;
+}
+
+static int test_sha256(void) {
+    const char* inputs[] = {
+        "",
+        "abc",
+        "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+    };
+    const char* expected[] = {
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"
+    };
+    
+    for (size_t i = 0; i < 3; i++) {
+        uint8_t digest[SHA256_DIGEST_SIZE];
+        char hex[2 * SHA256_DIGEST_SIZE + 1];
+        sha256_digest(inputs[i], strlen(inputs[i]), digest);
+        sha256_to_hex(digest, hex);
+        if (strcmp(hex, expected[i]) != 0) {
+            return 1;
+        }
+    }
+    
+    // Feeding bytes one at a time must match the one-shot digest
+    uint8_t whole[SHA256_DIGEST_SIZE];
+    uint8_t pieces[SHA256_DIGEST_SIZE];
+    sha256_digest(inputs[2], strlen(inputs[2]), whole);
+    Sha256 sha;
+    sha256_init(&sha);
+    for (size_t i = 0; inputs[2][i]; i++) {
+        sha256_update(&sha, &inputs[2][i], 1);
+    }
+    sha256_final(&sha, pieces);
+    return memcmp(whole, pieces, sizeof(whole)) != 0;
+}
+
+static int test_intent_expression(void) {
+    // Every keyword must land in its own perfect-hash slot
+    for (int i = 0; i <= INTENT_VERB_CONFIGURE; i++) {
+        const char* name = intent_verb_to_string((IntentVerb)i);
+        IntentVerb verb;
+        if (!intent_verb_lookup(name, strlen(name), &verb) || verb != (IntentVerb)i ||
+            intent_noun_lookup(name, strlen(name), NULL) != (strcmp(name, "source") == 0)) {
+            return 1;
+        }
+    }
+    for (int i = 0; i <= INTENT_NOUN_MANIFEST; i++) {
+        const char* name = intent_noun_to_string((IntentNoun)i);
+        IntentNoun noun;
+        if (!intent_noun_lookup(name, strlen(name), &noun) || noun != (IntentNoun)i) {
+            return 1;
+        }
+    }
+    if (intent_verb_lookup("tset", 4, NULL) || intent_verb_lookup("builds", 6, NULL) ||
+        intent_verb_lookup("", 0, NULL) || intent_noun_lookup("configurations", 14, NULL)) {
+        return 1;
+    }
+    
+    const char* texts[] = {
+        "validate policy live",
+        "build\ttarget",
+        "compile  source optimized_2",
+        "build target release extra",
+        " build target",
+        "build target ",
+        "build-target",
+        "make target",
+        "build targets"
+    };
+    IntentExpression expressions[9];
+    bool valid[9];
+    if (intent_expression_parse_batch(texts, 9, expressions, valid) != 3 ||
+        !valid[0] || !valid[1] || !valid[2] || valid[3] || valid[8]) {
+        return 1;
+    }
+    if (expressions[0].verb != INTENT_VERB_VALIDATE || expressions[0].noun != INTENT_NOUN_POLICY ||
+        expressions[0].binding != texts[0] + 16 || expressions[0].binding_len != 4 ||
+        expressions[1].binding != NULL || expressions[2].binding_len != 11) {
+        return 1;
+    }
+    
+    // A span of a longer buffer parses without a terminator
+    IntentExpression span;
+    return !intent_expression_parse("link artifact now!", 17, &span) ||
+           span.verb != INTENT_VERB_LINK || span.binding_len != 3;
+}
+
+static int test_topology_constraints(void) {
+    // Every table entry must agree with decoding its binary string
+    for (unsigned e = 0; e < TOPOLOGY_ENCODING_COUNT; e++) {
+        char text[8];
+        for (int i = 0; i < 7; i++) {
+            text[i] = (char)('0' + ((e >> i) & 1));
+        }
+        text[7] = '\0';
+        uint8_t encoding;
+        TopologyDecoding* decoding = decode_topology_binary(text);
+        const TopologyConstraints* constraints = topology_constraints((uint8_t)e);
+        bool match = decoding && topology_encoding_parse(text, &encoding) && encoding == e &&
+                     decoding->encoding == e &&
+                     constraints->semantic_validation == (text[0] == '1') &&
+                     constraints->topology_type == (text[2] - '0') * 2 + (text[3] - '0') &&
+                     constraints->fault_tolerance == text[4] - '0' &&
+                     constraints->concurrency_model == (text[5] - '0') * 2 + (text[6] - '0') &&
+                     decoding->concurrency_model == constraints->concurrency_model;
+        free_topology_decoding(decoding);
+        if (!match) {
+            return 1;
+        }
+    }
+    if (topology_encoding_parse("010110", NULL) || topology_encoding_parse("01011010", NULL) ||
+        topology_encoding_parse("0102101", NULL) || decode_topology_binary(NULL)) {
+        return 1;
+    }
+    
+    // Validation fails uncategorized nodes; fault tolerance reopens failures
+    uint8_t categories[4] = { TAX_UNKNOWN, TAX_ACTION, TAX_RESOURCE, TAX_CONTROLLER };
+    uint8_t states[4] = { STATE_TRUE, STATE_FALSE, STATE_TRUE, STATE_UNKNOWN };
+    topology_apply_states(0x11, categories, states, 4);
+    if (states[0] != STATE_FALSE || states[1] != STATE_UNKNOWN || states[2] != STATE_TRUE ||
+        states[3] != STATE_UNKNOWN) {
+        return 1;
+    }
+    
+    DAGNode* nodes[2] = {
+        dag_node_create(TOKEN_IDENTIFIER, TAX_UNKNOWN),
+        dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION)
+    };
+    if (!nodes[0] || !nodes[1]) {
+        dag_node_free(nodes[0]);
+        dag_node_free(nodes[1]);
+        return 1;
+    }
+    nodes[0]->state = STATE_TRUE;
+    nodes[1]->state = STATE_FALSE;
+    TopologyDecoding* topology = decode_topology_binary("1000100");
+    int result = !topology || apply_topology_constraints(nodes, 2, topology) != 0 ||
+                 nodes[0]->state != STATE_FALSE || nodes[1]->state != STATE_UNKNOWN;
+    free_topology_decoding(topology);
+    dag_node_free(nodes[0]);
+    dag_node_free(nodes[1]);
+    return result;
+}
+
+static int test_intent_processing(void) {
+    // Every model must leave a large intent set in the same state
+    enum { COUNT = 2000, MODELS = 3 };
+    const char* encodings[MODELS] = { "1000000", "1000001", "1000010" };
+    IntentResolution** sets[MODELS] = { NULL };
+    int result = 0;
+    for (int m = 0; m < MODELS && result == 0; m++) {
+        sets[m] = (IntentResolution**)calloc(COUNT, sizeof(IntentResolution*));
+        if (!sets[m]) {
+            result = 1;
+            break;
+        }
+        for (size_t i = 0; i < COUNT && result == 0; i++) {
+            char expression[64];
+            snprintf(expression, sizeof(expression), "%s %s b%zu",
+                     intent_verb_to_string((IntentVerb)(i % 9)),
+                     intent_noun_to_string((IntentNoun)(i % 8)), i);
+            IntentResolution* intent = (IntentResolution*)calloc(1, sizeof(IntentResolution));
+            if (!intent || !(intent->semantic_context = strdup(expression))) {
+                free(intent);
+                result = 1;
+                break;
+            }
+            sets[m][i] = intent;
+        }
+        if (result != 0) {
+            break;
+        }
+        // One malformed expression fails only its own intent
+        free(sets[m][7]->semantic_context);
+        sets[m][7]->semantic_context = strdup("build nothing");
+        
+        TopologyDecoding* topology = decode_topology_binary(encodings[m]);
+        result = !topology || !sets[m][7]->semantic_context ||
+                 apply_parallel_intent_processing(sets[m], COUNT, topology) != -1;
+        free_topology_decoding(topology);
+    }
+    
+    for (size_t i = 0; i < COUNT && result == 0; i++) {
+        IntentResolution* first = sets[0][i];
+        if (i == 7) {
+            result = first->stage != INTENT_STAGE_TODO || first->dag_representation;
+        } else {
+            result = first->stage != INTENT_STAGE_DONE || first->verb != (IntentVerb)(i % 9) ||
+                     !first->dag_representation || first->dag_representation->state != STATE_TRUE ||
+                     (first->build_action != NULL) != first->triggers_action;
+        }
+        for (int m = 1; m < MODELS && result == 0; m++) {
+            IntentResolution* other = sets[m][i];
+            result = other->stage != first->stage || other->noun != first->noun ||
+                     (first->build_action
+                          ? !other->build_action || strcmp(first->build_action, other->build_action)
+                          : other->build_action != NULL);
+        }
+    }
+    if (result == 0) {
+        char** actions = NULL;
+        size_t count = generate_build_actions(sets[2], COUNT, &actions);
+        result = count == 0 || !actions || strcmp(actions[0], "build_target_b1") != 0;
+        for (size_t i = 0; i < count; i++) {
+            free(actions[i]);
+        }
+        free(actions);
+    }
+    
+    for (int m = 0; m < MODELS; m++) {
+        for (size_t i = 0; sets[m] && i < COUNT && sets[m][i]; i++) {
+            dag_node_free(sets[m][i]->dag_representation);
+            free_intent_resolution(sets[m][i]);
+        }
+        free(sets[m]);
+    }
+    return result;
+}
+
+typedef struct TestTraceWorker {
+    pthread_t thread;
+    atomic_bool stop;
+    uint64_t amount;
+} TestTraceWorker;
+
+/**
+ * Count until told to stop, or once if amount is set
+ */
+static void* test_trace_worker_run(void* arg) {
+    TestTraceWorker* worker = (TestTraceWorker*)arg;
+    if (worker->amount) {
+        trace_count(TRACE_COUNTER_MATCHES, worker->amount);
+        return NULL;
+    }
+    while (!atomic_load(&worker->stop)) {
+        TraceSpan span = trace_span_begin("worker");
+        trace_count(TRACE_COUNTER_MATCHES, 1);
+        trace_span_end(&span);
+    }
+    return NULL;
+}
+
+static int test_trace(void) {
+    char dir[] = "/tmp/polybuild_traceXXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+    char path[256];
+    snprintf(path, sizeof(path), "%s/trace.json", dir);
+    
+    trace_start();
+    TraceSpan span = trace_span_begin("outer \"span\"");
+    trace_count(TRACE_COUNTER_MATCHES, 5);
+    trace_span_end(&span);
+    int result = !trace_active() || trace_span_count() != 1 ||
+                 trace_counter_total(TRACE_COUNTER_MATCHES) != 5;
+    
+#ifdef POLYBUILD_TRACE
+    // Instrumented library calls record their own spans and counters
+    DAGGraph* graph = test_random_graph(5000, 2, 3);
+    if (!graph || dag_graph_resolve_parallel(graph, 4) != 0 ||
+        trace_counter_total(TRACE_COUNTER_NODES_VISITED) != 5000 || trace_span_count() < 3) {
+        result = 1;
+    }
+    dag_graph_free_all(graph);
+#endif
+    
+    // Spans opened after stopping are not recorded
+    trace_stop();
+    size_t recorded = trace_span_count();
+    span = trace_span_begin("late");
+    trace_span_end(&span);
+    if (trace_span_count() != recorded || trace_export_chrome(path) != 0) {
+        result = 1;
+    }
+    
+    FILE* file = fopen(path, "r");
+    char* text = (char*)calloc(1, 1 << 20);
+    size_t len = file && text ? fread(text, 1, (1 << 20) - 1, file) : 0;
+    if (!file || len == 0 || !strstr(text, "\"traceEvents\":[") ||
+        !strstr(text, "{\"name\":\"outer \\\"span\\\"\",\"cat\":\"polybuild\",\"ph\":\"X\"") ||
+        !strstr(text, "\"matches\":5") || strstr(text, "late")) {
+        result = 1;
+    }
+    if (file) {
+        fclose(file);
+    }
+    free(text);
+    
+    // Starting again clears what was recorded
+    trace_start();
+    if (trace_span_count() != 0 || trace_counter_total(TRACE_COUNTER_MATCHES) != 0) {
+        result = 1;
+    }
+
+    // Restarting under a recording thread leaves it to clear its own ring
+    TestTraceWorker busy = { .amount = 0 };
+    atomic_init(&busy.stop, false);
+    if (pthread_create(&busy.thread, NULL, test_trace_worker_run, &busy) != 0) {
+        result = 1;
+    } else {
+        for (int i = 0; i < 200; i++) {
+            trace_start();
+        }
+        atomic_store(&busy.stop, true);
+        pthread_join(busy.thread, NULL);
+    }
+    trace_start();
+    TestTraceWorker once = { .amount = 7 };
+    atomic_init(&once.stop, false);
+    if (trace_counter_total(TRACE_COUNTER_MATCHES) != 0 || trace_span_count() != 0 ||
+        pthread_create(&once.thread, NULL, test_trace_worker_run, &once) != 0) {
+        result = 1;
+    } else {
+        pthread_join(once.thread, NULL);
+        result |= trace_counter_total(TRACE_COUNTER_MATCHES) != 7;
+    }
+    trace_stop();
+    
+    remove(path);
+    rmdir(dir);
+    return result;
+}
+
+static const char test_manifest_text[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<!-- generated -->\n"
+    "<pbd:definition xmlns:pbd=\"http://schema.obinexus.org/polybuild/definition/1.0\"\n"
+    "    xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" name=\"demo\" version=\"1.0.0\">\n"
+    "  <pbd:identity>\n"
+    "    <pbd:name>demo-core</pbd:name>\n"
+    "    <pbd:version>1.0.0</pbd:version>\n"
+    "    <pbd:stability>stable</pbd:stability>\n"
+    "    <pbd:guid>550e8400-e29b-41d4-a716-446655440000</pbd:guid>\n"
+    "  </pbd:identity>\n"
+    "  <pbd:topology type=\"star\">\n"
+    "    <pbd:fault-tolerance level=\"6\"/>\n"
+    "    <pbd:concurrency model=\"parallel\" />\n"
+    "    <pbd:binary-encoding>0101101</pbd:binary-encoding>\n"
+    "  </pbd:topology>\n"
+    "  <pbd:intents>\n"
+    "    <pbd:intent expression=\"compile source optimized\">\n"
+    "      <pbd:stage>doing</pbd:stage>\n"
+    "      <pbd:priority>85</pbd:priority>\n"
+    "    </pbd:intent>\n"
+    "    <pbd:intent expression=\"validate policy\"/>\n"
+    "  </pbd:intents>\n"
+    "  <pbd:dependencies>\n"
+    "    <pbd:dependency name=\"dag-core\" version=\"^1.0.0\" />\n"
+    "  </pbd:dependencies>\n"
+    "  <pbd:actions>\n"
+    "    <pbd:action name=\"link-app\">\n"
+    "      <pbd:command>cc main.o -o app &amp;&amp; echo &#x6f;k</pbd:command>\n"
+    "      <pbd:inputs><pbd:input path=\"main.o\"/></pbd:inputs>\n"
+    "      <pbd:outputs><pbd:output path=\"app\"/></pbd:outputs>\n"
+    "    </pbd:action>\n"
+    "    <pbd:action name=\"compile-main\">\n"
+    "      <pbd:command><![CDATA[cc -c main.c -o main.o]]></pbd:command>\n"
+    "      <pbd:inputs><pbd:input path=\"main.c\"/></pbd:inputs>\n"
+    "      <pbd:outputs><pbd:output path=\"main.o\"/></pbd:outputs>\n"
+    "    </pbd:action>\n"
+    "  </pbd:actions>\n"
+    "</pbd:definition>\n";
+
+/**
+ * Read a manifest through a window smaller than the document
+ */
+static int test_manifest_read(const char* text, ManifestGraph* builder, DAGGraph* graph,
+                              ManifestError* error) {
+    ManifestSink sink;
+    XmlReader* reader = xml_reader_create(text, strlen(text), 256);
+    if (!reader || manifest_graph_init(builder, graph, &sink) != 0) {
+        xml_reader_close(reader);
+        return -1;
+    }
+    int result = manifest_read(reader, &sink, error);
+    xml_reader_close(reader);
+    return result;
+}
+
+static int test_manifest(void) {
+    DAGGraph* graph = dag_graph_create(0);
+    ManifestGraph builder;
+    ManifestError error;
+    if (!graph || test_manifest_read(test_manifest_text, &builder, graph, &error) != 0 ||
+        manifest_graph_finish(&builder) != 0 || dag_graph_resolve(graph) != 0) {
+        return 1;
+    }
+    
+    // Nodes in document order: two intents, a dependency, two actions,
+    // then the hub of the compile intent, whose binding names no action
+    int result = 0;
+    if (graph->node_count != 6 || builder.intent_count != 2 || !builder.has_topology ||
+        builder.topology.type != MANIFEST_TOPOLOGY_STAR || builder.topology.fault_tolerance != 6 ||
+        builder.topology.concurrency != MANIFEST_CONCURRENCY_PARALLEL ||
+        builder.topology.decoding.concurrency_model != 1 || builder.topology.decoding.encoding != 90 ||
+        builder.intents[0]->verb != INTENT_VERB_COMPILE ||
+        builder.intents[0]->stage != INTENT_STAGE_DOING || builder.intents[0]->priority != 85 ||
+        strcmp(builder.intents[0]->binding_value, "optimized") != 0 ||
+        builder.intents[1]->binding_value != NULL ||
+        graph->nodes[2]->category != TAX_RESOURCE ||
+        strcmp(builder.actions[3].command, "cc main.o -o app && echo ok") != 0 ||
+        strcmp(builder.actions[4].command, "cc -c main.c -o main.o") != 0 ||
+        builder.actions[3].input_count != 1 || strcmp(builder.actions[3].inputs[0], "main.o") != 0) {
+        result = 1;
+    }
+    
+    // compile-main feeds link-app, and the compile intent precedes
+    // compile-main through the compile hub
+    if (graph->nodes[3]->in_count != 1 || graph->nodes[3]->in_edges[0].target != graph->nodes[4] ||
+        graph->nodes[4]->in_count != 1 || graph->nodes[4]->in_edges[0].target != graph->nodes[5] ||
+        graph->nodes[5]->in_count != 1 || graph->nodes[5]->in_edges[0].target != graph->nodes[0] ||
+        strcmp(builder.actions[5].name, "compile") != 0 || builder.actions[5].command ||
+        graph->topo_rank[4] > graph->topo_rank[3]) {
+        result = 1;
+    }
+    manifest_graph_free(&builder);
+    dag_graph_free_all(graph);
+    
+    // The workflow entry point reads the same manifest from a file
+    char path[] = "/tmp/polybuild_manifestXXXXXX";
+    int fd = mkstemp(path);
+    DAGNode** nodes = NULL;
+    size_t node_count = 0;
+    if (fd < 0 || write(fd, test_manifest_text, strlen(test_manifest_text)) < 0 ||
+        execute_intent_workflow(path, &nodes, &node_count, NULL) != 0 || node_count != 6 ||
+        nodes[3]->state != STATE_TRUE) {
+        result = 1;
+    }
+    for (size_t i = 0; i < node_count; i++) {
+        dag_node_free(nodes[i]);
+    }
+    free(nodes);
+    if (fd >= 0) {
+        close(fd);
+        remove(path);
+    }
+    
+    // Workflow failures come back to the caller instead of being printed
+    nodes = NULL;
+    if (execute_intent_workflow("/nonexistent/polybuild.xml", &nodes, &node_count, &error) == 0 ||
+        nodes != NULL || strcmp(error.message, "cannot open manifest") != 0) {
+        result = 1;
+    }
+    
+    // Bound intents link to their own action and the rest share a hub,
+    // so edges grow linearly with generated manifests
+    size_t generated = 3000;
+    const char* tail = strstr(test_manifest_text, "  <pbd:intents>");
+    size_t head_len = (size_t)(tail - test_manifest_text);
+    size_t text_len = head_len + generated * 200 + 256;
+    char* text = (char*)malloc(text_len);
+    if (!text) {
+        return 1;
+    }
+    size_t used = (size_t)snprintf(text, text_len, "%.*s  <pbd:intents>\n"
+                                   "    <pbd:intent expression=\"compile source\"/>\n",
+                                   (int)head_len, test_manifest_text);
+    for (size_t i = 0; i < generated; i++) {
+        used += (size_t)snprintf(text + used, text_len - used,
+                                 "    <pbd:intent expression=\"compile source m%zu\"/>\n", i);
+    }
+    used += (size_t)snprintf(text + used, text_len - used, "  </pbd:intents>\n  <pbd:actions>\n");
+    for (size_t i = 0; i < generated; i++) {
+        used += (size_t)snprintf(text + used, text_len - used,
+                                 "    <pbd:action name=\"compile-m%zu\">"
+                                 "<pbd:command>cc -c m%zu.c</pbd:command></pbd:action>\n", i, i);
+    }
+    snprintf(text + used, text_len - used, "  </pbd:actions>\n</pbd:definition>\n");
+
+    graph = dag_graph_create(0);
+    if (!graph || test_manifest_read(text, &builder, graph, &error) != 0 ||
+        manifest_graph_finish(&builder) != 0 || dag_graph_resolve(graph) != 0 ||
+        graph->node_count != 2 * generated + 2 || graph->edge_count != 2 * generated + 1) {
+        result = 1;
+    }
+    for (size_t i = 0; i < generated && result == 0; i++) {
+        DAGNode* action = graph->nodes[generated + 1 + i];
+        if (action->in_count != 2 || action->in_edges[0].target != graph->nodes[2 * generated + 1] ||
+            action->in_edges[1].target != graph->nodes[1 + i]) {
+            result = 1;
+        }
+    }
+    manifest_graph_free(&builder);
+    dag_graph_free_all(graph);
+    free(text);
+    
+    // Schema violations are reported with their line
+    static const struct {
+        const char* find;
+        const char* replace;
+        size_t line;
+    } broken[] = {
+        { "stable</", "solid</", 8 },
+        { "0101101", "0101102", 14 },
+        { "level=\"6\"", "level=\"13\"", 12 },
+        { "compile source", "compile sources", 17 },
+        { "<pbd:stage>doing</pbd:stage>", "<pbd:stage>doing</pbd:stages>", 18 },
+        { "<pbd:priority>85</pbd:priority>", "<pbd:priority>-1</pbd:priority>", 19 },
+        { "<pbd:version>1.0.0</pbd:version>\n    <pbd:stability>stable</pbd:stability>",
+          "<pbd:stability>stable</pbd:stability>\n    <pbd:version>1.0.0</pbd:version>", 8 },
+        { "<pbd:command>cc main", "<pbd:cmd>cc main", 28 },
+        { "name=\"link-app\"", "title=\"link-app\"", 27 },
+        { "  <pbd:topology type",
+          "  <pbd:intents><pbd:intent expression=\"validate policy\"/></pbd:intents>\n"
+          "  <pbd:topology type", 11 }
+    };
+    for (size_t i = 0; i < sizeof(broken) / sizeof(broken[0]); i++) {
+        char text[sizeof(test_manifest_text) + 128];
+        const char* at = strstr(test_manifest_text, broken[i].find);
+        if (!at) {
+            return 1;
+        }
+        snprintf(text, sizeof(text), "%.*s%s%s", (int)(at - test_manifest_text), test_manifest_text,
+                 broken[i].replace, at + strlen(broken[i].find));
+        
+        graph = dag_graph_create(0);
+        if (!graph || test_manifest_read(text, &builder, graph, &error) == 0 ||
+            error.line != broken[i].line) {
+            printf("Manifest case %zu: line %zu: %s\n", i, error.line, error.message);
+            result = 1;
+        }
+        manifest_graph_free(&builder);
+        dag_graph_free_all(graph);
+    }
+    return result;
+}
+
+/**
+ * Two writers of one target get their own temporaries; only a committed
+ * write replaces the target and neither leaves a temporary behind
+ */
+static int test_atomic_file(void) {
+    char path[] = "/tmp/polybuild_atomicXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+
+    AtomicFile first;
+    AtomicFile second;
+    if (atomic_file_open(&first, path, 0666) != 0) {
+        remove(path);
+        return 1;
+    }
+    if (atomic_file_open(&second, path, 0666) != 0) {
+        atomic_file_close(&first, false);
+        remove(path);
+        return 1;
+    }
+
+    int result = strcmp(first.temp, second.temp) == 0;
+    char* second_temp = strdup(second.temp);
+    FILE* stream = atomic_file_stream(&first);
+    result |= !stream || fputs("kept", stream) == EOF;
+    result |= write(second.fd, "dropped", 7) != 7;
+    result |= atomic_file_close(&second, false) != -1;
+    result |= atomic_file_close(&first, true) != 0;
+
+    char text[16] = { 0 };
+    FILE* file = fopen(path, "r");
+    result |= !file || fread(text, 1, sizeof(text) - 1, file) != 4 || strcmp(text, "kept") != 0;
+    if (file) {
+        fclose(file);
+    }
+    result |= !second_temp || access(second_temp, F_OK) == 0;
+
+    free(second_temp);
+    remove(path);
+    return result;
+}
+
+/**
+ * A graph written to an image must read back identically, in place and
+ * as a rebuilt graph
+ */
+static int test_dag_image(void) {
+    char path[] = "/tmp/polybuild_imageXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 1;
+    }
+    close(fd);
+    
+    DAGGraph* graph = test_random_graph(2000, 3, 11);
+    if (!graph || dag_graph_resolve(graph) != 0) {
+        return 1;
+    }
+    const char* names[2000] = { "compile", "link", NULL, "" };
+    
+    int result = 0;
+    DAGImage* image = NULL;
+    if (dag_image_write(graph, names, path) != 0 || !(image = dag_image_open(path)) ||
+        !dag_image_verify(image) || !dag_image_resolved(image) ||
+        dag_image_node_count(image) != graph->node_count ||
+        dag_image_edge_count(image) != graph->edge_count ||
+        strcmp(dag_image_node_name(image, 1), "link") != 0 ||
+        strcmp(dag_image_node_name(image, 2), "") != 0 ||
+        strcmp(dag_image_category_name(image, TAX_RESOURCE), "resource") != 0) {
+        result = 1;
+    }
+    
+    for (size_t i = 0; image && result == 0 && i < graph->node_count; i++) {
+        const float* weights;
+        size_t count;
+        const uint32_t* sources = dag_image_in_edges(image, i, &weights, &count);
+        uint32_t begin = graph->in_offsets[i];
+        if (dag_image_node_state(image, i) != (NodeState)graph->states[i] ||
+            dag_image_node_rank(image, i) != graph->topo_rank[i] ||
+            dag_image_node_category(image, i) != graph->nodes[i]->category ||
+            count != graph->in_offsets[i + 1] - begin ||
+            (count > 0 && (memcmp(sources, &graph->in_sources[begin], count * sizeof(uint32_t)) != 0 ||
+                           memcmp(weights, &graph->in_weights[begin], count * sizeof(float)) != 0))) {
+            result = 1;
+        }
+    }
+    
+    size_t actions = 0;
+    const uint32_t* listed = dag_image_category_nodes(image, TAX_ACTION, &actions);
+    if (!listed || actions != 400 || listed[0] != 1 || listed[1] != 6) {
+        result = 1;
+    }
+    
+    // Rebuilding the graph from the image resolves to the same states
+    DAGGraph* copy = dag_image_to_graph(image, NULL);
+    if (!copy || dag_graph_resolve(copy) != 0 || copy->edge_count != graph->edge_count) {
+        result = 1;
+    }
+    for (size_t i = 0; copy && result == 0 && i < graph->node_count; i++) {
+        if (copy->states[i] != graph->states[i]) {
+            result = 1;
+        }
+    }
+    dag_graph_free_all(copy);
+    dag_image_close(image);
+    
+    // Truncated or foreign files are rejected
+    if (truncate(path, 64) != 0 || dag_image_open(path) ||
+        test_write_file("/tmp", path + 5, "not an image") != 0 || dag_image_open(path)) {
+        result = 1;
+    }
+    
+    remove(path);
+    dag_graph_free_all(graph);
+    return result;
+}
+
+static int test_file_index(void) {
+    char dir[] = "/tmp/polybuild_indexXXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+    
+    char index_path[256], paths[3][256];
+    const char* names[] = { "b.txt", "a.txt", "c.txt" };
+    snprintf(index_path, sizeof(index_path), "%s/index", dir);
+    for (size_t i = 0; i < 3; i++) {
+        snprintf(paths[i], sizeof(paths[i]), "%s/%s", dir, names[i]);
+        if (test_write_file(dir, names[i], names[i]) != 0) {
+            return 1;
+        }
+    }
+    
+    // First run: everything is new and hashed once
+    int result = 0;
+    uint8_t digest[SHA256_DIGEST_SIZE];
+    uint8_t expected[SHA256_DIGEST_SIZE];
+    bool changed = false;
+    FileIndex* index = file_index_open(index_path);
+    for (size_t i = 0; index && i < 3; i++) {
+        sha256_digest(names[i], strlen(names[i]), expected);
+        if (file_index_check(index, paths[i], digest, &changed) != 0 || !changed ||
+            memcmp(digest, expected, sizeof(digest)) != 0 ||
+            file_index_check(index, paths[i], digest, &changed) != 0 || changed) {
+            result = 1;
+        }
+    }
+    if (!index || file_index_rehash_count(index) != 3 || file_index_count(index) != 3 ||
+        file_index_save(index) != 0) {
+        result = 1;
+    }
+    file_index_close(index);
+    
+    // Reopened: unchanged files are a stat each, a modified one is rehashed
+    index = file_index_open(index_path);
+    if (!index || file_index_count(index) != 3 ||
+        file_index_check(index, paths[0], digest, &changed) != 0 || changed ||
+        file_index_rehash_count(index) != 0 ||
+        test_write_file(dir, names[1], "modified") != 0 ||
+        file_index_check(index, paths[1], digest, &changed) != 0 || !changed ||
+        file_index_rehash_count(index) != 1) {
+        result = 1;
+    }
+    
+    // A vanished file is dropped from the saved index
+    remove(paths[2]);
+    if (file_index_check(index, paths[2], digest, &changed) != -1 ||
+        file_index_count(index) != 2 || file_index_save(index) != 0 ||
+        file_index_count(index) != 2 ||
+        file_index_check(index, paths[1], digest, &changed) != 0 || changed) {
+        result = 1;
+    }
+    sha256_digest("modified", strlen("modified"), expected);
+    if (memcmp(digest, expected, sizeof(digest)) != 0) {
+        result = 1;
+    }
+    
+    // Action keys do not depend on whether digests come from the index
+    const char* inputs[] = { paths[0], paths[1] };
+    BuildAction action = { "copy", "cat a b", inputs, 2, NULL, 0 };
+    DAGActionKey direct, indexed;
+    if (dag_action_cache_key(&action, NULL, 0, NULL, &direct) != 0 ||
+        dag_action_cache_key(&action, NULL, 0, index, &indexed) != 0 ||
+        memcmp(direct.bytes, indexed.bytes, sizeof(direct.bytes)) != 0) {
+        result = 1;
+    }
+    file_index_close(index);
+    
+    // The merged file keeps the untouched and the updated record only
+    index = file_index_open(index_path);
+    if (!index || file_index_count(index) != 2 ||
+        file_index_check(index, paths[0], digest, &changed) != 0 || changed ||
+        file_index_check(index, paths[1], digest, &changed) != 0 || changed ||
+        file_index_rehash_count(index) != 0) {
+        result = 1;
+    }
+    file_index_close(index);
+    
+    // Anything that is not an index reads as an empty one
+    if (test_write_file(dir, "index", "garbage") != 0) {
+        result = 1;
+    }
+    index = file_index_open(index_path);
+    if (!index || file_index_count(index) != 0) {
+        result = 1;
+    }
+    file_index_close(index);
+    
+    char command[512];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    if (system(command) != 0) {
+        result = 1;
+    }
+    return result;
+}
+
+static int test_action_cache(void) {
+    char dir[] = "/tmp/polybuild_cacheXXXXXX";
+    if (!mkdtemp(dir)) {
+        return 1;
+    }
+    
+    char store[256], input[256], output[256], final[256], runs[256];
+    char compile[2048], link[2048];
+    snprintf(store, sizeof(store), "%s/store", dir);
+    snprintf(input, sizeof(input), "%s/in.txt", dir);
+    snprintf(output, sizeof(output), "%s/out.txt", dir);
+    snprintf(final, sizeof(final), "%s/final.txt", dir);
+    snprintf(runs, sizeof(runs), "%s/runs", dir);
+    snprintf(compile, sizeof(compile), "cp %s %s && echo c >> %s", input, output, runs);
+    snprintf(link, sizeof(link), "cat %s %s > %s && echo l >> %s", output, output, final, runs);
+    
+    DAGActionCache* cache = dag_action_cache_open(store);
+    DAGGraph* graph = dag_graph_create(2);
+    DAGNode* first = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+    DAGNode* second = dag_node_create(TOKEN_IDENTIFIER, TAX_ACTION);
+    if (!cache || !graph || dag_graph_add_node(graph, first) != 0 ||
+        dag_graph_add_node(graph, second) != 0 ||
+        test_write_file(dir, "in.txt", "hello\n") != 0) {
+        return 1;
+    }
+    dag_add_edge(first, second, 1.0f);
+    
+    const char* compile_in[] = { input };
+    const char* compile_out[] = { output };
+    const char* link_out[] = { final };
+    BuildAction actions[2] = {
+        { "compile", compile, compile_in, 1, compile_out, 1 },
+        { "link", link, NULL, 0, link_out, 1 }
+    };
+    DAGExecOptions options = { 1, false, NULL, NULL, NULL, NULL, false, NULL, cache, NULL };
+    DAGExecOutcome outcomes[2];
+    
+    int result = 0;
+    if (dag_graph_execute(graph, actions, &options, outcomes) != 0 ||
+        outcomes[0] != DAG_EXEC_SUCCEEDED || outcomes[1] != DAG_EXEC_SUCCEEDED) {
+        result = 1;
+    }
+    
+    // Same inputs: outputs come back from the cache without running
+    remove(output);
+    remove(final);
+    if (dag_graph_execute(graph, actions, &options, outcomes) != 0 ||
+        outcomes[0] != DAG_EXEC_CACHED || outcomes[1] != DAG_EXEC_CACHED ||
+        second->state != STATE_TRUE) {
+        result = 1;
+    }
+    FILE* file = fopen(final, "r");
+    char text[64] = {0};
+    if (!file || !fgets(text, sizeof(text), file) || strcmp(text, "hello\n") != 0) {
+        result = 1;
+    }
+    if (file) {
+        fclose(file);
+    }
+    
+    // A changed input invalidates its action and everything downstream
+    if (test_write_file(dir, "in.txt", "changed\n") != 0 ||
+        dag_graph_execute(graph, actions, &options, outcomes) != 0 ||
+        outcomes[0] != DAG_EXEC_SUCCEEDED || outcomes[1] != DAG_EXEC_SUCCEEDED) {
+        result = 1;
+    }
+    
+    size_t run_count = 0;
+    file = fopen(runs, "r");
+    while (file && fgets(text, sizeof(text), file)) {
+        run_count++;
+    }
+    if (!file || run_count != 4) {
+        result = 1;
+    }
+    if (file) {
+        fclose(file);
+    }
+    
+    // A staging directory left by a crashed store does not block the key
+    const char* stale_out[] = { output };
+    BuildAction stale_action = { "stale", "true", compile_in, 1, stale_out, 1 };
+    DAGActionKey stale_key;
+    char hex[2 * SHA256_DIGEST_SIZE + 1];
+    char stale[512];
+    if (dag_action_cache_key(&stale_action, NULL, 0, NULL, &stale_key) != 0) {
+        result = 1;
+    } else {
+        sha256_to_hex(stale_key.bytes, hex);
+        snprintf(stale, sizeof(stale), "%s/%s.tmp.%ld", store, hex, (long)getpid());
+        remove(output);
+        if (mkdir(stale, 0755) != 0 || test_write_file(dir, "out.txt", "staged\n") != 0 ||
+            dag_action_cache_store(cache, &stale_key, &stale_action) != 0 ||
+            remove(output) != 0 ||
+            !dag_action_cache_restore(cache, &stale_key, &stale_action) ||
+            access(output, F_OK) != 0) {
+            result = 1;
+        }
+    }
+
+    dag_graph_free_all(graph);
+    dag_action_cache_close(cache);
+    char command[512];
+    snprintf(command, sizeof(command), "rm -rf %s", dir);
+    if (system(command) != 0) {
+        result = 1;
+    }
+    return result;
+}
+
+static int test_scanner(void) {
+    TrieNode* root = trie_node_create("root", TAX_UNKNOWN, 1.0f);
+    if (!root) {
+        return 1;
+    }
+    trie_insert(root, "he", TAX_ACTION, 1.0f);
+    trie_insert(root, "she", TAX_ACTION, 1.0f);
+    trie_insert(root, "his", TAX_ACTION, 1.0f);
+    trie_insert(root, "hers", TAX_RESOURCE, 1.0f);
+    trie_insert(root, "[0-9]+", TAX_PROPERTY, 1.0f);
+    
+    TrieScanner* scanner = trie_scanner_create(root);
+    if (!scanner || trie_scanner_rule_count(scanner) != 5) {
+        return 1;
+    }
+    
+    TestScanLog log = { .count = 0 };
+    const char* text = "ushers 12 his 345";
+    long found = trie_scanner_scan(scanner, text, strlen(text), test_log_match, &log);
+    
+    int result = 0;
+    if (found != 6 || log.count != 6 ||
+        !test_has_match(&log, 1, 3, "she") || !test_has_match(&log, 2, 2, "he") ||
+        !test_has_match(&log, 2, 4, "hers") || !test_has_match(&log, 10, 3, "his") ||
+        !test_has_match(&log, 7, 2, "[0-9]+") || !test_has_match(&log, 14, 3, "[0-9]+")) {
+        result = 1;
+    }
+    
+    // Literal counts agree with a brute-force search over random text
+    // Terminated only because sanitizer regexec interceptors read to the NUL
+    char haystack[4097];
+    size_t haystack_len = sizeof(haystack) - 1;
+    unsigned int seed = 5;
+    for (size_t i = 0; i < haystack_len; i++) {
+        haystack[i] = "ehirsu"[test_random(&seed) % 6];
+    }
+    haystack[haystack_len] = '\0';
+    size_t expected = 0;
+    const char* literals[] = {"he", "she", "his", "hers"};
+    for (size_t i = 0; i < haystack_len; i++) {
+        for (size_t k = 0; k < 4; k++) {
+            size_t n = strlen(literals[k]);
+            if (i + n <= haystack_len && memcmp(haystack + i, literals[k], n) == 0) {
+                expected++;
+            }
+        }
+    }
+    log.count = 0;
+    if (trie_scanner_scan(scanner, haystack, haystack_len, test_log_match, &log) !=
+        (long)expected) {
+        result = 1;
+    }
+    
+    trie_scanner_free(scanner);
+    trie_free(root);
+    return result;
+}
+
 int main() {
     printf("PolyBuild Test Suite\n");
     
@@ -45,9 +2236,227 @@ int main() {
     DAGNode* nodes[] = {node1, node2};
     
     // Resolve
-    dag_resolve(nodes, 2);
+    if (dag_resolve(nodes, 2) != 0 ||
+        node1->state != STATE_TRUE || node2->state != STATE_TRUE) {
+        printf("Failed to resolve DAG\n");
+        return 1;
+    }
     
     printf("DAG resolution successful\n");
+    
+    // An inhibiting edge outweighs a supporting one
+    DAGNode* node3 = dag_node_create(TOKEN_IDENTIFIER, TAX_PROPERTY);
+    DAGNode* node4 = dag_node_create(TOKEN_IDENTIFIER, TAX_CONTROLLER);
+    if (!node3 || !node4) {
+        printf("Failed to create DAG nodes\n");
+        return 1;
+    }
+    dag_add_edge(node2, node3, -2.0f);
+    dag_add_edge(node1, node3, 1.0f);
+    dag_add_edge(node3, node4, 1.0f);
+    
+    // Out-of-order array must still resolve sources first
+    DAGNode* chain[] = {node4, node3, node2, node1};
+    if (dag_resolve(chain, 4) != 0 ||
+        node3->state != STATE_FALSE || node4->state != STATE_FALSE) {
+        printf("Failed to resolve weighted chain\n");
+        return 1;
+    }
+    
+    // Cycles are reported instead of recursing forever
+    dag_add_edge(node4, node2, 1.0f);
+    if (dag_resolve(chain, 4) != -1 || node1->state != STATE_TRUE ||
+        node2->state != STATE_UNKNOWN) {
+        printf("Failed to detect DAG cycle\n");
+        return 1;
+    }
+    
+    printf("DAG cycle detection successful\n");
+    
+    if (test_dag_graph() != 0) {
+        printf("Failed to resolve CSR graph\n");
+        return 1;
+    }
+    
+    printf("DAG graph resolution successful\n");
+    
+    if (test_arena() != 0) {
+        printf("Failed to build graph in arena\n");
+        return 1;
+    }
+    
+    printf("Arena allocation successful\n");
+    
+    if (test_parallel_resolve() != 0) {
+        printf("Failed to resolve DAG in parallel\n");
+        return 1;
+    }
+    
+    printf("Parallel DAG resolution successful\n");
+    
+    if (test_vote_kernels() != 0) {
+        printf("Failed to agree across vote kernels\n");
+        return 1;
+    }
+    
+    printf("Vote kernels successful\n");
+    
+    if (test_concurrent_builder() != 0) {
+        printf("Failed to build DAG concurrently\n");
+        return 1;
+    }
+    
+    printf("Concurrent DAG builder successful\n");
+    
+    if (test_node_query() != 0) {
+        printf("Failed to query nodes by taxonomy\n");
+        return 1;
+    }
+    
+    printf("Node queries successful\n");
+    
+    if (test_incremental_resolve() != 0) {
+        printf("Failed to re-resolve DAG incrementally\n");
+        return 1;
+    }
+    
+    printf("Incremental DAG resolution successful\n");
+    
+    if (test_compressed_trie() != 0) {
+        printf("Failed to build compressed trie\n");
+        return 1;
+    }
+    
+    printf("Compressed trie successful\n");
+    
+    if (test_span_match() != 0) {
+        printf("Failed to match pattern spans\n");
+        return 1;
+    }
+    
+    printf("Span matching successful\n");
+    
+    if (test_scanner() != 0) {
+        printf("Failed to scan with trie automaton\n");
+        return 1;
+    }
+    
+    printf("Trie scanner successful\n");
+    
+    if (test_match_sink() != 0) {
+        printf("Failed to stream trie matches\n");
+        return 1;
+    }
+    
+    printf("Match streaming successful\n");
+    
+    if (test_file_scan() != 0) {
+        printf("Failed to scan mapped files\n");
+        return 1;
+    }
+    
+    printf("File scanning successful\n");
+    
+    if (test_batch_scan() != 0) {
+        printf("Failed to scan inputs in parallel\n");
+        return 1;
+    }
+    
+    printf("Batch scanning successful\n");
+    
+    if (test_executor() != 0) {
+        printf("Failed to execute build actions\n");
+        return 1;
+    }
+    
+    printf("Action execution successful\n");
+    
+    if (test_exec_history() != 0) {
+        printf("Failed to schedule from duration history\n");
+        return 1;
+    }
+    
+    printf("Duration history successful\n");
+    
+    if (test_sha256() != 0) {
+        printf("Failed to compute SHA-256 digests\n");
+        return 1;
+    }
+    
+    if (test_intent_expression() != 0) {
+        printf("Failed to parse intent expressions\n");
+        return 1;
+    }
+    
+    printf("Intent expressions successful\n");
+    
+    if (test_topology_constraints() != 0) {
+        printf("Failed to decode topology constraints\n");
+        return 1;
+    }
+    
+    printf("Topology constraints successful\n");
+    
+    if (test_intent_processing() != 0) {
+        printf("Failed to process intents concurrently\n");
+        return 1;
+    }
+    
+    printf("Intent processing successful\n");
+    
+    if (test_trace() != 0) {
+        printf("Failed to record and export a trace\n");
+        return 1;
+    }
+    
+    printf("Tracing successful\n");
+    
+    if (test_manifest() != 0) {
+        printf("Failed to stream a manifest into a graph\n");
+        return 1;
+    }
+    
+    printf("Manifest reader successful\n");
+    
+    if (test_atomic_file() != 0) {
+        printf("Failed to replace a file atomically\n");
+        return 1;
+    }
+    
+    printf("Atomic file successful\n");
+    
+    if (test_dag_image() != 0) {
+        printf("Failed to round-trip a graph image\n");
+        return 1;
+    }
+    
+    printf("Graph image successful\n");
+    
+    if (test_file_index() != 0) {
+        printf("Failed to track file digests in the index\n");
+        return 1;
+    }
+    
+    printf("File index successful\n");
+    
+    if (test_action_cache() != 0) {
+        printf("Failed to reuse cached action outputs\n");
+        return 1;
+    }
+    
+    printf("Action cache successful\n");
+    
+    DAGNode** matches = create_dag_from_trie_matches(root, "build", 5);
+    if (!matches || !matches[0]) {
+        printf("Failed to create DAG from trie matches\n");
+        return 1;
+    }
+    trie_dag_free_matches(matches);
+    trie_free(root);
+    dag_node_free(node1);
+    dag_node_free(node2);
+    dag_node_free(node3);
+    dag_node_free(node4);
     printf("All tests passed!\n");
     
     return 0;